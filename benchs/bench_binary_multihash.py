@@ -0,0 +1,53 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import sys
+import time
+import numpy as np
+import faiss
+
+# Compares the search speed of IndexBinaryMultiHash with the hash tables
+# stored as maps (after add) and as flat tables (after compact).
+# The memory usage of the flat tables is measured on a fresh index,
+# because the memory freed by the maps is usually not returned to the OS.
+
+if __name__ == "__main__":
+    d = 256
+    nb = int(sys.argv[1]) if len(sys.argv) > 1 else 10 ** 6
+    nq = 10000
+    k = 10
+
+    rs = np.random.RandomState(123)
+    xb = rs.randint(256, size=(nb, d // 8)).astype('uint8')
+    # queries are near-duplicates of database vectors
+    src = rs.choice(nb, nq, replace=False)
+    xq = xb[src].copy()
+    flip = rs.randint(d // 8, size=(nq, 4))
+    for j in range(flip.shape[1]):
+        xq[np.arange(nq), flip[:, j]] ^= np.uint8(1 << j)
+
+    for nhash, b in (8, 16), (8, 24), (16, 16):
+        for nflip in 0, 1:
+            for mode in "maps", "flat":
+                m0 = faiss.get_mem_usage_kb()
+                index = faiss.IndexBinaryMultiHash(d, nhash, b)
+                index.nflip = nflip
+                t0 = time.time()
+                if mode == "maps":
+                    index.add(xb)
+                else:
+                    # compact by chunks to keep the peak memory low
+                    for i0 in range(0, nb, 10 ** 5):
+                        index.add(xb[i0:i0 + 10 ** 5])
+                        index.compact()
+                t1 = time.time()
+                mem = (faiss.get_mem_usage_kb() - m0) / 1024
+                D, I = index.search(xq, k)
+                t2 = time.time()
+                print(f"{nhash=:} {b=:} {nflip=:} {mode}: "
+                      f"build {t1 - t0:.2f} s mem {mem:.0f} MiB "
+                      f"QPS {nq / (t2 - t1):.0f} "
+                      f"1-recall {(I[:, 0] == src).mean():.3f}", flush=True)
+                del index
@@ -27,3 +27,27 @@ if __name__ == "__main__":
                     times.append(t1 - t0)
                 print(f'| {k=:} t={np.mean(times):.3f} s ± {np.std(times):.3f} ', flush=True, end="")
             print()
+
+        code_size = xb.shape[1]
+        if code_size % 8 != 0:
+            # the tiled kernels need codes of a multiple of 64 bits
+            continue
+
+        # IndexBinaryFlat with and without the tiled kernels
+        index = faiss.IndexBinaryFlat(code_size * 8)
+        index.add(xb)
+        index.query_batch_size = 1024
+        for use_heap in True, False:
+            index.use_heap = use_heap
+            for tiled in False, True:
+                index.use_tiled_kernel = tiled
+                print(f"flat {use_heap=:} {tiled=:}", end="\t")
+                for k in 1, 4, 16, 64, 256:
+                    times = []
+                    for _run in range(5):
+                        t0 = time.time()
+                        D, I = index.search(xq, k)
+                        t1 = time.time()
+                        times.append(t1 - t0)
+                    print(f'| {k=:} t={np.mean(times):.3f} s ± {np.std(times):.3f} ', flush=True, end="")
+                print()
@@ -62,7 +62,7 @@ def eval_recall(index, name, single_query=False):
 
 def eval_and_plot(
         name, rescale_norm=True, plot=True, single_query=False,
-        implem=None, num_threads=1):
+        implem=None, num_threads=1, two_blocks=True):
     index = faiss.index_factory(d, name)
     index_path = f"indices/{name}.faissindex"
 
@@ -85,8 +85,12 @@ def eval_and_plot(
         name += f"(single_query={single_query})"
     if num_threads > 1:
         name += f"(num_threads={num_threads})"
+    if not two_blocks:
+        name += "(two_blocks=False)"
 
     faiss.omp_set_num_threads(num_threads)
+    # only has an effect on AVX512 builds
+    faiss.cvar.pq4_qbs_accumulate_2_blocks = two_blocks
 
     data = []
     print(f"======{name}")
@@ -112,6 +116,11 @@ eval_and_plot(f"IVF{nlist},PQ{M}x4fs", num_threads=8)
 eval_and_plot(f"IVF{nlist},PQ{M}x4fs", single_query=True, implem=0, num_threads=8)
 eval_and_plot(f"IVF{nlist},PQ{M}x4fs", single_query=True, implem=14, num_threads=8)
 eval_and_plot(f"IVF{nlist},PQ{M}x4fs", single_query=True, implem=15, num_threads=8)
+# compare the 2-block (bbs=64) AVX512 qbs kernels with the 1-block ones
+eval_and_plot(f"IVF{nlist},PQ{M}x4fs", single_query=True, implem=14, num_threads=8,
+              two_blocks=False)
+eval_and_plot(f"IVF{nlist},PQ{M}x4fs", single_query=True, implem=15, num_threads=8,
+              two_blocks=False)
 
 plt.title("Indices on Bigann50M")
 plt.xlabel("1Recall@{}".format(k))
@@ -28,6 +28,7 @@ typedef enum FaissQuantizerType {
     QT_bf16,
     QT_8bit_direct_signed, ///< fast indexing of signed int8s ranging from [-128
                            ///< to 127]
+    QT_mixed, ///< 8, 4, 2 or 0 bits per component, allocated at training
 } FaissQuantizerType;
 
 // forward declaration
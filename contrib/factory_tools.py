@@ -143,6 +143,7 @@ def reverse_index_factory(index):
             faiss.ScalarQuantizer.QT_6bit: "6",
             faiss.ScalarQuantizer.QT_fp16: "fp16",
             faiss.ScalarQuantizer.QT_bf16: "bf16",
+            faiss.ScalarQuantizer.QT_mixed: "mixed",
         }
         return f"SQ{sqtypes[index.sq.qtype]}"
 
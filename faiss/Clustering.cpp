@@ -21,6 +21,7 @@
 
 #include <faiss/IndexFlat.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/io.h>
 #include <faiss/impl/kmeans1d.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/random.h>
@@ -604,6 +605,251 @@ void Clustering::train_encoded(
     }
 }
 
+/***************************************************************
+ * Mini-batch k-means
+ ***************************************************************/
+
+IOReaderBatchSource::IOReaderBatchSource(
+        IOReader* reader,
+        size_t d,
+        bool fvecs_format)
+        : reader(reader), d(d), fvecs_format(fvecs_format) {
+    if (auto vr = dynamic_cast<VectorIOReader*>(reader)) {
+        start_position = vr->rp;
+    } else if (auto fr = dynamic_cast<FileIOReader*>(reader)) {
+        start_position = ftell(fr->f);
+    }
+}
+
+bool IOReaderBatchSource::rewind() {
+    if (start_position < 0) {
+        return false;
+    }
+    if (auto vr = dynamic_cast<VectorIOReader*>(reader)) {
+        vr->rp = start_position;
+        return true;
+    } else if (auto fr = dynamic_cast<FileIOReader*>(reader)) {
+        return fseek(fr->f, start_position, SEEK_SET) == 0;
+    }
+    return false;
+}
+
+size_t IOReaderBatchSource::next_batch(size_t max_n, float* x) {
+    if (!fvecs_format) {
+        return (*reader)(x, sizeof(float) * d, max_n);
+    }
+    size_t i = 0;
+    for (; i < max_n; i++) {
+        int32_t di;
+        if ((*reader)(&di, sizeof(di), 1) != 1) {
+            break;
+        }
+        FAISS_THROW_IF_NOT_FMT(
+                di >= 0 && size_t(di) == d,
+                "vector of dimension %d in fvecs data, expected %zd",
+                di,
+                d);
+        size_t nread = (*reader)(x + i * d, sizeof(float), d);
+        FAISS_THROW_IF_NOT_FMT(
+                nread == d, "truncated fvecs data in %s", reader->name.c_str());
+    }
+    return i;
+}
+
+void Clustering::train_minibatch(ClusteringBatchSource& source, Index& index) {
+    FAISS_THROW_IF_NOT_FMT(
+            index.d == d,
+            "Index dimension %d not the same as data dimension %d",
+            int(index.d),
+            int(d));
+    FAISS_THROW_IF_NOT(minibatch_size > 0);
+    FAISS_THROW_IF_NOT_MSG(
+            centroids.empty() || centroids.size() == d * k,
+            "input centroids should be empty or of size k * d");
+
+    double t0 = getmillisecs();
+    const uint64_t actual_seed = get_actual_rng_seed(seed);
+    RandomGenerator rng(actual_seed);
+
+    // input centroids can be kept frozen
+    size_t k_frozen = frozen_centroids && !centroids.empty() ? k : 0;
+    FAISS_THROW_IF_NOT_MSG(
+            k_frozen < k, "cannot run mini-batch k-means on frozen centroids");
+
+    if (verbose) {
+        printf("Mini-batch clustering in %zdD to %zd clusters, "
+               "batches of %zd vectors, %d passes\n",
+               d,
+               k,
+               minibatch_size,
+               minibatch_npass);
+    }
+
+    std::vector<float> batch(minibatch_size * d);
+    std::vector<idx_t> assign(minibatch_size);
+    std::vector<float> dis(minibatch_size);
+    // (decayed) number of vectors assigned to each centroid
+    std::vector<float> counts(k);
+    // number of vectors assigned to each centroid during the current pass
+    std::vector<size_t> pass_counts(k);
+    bool index_ready = false;
+    double t_search_tot = 0;
+
+    for (int pass = 0; pass < minibatch_npass; pass++) {
+        if (pass > 0) {
+            if (!source.rewind()) {
+                if (verbose) {
+                    printf("  Batch source cannot be rewound, "
+                           "stopping after %d pass(es)\n",
+                           pass);
+                }
+                break;
+            }
+            // centroids that did not get any vector in the previous pass are
+            // re-seeded in this one
+            for (size_t c = k_frozen; c < k; c++) {
+                if (pass_counts[c] == 0) {
+                    counts[c] = 0;
+                }
+            }
+            std::fill(pass_counts.begin(), pass_counts.end(), 0);
+        }
+
+        for (;;) {
+            size_t n = source.next_batch(minibatch_size, batch.data());
+            if (n == 0) {
+                break;
+            }
+            FAISS_THROW_IF_NOT(n <= minibatch_size);
+            if (check_input_data_for_NaNs) {
+                for (size_t i = 0; i < n * d; i++) {
+                    FAISS_THROW_IF_NOT_MSG(
+                            std::isfinite(batch[i]),
+                            "input contains NaN's or Inf's");
+                }
+            }
+
+            if (centroids.empty()) {
+                FAISS_THROW_IF_NOT_FMT(
+                        n >= k,
+                        "Number of vectors in the first batch (%zd) should "
+                        "be at least as large as number of clusters (%zd)",
+                        n,
+                        k);
+                std::vector<int> perm(n);
+                rand_perm(perm.data(), n, actual_seed + 1);
+                centroids.resize(k * d);
+                for (size_t c = 0; c < k; c++) {
+                    memcpy(centroids.data() + c * d,
+                           batch.data() + perm[c] * d,
+                           sizeof(float) * d);
+                }
+                post_process_centroids();
+            }
+
+            if (!index_ready) {
+                if (index.ntotal != 0) {
+                    index.reset();
+                }
+                if (!index.is_trained) {
+                    index.train(k, centroids.data());
+                }
+                index.add(k, centroids.data());
+                index_ready = true;
+            }
+
+            double t0s = getmillisecs();
+            index.search(n, batch.data(), 1, dis.data(), assign.data());
+            InterruptCallback::check();
+            t_search_tot += getmillisecs() - t0s;
+
+            float obj = 0;
+            for (size_t i = 0; i < n; i++) {
+                obj += dis[i];
+            }
+
+            if (minibatch_count_decay != 1) {
+                for (size_t c = 0; c < k; c++) {
+                    counts[c] *= minibatch_count_decay;
+                }
+            }
+
+            // update the centroids with the batch vectors in order, each
+            // thread is taking care of a range of centroids
+#pragma omp parallel
+            {
+                int nt = omp_get_num_threads();
+                int rank = omp_get_thread_num();
+                size_t c0 = k_frozen + ((k - k_frozen) * rank) / nt;
+                size_t c1 = k_frozen + ((k - k_frozen) * (rank + 1)) / nt;
+
+                for (size_t i = 0; i < n; i++) {
+                    idx_t ci = assign[i];
+                    if (ci < (idx_t)c0 || ci >= (idx_t)c1) {
+                        continue;
+                    }
+                    counts[ci] += 1;
+                    pass_counts[ci]++;
+                    float eta = 1 / counts[ci];
+                    float* c = centroids.data() + ci * d;
+                    const float* xi = batch.data() + i * d;
+                    for (size_t j = 0; j < d; j++) {
+                        c[j] += eta * (xi[j] - c[j]);
+                    }
+                }
+            }
+
+            // handle empty clusters: the centroids that never got any vector
+            // are moved to random vectors of the batch
+            int nsplit = 0;
+            for (size_t c = k_frozen; c < k; c++) {
+                if (counts[c] == 0) {
+                    size_t i = rng.rand_int64() % n;
+                    memcpy(centroids.data() + c * d,
+                           batch.data() + i * d,
+                           sizeof(float) * d);
+                    nsplit++;
+                }
+            }
+
+            post_process_centroids();
+
+            index.reset();
+            if (update_index) {
+                index.train(k, centroids.data());
+            }
+            index.add(k, centroids.data());
+            InterruptCallback::check();
+
+            ClusteringIterationStats stats = {
+                    obj,
+                    (getmillisecs() - t0) / 1000.0,
+                    t_search_tot / 1000,
+                    imbalance_factor(n, k, assign.data()),
+                    nsplit};
+            iteration_stats.push_back(stats);
+
+            if (verbose) {
+                printf("  Pass %d batch %zd (%.2f s, search %.2f s): "
+                       "objective=%g imbalance=%.3f nsplit=%d       \r",
+                       pass,
+                       iteration_stats.size(),
+                       stats.time,
+                       stats.time_search,
+                       stats.obj,
+                       stats.imbalance_factor,
+                       nsplit);
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (verbose) {
+        printf("\n");
+    }
+    FAISS_THROW_IF_NOT_MSG(index_ready, "no training vectors in source");
+}
+
 Clustering1D::Clustering1D(int k) : Clustering(1, k) {}
 
 Clustering1D::Clustering1D(int k, const ClusteringParameters& cp)
@@ -69,6 +69,17 @@ struct ClusteringParameters {
     /// Only used when init_method = AFK_MC2.
     /// Longer chains give better approximation but are slower.
     uint16_t afkmc2_chain_length = 50;
+
+    /// mini-batch k-means (Clustering::train_minibatch): max number of
+    /// vectors per batch
+    size_t minibatch_size = 65536;
+    /// mini-batch k-means: number of passes over the data. Passes after the
+    /// first one are done only if the batch source can be rewound.
+    int minibatch_npass = 1;
+    /// mini-batch k-means: the per-centroid counts are multiplied by this
+    /// factor after each batch. The learning rate of a centroid is the
+    /// inverse of its count, so values < 1 keep it from vanishing.
+    float minibatch_count_decay = 1.0;
 };
 
 struct ClusteringIterationStats {
@@ -79,6 +90,40 @@ struct ClusteringIterationStats {
     int nsplit;              ///< number of cluster splits
 };
 
+struct IOReader;
+
+/** Source of training vectors for Clustering::train_minibatch. */
+struct ClusteringBatchSource {
+    /** fill x (size max_n * d) with the next batch of vectors
+     * @return number of vectors in the batch, 0 at the end of the data */
+    virtual size_t next_batch(size_t max_n, float* x) = 0;
+
+    /// rewind to the beginning of the data, returns false if not supported
+    virtual bool rewind() {
+        return false;
+    }
+
+    virtual ~ClusteringBatchSource() {}
+};
+
+/** Batch source that reads float32 vectors from an IOReader, either raw
+ * (d floats per vector) or in .fvecs format (an int32 d before each
+ * vector). The reader is not owned. Rewinding to the position the reader
+ * had at construction is supported for VectorIOReader and FileIOReader. */
+struct IOReaderBatchSource : ClusteringBatchSource {
+    IOReader* reader;
+    size_t d;
+    bool fvecs_format;
+    /// position of the reader at construction, -1 if unknown
+    int64_t start_position = -1;
+
+    IOReaderBatchSource(IOReader* reader, size_t d, bool fvecs_format = false);
+
+    size_t next_batch(size_t max_n, float* x) override;
+
+    bool rewind() override;
+};
+
 /** K-means clustering based on assignment - centroid update iterations
  *
  * The clustering is based on an Index object that assigns training
@@ -134,6 +179,25 @@ struct Clustering : ClusteringParameters {
             Index& index,
             const float* weights = nullptr);
 
+    /** run mini-batch k-means on vectors read from source, for data that
+     * does not fit in RAM.
+     *
+     * Each batch (of at most minibatch_size vectors) is assigned with the
+     * index, then each centroid moves towards its assigned vectors with a
+     * learning rate that is the inverse of its count of assigned vectors
+     * (Sculley, "Web-scale k-means clustering", WWW'10). After each batch,
+     * the centroids that have not been assigned any vector yet are moved to
+     * random vectors of the batch. Centroids that did not get any vector
+     * during a pass are re-seeded this way during the next pass.
+     * If the centroids are empty on input, they are initialized with random
+     * vectors from the first batch, which must contain at least k vectors.
+     * One iteration_stats entry is added per batch.
+     *
+     * @param source     source of the training vectors
+     * @param index      index used for assignment
+     */
+    void train_minibatch(ClusteringBatchSource& source, Index& index);
+
     /// Post-process the centroids after each centroid update.
     /// includes optional L2 normalization and nearest integer rounding
     void post_process_centroids();
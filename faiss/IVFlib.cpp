@@ -287,6 +287,9 @@ void SlidingIndexWindow::step(const Index* sub_index, bool remove_oldest) {
     } else {
         FAISS_THROW_MSG("nothing to do???");
     }
+    for (int i = 0; i < nlist; i++) {
+        ils->recompute_id_summary(i);
+    }
     index->ntotal = index_ivf->ntotal;
 }
 
@@ -332,6 +335,8 @@ void set_invlist_range(
         ntotal += src->list_size(i - i0);
         std::swap(src->codes[i - i0], dst->codes[i]);
         std::swap(src->ids[i - i0], dst->ids[i]);
+        src->recompute_id_summary(i - i0);
+        dst->recompute_id_summary(i);
     }
     ivf->ntotal = index->ntotal = ntotal;
 }
@@ -41,6 +41,9 @@ void IndexBinaryFlat::search(
     const IDSelector* sel = params ? params->sel : nullptr;
     FAISS_THROW_IF_NOT(k > 0);
 
+    const bool tiled = use_tiled_kernel && code_size % 8 == 0 &&
+            approx_topk_mode == ApproxTopK_mode_t::EXACT_TOPK;
+
     const idx_t block_size = query_batch_size;
     for (idx_t s = 0; s < n; s += block_size) {
         idx_t nn = block_size;
@@ -53,14 +56,36 @@ void IndexBinaryFlat::search(
             int_maxheap_array_t res = {
                     size_t(nn), size_t(k), labels + s * k, distances + s * k};
 
-            hammings_knn_hc(
-                    &res,
+            if (tiled) {
+                hammings_knn_hc_tiled(
+                        &res,
+                        x + s * code_size,
+                        xb.data(),
+                        ntotal,
+                        code_size,
+                        /* ordered = */ true,
+                        sel);
+            } else {
+                hammings_knn_hc(
+                        &res,
+                        x + s * code_size,
+                        xb.data(),
+                        ntotal,
+                        code_size,
+                        /* ordered = */ true,
+                        approx_topk_mode,
+                        sel);
+            }
+        } else if (tiled) {
+            hammings_knn_mc_tiled(
                     x + s * code_size,
                     xb.data(),
+                    nn,
                     ntotal,
+                    k,
                     code_size,
-                    /* ordered = */ true,
-                    approx_topk_mode,
+                    distances + s * k,
+                    labels + s * k,
                     sel);
         } else {
             hammings_knn_mc(
@@ -31,6 +31,12 @@ struct IndexBinaryFlat : IndexBinary {
 
     size_t query_batch_size = 32;
 
+    /** Compute the distances by tiles of queries x database codes, see
+     * hammings_knn_hc_tiled. Used only for exact top-k and when the code
+     * size is a multiple of 8 bytes.
+     */
+    bool use_tiled_kernel = false;
+
     ApproxTopK_mode_t approx_topk_mode = ApproxTopK_mode_t::EXACT_TOPK;
 
     explicit IndexBinaryFlat(idx_t d);
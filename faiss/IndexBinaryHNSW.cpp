@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <memory>
 
 #include <cstdint>
@@ -25,6 +26,7 @@
 #include <faiss/impl/VisitedTable.h>
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/hamming.h>
+#include <faiss/utils/prefetch.h>
 #include <faiss/utils/random.h>
 
 #include <random>
@@ -164,6 +166,304 @@ void hnsw_add_vertices(
 
 } // anonymous namespace
 
+/**************************************************************
+ * Search specialized for binary codes
+ *
+ * Same algorithm as HNSW::search with a bounded queue, but the distances
+ * are computed directly as integers on the IndexBinaryFlat codes, for all
+ * the unvisited neighbors of a node at a time, after prefetching their
+ * codes. The candidate and result heaps store integer distances.
+ **************************************************************/
+
+namespace {
+
+using storage_idx_t = HNSW::storage_idx_t;
+
+/// same as HNSW::MinimaxHeap, with integer distances
+struct IntMinimaxHeap {
+    using HC = CMax<int32_t, storage_idx_t>;
+
+    int n;
+    int k = 0;
+    int nvalid = 0;
+    std::vector<storage_idx_t> ids;
+    std::vector<int32_t> dis;
+
+    explicit IntMinimaxHeap(int n) : n(n), ids(n), dis(n) {}
+
+    void push(storage_idx_t i, int32_t v) {
+        if (k == n) {
+            if (v >= dis[0]) {
+                return;
+            }
+            if (ids[0] != -1) {
+                --nvalid;
+            }
+            heap_pop<HC>(k--, dis.data(), ids.data());
+        }
+        heap_push<HC>(++k, dis.data(), ids.data(), v, i);
+        ++nvalid;
+    }
+
+    int size() const {
+        return nvalid;
+    }
+
+    /// pops the rightmost minimum, like HNSW::MinimaxHeap::pop_min
+    storage_idx_t pop_min(int32_t* vmin_out) {
+        if (nvalid == 0) {
+            return -1;
+        }
+        const storage_idx_t* ids_p = ids.data();
+        const int32_t* dis_p = dis.data();
+        const int nk = k;
+        // branchless loop that the compiler vectorizes: the distances are
+        // >= 0 and the popped entries (id -1) are mapped to UINT32_MAX
+        uint32_t vmin = std::numeric_limits<uint32_t>::max();
+        for (int i = 0; i < nk; i++) {
+            uint32_t v = uint32_t(dis_p[i]) | uint32_t(ids_p[i] >> 31);
+            vmin = std::min(vmin, v);
+        }
+        int imin = nk - 1;
+        while (ids_p[imin] == -1 || uint32_t(dis_p[imin]) != vmin) {
+            imin--;
+        }
+        *vmin_out = vmin;
+        storage_idx_t ret = ids[imin];
+        ids[imin] = -1;
+        --nvalid;
+        return ret;
+    }
+
+    int count_below(int32_t thresh) const {
+        const int32_t* dis_p = dis.data();
+        const int nk = k;
+        int n_below = 0;
+        for (int i = 0; i < nk; i++) {
+            n_below += dis_p[i] < thresh;
+        }
+        return n_below;
+    }
+};
+
+template <class HammingComputer>
+struct BinaryHNSWSearcher {
+    const HNSW& hnsw;
+    const uint8_t* codes;
+    const size_t code_size;
+    HammingComputer hc;
+
+    // unvisited neighbors of the current node and their distances
+    std::vector<storage_idx_t> nb_ids;
+    std::vector<int32_t> nb_dis;
+
+    HNSWStats stats;
+
+    BinaryHNSWSearcher(const HNSW& hnsw, const IndexBinaryFlat& storage)
+            : hnsw(hnsw),
+              codes(storage.xb.data()),
+              code_size(storage.code_size),
+              nb_ids(hnsw.nb_neighbors(0)),
+              nb_dis(hnsw.nb_neighbors(0)) {}
+
+    int32_t distance(storage_idx_t i) {
+        stats.ndis++;
+        return hc.hamming(codes + i * code_size);
+    }
+
+    /// computes the distances for nb_ids[0:n]
+    void compute_nb_distances(size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            prefetch_L2(codes + nb_ids[i] * code_size);
+        }
+        for (size_t i = 0; i < n; i++) {
+            nb_dis[i] = hc.hamming(codes + nb_ids[i] * code_size);
+        }
+        stats.ndis += n;
+    }
+
+    /// collects the neighbors of v at a level
+    size_t get_neighbors(storage_idx_t v, int level) {
+        size_t begin, end;
+        hnsw.neighbor_range(v, level, &begin, &end);
+        size_t n = 0;
+        for (size_t j = begin; j < end; j++) {
+            storage_idx_t v1 = hnsw.neighbors[j];
+            if (v1 < 0) {
+                break;
+            }
+            nb_ids[n++] = v1;
+        }
+        return n;
+    }
+
+    void greedy_update_nearest(
+            int level,
+            storage_idx_t& nearest,
+            int32_t& d_nearest) {
+        for (;;) {
+            storage_idx_t prev_nearest = nearest;
+            size_t n = get_neighbors(nearest, level);
+            compute_nb_distances(n);
+            for (size_t i = 0; i < n; i++) {
+                if (nb_dis[i] < d_nearest) {
+                    nearest = nb_ids[i];
+                    d_nearest = nb_dis[i];
+                }
+            }
+            stats.nhops++;
+            if (nearest == prev_nearest) {
+                return;
+            }
+        }
+    }
+
+    /// search for one query, the result heap is (simi, idxi) of size k
+    void search(
+            const uint8_t* q,
+            idx_t k,
+            int32_t* simi,
+            idx_t* idxi,
+            VisitedTable& vt,
+            int efSearch,
+            bool do_dis_check,
+            const IDSelector* sel) {
+        using RC = CMax<int32_t, idx_t>;
+        heap_heapify<RC>(k, simi, idxi);
+        if (hnsw.entry_point == -1) {
+            return;
+        }
+        hc.set(q, code_size);
+
+        // greedy search on upper levels
+        storage_idx_t nearest = hnsw.entry_point;
+        int32_t d_nearest = distance(nearest);
+        for (int level = hnsw.max_level; level >= 1; level--) {
+            greedy_update_nearest(level, nearest, d_nearest);
+        }
+
+        // search from candidates at level 0
+        IntMinimaxHeap candidates(std::max(efSearch, int(k)));
+        candidates.push(nearest, d_nearest);
+
+        auto add_to_results = [&](storage_idx_t v, int32_t d) {
+            if (d < simi[0] && (!sel || sel->is_member(v))) {
+                heap_replace_top<RC>(k, simi, idxi, d, v);
+            }
+        };
+
+        add_to_results(nearest, d_nearest);
+        vt.set(nearest);
+
+        int nstep = 0;
+        while (candidates.size() > 0) {
+            int32_t d0 = 0;
+            storage_idx_t v0 = candidates.pop_min(&d0);
+
+            if (do_dis_check) {
+                // stop when there are more than ef distances that are
+                // processed already that are smaller than d0
+                if (candidates.count_below(d0) >= efSearch) {
+                    break;
+                }
+            }
+
+            size_t begin, end;
+            hnsw.neighbor_range(v0, 0, &begin, &end);
+            for (size_t j = begin; j < end; j++) {
+                storage_idx_t v1 = hnsw.neighbors[j];
+                if (v1 < 0) {
+                    break;
+                }
+                vt.prefetch(v1);
+            }
+            size_t n = 0;
+            for (size_t j = begin; j < end; j++) {
+                storage_idx_t v1 = hnsw.neighbors[j];
+                if (v1 < 0) {
+                    break;
+                }
+                if (vt.set(v1)) {
+                    nb_ids[n++] = v1;
+                }
+            }
+
+            compute_nb_distances(n);
+            for (size_t i = 0; i < n; i++) {
+                add_to_results(nb_ids[i], nb_dis[i]);
+                candidates.push(nb_ids[i], nb_dis[i]);
+            }
+
+            nstep++;
+            if (!do_dis_check && nstep > efSearch) {
+                break;
+            }
+        }
+
+        stats.n1++;
+        if (candidates.size() == 0) {
+            stats.n2++;
+        }
+        stats.nhops += nstep;
+
+        vt.advance();
+        heap_reorder<RC>(k, simi, idxi);
+    }
+};
+
+struct RunBinaryHNSWSearch {
+    using T = void;
+
+    template <class HammingComputer>
+    void f(const IndexBinaryHNSW* index,
+           const IndexBinaryFlat* storage,
+           idx_t n,
+           const uint8_t* x,
+           idx_t k,
+           int32_t* distances,
+           idx_t* labels,
+           const SearchParameters* params) {
+        const HNSW& hnsw = index->hnsw;
+        int efSearch = hnsw.efSearch;
+        bool do_dis_check = hnsw.check_relative_distance;
+        const IDSelector* sel = nullptr;
+        if (params) {
+            if (auto hnsw_params =
+                        dynamic_cast<const SearchParametersHNSW*>(params)) {
+                efSearch = hnsw_params->efSearch;
+                do_dis_check = hnsw_params->check_relative_distance;
+            }
+            sel = params->sel;
+        }
+
+#pragma omp parallel
+        {
+            VisitedTable vt(index->ntotal);
+            BinaryHNSWSearcher<HammingComputer> searcher(hnsw, *storage);
+
+#pragma omp for
+            for (idx_t i = 0; i < n; i++) {
+                searcher.search(
+                        x + i * index->code_size,
+                        k,
+                        distances + i * k,
+                        labels + i * k,
+                        vt,
+                        efSearch,
+                        do_dis_check,
+                        sel);
+            }
+
+#pragma omp critical
+            {
+                hnsw_stats.combine(searcher.stats);
+            }
+        }
+    }
+};
+
+} // namespace
+
 /**************************************************************
  * IndexBinaryHNSW implementation
  **************************************************************/
@@ -215,6 +515,28 @@ void IndexBinaryHNSW::search(
                 params, "IndexBinaryHNSW params have incorrect type");
     }
 
+    bool bounded_queue = hnsw.search_bounded_queue;
+    if (params) {
+        bounded_queue = params->bounded_queue;
+    }
+    IndexBinaryFlat* flat_storage = dynamic_cast<IndexBinaryFlat*>(storage);
+    if (flat_storage && bounded_queue) {
+        // integer search specialized for the Hamming distance
+        RunBinaryHNSWSearch r;
+        dispatch_HammingComputer(
+                code_size,
+                r,
+                this,
+                flat_storage,
+                n,
+                x,
+                k,
+                distances,
+                labels,
+                params_in);
+        return;
+    }
+
     // we use the buffer for distances as float but convert them back
     // to int in the end
     float* distances_f = (float*)distances;
@@ -9,11 +9,14 @@
 
 #include <faiss/IndexBinaryHash.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdio>
-#include <unordered_set>
+#include <numeric>
 
 #include <faiss/utils/hamming.h>
+#include <faiss/utils/prefetch.h>
+#include <faiss/utils/sorting.h>
 #include <faiss/utils/utils.h>
 
 #include <faiss/impl/AuxIndexStructures.h>
@@ -308,9 +311,10 @@ IndexBinaryMultiHash::~IndexBinaryMultiHash() {
 void IndexBinaryMultiHash::reset() {
     storage->reset();
     ntotal = 0;
-    for (auto map : maps) {
+    for (auto& map : maps) {
         map.clear();
     }
+    flat_tables.clear();
 }
 
 void IndexBinaryMultiHash::add(idx_t n, const uint8_t* x) {
@@ -337,16 +341,33 @@ template <class HammingComputer, class SearchResults>
 static void verify_shortlist(
         const IndexBinaryFlat* index,
         const uint8_t* q,
-        const std::unordered_set<idx_t>& shortlist,
+        const std::vector<idx_t>& shortlist,
         SearchResults& res) {
     size_t code_size = index->code_size;
 
     HammingComputer hc(q, code_size);
     const uint8_t* codes = index->xb.data();
 
-    for (auto i : shortlist) {
-        int dis = hc.hamming(codes + i * code_size);
-        res.add(dis, i);
+    // the distances are computed in blocks, separately from the result
+    // updates, so that the codes can be prefetched and the popcounts
+    // of consecutive codes overlap
+    constexpr size_t bs = 64;
+    constexpr size_t prefetch_dist = 8;
+    int dis[bs];
+    size_t n = shortlist.size();
+    const idx_t* ids = shortlist.data();
+
+    for (size_t i0 = 0; i0 < n; i0 += bs) {
+        size_t i1 = std::min(n, i0 + bs);
+        for (size_t i = i0; i < i1; i++) {
+            if (i + prefetch_dist < n) {
+                prefetch_L2(codes + ids[i + prefetch_dist] * code_size);
+            }
+            dis[i - i0] = hc.hamming(codes + ids[i] * code_size);
+        }
+        for (size_t i = i0; i < i1; i++) {
+            res.add(dis[i - i0], ids[i]);
+        }
     }
 }
 
@@ -363,12 +384,14 @@ void search_1_query_multihash(
         const IndexBinaryMultiHash& index,
         const uint8_t* xi,
         SearchResults& res,
+        std::vector<idx_t>& shortlist,
         size_t& n0,
         size_t& nlist,
         size_t& ndis) {
-    std::unordered_set<idx_t> shortlist;
+    shortlist.clear();
     int b = index.b;
     uint64_t mask = ((uint64_t)1 << b) - 1;
+    bool has_flat = !index.flat_tables.empty();
 
     int ho = 0;
     for (int h = 0; h < index.nhash; h++) {
@@ -380,13 +403,21 @@ void search_1_query_multihash(
         // loop over neighbors that are at most at nflip bits
         do {
             uint64_t hash = qhash ^ fe.x;
-            auto it = map.find(hash);
-
-            if (it != map.end()) {
-                const std::vector<idx_t>& v = it->second;
-                for (auto i : v) {
-                    shortlist.insert(i);
+            bool found = false;
+            const idx_t *begin, *end;
+            if (has_flat && index.flat_tables[h].lookup(hash, begin, end)) {
+                shortlist.insert(shortlist.end(), begin, end);
+                found = true;
+            }
+            if (!map.empty()) {
+                auto it = map.find(hash);
+                if (it != map.end()) {
+                    const std::vector<idx_t>& v = it->second;
+                    shortlist.insert(shortlist.end(), v.begin(), v.end());
+                    found = true;
                 }
+            }
+            if (found) {
                 nlist++;
             } else {
                 n0++;
@@ -395,6 +426,12 @@ void search_1_query_multihash(
 
         ho += b;
     }
+
+    // remove the duplicates. The sorted order also makes the accesses to
+    // the codes in verify_shortlist sequential.
+    std::sort(shortlist.begin(), shortlist.end());
+    shortlist.erase(
+            std::unique(shortlist.begin(), shortlist.end()), shortlist.end());
     ndis += shortlist.size();
 
     // verify shortlist
@@ -418,6 +455,7 @@ void IndexBinaryMultiHash::range_search(
 #pragma omp parallel if (n > 100) reduction(+ : ndis, n0, nlist)
     {
         RangeSearchPartialResult pres(result);
+        std::vector<idx_t> shortlist;
 
 #pragma omp for
         for (idx_t i = 0; i < n; i++) { // loop queries
@@ -425,7 +463,8 @@ void IndexBinaryMultiHash::range_search(
             RangeSearchResults res = {radius, qres};
             const uint8_t* q = x + i * code_size;
 
-            search_1_query_multihash(*this, q, res, n0, nlist, ndis);
+            search_1_query_multihash(
+                    *this, q, res, shortlist, n0, nlist, ndis);
         }
         pres.finalize();
     }
@@ -449,18 +488,24 @@ void IndexBinaryMultiHash::search(
     using HeapForL2 = CMax<int32_t, idx_t>;
     size_t nlist = 0, ndis = 0, n0 = 0;
 
-#pragma omp parallel for if (n > 100) reduction(+ : nlist, ndis, n0)
-    for (idx_t i = 0; i < n; i++) {
-        int32_t* simi = distances + k * i;
-        idx_t* idxi = labels + k * i;
+#pragma omp parallel if (n > 100) reduction(+ : nlist, ndis, n0)
+    {
+        std::vector<idx_t> shortlist;
 
-        heap_heapify<HeapForL2>(k, simi, idxi);
-        KnnSearchResults res = {k, simi, idxi};
-        const uint8_t* q = x + i * code_size;
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            int32_t* simi = distances + k * i;
+            idx_t* idxi = labels + k * i;
 
-        search_1_query_multihash(*this, q, res, n0, nlist, ndis);
+            heap_heapify<HeapForL2>(k, simi, idxi);
+            KnnSearchResults res = {k, simi, idxi};
+            const uint8_t* q = x + i * code_size;
 
-        heap_reorder<HeapForL2>(k, simi, idxi);
+            search_1_query_multihash(
+                    *this, q, res, shortlist, n0, nlist, ndis);
+
+            heap_reorder<HeapForL2>(k, simi, idxi);
+        }
     }
     indexBinaryHash_stats.nq += n;
     indexBinaryHash_stats.n0 += n0;
@@ -470,11 +515,139 @@ void IndexBinaryMultiHash::search(
 
 size_t IndexBinaryMultiHash::hashtable_size() const {
     size_t tot = 0;
-    for (auto map : maps) {
+    for (const auto& map : maps) {
         tot += map.size();
     }
+    for (const auto& table : flat_tables) {
+        tot += table.nbucket();
+    }
 
     return tot;
 }
 
+bool IndexBinaryMultiHash::FlatTable::lookup(
+        uint64_t hash,
+        const idx_t*& begin,
+        const idx_t*& end) const {
+    size_t i;
+    if (hashes.empty()) {
+        if (hash + 1 >= lims.size()) {
+            return false;
+        }
+        i = hash;
+    } else {
+        uint64_t t = hash >> dir_shift;
+        if (t + 1 >= dir.size()) {
+            return false;
+        }
+        auto i0 = hashes.begin() + dir[t], i1 = hashes.begin() + dir[t + 1];
+        auto it = std::lower_bound(i0, i1, hash);
+        if (it == i1 || *it != hash) {
+            return false;
+        }
+        i = it - hashes.begin();
+    }
+    begin = ids.data() + lims[i];
+    end = ids.data() + lims[i + 1];
+    return begin != end;
+}
+
+size_t IndexBinaryMultiHash::FlatTable::nbucket() const {
+    if (!hashes.empty()) {
+        return hashes.size();
+    }
+    size_t nb = 0;
+    for (size_t i = 0; i + 1 < lims.size(); i++) {
+        nb += lims[i + 1] > lims[i];
+    }
+    return nb;
+}
+
+void IndexBinaryMultiHash::compact() {
+    if (flat_tables.empty()) {
+        flat_tables.resize(nhash);
+    }
+    FAISS_THROW_IF_NOT(flat_tables.size() == (size_t)nhash);
+
+#pragma omp parallel for if (nhash > 1)
+    for (int h = 0; h < nhash; h++) {
+        FlatTable& table = flat_tables[h];
+        Map& map = maps[h];
+
+        // collect the (hash, id) pairs of the table and the map
+        size_t n = table.ids.size();
+        for (const auto& it : map) {
+            n += it.second.size();
+        }
+        std::vector<uint64_t> vals(n);
+        std::vector<idx_t> ids(n);
+        size_t ofs = 0;
+        for (size_t i = 0; i + 1 < table.lims.size(); i++) {
+            uint64_t hash = table.hashes.empty() ? i : table.hashes[i];
+            for (int64_t j = table.lims[i]; j < table.lims[i + 1]; j++) {
+                vals[ofs] = hash;
+                ids[ofs] = table.ids[j];
+                ofs++;
+            }
+        }
+        for (const auto& it : map) {
+            for (idx_t id : it.second) {
+                vals[ofs] = it.first;
+                ids[ofs] = id;
+                ofs++;
+            }
+        }
+        Map().swap(map);
+
+        FlatTable nt;
+        std::vector<int64_t> perm(n);
+        if (b < 32 && ((size_t)1 << b) <= n) {
+            // dense table: the bucket sort directly gives the limits
+            size_t nbucket = (size_t)1 << b;
+            nt.lims.resize(nbucket + 1);
+            bucket_sort(n, vals.data(), nbucket, nt.lims.data(), perm.data());
+        } else {
+            // sparse table: only the non-empty buckets are stored
+            std::iota(perm.begin(), perm.end(), 0);
+            std::sort(perm.begin(), perm.end(), [&](int64_t i, int64_t j) {
+                return vals[i] < vals[j] || (vals[i] == vals[j] && i < j);
+            });
+            nt.lims.push_back(0);
+            for (size_t i = 0; i < n; i++) {
+                if (i > 0 && vals[perm[i]] == vals[perm[i - 1]]) {
+                    continue;
+                }
+                if (i > 0) {
+                    nt.lims.push_back(i);
+                }
+                nt.hashes.push_back(vals[perm[i]]);
+            }
+            if (n > 0) {
+                nt.lims.push_back(n);
+            }
+            // the directory has about as many entries as there are hashes
+            int dir_bits = 0;
+            while (dir_bits < b &&
+                   ((size_t)2 << dir_bits) <= nt.hashes.size()) {
+                dir_bits++;
+            }
+            nt.dir_shift = b - dir_bits;
+            nt.dir.resize(((size_t)1 << dir_bits) + 1);
+            size_t j = 0;
+            for (size_t t = 0; t < nt.dir.size(); t++) {
+                while (j < nt.hashes.size() &&
+                       (nt.hashes[j] >> nt.dir_shift) < t) {
+                    j++;
+                }
+                nt.dir[t] = j;
+            }
+        }
+        nt.ids.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            nt.ids[i] = ids[perm[i]];
+        }
+        table = std::move(nt);
+    }
+}
+
 } // namespace faiss
@@ -91,6 +91,31 @@ struct IndexBinaryMultiHash : IndexBinary {
     // the different hashes, size nhash
     std::vector<Map> maps;
 
+    /** Hash table in a flat layout, built by compact(). The ids of the
+     * vectors with hash value hashes[i] are in ids[lims[i]:lims[i + 1]].
+     * When the table is dense, hashes is empty and lims is indexed
+     * directly by the hash value (size 2^b + 1). Otherwise the hashes
+     * with high bits t = hash >> dir_shift are in hashes[dir[t]:dir[t + 1]].
+     */
+    struct FlatTable {
+        std::vector<uint64_t> hashes; ///< sorted, empty if dense
+        std::vector<int64_t> lims;
+        std::vector<idx_t> ids;
+        std::vector<int64_t> dir; ///< directory on the high bits of hashes
+        int dir_shift = 0;
+
+        /// find the ids of a hash value, returns false if there are none
+        bool lookup(uint64_t hash, const idx_t*& begin, const idx_t*& end)
+                const;
+
+        /// nb of non-empty buckets
+        size_t nbucket() const;
+    };
+
+    /// flat tables, size nhash (or empty if compact was never called).
+    /// Vectors added after the last call to compact() are in maps.
+    std::vector<FlatTable> flat_tables;
+
     int nhash; ///< nb of hash maps
     int b;     ///< nb bits per hash map
     int nflip; ///< nb bit flips to use at search time
@@ -121,6 +146,10 @@ struct IndexBinaryMultiHash : IndexBinary {
             const SearchParameters* params = nullptr) const override;
 
     size_t hashtable_size() const;
+
+    /// move the content of maps to flat_tables, which use less memory and
+    /// are faster to search. Called automatically when reading the index.
+    void compact();
 };
 
 } // namespace faiss
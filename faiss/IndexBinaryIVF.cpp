@@ -326,7 +326,10 @@ void IndexBinaryIVF::merge_from(IndexBinary& otherIndex, idx_t add_id) {
 }
 
 void IndexBinaryIVF::replace_invlists(InvertedLists* il, bool own) {
-    FAISS_THROW_IF_NOT(il->nlist == nlist && il->code_size == code_size);
+    FAISS_THROW_IF_NOT(il->nlist == nlist);
+    FAISS_THROW_IF_NOT(
+            il->code_size == code_size ||
+            il->code_size == InvertedLists::INVALID_CODE_SIZE);
     if (own_invlists) {
         delete invlists;
     }
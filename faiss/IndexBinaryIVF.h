@@ -93,7 +93,7 @@ struct IndexBinaryIVF : IndexBinary {
      * @param precomputed_idx    quantization indices for the input vectors
      * (size n)
      */
-    void add_core(
+    virtual void add_core(
             idx_t n,
             const uint8_t* x,
             const idx_t* xids,
@@ -116,7 +116,7 @@ struct IndexBinaryIVF : IndexBinary {
      *                     instead of ids (used for reranking).
      * @param params used to override the object's search parameters
      */
-    void search_preassigned(
+    virtual void search_preassigned(
             idx_t n,
             const uint8_t* x,
             idx_t k,
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexBinaryIVFFastScan.h>
+
+#include <omp.h>
+#include <cinttypes>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/simd_result_handlers.h>
+#include <faiss/invlists/BlockInvertedLists.h>
+#include <faiss/invlists/DirectMap.h>
+#include <faiss/utils/AlignedTable.h>
+#include <faiss/utils/hamming.h>
+#include <faiss/utils/utils.h>
+
+namespace faiss {
+
+inline size_t roundup(size_t a, size_t b) {
+    return (a + b - 1) / b * b;
+}
+
+IndexBinaryIVFFastScan::IndexBinaryIVFFastScan(
+        IndexBinary* quantizer,
+        size_t d,
+        size_t nlist,
+        int bbs)
+        : IndexBinaryIVF(quantizer, d, nlist), bbs(bbs) {
+    FAISS_THROW_IF_NOT(bbs % 32 == 0);
+    replace_invlists(new BlockInvertedLists(nlist, get_CodePacker()), true);
+}
+
+IndexBinaryIVFFastScan::IndexBinaryIVFFastScan() = default;
+
+CodePacker* IndexBinaryIVFFastScan::get_CodePacker() const {
+    return new CodePackerPQ4(nsq(), bbs);
+}
+
+void IndexBinaryIVFFastScan::init_code_packer() {
+    auto bil = dynamic_cast<BlockInvertedLists*>(invlists);
+    FAISS_THROW_IF_NOT(bil);
+    delete bil->packer; // in case there was one before
+    bil->packer = get_CodePacker();
+}
+
+void IndexBinaryIVFFastScan::add_core(
+        idx_t n,
+        const uint8_t* x,
+        const idx_t* xids,
+        const idx_t* precomputed_idx) {
+    FAISS_THROW_IF_NOT(is_trained);
+    auto bil = dynamic_cast<BlockInvertedLists*>(invlists);
+    FAISS_THROW_IF_NOT_MSG(
+            bil && bil->packer, "fast-scan requires BlockInvertedLists");
+    direct_map.check_can_add(xids);
+
+    const idx_t* idx;
+    std::unique_ptr<idx_t[]> scoped_idx;
+
+    if (precomputed_idx) {
+        idx = precomputed_idx;
+    } else {
+        scoped_idx.reset(new idx_t[n]);
+        quantizer->assign(n, x, scoped_idx.get());
+        idx = scoped_idx.get();
+    }
+
+    // group the vectors per inverted list so that each list is resized
+    // only once
+    std::vector<idx_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](idx_t a, idx_t b) {
+        return idx[a] < idx[b];
+    });
+
+    DirectMapAdd dm_adder(direct_map, n, xids);
+    const CodePacker& packer = *bil->packer;
+
+#pragma omp parallel
+    {
+        int nt = omp_get_num_threads();
+        int rank = omp_get_thread_num();
+
+        // each thread takes care of a subset of lists
+        for (idx_t i0 = 0; i0 < n;) {
+            idx_t list_no = idx[order[i0]];
+            idx_t i1 = i0 + 1;
+            while (i1 < n && idx[order[i1]] == list_no) {
+                i1++;
+            }
+            if (list_no >= 0 && list_no % nt == rank) {
+                size_t o = bil->list_size(list_no);
+                bil->resize(list_no, o + i1 - i0);
+                idx_t* list_ids = bil->ids[list_no].data();
+                uint8_t* list_codes = bil->codes[list_no].data();
+                for (idx_t i = i0; i < i1; i++) {
+                    idx_t j = order[i];
+                    size_t ofs = o + i - i0;
+                    list_ids[ofs] = xids ? xids[j] : ntotal + j;
+                    packer.pack_1(x + j * code_size, ofs, list_codes);
+                    dm_adder.add(j, list_no, ofs);
+                }
+            } else if (rank == 0 && list_no < 0) {
+                for (idx_t i = i0; i < i1; i++) {
+                    dm_adder.add(order[i], -1, 0);
+                }
+            }
+            i0 = i1;
+        }
+    }
+
+    if (verbose) {
+        printf("IndexBinaryIVFFastScan::add_core: added %" PRId64
+               " vectors\n",
+               n);
+    }
+    ntotal += n;
+}
+
+void IndexBinaryIVFFastScan::reconstruct_from_offset(
+        idx_t list_no,
+        idx_t offset,
+        uint8_t* recons) const {
+    auto bil = dynamic_cast<const BlockInvertedLists*>(invlists);
+    FAISS_THROW_IF_NOT(bil && bil->packer);
+    InvertedLists::ScopedCodes list_codes(invlists, list_no);
+    bil->packer->unpack_1(list_codes.get(), offset, recons);
+}
+
+namespace {
+
+/** Common part of the SIMD result handlers: the 32 distances of a call to
+ * handle() are those of codes j0 + 32 * b ... j0 + 32 * b + 31 of the
+ * list, the ones beyond ntotal are padding. */
+struct BinaryFastScanHandler : SIMDResultHandler {
+    size_t ntotal = 0;
+    size_t i0 = 0;
+    size_t j0 = 0;
+    const idx_t* ids = nullptr;
+    idx_t list_no = -1;
+    bool store_pairs = false;
+
+    void set_block_origin(size_t i0_in, size_t j0_in) final {
+        i0 = i0_in;
+        j0 = j0_in;
+    }
+
+    /// mask of the elements of (d0, d1) that are < thr
+    uint32_t get_lt_mask(
+            uint16_t thr,
+            size_t b,
+            simd16uint16 d0,
+            simd16uint16 d1) const {
+        size_t j = j0 + 32 * b;
+        if (j >= ntotal) {
+            return 0;
+        }
+        uint32_t lt_mask = ~cmp_ge32(d0, d1, simd16uint16(thr));
+        if (j + 32 > ntotal) {
+            lt_mask &= (uint32_t(1) << (ntotal - j)) - 1;
+        }
+        return lt_mask;
+    }
+
+    idx_t get_id(size_t ofs) const {
+        return store_pairs ? lo_build(list_no, ofs) : ids[ofs];
+    }
+};
+
+/** updates the int32 max-heaps of the IndexBinaryIVF search. Query q of
+ * the block goes to heap q_map[i0 + q] (or i0 + q if there is no q_map) */
+struct BinaryFastScanHeapHandler : BinaryFastScanHandler {
+    int32_t* distances = nullptr;
+    idx_t* labels = nullptr;
+    size_t k = 0;
+    const int* q_map = nullptr;
+    size_t nup = 0;
+
+    void handle(size_t q, size_t b, simd16uint16 d0, simd16uint16 d1) final {
+        q += i0;
+        if (q_map) {
+            q = q_map[q];
+        }
+        int32_t* heap_dis = distances + q * k;
+        idx_t* heap_ids = labels + q * k;
+
+        uint16_t thr = heap_dis[0] < 65536 ? heap_dis[0] : 65535;
+        uint32_t lt_mask = get_lt_mask(thr, b, d0, d1);
+        if (!lt_mask) {
+            return;
+        }
+        ALIGNED(32) uint16_t d32tab[32];
+        d0.store(d32tab);
+        d1.store(d32tab + 16);
+        while (lt_mask) {
+            int j = __builtin_ctz(lt_mask);
+            lt_mask &= lt_mask - 1;
+            int32_t dis = d32tab[j];
+            if (dis < heap_dis[0]) {
+                heap_replace_top<CMax<int32_t, idx_t>>(
+                        k, heap_dis, heap_ids, dis, get_id(j0 + 32 * b + j));
+                nup++;
+            }
+        }
+    }
+};
+
+/// collects the codes at distance < radius
+struct BinaryFastScanRangeHandler : BinaryFastScanHandler {
+    uint16_t radius = 0;
+    RangeQueryResult* qres = nullptr;
+
+    void handle(size_t, size_t b, simd16uint16 d0, simd16uint16 d1) final {
+        uint32_t lt_mask = get_lt_mask(radius, b, d0, d1);
+        if (!lt_mask) {
+            return;
+        }
+        ALIGNED(32) uint16_t d32tab[32];
+        d0.store(d32tab);
+        d1.store(d32tab + 16);
+        while (lt_mask) {
+            int j = __builtin_ctz(lt_mask);
+            lt_mask &= lt_mask - 1;
+            qres->add(d32tab[j], get_id(j0 + 32 * b + j));
+        }
+    }
+};
+
+/// look-up table for a query: entry (2 * i + h, v) is the Hamming distance
+/// between the h-th nibble of byte i of the query and v
+void compute_hamming_LUT(const uint8_t* q, size_t code_size, uint8_t* LUT) {
+    for (size_t i = 0; i < code_size; i++) {
+        uint8_t qlo = q[i] & 15, qhi = q[i] >> 4;
+        for (int v = 0; v < 16; v++) {
+            LUT[(2 * i) * 16 + v] = __builtin_popcount(qlo ^ v);
+            LUT[(2 * i + 1) * 16 + v] = __builtin_popcount(qhi ^ v);
+        }
+    }
+}
+
+struct IVFBinaryFastScanScanner : BinaryInvertedListScanner {
+    size_t code_size;
+    int bbs;
+    size_t block_size;
+    bool store_pairs;
+
+    AlignedTable<uint8_t> LUT;
+    HammingComputerDefault hc;
+    idx_t list_no = -1;
+
+    IVFBinaryFastScanScanner(
+            size_t code_size,
+            int bbs,
+            size_t block_size,
+            bool store_pairs)
+            : code_size(code_size),
+              bbs(bbs),
+              block_size(block_size),
+              store_pairs(store_pairs),
+              LUT(2 * code_size * 16) {}
+
+    void set_query(const uint8_t* query_vector) override {
+        hc.set(query_vector, code_size);
+        std::vector<uint8_t> tab(2 * code_size * 16);
+        compute_hamming_LUT(query_vector, code_size, tab.data());
+        pq4_pack_LUT(1, 2 * code_size, tab.data(), LUT.get());
+    }
+
+    void set_list(idx_t list_no_in, uint8_t /* coarse_dis */) override {
+        list_no = list_no_in;
+    }
+
+    uint32_t distance_to_code(const uint8_t* code) const override {
+        return hc.hamming(code);
+    }
+
+    void run(size_t n, const uint8_t* codes, BinaryFastScanHandler& res)
+            const {
+        res.ntotal = n;
+        res.list_no = list_no;
+        res.store_pairs = store_pairs;
+        pq4_accumulate_loop(
+                1,
+                roundup(n, bbs),
+                bbs,
+                2 * code_size,
+                codes,
+                LUT.get(),
+                res,
+                nullptr,
+                block_size);
+    }
+
+    size_t scan_codes(
+            size_t n,
+            const uint8_t* codes,
+            const idx_t* ids,
+            int32_t* simi,
+            idx_t* idxi,
+            size_t k) const override {
+        BinaryFastScanHeapHandler res;
+        res.ids = ids;
+        res.distances = simi;
+        res.labels = idxi;
+        res.k = k;
+        run(n, codes, res);
+        return res.nup;
+    }
+
+    void scan_codes_range(
+            size_t n,
+            const uint8_t* codes,
+            const idx_t* ids,
+            int radius,
+            RangeQueryResult& result) const override {
+        if (radius <= 0) {
+            return;
+        }
+        BinaryFastScanRangeHandler res;
+        res.ids = ids;
+        res.radius = std::min(radius, 65535);
+        res.qres = &result;
+        run(n, codes, res);
+    }
+};
+
+} // anonymous namespace
+
+BinaryInvertedListScanner* IndexBinaryIVFFastScan::get_InvertedListScanner(
+        bool store_pairs) const {
+    size_t block_size = bbs * nsq() / 2;
+    return new IVFBinaryFastScanScanner(
+            code_size, bbs, block_size, store_pairs);
+}
+
+void IndexBinaryIVFFastScan::search_preassigned(
+        idx_t n,
+        const uint8_t* x,
+        idx_t k,
+        const idx_t* assign,
+        const int32_t* centroid_dis,
+        int32_t* distances,
+        idx_t* labels,
+        bool store_pairs,
+        const IVFSearchParameters* params) const {
+    // the other search variants access the codes with a fixed stride
+    FAISS_THROW_IF_NOT_MSG(
+            use_heap && !per_invlist_search,
+            "IndexBinaryIVFFastScan supports only the heap-based search");
+    size_t nprobe = std::min(nlist, params ? params->nprobe : this->nprobe);
+    size_t max_codes_2 = params ? params->max_codes : max_codes;
+
+    if (bbs != 32 || max_codes_2 != 0 || metric_type != METRIC_L2) {
+        // one query at a time, with the scanner
+        IndexBinaryIVF::search_preassigned(
+                n,
+                x,
+                k,
+                assign,
+                centroid_dis,
+                distances,
+                labels,
+                store_pairs,
+                params);
+        return;
+    }
+
+    // The queries that visit the same inverted list are handled together
+    // by the qbs kernels, so that the codes are loaded once for up to
+    // qbs_max queries.
+    constexpr int qbs_max = 11;
+    size_t dim12 = nsq() * 16;
+    size_t block_size = bbs * nsq() / 2;
+
+    std::vector<uint8_t> LUTs(n * dim12);
+#pragma omp parallel for if (n > 100)
+    for (idx_t i = 0; i < n; i++) {
+        compute_hamming_LUT(x + i * code_size, code_size, &LUTs[i * dim12]);
+        heap_heapify<CMax<int32_t, idx_t>>(
+                k, distances + i * k, labels + i * k);
+    }
+
+    for (idx_t i = 0; i < n * (idx_t)nprobe; i++) {
+        FAISS_THROW_IF_NOT_FMT(
+                assign[i] < (idx_t)nlist,
+                "Invalid key=%" PRId64 " nlist=%zd",
+                assign[i],
+                nlist);
+    }
+
+    size_t nlistv = 0, ndis = 0, nheap = 0;
+    int nslice = std::max(1, std::min<int>(n, omp_get_max_threads()));
+
+#pragma omp parallel for reduction(+ : nlistv, ndis, nheap)
+    for (int slice = 0; slice < nslice; slice++) {
+        idx_t q0 = n * slice / nslice;
+        idx_t q1 = n * (slice + 1) / nslice;
+
+        // (list_no, query) pairs of the slice, grouped by list
+        std::vector<std::pair<idx_t, int>> lq;
+        for (idx_t i = q0; i < q1; i++) {
+            for (size_t j = 0; j < nprobe; j++) {
+                idx_t list_no = assign[i * nprobe + j];
+                if (list_no >= 0) {
+                    lq.emplace_back(list_no, i);
+                }
+            }
+        }
+        std::sort(lq.begin(), lq.end());
+
+        AlignedTable<uint8_t> LUT(qbs_max * dim12);
+        std::vector<int> q_map(qbs_max);
+        BinaryFastScanHeapHandler res;
+        res.distances = distances;
+        res.labels = labels;
+        res.k = k;
+        res.store_pairs = store_pairs;
+        res.q_map = q_map.data();
+
+        for (size_t i0 = 0; i0 < lq.size();) {
+            idx_t list_no = lq[i0].first;
+            size_t i1 = i0 + 1;
+            while (i1 < lq.size() && i1 < i0 + qbs_max &&
+                   lq[i1].first == list_no) {
+                i1++;
+            }
+            size_t list_size = invlists->list_size(list_no);
+            if (list_size == 0) {
+                i0 = i1;
+                continue;
+            }
+            int nc = i1 - i0;
+            for (int i = 0; i < nc; i++) {
+                q_map[i] = lq[i0 + i].second;
+            }
+            int qbs = pq4_preferred_qbs(nc);
+            pq4_pack_LUT_qbs_q_map(
+                    qbs, nsq(), LUTs.data(), q_map.data(), LUT.get());
+
+            InvertedLists::ScopedCodes codes(invlists, list_no);
+            std::unique_ptr<InvertedLists::ScopedIds> sids;
+            if (!store_pairs) {
+                sids = std::make_unique<InvertedLists::ScopedIds>(
+                        invlists, list_no);
+                res.ids = sids->get();
+            }
+            res.ntotal = list_size;
+            res.list_no = list_no;
+            pq4_accumulate_loop_qbs(
+                    qbs,
+                    list_size,
+                    nsq(),
+                    codes.get(),
+                    LUT.get(),
+                    res,
+                    nullptr,
+                    block_size);
+
+            nlistv += nc;
+            ndis += nc * list_size;
+            i0 = i1;
+        }
+        nheap += res.nup;
+
+        for (idx_t i = q0; i < q1; i++) {
+            heap_reorder<CMax<int32_t, idx_t>>(
+                    k, distances + i * k, labels + i * k);
+        }
+    }
+
+    indexIVF_stats.nq += n;
+    indexIVF_stats.nlist += nlistv;
+    indexIVF_stats.ndis += ndis;
+    indexIVF_stats.nheap_updates += nheap;
+}
+
+} // namespace faiss
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <faiss/IndexBinaryIVF.h>
+#include <faiss/impl/CodePacker.h>
+
+namespace faiss {
+
+/** Binary IVF index where the inverted lists are scanned with the SIMD
+ * kernels of the PQ4 fast-scan.
+ *
+ * Each byte of a binary code is seen as two 4-bit sub-codes. For a given
+ * query, a look-up table stores the Hamming distance between each 4-bit
+ * chunk of the query and the 16 possible sub-code values, so that the
+ * Hamming distance to a code is the sum of 2 * code_size table entries.
+ * The inverted lists are BlockInvertedLists that store the codes in the
+ * blocked, transposed layout of pq4_fast_scan.h, and the distances to bbs
+ * codes are computed at a time with in-register table lookups.
+ *
+ * The distances are exact, so the results are the same as those of
+ * IndexBinaryIVF (up to ties). Only the heap-based search is supported
+ * (use_heap = true, per_invlist_search = false).
+ */
+struct IndexBinaryIVFFastScan : IndexBinaryIVF {
+    /// size of the database blocks (multiple of 32)
+    int bbs = 32;
+
+    IndexBinaryIVFFastScan(
+            IndexBinary* quantizer,
+            size_t d,
+            size_t nlist,
+            int bbs = 32);
+
+    IndexBinaryIVFFastScan();
+
+    /// number of 4-bit sub-codes = 2 * code_size
+    size_t nsq() const {
+        return 2 * code_size;
+    }
+
+    CodePacker* get_CodePacker() const;
+
+    /// set the code packer of the inverted lists (eg. after reading them)
+    void init_code_packer();
+
+    void add_core(
+            idx_t n,
+            const uint8_t* x,
+            const idx_t* xids,
+            const idx_t* precomputed_idx) override;
+
+    void search_preassigned(
+            idx_t n,
+            const uint8_t* x,
+            idx_t k,
+            const idx_t* assign,
+            const int32_t* centroid_dis,
+            int32_t* distances,
+            idx_t* labels,
+            bool store_pairs,
+            const IVFSearchParameters* params = nullptr) const override;
+
+    BinaryInvertedListScanner* get_InvertedListScanner(
+            bool store_pairs = false) const override;
+
+    void reconstruct_from_offset(idx_t list_no, idx_t offset, uint8_t* recons)
+            const override;
+};
+
+} // namespace faiss
@@ -0,0 +1,476 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexDiskGraph.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <faiss/IndexNSG.h>
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/impl/QueryTrace.h>
+#include <faiss/utils/distances.h>
+
+namespace faiss {
+
+IndexDiskGraphStats indexDiskGraph_stats;
+
+void IndexDiskGraphStats::reset() {
+    nq = nhops = nreads = nbytes = ndis_pq = 0;
+}
+
+void IndexDiskGraphStats::combine(const IndexDiskGraphStats& other) {
+    nq += other.nq;
+    nhops += other.nhops;
+    nreads += other.nreads;
+    nbytes += other.nbytes;
+    ndis_pq += other.ndis_pq;
+}
+
+namespace {
+
+const uint32_t disk_graph_magic = 0x52474446; // "FDGR"
+
+struct DiskGraphHeader {
+    uint32_t magic;
+    uint32_t d;
+    int64_t ntotal;
+    int32_t R;
+    int32_t entry_point;
+    uint64_t node_size;
+};
+
+/// buffer aligned on sectors. The file is opened without O_DIRECT, so the
+/// reads go through the page cache and the alignment is not required, but
+/// it keeps the reads compatible with direct I/O.
+struct SectorBuffer {
+    uint8_t* data = nullptr;
+
+    explicit SectorBuffer(size_t size) {
+        size_t s = IndexDiskGraph::sector_size;
+        size = (size + s - 1) / s * s;
+        if (posix_memalign((void**)&data, s, size) != 0) {
+            FAISS_THROW_FMT("could not allocate %zd bytes", size);
+        }
+        memset(data, 0, size);
+    }
+
+    ~SectorBuffer() {
+        free(data);
+    }
+
+    SectorBuffer(const SectorBuffer&) = delete;
+    SectorBuffer& operator=(const SectorBuffer&) = delete;
+};
+
+void pread_all(int fd, uint8_t* buf, size_t size, size_t offset) {
+    while (size > 0) {
+        ssize_t ret = pread(fd, buf, size, offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        FAISS_THROW_IF_NOT_FMT(
+                ret > 0,
+                "read error at offset %zd: %s",
+                offset,
+                ret < 0 ? strerror(errno) : "unexpected end of file");
+        buf += ret;
+        size -= ret;
+        offset += ret;
+    }
+}
+
+} // anonymous namespace
+
+/// read-only file shared by the copies of the index
+struct IndexDiskGraph::File {
+    int fd = -1;
+
+    explicit File(const std::string& fname) {
+        fd = ::open(fname.c_str(), O_RDONLY);
+        FAISS_THROW_IF_NOT_FMT(
+                fd >= 0,
+                "could not open %s for reading: %s",
+                fname.c_str(),
+                strerror(errno));
+    }
+
+    ~File() {
+        close(fd);
+    }
+};
+
+IndexDiskGraph::IndexDiskGraph(
+        int d,
+        int pq_M,
+        const std::string& filename,
+        int R,
+        MetricType metric,
+        int pq_nbits)
+        : Index(d, metric),
+          pq_index(d, pq_M, pq_nbits, metric),
+          filename(filename),
+          R(R) {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    FAISS_THROW_IF_NOT(R > 0);
+    is_trained = false;
+}
+
+IndexDiskGraph::IndexDiskGraph() {}
+
+IndexDiskGraph::~IndexDiskGraph() {}
+
+void IndexDiskGraph::train(idx_t n, const float* x) {
+    pq_index.train(n, x);
+    is_trained = pq_index.is_trained;
+}
+
+void IndexDiskGraph::add(idx_t n, const float* x) {
+    FAISS_THROW_IF_NOT_MSG(is_trained, "index not trained");
+    FAISS_THROW_IF_NOT_MSG(
+            ntotal == 0, "IndexDiskGraph does not support incremental add");
+
+    // the graph is built in RAM, then only the file is kept
+    IndexNSGFlat nsg_index(d, R, metric_type);
+    nsg_index.GK = GK;
+    nsg_index.build_type = build_type;
+    nsg_index.verbose = verbose;
+    nsg_index.add(n, x);
+
+    add_graph(n, x, *nsg_index.nsg.final_graph, nsg_index.nsg.enterpoint);
+}
+
+size_t IndexDiskGraph::node_offset(idx_t i) const {
+    if (nodes_per_sector > 0) {
+        return (1 + i / nodes_per_sector) * sector_size +
+                (i % nodes_per_sector) * node_size;
+    } else {
+        return (1 + i * sectors_per_node) * sector_size;
+    }
+}
+
+size_t IndexDiskGraph::node_read_size() const {
+    return nodes_per_sector > 0 ? sector_size : sectors_per_node * sector_size;
+}
+
+void IndexDiskGraph::add_graph(
+        idx_t n,
+        const float* x,
+        const nsg::Graph<storage_idx_t>& graph,
+        storage_idx_t entry_point_in) {
+    FAISS_THROW_IF_NOT_MSG(is_trained, "index not trained");
+    FAISS_THROW_IF_NOT_MSG(
+            ntotal == 0, "IndexDiskGraph does not support incremental add");
+    FAISS_THROW_IF_NOT(graph.N == n);
+    FAISS_THROW_IF_NOT_FMT(
+            graph.K <= R, "graph degree %d > R = %d", graph.K, R);
+    FAISS_THROW_IF_NOT(n <= std::numeric_limits<storage_idx_t>::max());
+    FAISS_THROW_IF_NOT(entry_point_in >= 0 && entry_point_in < n);
+    for (size_t i = 0; i < size_t(n) * graph.K; i++) {
+        FAISS_THROW_IF_NOT_MSG(graph.data[i] < n, "invalid graph node");
+    }
+
+    node_size = d * sizeof(float) + (1 + R) * sizeof(storage_idx_t);
+    nodes_per_sector = sector_size / node_size;
+    sectors_per_node = nodes_per_sector > 0
+            ? 0
+            : (node_size + sector_size - 1) / sector_size;
+    entry_point = entry_point_in;
+
+    file.reset();
+    FILE* f = fopen(filename.c_str(), "wb");
+    FAISS_THROW_IF_NOT_FMT(
+            f, "could not open %s for writing", filename.c_str());
+
+    // writes one sector-aligned block at a time
+    size_t nodes_per_block = nodes_per_sector > 0 ? nodes_per_sector : 1;
+    size_t block_size = node_read_size();
+    std::vector<uint8_t> block(block_size);
+    bool ok = true;
+
+    DiskGraphHeader header{
+            disk_graph_magic,
+            uint32_t(d),
+            int64_t(n),
+            int32_t(R),
+            entry_point,
+            uint64_t(node_size)};
+    std::vector<uint8_t> header_sector(sector_size);
+    memcpy(header_sector.data(), &header, sizeof(header));
+    ok = ok && fwrite(header_sector.data(), 1, sector_size, f) == sector_size;
+
+    for (idx_t i0 = 0; i0 < n && ok; i0 += nodes_per_block) {
+        idx_t i1 = std::min(i0 + idx_t(nodes_per_block), n);
+        memset(block.data(), 0, block_size);
+        for (idx_t i = i0; i < i1; i++) {
+            uint8_t* rec = block.data() + (i - i0) * node_size;
+            memcpy(rec, x + i * d, d * sizeof(float));
+            storage_idx_t* links =
+                    (storage_idx_t*)(rec + d * sizeof(float));
+            storage_idx_t degree = 0;
+            for (int j = 0; j < graph.K; j++) {
+                storage_idx_t nb = graph.at(i, j);
+                if (nb >= 0) {
+                    links[1 + degree++] = nb;
+                }
+            }
+            links[0] = degree;
+        }
+        ok = fwrite(block.data(), 1, block_size, f) == block_size;
+    }
+    ok = fclose(f) == 0 && ok;
+    FAISS_THROW_IF_NOT_FMT(ok, "write error on %s", filename.c_str());
+
+    pq_index.add(n, x);
+    ntotal = n;
+    open();
+}
+
+void IndexDiskGraph::open() {
+    file.reset();
+    file = std::make_shared<File>(filename);
+
+    DiskGraphHeader header;
+    SectorBuffer buf(sector_size);
+    pread_all(file->fd, buf.data, sector_size, 0);
+    memcpy(&header, buf.data, sizeof(header));
+    FAISS_THROW_IF_NOT_FMT(
+            header.magic == disk_graph_magic,
+            "%s is not a disk graph file",
+            filename.c_str());
+    FAISS_THROW_IF_NOT_FMT(
+            header.d == d && header.ntotal == ntotal && header.R == R &&
+                    header.node_size == node_size &&
+                    header.entry_point == entry_point,
+            "%s does not match the index",
+            filename.c_str());
+}
+
+namespace {
+
+struct Candidate {
+    float dis;
+    IndexDiskGraph::storage_idx_t id;
+    bool expanded;
+
+    bool operator<(const Candidate& other) const {
+        return dis < other.dis;
+    }
+};
+
+} // anonymous namespace
+
+void IndexDiskGraph::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params_in) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT_MSG(ntotal == 0 || file, "file not opened");
+
+    int L = search_L;
+    int W = beam_width;
+    const IDSelector* sel = nullptr;
+    if (params_in) {
+        auto params =
+                dynamic_cast<const SearchParametersDiskGraph*>(params_in);
+        FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
+        L = params->search_L > 0 ? params->search_L : L;
+        W = params->beam_width > 0 ? params->beam_width : W;
+        sel = params->sel;
+    }
+    FAISS_THROW_IF_NOT(W > 0);
+    size_t pool_size = std::max(size_t(L), size_t(k));
+    size_t beam_size = W;
+
+    // internally, smaller is better
+    bool is_ip = metric_type == METRIC_INNER_PRODUCT;
+    float sign = is_ip ? -1 : 1;
+
+    // exceptions cannot leave the parallel section, they are re-thrown
+    // after it
+    bool interrupt = false;
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel if (n > 1)
+    {
+        std::unique_ptr<FlatCodesDistanceComputer> dc(
+                pq_index.get_FlatCodesDistanceComputer());
+        std::vector<Candidate> pool;
+        pool.reserve(pool_size + 1);
+        std::unordered_set<storage_idx_t> visited;
+        std::vector<std::pair<float, idx_t>> results;
+        size_t read_size = node_read_size();
+        SectorBuffer buf(beam_size * read_size);
+        std::vector<storage_idx_t> beam;
+        IndexDiskGraphStats stats;
+
+#pragma omp for schedule(dynamic)
+        for (idx_t q = 0; q < n; q++) {
+            if (interrupt) {
+                continue;
+            }
+            try {
+                const float* xq = x + q * d;
+                float* D = distances + q * k;
+                idx_t* I = labels + q * k;
+                pool.clear();
+                visited.clear();
+                results.clear();
+                stats.nq++;
+
+                if (ntotal > 0) {
+                    dc->set_query(xq);
+                    pool.push_back(
+                            {sign * (*dc)(entry_point), entry_point, false});
+                    visited.insert(entry_point);
+                    stats.ndis_pq++;
+                }
+
+                while (true) {
+                    // closest candidates not expanded yet
+                    beam.clear();
+                    for (auto& c : pool) {
+                        if (!c.expanded) {
+                            c.expanded = true;
+                            beam.push_back(c.id);
+                            if (beam.size() == beam_size) {
+                                break;
+                            }
+                        }
+                    }
+                    if (beam.empty()) {
+                        break;
+                    }
+                    stats.nhops++;
+
+                    // read the records of the beam in one batch
+                    QueryTraceTimer io_timer(QT_io_wait);
+                    for (size_t b = 0; b < beam.size(); b++) {
+                        size_t offset = node_offset(beam[b]);
+                        size_t sector_offset =
+                                offset / sector_size * sector_size;
+                        pread_all(
+                                file->fd,
+                                buf.data + b * read_size,
+                                read_size,
+                                sector_offset);
+                    }
+                    io_timer.stop();
+                    stats.nreads += beam.size();
+                    stats.nbytes += beam.size() * read_size;
+
+                    for (size_t b = 0; b < beam.size(); b++) {
+                        storage_idx_t id = beam[b];
+                        size_t offset = node_offset(id);
+                        const uint8_t* rec =
+                                buf.data + b * read_size + offset % sector_size;
+                        const float* vec = (const float*)rec;
+
+                        if (!sel || sel->is_member(id)) {
+                            float dis = is_ip ? -fvec_inner_product(xq, vec, d)
+                                              : fvec_L2sqr(xq, vec, d);
+                            results.emplace_back(dis, id);
+                        }
+
+                        const storage_idx_t* links =
+                                (const storage_idx_t*)(rec + d * sizeof(float));
+                        storage_idx_t degree = links[0];
+                        for (storage_idx_t j = 1; j <= degree; j++) {
+                            storage_idx_t nb = links[j];
+                            if (!visited.insert(nb).second) {
+                                continue;
+                            }
+                            float dis = sign * (*dc)(nb);
+                            stats.ndis_pq++;
+                            if (pool.size() == pool_size &&
+                                !(dis < pool.back().dis)) {
+                                continue;
+                            }
+                            Candidate c{dis, nb, false};
+                            pool.insert(
+                                    std::upper_bound(
+                                            pool.begin(), pool.end(), c),
+                                    c);
+                            if (pool.size() > pool_size) {
+                                pool.pop_back();
+                            }
+                        }
+                    }
+                }
+
+                size_t nres = std::min(size_t(k), results.size());
+                std::partial_sort(
+                        results.begin(), results.begin() + nres, results.end());
+                for (size_t i = 0; i < nres; i++) {
+                    D[i] = sign * results[i].first;
+                    I[i] = results[i].second;
+                }
+                for (size_t i = nres; i < k; i++) {
+                    D[i] = is_ip ? -HUGE_VALF : HUGE_VALF;
+                    I[i] = -1;
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                exception_string = e.what();
+                interrupt = true;
+            }
+        }
+
+#pragma omp critical
+        indexDiskGraph_stats.combine(stats);
+        query_trace_add_count(QTC_nq, stats.nq);
+        query_trace_add_count(QTC_nhops, stats.nhops);
+        query_trace_add_count(QTC_ndis, stats.ndis_pq);
+        query_trace_add_count(QTC_nbytes_read, stats.nbytes);
+    }
+
+    if (interrupt) {
+        FAISS_THROW_FMT(
+                "search interrupted with: %s", exception_string.c_str());
+    }
+}
+
+void IndexDiskGraph::reconstruct(idx_t key, float* recons) const {
+    FAISS_THROW_IF_NOT(key >= 0 && key < ntotal);
+    FAISS_THROW_IF_NOT_MSG(file, "file not opened");
+    size_t read_size = node_read_size();
+    SectorBuffer buf(read_size);
+    size_t offset = node_offset(key);
+    pread_all(
+            file->fd, buf.data, read_size, offset / sector_size * sector_size);
+    memcpy(recons, buf.data + offset % sector_size, d * sizeof(float));
+}
+
+void IndexDiskGraph::reset() {
+    file.reset();
+    pq_index.reset();
+    entry_point = -1;
+    ntotal = 0;
+}
+
+} // namespace faiss
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <faiss/IndexPQ.h>
+#include <faiss/impl/NSG.h>
+
+namespace faiss {
+
+struct SearchParametersDiskGraph : SearchParameters {
+    /// size of the candidate list (0 = use the index's search_L)
+    int search_L = 0;
+    /// nb of nodes read from disk per hop (0 = use the index's beam_width)
+    int beam_width = 0;
+
+    ~SearchParametersDiskGraph() {}
+};
+
+/// Statistics of the disk reads of IndexDiskGraph::search
+struct IndexDiskGraphStats {
+    size_t nq = 0;      ///< nb of queries
+    size_t nhops = 0;   ///< nb of beam search iterations
+    size_t nreads = 0;  ///< nb of nodes read from disk
+    size_t nbytes = 0;  ///< nb of bytes read from disk
+    size_t ndis_pq = 0; ///< nb of PQ distances computed
+
+    void reset();
+    void combine(const IndexDiskGraphStats& other);
+};
+
+FAISS_API extern IndexDiskGraphStats indexDiskGraph_stats;
+
+/** Graph index whose vectors and links are stored on disk (DiskANN-style).
+ *
+ * Only the PQ codes of the vectors are kept in RAM. The full-precision
+ * vector and the neighbor list of each node are stored together in a
+ * record of a file, aligned on 4 KiB sectors:
+ *
+ *   sector 0:  header
+ *   sector 1+: node records, nodes_per_sector records per sector, or
+ *              sectors_per_node sectors per record if a record does not
+ *              fit in a sector. A record is
+ *              float vector[d], int32 degree, int32 neighbors[R]
+ *
+ * The search is a beam search on the graph: the candidates are ranked by
+ * their PQ distance to the query, and at each hop the beam_width closest
+ * candidates that were not expanded yet are read from disk in one batch.
+ * The exact distances of the nodes read are used for the results, so the
+ * vectors do not need to be read again for re-ranking.
+ *
+ * The graph is built with NSG in RAM by add(), or can be provided with
+ * add_graph() (eg. NSG final_graph or level 0 of an HNSW graph).
+ *
+ * The file is written at add time and opened read-only afterwards. The
+ * index itself (PQ codes, layout and file name) is serialized with
+ * write_index, the file is not copied.
+ */
+struct IndexDiskGraph : Index {
+    using storage_idx_t = int32_t;
+
+    /// codes used to rank the candidates, kept in RAM
+    IndexPQ pq_index;
+
+    /// file storing the vectors and the graph
+    std::string filename;
+
+    /// max nb of neighbors per node
+    int R = 32;
+
+    /// build-time parameters of the NSG graph built by add()
+    int GK = 64;
+    char build_type = 0;
+
+    /// search-time parameters
+    int search_L = 64;
+    int beam_width = 4;
+
+    /// node searched first
+    storage_idx_t entry_point = -1;
+
+    static constexpr size_t sector_size = 4096;
+
+    /// layout of the records in the file
+    size_t node_size = 0;
+    size_t nodes_per_sector = 0;
+    size_t sectors_per_node = 0;
+
+    /**
+     * @param pq_M     nb of PQ sub-quantizers of the in-RAM codes
+     * @param filename file where the graph is written by add
+     */
+    IndexDiskGraph(
+            int d,
+            int pq_M,
+            const std::string& filename,
+            int R = 32,
+            MetricType metric = METRIC_L2,
+            int pq_nbits = 8);
+
+    IndexDiskGraph();
+
+    ~IndexDiskGraph() override;
+
+    /// trains the PQ
+    void train(idx_t n, const float* x) override;
+
+    /// builds the NSG graph of the vectors and writes the file. The index
+    /// is built once, all the vectors must be added in a single call.
+    void add(idx_t n, const float* x) override;
+
+    /** writes the file for a given graph of the n vectors.
+     *
+     * @param graph  graph.at(i, j) is the j-th neighbor of node i,
+     *               negative entries are ignored; graph.K <= R
+     */
+    void add_graph(
+            idx_t n,
+            const float* x,
+            const nsg::Graph<storage_idx_t>& graph,
+            storage_idx_t entry_point);
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    /// reads the vector from disk
+    void reconstruct(idx_t key, float* recons) const override;
+
+    /// forgets the vectors, the file is left as is
+    void reset() override;
+
+    /// opens the file for reading and checks that it matches the index
+    void open();
+
+    /// offset of the record of a node in the file
+    size_t node_offset(idx_t i) const;
+
+    /// nb of bytes to read for a record
+    size_t node_read_size() const;
+
+   private:
+    struct File;
+    std::shared_ptr<File> file;
+};
+
+} // namespace faiss
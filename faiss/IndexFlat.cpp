@@ -701,6 +701,18 @@ inline void flat_pano_search_core(
  * IndexFlatPanorama
  ***************************************************/
 
+void IndexFlatPanorama::train(idx_t n, const float* x) {
+    if (!auto_tune) {
+        return;
+    }
+    FAISS_THROW_IF_NOT_MSG(
+            ntotal == 0, "cannot calibrate a non-empty IndexFlatPanorama");
+    // keep the batches large enough for the usual values of k
+    pano.calibrate(n, x, metric_type, 256, 2048);
+    n_levels = pano.n_levels;
+    batch_size = pano.batch_size;
+}
+
 void IndexFlatPanorama::add(idx_t n, const float* x) {
     size_t offset = ntotal;
     ntotal += n;
@@ -907,13 +919,12 @@ void IndexFlatPanorama::search_subset(
 
                         bool pruned = false;
                         for (size_t level = 0; level < n_levels; level++) {
+                            size_t actual_level_width =
+                                    pano.level_size(level);
                             local_stats.total_dims_scanned +=
-                                    pano.level_width_floats;
+                                    actual_level_width;
 
                             // Refine distance
-                            size_t actual_level_width = std::min(
-                                    pano.level_width_floats,
-                                    d - level * pano.level_width_floats);
                             float dot_product = fvec_inner_product<SL>(
                                     x_ptr, p_ptr, actual_level_width);
                             if constexpr (is_sim) {
@@ -946,8 +957,8 @@ void IndexFlatPanorama::search_subset(
                             }
 
                             cum_sum_offset++;
-                            x_ptr += pano.level_width_floats;
-                            p_ptr += pano.level_width_floats;
+                            x_ptr += actual_level_width;
+                            p_ptr += actual_level_width;
                         }
 
                         if (!pruned) {
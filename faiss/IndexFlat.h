@@ -101,11 +101,16 @@ struct IndexFlatL2 : IndexFlat {
 };
 
 struct IndexFlatPanorama : IndexFlat {
-    const size_t batch_size;
-    const size_t n_levels;
+    size_t batch_size;
+    size_t n_levels;
     std::vector<float> cum_sums;
     Panorama pano;
 
+    /// if set, train() replaces n_levels and batch_size with values
+    /// calibrated on the training set (see Panorama::calibrate). The levels
+    /// may then have different widths.
+    bool auto_tune = false;
+
     /**
      * @param d dimensionality of the input vectors
      * @param metric metric type
@@ -125,6 +130,10 @@ struct IndexFlatPanorama : IndexFlat {
                 metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
     }
 
+    /// calibrates the levels and batch size if auto_tune is set, the index
+    /// must be empty
+    void train(idx_t n, const float* x) override;
+
     void add(idx_t n, const float* x) override;
 
     void search(
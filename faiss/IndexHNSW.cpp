@@ -26,6 +26,7 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/QueryTrace.h>
 #include <faiss/impl/ResultHandler.h>
 #include <faiss/impl/VisitedTable.h>
 #include <faiss/utils/random.h>
@@ -277,7 +278,9 @@ void hnsw_search(
                 res.begin(i);
                 dis->set_query(x + i * index->d);
 
+                QueryTraceTimer graph_timer(QT_graph_search);
                 HNSWStats stats = hnsw.search(*dis, index, res, vt, params);
+                graph_timer.stop();
                 n1 += stats.n1;
                 n2 += stats.n2;
                 ndis += stats.ndis;
@@ -289,6 +292,9 @@ void hnsw_search(
     }
 
     hnsw_stats.combine({n1, n2, ndis, nhops});
+    query_trace_add_count(QTC_nq, n);
+    query_trace_add_count(QTC_ndis, ndis);
+    query_trace_add_count(QTC_nhops, nhops);
 }
 
 } // anonymous namespace
@@ -25,6 +25,7 @@
 #include <faiss/impl/CodePacker.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
+#include <faiss/impl/QueryTrace.h>
 #include <faiss/impl/ResultHandler.h>
 #include <faiss/impl/expanded_scanners.h>
 
@@ -309,6 +310,9 @@ void IndexIVF::search(
     if (params_in) {
         params = dynamic_cast<const IVFSearchParameters*>(params_in);
         FAISS_THROW_IF_NOT_MSG(params, "IndexIVF params have incorrect type");
+        FAISS_THROW_IF_NOT_MSG(
+                !params->init_threshold,
+                "init_threshold is supported only by search_preassigned");
     }
     const size_t nprobe =
             std::min(nlist, params ? params->nprobe : this->nprobe);
@@ -325,6 +329,7 @@ void IndexIVF::search(
         std::unique_ptr<float[]> coarse_dis(new float[n * nprobe]);
 
         double t0 = getmillisecs();
+        QueryTraceTimer coarse_timer(QT_coarse_quantization);
         quantizer->search(
                 n,
                 x,
@@ -332,6 +337,7 @@ void IndexIVF::search(
                 coarse_dis.get(),
                 idx.get(),
                 params ? params->quantizer_params : nullptr);
+        coarse_timer.stop();
 
         double t1 = getmillisecs();
         invlists->prefetch_lists(idx.get(), n * nprobe);
@@ -458,12 +464,49 @@ void IndexIVF::search_preassigned(
 
     void* inverted_list_context =
             params ? params->inverted_list_context : nullptr;
+    const float* init_threshold = params ? params->init_threshold : nullptr;
 
 #pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis, nheap)
     {
         std::unique_ptr<InvertedListScanner> scanner(
                 get_InvertedListScanner(store_pairs, sel, params));
 
+        // with a selector, lists whose id summary shows that all their ids
+        // are selected are scanned without the selector
+        std::unique_ptr<InvertedListScanner> scanner_all;
+        const float* query = nullptr;
+        const float* scanner_all_query = nullptr;
+
+        auto set_query = [&](const float* xi) {
+            scanner->set_query(xi);
+            query = xi;
+        };
+
+        // scanner to use for a list, nullptr if no id can be selected
+        auto select_scanner = [&](idx_t key) -> InvertedListScanner* {
+            const IDSummary* summary =
+                    sel ? invlists->get_id_summary(key) : nullptr;
+            if (!summary) {
+                return scanner.get();
+            }
+            IDSummaryCheck check = sel->check_summary(*summary);
+            if (check == IDSC_none) {
+                return nullptr;
+            }
+            if (check == IDSC_some) {
+                return scanner.get();
+            }
+            if (!scanner_all) {
+                scanner_all.reset(
+                        get_InvertedListScanner(store_pairs, nullptr, params));
+            }
+            if (scanner_all_query != query) {
+                scanner_all->set_query(query);
+                scanner_all_query = query;
+            }
+            return scanner_all.get();
+        };
+
         /*****************************************************
          * Depending on parallel_mode, there are two possible ways
          * to organize the search. Here we define local functions
@@ -472,7 +515,7 @@ void IndexIVF::search_preassigned(
 
         // initialize + reorder a result heap
 
-        auto init_result = [&](float* simi, idx_t* idxi) {
+        auto init_result = [&](float* simi, idx_t* idxi, idx_t i) {
             if (!do_heap_init) {
                 return;
             }
@@ -481,6 +524,10 @@ void IndexIVF::search_preassigned(
             } else {
                 heap_heapify<HeapForL2>(k, simi, idxi);
             }
+            if (init_threshold) {
+                // a heap of equal values with ids -1 is a valid heap
+                std::fill(simi, simi + k, init_threshold[i]);
+            }
         };
 
         auto add_local_results = [&](const float* local_dis,
@@ -527,18 +574,26 @@ void IndexIVF::search_preassigned(
                 return (size_t)0;
             }
 
-            scanner->set_list(key, coarse_dis_i);
+            InvertedListScanner* list_scanner = select_scanner(key);
+            if (!list_scanner) {
+                return (size_t)0;
+            }
+
+            QueryTraceTimer lut_timer(QT_lut_build);
+            list_scanner->set_list(key, coarse_dis_i);
+            lut_timer.stop();
 
             nlistv++;
 
             try {
+                QueryTraceTimer scan_timer(QT_list_scan);
                 if (invlists->use_iterator) {
                     size_t list_size = 0;
 
                     std::unique_ptr<InvertedListsIterator> it(
                             invlists->get_iterator(key, inverted_list_context));
 
-                    nheap += scanner->iterate_codes(
+                    nheap += list_scanner->iterate_codes(
                             it.get(), simi, idxi, k, list_size);
 
                     return list_size;
@@ -573,7 +628,7 @@ void IndexIVF::search_preassigned(
                         ids += jmin;
                     }
 
-                    nheap += scanner->scan_codes(
+                    nheap += list_scanner->scan_codes(
                             list_size, codes, ids, simi, idxi, k);
 
                     return list_size;
@@ -599,11 +654,11 @@ void IndexIVF::search_preassigned(
                 }
 
                 // loop over queries
-                scanner->set_query(x + i * d);
+                set_query(x + i * d);
                 float* simi = distances + i * k;
                 idx_t* idxi = labels + i * k;
 
-                init_result(simi, idxi);
+                init_result(simi, idxi, i);
 
                 idx_t nscan = 0;
 
@@ -633,8 +688,8 @@ void IndexIVF::search_preassigned(
             std::vector<float> local_dis(k);
 
             for (size_t i = 0; i < n; i++) {
-                scanner->set_query(x + i * d);
-                init_result(local_dis.data(), local_idx.data());
+                set_query(x + i * d);
+                init_result(local_dis.data(), local_idx.data(), i);
 
 #pragma omp for schedule(dynamic)
                 for (idx_t ik = 0; ik < nprobe; ik++) {
@@ -652,7 +707,7 @@ void IndexIVF::search_preassigned(
                 float* simi = distances + i * k;
                 idx_t* idxi = labels + i * k;
 #pragma omp single
-                init_result(simi, idxi);
+                init_result(simi, idxi, i);
 
 #pragma omp barrier
 #pragma omp critical
@@ -670,15 +725,15 @@ void IndexIVF::search_preassigned(
 
 #pragma omp single
             for (int64_t i = 0; i < n; i++) {
-                init_result(distances + i * k, labels + i * k);
+                init_result(distances + i * k, labels + i * k, i);
             }
 
 #pragma omp for schedule(dynamic)
             for (int64_t ij = 0; ij < n * nprobe; ij++) {
                 size_t i = ij / nprobe;
 
-                scanner->set_query(x + i * d);
-                init_result(local_dis.data(), local_idx.data());
+                set_query(x + i * d);
+                init_result(local_dis.data(), local_idx.data(), i);
                 ndis += scan_one_list(
                         keys[ij],
                         coarse_dis[ij],
@@ -719,6 +774,10 @@ void IndexIVF::search_preassigned(
     ivf_stats->nlist += nlistv;
     ivf_stats->ndis += ndis;
     ivf_stats->nheap_updates += nheap;
+    query_trace_add_count(QTC_nq, n);
+    query_trace_add_count(QTC_nlist, nlistv);
+    query_trace_add_count(QTC_ndis, ndis);
+    query_trace_add_count(QTC_nheap_updates, nheap);
 }
 
 void IndexIVF::range_search(
@@ -740,8 +799,10 @@ void IndexIVF::range_search(
     std::unique_ptr<float[]> coarse_dis(new float[nx * nprobe]);
 
     double t0 = getmillisecs();
+    QueryTraceTimer coarse_timer(QT_coarse_quantization);
     quantizer->search(
             nx, x, nprobe, coarse_dis.get(), keys.get(), quantizer_params);
+    coarse_timer.stop();
     indexIVF_stats.quantization_time += getmillisecs() - t0;
 
     t0 = getmillisecs();
@@ -827,9 +888,18 @@ void IndexIVF::range_search_preassigned(
                 return;
             }
 
+            const IDSummary* summary =
+                    sel ? invlists->get_id_summary(key) : nullptr;
+            if (summary && sel->check_summary(*summary) == IDSC_none) {
+                return;
+            }
+
             try {
                 size_t list_size = 0;
+                QueryTraceTimer lut_timer(QT_lut_build);
                 scanner->set_list(key, coarse_dis[i * nprobe + ik]);
+                lut_timer.stop();
+                QueryTraceTimer scan_timer(QT_list_scan);
                 if (invlists->use_iterator) {
                     std::unique_ptr<InvertedListsIterator> it(
                             invlists->get_iterator(key, inverted_list_context));
@@ -918,6 +988,9 @@ void IndexIVF::range_search_preassigned(
     stats->nq += nx;
     stats->nlist += nlistv;
     stats->ndis += ndis;
+    query_trace_add_count(QTC_nq, nx);
+    query_trace_add_count(QTC_nlist, nlistv);
+    query_trace_add_count(QTC_ndis, ndis);
 }
 
 void IndexIVF::search1(
@@ -938,8 +1011,10 @@ void IndexIVF::search1(
     std::unique_ptr<float[]> coarse_dis(new float[nx * nprobe]);
 
     double t0 = getmillisecs();
+    QueryTraceTimer coarse_timer(QT_coarse_quantization);
     quantizer->search(
             nx, x, nprobe, coarse_dis.get(), keys.get(), quantizer_params);
+    coarse_timer.stop();
     indexIVF_stats.quantization_time += getmillisecs() - t0;
 
     t0 = getmillisecs();
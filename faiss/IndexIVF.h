@@ -71,6 +71,12 @@ struct SearchParametersIVF : SearchParameters {
     SearchParameters* quantizer_params = nullptr;
     /// context object to pass to InvertedLists
     void* inverted_list_context = nullptr;
+    /// if non-null, per-query bound used to initialize the result heaps of
+    /// search_preassigned: results that are not better than
+    /// init_threshold[i] are not collected for query i (IndexShards uses
+    /// this to share the k-th distance across shards). Index types that do
+    /// not support it may ignore it.
+    const float* init_threshold = nullptr;
 
     virtual ~SearchParametersIVF() {}
 };
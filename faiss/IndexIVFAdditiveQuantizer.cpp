@@ -11,11 +11,14 @@
 #include <cmath>
 #include <cstring>
 
+#include <faiss/IndexIVFPQ.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/ResidualQuantizer.h>
 #include <faiss/impl/ResultHandler.h>
+#include <faiss/invlists/DirectMap.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/extra_distances.h>
+#include <faiss/utils/pq_code_distance.h>
 
 namespace faiss {
 
@@ -42,6 +45,35 @@ void IndexIVFAdditiveQuantizer::train_encoder(
         const float* x,
         const idx_t* assign) {
     aq->train(n, x);
+    if (by_residual) {
+        precompute_table();
+    }
+}
+
+void IndexIVFAdditiveQuantizer::precompute_table() {
+    precomputed_table.clear();
+    if (use_precomputed_table == -1) {
+        return;
+    }
+    use_precomputed_table = 0;
+    if (!by_residual || metric_type != METRIC_L2 ||
+        aq->search_type == AdditiveQuantizer::ST_decompress) {
+        return;
+    }
+    size_t K = aq->total_codebook_size;
+    if (nlist * K * sizeof(float) > precomputed_table_max_bytes) {
+        if (verbose) {
+            printf("IndexIVFAdditiveQuantizer::precompute_table: "
+                   "not computing table, too large (%zd bytes)\n",
+                   nlist * K * sizeof(float));
+        }
+        return;
+    }
+    std::vector<float> centroids(nlist * d);
+    quantizer->reconstruct_n(0, nlist, centroids.data());
+    precomputed_table.resize(nlist * K);
+    aq->compute_LUT(nlist, centroids.data(), precomputed_table.data());
+    use_precomputed_table = 1;
 }
 
 idx_t IndexIVFAdditiveQuantizer::train_encoder_num_vectors() const {
@@ -237,6 +269,20 @@ struct AQInvertedListScannerLUT : AQInvertedListScanner {
     std::vector<float> LUT, tmp;
     float distance_bias;
 
+    /** how the LUT of a list is obtained:
+     * - LUT_per_query: the query is not a residual, the LUT is the same for
+     *   all lists
+     * - LUT_precomputed: LUT_query minus the precomputed table of the list
+     * - LUT_per_list: computed from the residual of the query
+     */
+    enum { LUT_per_query, LUT_precomputed, LUT_per_list } lut_mode;
+    std::vector<float> LUT_query;
+
+    /// the codes start with M bytes, one per codebook
+    bool byte_codes;
+    /// decoded values of the quantized norms
+    std::vector<float> norm_tab;
+
     AQInvertedListScannerLUT(
             const IndexIVFAdditiveQuantizer& ia,
             bool store_pairs)
@@ -244,6 +290,40 @@ struct AQInvertedListScannerLUT : AQInvertedListScanner {
         LUT.resize(aq.total_codebook_size);
         tmp.resize(ia.d);
         distance_bias = 0;
+        if (is_IP || !ia.by_residual) {
+            lut_mode = LUT_per_query;
+        } else if (
+                ia.use_precomputed_table == 1 &&
+                ia.precomputed_table.size() ==
+                        ia.nlist * aq.total_codebook_size) {
+            lut_mode = LUT_precomputed;
+            LUT_query.resize(aq.total_codebook_size);
+        } else {
+            lut_mode = LUT_per_list;
+        }
+        byte_codes = aq.only_8bit &&
+                search_type != AdditiveQuantizer::ST_norm_from_LUT;
+        if (byte_codes && norm_code_bits() > 0) {
+            norm_tab.resize(size_t(1) << norm_code_bits());
+            for (size_t i = 0; i < norm_tab.size(); i++) {
+                norm_tab[i] = aq.decode_norm(i);
+            }
+        }
+    }
+
+    /// nb of bits of the norms decoded with norm_tab
+    static constexpr int norm_code_bits() {
+        if constexpr (
+                search_type == AdditiveQuantizer::ST_norm_qint8 ||
+                search_type == AdditiveQuantizer::ST_norm_cqint8) {
+            return 8;
+        } else if constexpr (
+                search_type == AdditiveQuantizer::ST_norm_qint4 ||
+                search_type == AdditiveQuantizer::ST_norm_cqint4) {
+            return 4;
+        } else {
+            return 0;
+        }
     }
 
     /// from now on we handle this query.
@@ -252,14 +332,31 @@ struct AQInvertedListScannerLUT : AQInvertedListScanner {
         if (!is_IP && !ia.by_residual) {
             distance_bias = fvec_norm_L2sqr(query_vector, ia.d);
         }
+        if (lut_mode == LUT_per_query) {
+            aq.compute_LUT(1, q0, LUT.data());
+        } else if (lut_mode == LUT_precomputed) {
+            aq.compute_LUT(1, q0, LUT_query.data());
+        }
     }
 
     /// following codes come from this inverted list
     void set_list(idx_t list_no, float coarse_dis) override {
-        AQInvertedListScanner::set_list(list_no, coarse_dis);
-        // TODO find a way to provide the nprobes together to do a matmul
-        // +  precompute tables
-        aq.compute_LUT(1, q, LUT.data());
+        if (lut_mode == LUT_per_list) {
+            AQInvertedListScanner::set_list(list_no, coarse_dis);
+            // TODO find a way to provide the nprobes together to do a matmul
+            aq.compute_LUT(1, q, LUT.data());
+        } else {
+            this->list_no = list_no;
+            if (lut_mode == LUT_precomputed) {
+                size_t K = aq.total_codebook_size;
+                fvec_madd(
+                        K,
+                        LUT_query.data(),
+                        -1.0f,
+                        ia.precomputed_table.data() + list_no * K,
+                        LUT.data());
+            }
+        }
 
         if (ia.by_residual) {
             distance_bias = coarse_dis;
@@ -272,6 +369,89 @@ struct AQInvertedListScannerLUT : AQInvertedListScanner {
                 aq.compute_1_distance_LUT<is_IP, search_type>(code, LUT.data());
     }
 
+    /// same as compute_1_distance_LUT, given the sum of the LUT entries
+    float finalize_distance(float accu, const uint8_t* code) const {
+        if constexpr (is_IP) {
+            return accu;
+        } else if constexpr (search_type == AdditiveQuantizer::ST_LUT_nonorm) {
+            return -accu;
+        } else if constexpr (search_type == AdditiveQuantizer::ST_norm_float) {
+            float norm2;
+            memcpy(&norm2, code + aq.M, sizeof(norm2));
+            return norm2 - 2 * accu;
+        } else if constexpr (norm_code_bits() == 4) {
+            return norm_tab[code[aq.M] & 15] - 2 * accu;
+        } else {
+            return norm_tab[code[aq.M]] - 2 * accu;
+        }
+    }
+
+    /// With 8-bit codebooks, the LUT has the same layout as a PQ distance
+    /// table, so the sums of LUT entries are computed 4 codes at a time
+    /// with the PQ code distance kernels (SIMD gathers when available).
+    template <class C>
+    size_t scan_byte_codes(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            ResultHandler& handler) const {
+        const size_t M = aq.M;
+        size_t nup = 0;
+        float accu[4];
+        for (size_t j0 = 0; j0 < list_size; j0 += 4) {
+            const size_t nj = std::min(list_size - j0, size_t(4));
+            const uint8_t* c = codes + j0 * code_size;
+            if (nj == 4) {
+                pq_code_distance_four(
+                        M,
+                        8,
+                        LUT.data(),
+                        c,
+                        c + code_size,
+                        c + 2 * code_size,
+                        c + 3 * code_size,
+                        accu[0],
+                        accu[1],
+                        accu[2],
+                        accu[3]);
+            } else {
+                for (size_t jj = 0; jj < nj; jj++) {
+                    accu[jj] = pq_code_distance_single(
+                            M, 8, LUT.data(), c + jj * code_size);
+                }
+            }
+            for (size_t jj = 0; jj < nj; jj++) {
+                float dis = distance_bias +
+                        finalize_distance(accu[jj], c + jj * code_size);
+                if (C::cmp(handler.threshold, dis)) {
+                    size_t j = j0 + jj;
+                    idx_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                    handler.add_result(dis, id);
+                    nup++;
+                }
+            }
+        }
+        return nup;
+    }
+
+    size_t scan_codes(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            ResultHandler& handler) const override {
+        if (!byte_codes) {
+            return InvertedListScanner::scan_codes(
+                    list_size, codes, ids, handler);
+        }
+        if (keep_max) {
+            return scan_byte_codes<CMin<float, idx_t>>(
+                    list_size, codes, ids, handler);
+        } else {
+            return scan_byte_codes<CMax<float, idx_t>>(
+                    list_size, codes, ids, handler);
+        }
+    }
+
     ~AQInvertedListScannerLUT() override = default;
 };
 
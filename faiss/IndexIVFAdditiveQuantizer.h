@@ -26,7 +26,17 @@ namespace faiss {
 struct IndexIVFAdditiveQuantizer : IndexIVF {
     // the quantizer
     AdditiveQuantizer* aq;
-    int use_precomputed_table = 0; // for future use
+
+    /** Precomputed table that speeds up the computation of the LUTs of
+     * residuals (by_residual with L2). For list l it contains the inner
+     * products of centroid l with the codebook entries, so that the LUT of
+     * the residual is LUT(query) - table[l].
+     * -1: disabled, 0: not computed, 1: computed
+     */
+    int use_precomputed_table = 0;
+
+    /// size nlist * aq->total_codebook_size (not serialized)
+    std::vector<float> precomputed_table;
 
     using Search_type_t = AdditiveQuantizer::Search_type_t;
 
@@ -44,6 +54,10 @@ struct IndexIVFAdditiveQuantizer : IndexIVF {
 
     idx_t train_encoder_num_vectors() const override;
 
+    /// build the precomputed table if it is useful and does not exceed
+    /// precomputed_table_max_bytes
+    void precompute_table();
+
     void encode_vectors(
             idx_t n,
             const float* x,
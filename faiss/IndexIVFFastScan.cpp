@@ -19,6 +19,7 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/FastScanDistancePostProcessing.h>
 #include <faiss/impl/LookupTableScaler.h>
+#include <faiss/impl/QueryTrace.h>
 #include <faiss/impl/RaBitQUtils.h>
 #include <faiss/impl/pq4_fast_scan.h>
 #include <faiss/impl/simd_result_handlers.h>
@@ -281,6 +282,7 @@ void IndexIVFFastScan::compute_LUT_uint8(
         AlignedTable<uint16_t>& biases,
         float* normalizers,
         const FastScanDistancePostProcessing& context) const {
+    QueryTraceTimer lut_timer(QT_lut_build);
     AlignedTable<float> dis_tables_float;
     AlignedTable<float> biases_float;
 
@@ -440,6 +442,7 @@ struct CoarseQuantizedWithBuffer : CoarseQuantized {
             const SearchParameters* quantizer_params) {
         dis_buffer.resize(nprobe * n);
         ids_buffer.resize(nprobe * n);
+        QueryTraceTimer coarse_timer(QT_coarse_quantization);
         quantizer->search(
                 n,
                 x,
@@ -679,6 +682,9 @@ void IndexIVFFastScan::search_dispatch_implem(
         indexIVF_stats.nq += n;
         indexIVF_stats.ndis += ndis;
         indexIVF_stats.nlist += nlist_visited;
+        query_trace_add_count(QTC_nq, n);
+        query_trace_add_count(QTC_ndis, ndis);
+        query_trace_add_count(QTC_nlist, nlist_visited);
     } else {
         FAISS_THROW_FMT("implem %d does not exist", implem);
     }
@@ -819,7 +825,9 @@ void IndexIVFFastScan::search_implem_1(
     AlignedTable<float> biases;
 
     FastScanDistancePostProcessing empty_context;
+    QueryTraceTimer lut_timer(QT_lut_build);
     compute_LUT(n, x, cq, dis_tables, biases, empty_context);
+    lut_timer.stop();
 
     bool single_LUT = !lookup_table_is_3d();
 
@@ -1023,6 +1031,7 @@ void IndexIVFFastScan::search_implem_10(
             probe_map[0] = static_cast<int>(j);
             handler.set_list_context(list_no, probe_map);
 
+            QueryTraceTimer scan_timer(QT_list_scan);
             pq4_accumulate_loop(
                     1,
                     roundup(ls, bbs),
@@ -1176,6 +1185,7 @@ void IndexIVFFastScan::search_implem_12(
         }
         handler.set_list_context(list_no, probe_map);
 
+        QueryTraceTimer scan_timer(QT_list_scan);
         pq4_accumulate_loop_qbs(
                 qbs_for_list,
                 list_size,
@@ -1400,6 +1410,7 @@ void IndexIVFFastScan::search_implem_14(
             }
             handler->set_list_context(list_no, probe_map);
 
+            QueryTraceTimer scan_timer(QT_list_scan);
             pq4_accumulate_loop_qbs(
                     qbs_for_list,
                     list_size,
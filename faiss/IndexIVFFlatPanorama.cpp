@@ -44,6 +44,26 @@ IndexIVFFlatPanorama::IndexIVFFlatPanorama(
 
 IndexIVFFlatPanorama::IndexIVFFlatPanorama() : n_levels(0) {}
 
+void IndexIVFFlatPanorama::train_encoder(
+        idx_t n,
+        const float* x,
+        const idx_t* assign) {
+    IndexIVFFlat::train_encoder(n, x, assign);
+    if (!auto_tune) {
+        return;
+    }
+    ArrayInvertedListsPanorama* storage =
+            dynamic_cast<ArrayInvertedListsPanorama*>(invlists);
+    FAISS_THROW_IF_NOT_MSG(
+            storage,
+            "IndexIVFFlatPanorama requires ArrayInvertedListsPanorama");
+    Panorama pano = storage->pano;
+    // the inverted lists are short, so are the batches
+    pano.calibrate(n, x, metric_type, 64, 512);
+    storage->set_panorama(pano);
+    n_levels = pano.n_levels;
+}
+
 namespace {
 
 template <typename VectorDistance, bool use_sel>
@@ -92,19 +112,19 @@ struct IVFFlatScannerPanorama : InvertedListScanner {
             ResultHandler& handler) const override {
         size_t nup = 0;
 
-        const size_t n_batches =
-                (list_size + storage->kBatchSize - 1) / storage->kBatchSize;
+        const size_t batch_size = storage->pano.batch_size;
+        const size_t n_batches = (list_size + batch_size - 1) / batch_size;
 
         const float* cum_sums_data = storage->get_cum_sums(list_no);
 
-        std::vector<float> exact_distances(storage->kBatchSize);
-        std::vector<uint32_t> active_indices(storage->kBatchSize);
+        std::vector<float> exact_distances(batch_size);
+        std::vector<uint32_t> active_indices(batch_size);
 
         PanoramaStats local_stats;
         local_stats.reset();
 
         for (size_t batch_no = 0; batch_no < n_batches; batch_no++) {
-            size_t batch_start = batch_no * storage->kBatchSize;
+            size_t batch_start = batch_no * batch_size;
 
             size_t num_active = with_metric_type(metric, [&]<MetricType M>() {
                 return storage->pano.progressive_filter_batch<C, M>(
@@ -35,11 +35,19 @@ namespace faiss {
 /// We inherit from IndexIVFFlat instead of IndexIVF so we can keep the same
 /// insertion logic. The code responsible for level-oriented storage is in
 /// `ArrayInvertedListsPanorama`, which is a struct member of `IndexIVF`.
+///
+/// AUTO-TUNING:
+/// If auto_tune is set, training calibrates the level split (which may then
+/// be non-uniform) and the batch size of the inverted lists on the training
+/// vectors, see Panorama::calibrate. n_levels is updated accordingly.
 struct IndexIVFFlatPanorama : IndexIVFFlat {
     size_t n_levels;
 
     std::vector<MaybeOwnedVector<float>> cum_sums;
 
+    /// calibrate the Panorama layout at training time
+    bool auto_tune = false;
+
     explicit IndexIVFFlatPanorama(
             Index* quantizer,
             size_t d,
@@ -48,6 +56,8 @@ struct IndexIVFFlatPanorama : IndexIVFFlat {
             MetricType = METRIC_L2,
             bool own_invlists = true);
 
+    void train_encoder(idx_t n, const float* x, const idx_t* assign) override;
+
     InvertedListScanner* get_InvertedListScanner(
             bool store_pairs,
             const IDSelector* sel,
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexIVFPQPanorama.h>
+
+#include <cstring>
+#include <memory>
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+/*****************************************
+ * IndexIVFPQPanorama implementation
+ ******************************************/
+
+IndexIVFPQPanorama::IndexIVFPQPanorama(
+        Index* quantizer,
+        size_t d,
+        size_t nlist,
+        size_t M,
+        size_t nbits_per_idx,
+        size_t n_levels,
+        MetricType metric,
+        bool own_invlists)
+        : IndexIVFPQ(
+                  quantizer,
+                  d,
+                  nlist,
+                  M,
+                  nbits_per_idx,
+                  metric,
+                  own_invlists),
+          n_levels(n_levels) {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    FAISS_THROW_IF_NOT_MSG(
+            nbits_per_idx == 8,
+            "IndexIVFPQPanorama supports only 8-bit sub-quantizers");
+    // the look-up tables are computed per list
+    use_precomputed_table = -1;
+    code_size = get_panorama_codes().code_size();
+    if (invlists) {
+        invlists->code_size = code_size;
+    }
+}
+
+IndexIVFPQPanorama::IndexIVFPQPanorama() {
+    use_precomputed_table = -1;
+}
+
+PanoramaCodes IndexIVFPQPanorama::get_panorama_codes() const {
+    return PanoramaCodes(d, n_levels, pq.dsub, pq.code_size);
+}
+
+void IndexIVFPQPanorama::encode_vectors(
+        idx_t n,
+        const float* x,
+        const idx_t* list_nos,
+        uint8_t* codes,
+        bool include_listnos) const {
+    PanoramaCodes pano = get_panorama_codes();
+    size_t coarse_size = include_listnos ? coarse_code_size() : 0;
+    memset(codes, 0, (code_size + coarse_size) * n);
+
+#pragma omp parallel if (n > 1000)
+    {
+        std::vector<float> residual(d);
+        std::vector<float> recons(d);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            int64_t list_no = list_nos[i];
+            if (list_no >= 0) {
+                const float* xi = x + i * d;
+                uint8_t* code = codes + i * (code_size + coarse_size);
+                if (by_residual) {
+                    quantizer->compute_residual(xi, residual.data(), list_no);
+                    xi = residual.data();
+                }
+                if (coarse_size) {
+                    encode_listno(list_no, code);
+                }
+                code += coarse_size;
+                pq.compute_code(xi, code);
+                pq.decode(code, recons.data());
+                pano.encode_norms(recons.data(), code);
+            }
+        }
+    }
+}
+
+void IndexIVFPQPanorama::decode_vectors(
+        idx_t n,
+        const uint8_t* codes,
+        const idx_t* listnos,
+        float* x) const {
+    std::vector<float> centroid(d);
+    for (idx_t i = 0; i < n; i++) {
+        float* xi = x + i * d;
+        pq.decode(codes + i * code_size, xi);
+        if (by_residual) {
+            quantizer->reconstruct(listnos[i], centroid.data());
+            for (size_t j = 0; j < d; j++) {
+                xi[j] += centroid[j];
+            }
+        }
+    }
+}
+
+void IndexIVFPQPanorama::add_core(
+        idx_t n,
+        const float* x,
+        const idx_t* xids,
+        const idx_t* coarse_idx,
+        void* inverted_list_context) {
+    // goes through encode_vectors to fill in the norms
+    IndexIVF::add_core(n, x, xids, coarse_idx, inverted_list_context);
+}
+
+namespace {
+
+template <class C>
+struct IVFPQScannerPanorama
+        : IVFPanoramaScanner<C, IVFPQScannerPanorama<C>> {
+    using Base = IVFPanoramaScanner<C, IVFPQScannerPanorama<C>>;
+
+    const IndexIVFPQPanorama& index;
+    const ProductQuantizer& pq;
+
+    // level l covers sub-quantizers [level_m[l], level_m[l + 1])
+    std::vector<size_t> level_m;
+
+    // M * ksub look-up table
+    std::vector<float> sim_table;
+
+    const float* x = nullptr;
+    std::vector<float> residual;
+
+    IVFPQScannerPanorama(
+            const IndexIVFPQPanorama& index,
+            bool store_pairs,
+            const IDSelector* sel)
+            : Base(index.get_panorama_codes(), store_pairs, sel),
+              index(index),
+              pq(index.pq),
+              sim_table(pq.M * pq.ksub),
+              residual(index.d) {
+        for (size_t dim : this->pano.level_dims) {
+            level_m.push_back(dim / pq.dsub);
+        }
+    }
+
+    void compute_tables(const float* q) {
+        if (C::is_max) {
+            pq.compute_distance_table(q, sim_table.data());
+        } else {
+            pq.compute_inner_prod_table(q, sim_table.data());
+        }
+        this->pano.compute_suffix_norms(q, this->q_norms.data());
+    }
+
+    void set_query(const float* query) override {
+        x = query;
+        if (!index.by_residual || !C::is_max) {
+            compute_tables(x);
+        }
+    }
+
+    void set_list(idx_t list_no, float coarse_dis) override {
+        this->list_no = list_no;
+        if (index.by_residual) {
+            if (C::is_max) {
+                index.quantizer->compute_residual(
+                        x, residual.data(), list_no);
+                compute_tables(residual.data());
+            } else {
+                this->accu0 = coarse_dis;
+            }
+        }
+    }
+
+    float partial_distance(size_t l, const uint8_t* code) const {
+        const float* tab = sim_table.data() + level_m[l] * pq.ksub;
+        float dis = 0;
+        for (size_t m = level_m[l]; m < level_m[l + 1]; m++) {
+            dis += tab[code[m]];
+            tab += pq.ksub;
+        }
+        return dis;
+    }
+};
+
+} // anonymous namespace
+
+InvertedListScanner* IndexIVFPQPanorama::get_InvertedListScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
+    if (metric_type == METRIC_L2) {
+        return new IVFPQScannerPanorama<CMax<float, idx_t>>(
+                *this, store_pairs, sel);
+    } else if (metric_type == METRIC_INNER_PRODUCT) {
+        return new IVFPQScannerPanorama<CMin<float, idx_t>>(
+                *this, store_pairs, sel);
+    } else {
+        FAISS_THROW_MSG("metric type not supported");
+    }
+}
+
+} // namespace faiss
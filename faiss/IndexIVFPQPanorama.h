@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#ifndef FAISS_INDEX_IVFPQ_PANORAMA_H
+#define FAISS_INDEX_IVFPQ_PANORAMA_H
+
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/impl/PanoramaCodes.h>
+
+namespace faiss {
+
+/// Panorama adaptation of IndexIVFPQ
+/// (https://www.arxiv.org/pdf/2510.00566).
+///
+/// A level is a contiguous range of sub-quantizers. The distance to a code
+/// is accumulated level by level from the look-up tables and the
+/// candidates that cannot enter the result set are pruned with
+/// Cauchy-Schwarz bounds, see PanoramaCodes. The results are the same as
+/// those of IndexIVFPQ with polysemous filtering disabled. Only 8-bit
+/// sub-quantizers are supported.
+///
+/// OVERHEAD: (n_levels - 1) floats per vector are stored after the PQ code.
+/// The look-up tables are computed for each (query, list) pair when
+/// by_residual and L2, as in IndexIVFPQ without precomputed tables.
+struct IndexIVFPQPanorama : IndexIVFPQ {
+    size_t n_levels = 0;
+
+    IndexIVFPQPanorama(
+            Index* quantizer,
+            size_t d,
+            size_t nlist,
+            size_t M,
+            size_t nbits_per_idx,
+            size_t n_levels,
+            MetricType metric = METRIC_L2,
+            bool own_invlists = true);
+
+    IndexIVFPQPanorama();
+
+    /// level split and layout of the codes
+    PanoramaCodes get_panorama_codes() const;
+
+    void encode_vectors(
+            idx_t n,
+            const float* x,
+            const idx_t* list_nos,
+            uint8_t* codes,
+            bool include_listnos = false) const override;
+
+    void decode_vectors(
+            idx_t n,
+            const uint8_t* codes,
+            const idx_t* listnos,
+            float* x) const override;
+
+    void add_core(
+            idx_t n,
+            const float* x,
+            const idx_t* xids,
+            const idx_t* precomputed_idx,
+            void* inverted_list_context = nullptr) override;
+
+    InvertedListScanner* get_InvertedListScanner(
+            bool store_pairs,
+            const IDSelector* sel,
+            const IVFSearchParameters* params) const override;
+};
+
+} // namespace faiss
+
+#endif
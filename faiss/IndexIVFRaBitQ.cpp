@@ -9,9 +9,14 @@
 
 #include <omp.h>
 
+#include <algorithm>
+#include <cinttypes>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <faiss/impl/FaissAssert.h>
@@ -19,6 +24,7 @@
 #include <faiss/impl/RaBitQuantizer.h>
 #include <faiss/impl/ResultHandler.h>
 #include <faiss/impl/expanded_scanners.h>
+#include <faiss/utils/Heap.h>
 
 namespace faiss {
 
@@ -318,6 +324,259 @@ InvertedListScanner* IndexIVFRaBitQ::get_InvertedListScanner(
             *this, store_pairs, sel, used_qb, centered);
 }
 
+namespace {
+
+/* Search a batch of queries, grouped by inverted list. The queries of a
+ * group share a RaBitQMultiQueryDistanceComputer so that the 1-bit
+ * estimates for up to RaBitQMultiQueryDistanceComputer::max_nq queries are
+ * computed with a single pass over the codes. */
+template <class C>
+void search_batch_by_list(
+        const IndexIVFRaBitQ& index,
+        idx_t n,
+        const float* x,
+        idx_t k,
+        const idx_t* assign,
+        idx_t nprobe,
+        float* distances,
+        idx_t* labels,
+        bool store_pairs,
+        const IDSelector* sel,
+        uint8_t qb,
+        bool centered,
+        size_t& nlistv,
+        size_t& ndis,
+        size_t& nheap) {
+    using MQDC = RaBitQMultiQueryDistanceComputer;
+    const bool keep_max = is_similarity_metric(index.metric_type);
+    const bool is_multibit = index.rabitq.nb_bits > 1;
+    const size_t code_size = index.code_size;
+    const size_t code_size_base = (index.d + 7) / 8;
+
+    for (idx_t i = 0; i < n; i++) {
+        heap_heapify<C>(k, distances + i * k, labels + i * k);
+    }
+
+    // (list_no, query) pairs sorted by list
+    std::vector<std::pair<idx_t, idx_t>> list_queries;
+    list_queries.reserve(n * nprobe);
+    for (idx_t i = 0; i < n; i++) {
+        for (idx_t j = 0; j < nprobe; j++) {
+            idx_t key = assign[i * nprobe + j];
+            if (key < 0) {
+                // not enough centroids for multiprobe
+                continue;
+            }
+            FAISS_THROW_IF_NOT_FMT(
+                    key < (idx_t)index.nlist,
+                    "Invalid key=%" PRId64 " nlist=%zd\n",
+                    key,
+                    index.nlist);
+            list_queries.emplace_back(key, i);
+        }
+    }
+    std::sort(list_queries.begin(), list_queries.end());
+
+    std::vector<float> centroid(index.d);
+    MQDC dc(index.rabitq, qb, centroid.data(), centered);
+    std::vector<const float*> xq(MQDC::max_nq);
+    std::vector<idx_t> qnos(MQDC::max_nq);
+    std::vector<float> dis(MQDC::max_nq);
+    size_t local_1bit_evaluations = 0;
+    size_t local_multibit_evaluations = 0;
+
+    for (size_t i0 = 0; i0 < list_queries.size();) {
+        idx_t list_no = list_queries[i0].first;
+        size_t i1 = i0 + 1;
+        while (i1 < list_queries.size() && list_queries[i1].first == list_no) {
+            i1++;
+        }
+        const InvertedLists* invlists = index.invlists;
+        size_t list_size = invlists->list_size(list_no);
+        if (list_size == 0) {
+            i0 = i1;
+            continue;
+        }
+        nlistv += i1 - i0;
+
+        index.quantizer->reconstruct(list_no, centroid.data());
+        InvertedLists::ScopedCodes scodes(invlists, list_no);
+        std::unique_ptr<InvertedLists::ScopedIds> sids;
+        const idx_t* ids = nullptr;
+        if (!store_pairs) {
+            sids = std::make_unique<InvertedLists::ScopedIds>(
+                    invlists, list_no);
+            ids = sids->get();
+        }
+
+        for (size_t q0 = i0; q0 < i1; q0 += MQDC::max_nq) {
+            size_t nq = std::min(i1 - q0, MQDC::max_nq);
+            for (size_t q = 0; q < nq; q++) {
+                qnos[q] = list_queries[q0 + q].second;
+                xq[q] = x + qnos[q] * index.d;
+            }
+            dc.set_queries(nq, xq.data());
+            ndis += nq * list_size;
+
+            const uint8_t* codes = scodes.get();
+            for (size_t j = 0; j < list_size; j++, codes += code_size) {
+                int64_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                if (sel && !sel->is_member(id)) {
+                    continue;
+                }
+                dc.distances_to_code_1bit(codes, dis.data());
+
+                for (size_t q = 0; q < nq; q++) {
+                    float* simi = distances + qnos[q] * k;
+                    idx_t* idxi = labels + qnos[q] * k;
+                    float d_q = dis[q];
+                    if (is_multibit) {
+                        // same two-stage filtering as
+                        // RaBitInvertedListScanner::scan_codes
+                        local_1bit_evaluations++;
+                        const auto* base_fac = reinterpret_cast<
+                                const rabitq_utils::SignBitFactorsWithError*>(
+                                codes + code_size_base);
+                        if (!rabitq_utils::should_refine_candidate(
+                                    d_q,
+                                    base_fac->f_error,
+                                    dc.g_errors[q],
+                                    simi[0],
+                                    keep_max)) {
+                            continue;
+                        }
+                        local_multibit_evaluations++;
+                        d_q = dc.distance_to_code_full(q, codes);
+                    }
+                    if (C::cmp(simi[0], d_q)) {
+                        heap_replace_top<C>(k, simi, idxi, d_q, id);
+                        nheap++;
+                    }
+                }
+            }
+        }
+        i0 = i1;
+    }
+
+    if (is_multibit) {
+#pragma omp atomic
+        rabitq_stats.n_1bit_evaluations += local_1bit_evaluations;
+#pragma omp atomic
+        rabitq_stats.n_multibit_evaluations += local_multibit_evaluations;
+    }
+
+    for (idx_t i = 0; i < n; i++) {
+        heap_reorder<C>(k, distances + i * k, labels + i * k);
+    }
+}
+
+} // anonymous namespace
+
+void IndexIVFRaBitQ::search_preassigned(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        const idx_t* assign,
+        const float* centroid_dis,
+        float* distances,
+        idx_t* labels,
+        bool store_pairs,
+        const IVFSearchParameters* params,
+        IndexIVFStats* ivf_stats) const {
+    uint8_t used_qb = qb;
+    bool centered = false;
+    if (auto rparams = dynamic_cast<const IVFRaBitQSearchParameters*>(params)) {
+        used_qb = rparams->qb;
+        centered = rparams->centered;
+    }
+    idx_t max_codes = params ? params->max_codes : this->max_codes;
+
+    // the batched search covers the default search configuration, the
+    // other ones are handled by the generic implementation
+    if (query_batch_size <= 1 || n <= 1 || used_qb == 0 || max_codes != 0 ||
+        parallel_mode != 0 || invlists->use_iterator) {
+        IndexIVF::search_preassigned(
+                n,
+                x,
+                k,
+                assign,
+                centroid_dis,
+                distances,
+                labels,
+                store_pairs,
+                params,
+                ivf_stats);
+        return;
+    }
+
+    FAISS_THROW_IF_NOT(k > 0);
+    idx_t nprobe = params ? params->nprobe : this->nprobe;
+    nprobe = std::min((idx_t)nlist, nprobe);
+    FAISS_THROW_IF_NOT(nprobe > 0);
+
+    const IDSelector* sel = params ? params->sel : nullptr;
+    FAISS_THROW_IF_NOT_MSG(
+            !(sel && store_pairs),
+            "selector and store_pairs cannot be combined");
+
+    size_t nlistv = 0, ndis = 0, nheap = 0;
+    // there are at least as many batches as threads, so that searches with
+    // fewer than query_batch_size queries are still parallel
+    const idx_t nt = omp_in_parallel() ? 1 : omp_get_max_threads();
+    const idx_t bs = std::min((idx_t)query_batch_size, (n + nt - 1) / nt);
+    const idx_t nbatch = (n + bs - 1) / bs;
+
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel for if (nbatch > 1) reduction(+ : nlistv, ndis, nheap)
+    for (idx_t b = 0; b < nbatch; b++) {
+        idx_t i0 = b * bs;
+        idx_t i1 = std::min(n, i0 + bs);
+        try {
+            auto search_batch = [&](auto heap_tag) {
+                using C = decltype(heap_tag);
+                search_batch_by_list<C>(
+                        *this,
+                        i1 - i0,
+                        x + i0 * d,
+                        k,
+                        assign + i0 * nprobe,
+                        nprobe,
+                        distances + i0 * k,
+                        labels + i0 * k,
+                        store_pairs,
+                        sel,
+                        used_qb,
+                        centered,
+                        nlistv,
+                        ndis,
+                        nheap);
+            };
+            if (metric_type == METRIC_INNER_PRODUCT) {
+                search_batch(CMin<float, idx_t>());
+            } else {
+                search_batch(CMax<float, idx_t>());
+            }
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
+        }
+    }
+
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+
+    if (ivf_stats == nullptr) {
+        ivf_stats = &indexIVF_stats;
+    }
+    ivf_stats->nq += n;
+    ivf_stats->nlist += nlistv;
+    ivf_stats->ndis += ndis;
+    ivf_stats->nheap_updates += nheap;
+}
+
 void IndexIVFRaBitQ::reconstruct_from_offset(
         int64_t list_no,
         int64_t offset,
@@ -31,6 +31,15 @@ struct IndexIVFRaBitQ : IndexIVF {
     // use '0' to disable quantization and use raw fp32 values.
     uint8_t qb = 4;
 
+    // if > 1, search processes the queries in batches of this size. Within a
+    // batch, the queries that visit the same inverted list are scanned
+    // together, so that each code is loaded once for up to 16 queries.
+    // The batches are smaller when there are too few queries to give one
+    // batch to each thread. Requires a quantized query (qb > 0). Within
+    // each query the lists are visited in list order rather than probe
+    // order. Not serialized.
+    size_t query_batch_size = 0;
+
     IndexIVFRaBitQ(
             Index* quantizer,
             const size_t d,
@@ -63,6 +72,18 @@ struct IndexIVFRaBitQ : IndexIVF {
             const idx_t* precomputed_idx,
             void* inverted_list_context = nullptr) override;
 
+    void search_preassigned(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            const idx_t* assign,
+            const float* centroid_dis,
+            float* distances,
+            idx_t* labels,
+            bool store_pairs,
+            const IVFSearchParameters* params = nullptr,
+            IndexIVFStats* stats = nullptr) const override;
+
     InvertedListScanner* get_InvertedListScanner(
             bool store_pairs,
             const IDSelector* sel,
@@ -592,6 +592,14 @@ IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::IVFRaBitQHeapHandler(
     current_list_no = 0;
     probe_indices.clear();
 
+    if (is_multibit) {
+        unpacked_code.resize(idx->code_size);
+        refine_recons.resize(32 * idx->d);
+        refine_ips.resize(32);
+        refine_offsets.resize(32);
+        refine_ids.resize(32);
+    }
+
     // Initialize heaps in constructor (standard pattern from HeapHandler)
     for (int64_t q = 0; q < static_cast<int64_t>(nq); q++) {
         float* heap_dis = heap_distances + q * k;
@@ -654,33 +662,36 @@ void IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::handle(
     size_t local_1bit_evaluations = 0;
     size_t local_multibit_evaluations = 0;
 
-    // Process each candidate vector in the SIMD batch
-    for (size_t j = 0; j < max_positions; j++) {
-        const int64_t result_id = this->adjust_id(b, j);
-
-        if (result_id < 0) {
-            continue;
-        }
+    if (is_multibit) {
+        const bool is_similarity =
+                index->metric_type == MetricType::METRIC_INNER_PRODUCT;
+        const float g_error = query_factors.g_error;
 
-        const float normalized_distance = d32tab[j] * one_a + bias;
+        // Stage 1: 1-bit estimates and error bounds for the whole batch.
+        // Candidates that cannot enter the heap are pruned.
+        size_t n_refine = 0;
+        for (size_t j = 0; j < max_positions; j++) {
+            const int64_t result_id = this->adjust_id(b, j);
 
-        const uint8_t* base_ptr = rabitq_utils::get_block_aux_ptr(
-                list_codes_ptr,
-                idx_base + j,
-                index->bbs,
-                packed_block_size,
-                full_block_size,
-                storage_size);
+            if (result_id < 0) {
+                continue;
+            }
 
-        if (is_multibit) {
             // Track candidates actually considered for two-stage filtering
             local_1bit_evaluations++;
 
-            // Multi-bit: use SignBitFactorsWithError and two-stage search
+            const float normalized_distance = d32tab[j] * one_a + bias;
+
             const SignBitFactorsWithError& full_factors =
-                    *reinterpret_cast<const SignBitFactorsWithError*>(base_ptr);
+                    *reinterpret_cast<const SignBitFactorsWithError*>(
+                            rabitq_utils::get_block_aux_ptr(
+                                    list_codes_ptr,
+                                    idx_base + j,
+                                    index->bbs,
+                                    packed_block_size,
+                                    full_block_size,
+                                    storage_size));
 
-            // Compute 1-bit adjusted distance using shared helper
             float dist_1bit = rabitq_utils::compute_1bit_adjusted_distance(
                     normalized_distance,
                     full_factors,
@@ -689,38 +700,52 @@ void IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::handle(
                     index->qb,
                     index->d);
 
-            // Adaptive filtering: decide whether to compute full distance
-            const bool is_similarity =
-                    index->metric_type == MetricType::METRIC_INNER_PRODUCT;
-
-            float g_error = query_factors.g_error;
-
-            bool should_refine = rabitq_utils::should_refine_candidate(
-                    dist_1bit,
-                    full_factors.f_error,
-                    g_error,
-                    heap_dis[0],
-                    is_similarity);
-            if (should_refine) {
-                local_multibit_evaluations++;
+            if (rabitq_utils::should_refine_candidate(
+                        dist_1bit,
+                        full_factors.f_error,
+                        g_error,
+                        heap_dis[0],
+                        is_similarity)) {
+                refine_offsets[n_refine] = idx_base + j;
+                refine_ids[n_refine] = result_id;
+                n_refine++;
+            }
+        }
 
-                // Compute local_offset: position within current inverted list
-                size_t local_offset = this->j0 + b * 32 + j;
+        // Stage 2: full multi-bit distances of the survivors, in one batch
+        if (n_refine > 0) {
+            local_multibit_evaluations += n_refine;
 
-                // Compute full multi-bit distance
-                float dist_full = compute_full_multibit_distance(
-                        result_id, local_q, q, local_offset);
+            float dis_full[32];
+            compute_full_multibit_distances(
+                    n_refine, query_factors, refine_offsets.data(), dis_full);
 
-                // Update heap if this distance is better
-                if (Cfloat::cmp(heap_dis[0], dist_full)) {
+            for (size_t i = 0; i < n_refine; i++) {
+                if (Cfloat::cmp(heap_dis[0], dis_full[i])) {
                     heap_replace_top<Cfloat>(
-                            k, heap_dis, heap_ids, dist_full, result_id);
+                            k, heap_dis, heap_ids, dis_full[i], refine_ids[i]);
                     nup++;
                 }
             }
-        } else {
-            const auto& db_factors =
-                    *reinterpret_cast<const SignBitFactors*>(base_ptr);
+        }
+    } else {
+        for (size_t j = 0; j < max_positions; j++) {
+            const int64_t result_id = this->adjust_id(b, j);
+
+            if (result_id < 0) {
+                continue;
+            }
+
+            const float normalized_distance = d32tab[j] * one_a + bias;
+
+            const auto& db_factors = *reinterpret_cast<const SignBitFactors*>(
+                    rabitq_utils::get_block_aux_ptr(
+                            list_codes_ptr,
+                            idx_base + j,
+                            index->bbs,
+                            packed_block_size,
+                            full_block_size,
+                            storage_size));
 
             // Compute adjusted distance using shared helper
             float adjusted_distance =
@@ -773,51 +798,61 @@ void IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::end() {
 }
 
 template <class C>
-float IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::
-        compute_full_multibit_distance(
-                size_t /*db_idx*/,
-                size_t local_q,
-                size_t global_q,
-                size_t local_offset) const {
+void IndexIVFRaBitQFastScan::IVFRaBitQHeapHandler<C>::
+        compute_full_multibit_distances(
+                size_t n,
+                const QueryFactorsData& query_factors,
+                const size_t* local_offsets,
+                float* dis_out) {
     const size_t ex_bits = index->rabitq.nb_bits - 1;
     const size_t dim = index->d;
-
-    const uint8_t* base_ptr = rabitq_utils::get_block_aux_ptr(
-            list_codes_ptr,
-            local_offset,
-            index->bbs,
-            packed_block_size,
-            full_block_size,
-            storage_size);
-
     const size_t ex_code_size = (dim * ex_bits + 7) / 8;
-    const uint8_t* ex_code = base_ptr + sizeof(SignBitFactorsWithError);
-    const ExtraBitsFactors& ex_fac = *reinterpret_cast<const ExtraBitsFactors*>(
-            base_ptr + sizeof(SignBitFactorsWithError) + ex_code_size);
-
-    // Use local_q to access probe_indices (batch-local), global_q for storage
-    size_t probe_rank = probe_indices[local_q];
-    size_t nprobe = context->nprobe > 0 ? context->nprobe : index->nprobe;
-    size_t storage_idx = global_q * nprobe + probe_rank;
-    const auto& query_factors = context->query_factors[storage_idx];
-
-    size_t list_no = current_list_no;
-    InvertedLists::ScopedCodes list_codes(index->invlists, list_no);
 
-    std::vector<uint8_t> unpacked_code(index->code_size);
-    packer->unpack_1(list_codes.get(), local_offset, unpacked_code.data());
-    const uint8_t* sign_bits = unpacked_code.data();
+    // decode the candidates to float reconstructions, one row per candidate
+    for (size_t i = 0; i < n; i++) {
+        packer->unpack_1(
+                list_codes_ptr, local_offsets[i], unpacked_code.data());
+        const uint8_t* ex_code = rabitq_utils::get_block_aux_ptr(
+                                         list_codes_ptr,
+                                         local_offsets[i],
+                                         index->bbs,
+                                         packed_block_size,
+                                         full_block_size,
+                                         storage_size) +
+                sizeof(SignBitFactorsWithError);
+        rabitq_utils::decode_multibit_reconstruction(
+                unpacked_code.data(),
+                ex_code,
+                dim,
+                ex_bits,
+                refine_recons.data() + i * dim);
+    }
 
-    return rabitq_utils::compute_full_multibit_distance(
-            sign_bits,
-            ex_code,
-            ex_fac,
+    fvec_inner_products_ny(
+            refine_ips.data(),
             query_factors.rotated_q.data(),
-            query_factors.qr_to_c_L2sqr,
-            query_factors.qr_norm_L2sqr,
+            refine_recons.data(),
             dim,
-            ex_bits,
-            index->metric_type);
+            n);
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t* ex_fac_ptr = rabitq_utils::get_block_aux_ptr(
+                                            list_codes_ptr,
+                                            local_offsets[i],
+                                            index->bbs,
+                                            packed_block_size,
+                                            full_block_size,
+                                            storage_size) +
+                sizeof(SignBitFactorsWithError) + ex_code_size;
+        const ExtraBitsFactors& ex_fac =
+                *reinterpret_cast<const ExtraBitsFactors*>(ex_fac_ptr);
+        dis_out[i] = rabitq_utils::multibit_distance_from_ip(
+                refine_ips[i],
+                ex_fac,
+                query_factors.qr_to_c_L2sqr,
+                query_factors.qr_norm_L2sqr,
+                index->metric_type);
+    }
 }
 
 /*********************************************************
@@ -238,17 +238,26 @@ struct IndexIVFRaBitQFastScan : IndexIVFFastScan {
         }
 
        private:
-        /// Compute full multi-bit distance for a candidate vector (multi-bit
-        /// only)
-        /// @param db_idx Global database vector index
-        /// @param local_q Batch-local query index (for probe_indices access)
-        /// @param global_q Global query index (for storage indexing)
-        /// @param local_offset Offset within the current inverted list
-        float compute_full_multibit_distance(
-                size_t /*db_idx*/,
-                size_t local_q,
-                size_t global_q,
-                size_t local_offset) const;
+        // scratch buffers for the batched multi-bit refinement
+        std::vector<uint8_t> unpacked_code; // [code_size]
+        std::vector<float> refine_recons;   // [32 * d]
+        std::vector<float> refine_ips;      // [32]
+        std::vector<size_t> refine_offsets; // [32]
+        std::vector<int64_t> refine_ids;    // [32]
+
+        /// Compute full multi-bit distances for a batch of candidates that
+        /// survived the 1-bit error-bound pruning (multi-bit only). The
+        /// candidates are decoded to floats, then their inner products with
+        /// the rotated query are computed with a single SIMD batched call.
+        /// @param n             number of candidates (<= 32)
+        /// @param query_factors factors of the query for the current list
+        /// @param local_offsets offsets within the current inverted list
+        /// @param dis_out       output distances, size n
+        void compute_full_multibit_distances(
+                size_t n,
+                const QueryFactorsData& query_factors,
+                const size_t* local_offsets,
+                float* dis_out);
     };
 };
 
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexIVFScalarQuantizerPanorama.h>
+
+#include <memory>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/ScalarQuantizer.h>
+
+namespace faiss {
+
+/*******************************************************************
+ * IndexIVFScalarQuantizerPanorama implementation
+ ********************************************************************/
+
+IndexIVFScalarQuantizerPanorama::IndexIVFScalarQuantizerPanorama(
+        Index* quantizer,
+        size_t d,
+        size_t nlist,
+        ScalarQuantizer::QuantizerType qtype,
+        size_t n_levels,
+        MetricType metric,
+        bool by_residual,
+        bool own_invlists)
+        : IndexIVFScalarQuantizer(
+                  quantizer,
+                  d,
+                  nlist,
+                  qtype,
+                  metric,
+                  by_residual,
+                  own_invlists),
+          n_levels(n_levels) {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    FAISS_THROW_IF_NOT_MSG(
+            qtype != ScalarQuantizer::QT_mixed,
+            "QT_mixed is not supported by IndexIVFScalarQuantizerPanorama");
+    code_size = get_panorama_codes().code_size();
+    if (invlists) {
+        invlists->code_size = code_size;
+    }
+}
+
+IndexIVFScalarQuantizerPanorama::IndexIVFScalarQuantizerPanorama() {}
+
+PanoramaCodes IndexIVFScalarQuantizerPanorama::get_panorama_codes() const {
+    // levels of 16 dimensions start on a byte boundary for all the
+    // supported code sizes and keep the SIMD distance computers
+    return PanoramaCodes(d, n_levels, 16, sq.code_size);
+}
+
+void IndexIVFScalarQuantizerPanorama::train_encoder(
+        idx_t n,
+        const float* x,
+        const idx_t* /* assign */) {
+    sq.train(n, x);
+}
+
+void IndexIVFScalarQuantizerPanorama::encode_vectors(
+        idx_t n,
+        const float* x,
+        const idx_t* list_nos,
+        uint8_t* codes,
+        bool include_listnos) const {
+    IndexIVFScalarQuantizer::encode_vectors(
+            n, x, list_nos, codes, include_listnos);
+
+    PanoramaCodes pano = get_panorama_codes();
+    std::unique_ptr<ScalarQuantizer::SQuantizer> squant(sq.select_quantizer());
+    size_t coarse_size = include_listnos ? coarse_code_size() : 0;
+
+#pragma omp parallel if (n > 1000)
+    {
+        std::vector<float> recons(d);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            if (list_nos[i] >= 0) {
+                uint8_t* code =
+                        codes + i * (code_size + coarse_size) + coarse_size;
+                squant->decode_vector(code, recons.data());
+                pano.encode_norms(recons.data(), code);
+            }
+        }
+    }
+}
+
+void IndexIVFScalarQuantizerPanorama::decode_vectors(
+        idx_t n,
+        const uint8_t* codes,
+        const idx_t*,
+        float* x) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    std::unique_ptr<ScalarQuantizer::SQuantizer> squant(sq.select_quantizer());
+    for (idx_t i = 0; i < n; i++) {
+        squant->decode_vector(codes + i * code_size, x + i * d);
+    }
+}
+
+void IndexIVFScalarQuantizerPanorama::add_core(
+        idx_t n,
+        const float* x,
+        const idx_t* xids,
+        const idx_t* coarse_idx,
+        void* inverted_list_context) {
+    // goes through encode_vectors to fill in the norms
+    IndexIVF::add_core(n, x, xids, coarse_idx, inverted_list_context);
+}
+
+namespace {
+
+template <class C>
+struct IVFSQScannerPanorama
+        : IVFPanoramaScanner<C, IVFSQScannerPanorama<C>> {
+    using Base = IVFPanoramaScanner<C, IVFSQScannerPanorama<C>>;
+
+    const IndexIVFScalarQuantizerPanorama& index;
+
+    // one scalar quantizer per level, trained on the level's dimensions
+    std::vector<ScalarQuantizer> level_sq;
+    std::vector<std::unique_ptr<ScalarQuantizer::SQDistanceComputer>>
+            level_dc;
+    // offset of the level in the code
+    std::vector<size_t> level_offset;
+
+    const float* x = nullptr;
+    std::vector<float> residual;
+
+    IVFSQScannerPanorama(
+            const IndexIVFScalarQuantizerPanorama& index,
+            bool store_pairs,
+            const IDSelector* sel)
+            : Base(index.get_panorama_codes(), store_pairs, sel),
+              index(index),
+              residual(index.d) {
+        const ScalarQuantizer& sq = index.sq;
+        const PanoramaCodes& pano = this->pano;
+        size_t d = index.d;
+        bool per_dim = sq.trained.size() == 2 * d;
+        for (size_t l = 0; l < pano.n_levels; l++) {
+            size_t i0 = pano.level_dims[l], i1 = pano.level_dims[l + 1];
+            ScalarQuantizer sql(i1 - i0, sq.qtype);
+            if (per_dim) {
+                sql.trained.resize(2 * (i1 - i0));
+                std::copy(
+                        sq.trained.begin() + i0,
+                        sq.trained.begin() + i1,
+                        sql.trained.begin());
+                std::copy(
+                        sq.trained.begin() + d + i0,
+                        sq.trained.begin() + d + i1,
+                        sql.trained.begin() + (i1 - i0));
+            } else {
+                sql.trained = sq.trained;
+            }
+            level_sq.push_back(sql);
+            level_offset.push_back(i0 * sq.bits / 8);
+        }
+        for (const ScalarQuantizer& sql : level_sq) {
+            level_dc.emplace_back(
+                    sql.get_distance_computer(index.metric_type));
+        }
+    }
+
+    void set_level_queries(const float* q) {
+        for (size_t l = 0; l < this->pano.n_levels; l++) {
+            level_dc[l]->set_query(q + this->pano.level_dims[l]);
+        }
+        this->pano.compute_suffix_norms(q, this->q_norms.data());
+    }
+
+    void set_query(const float* query) override {
+        x = query;
+        if (!index.by_residual || !C::is_max) {
+            set_level_queries(x);
+        }
+    }
+
+    void set_list(idx_t list_no, float coarse_dis) override {
+        this->list_no = list_no;
+        if (index.by_residual) {
+            if (C::is_max) {
+                index.quantizer->compute_residual(
+                        x, residual.data(), list_no);
+                set_level_queries(residual.data());
+            } else {
+                this->accu0 = coarse_dis;
+            }
+        }
+    }
+
+    float partial_distance(size_t l, const uint8_t* code) const {
+        return level_dc[l]->query_to_code(code + level_offset[l]);
+    }
+};
+
+} // anonymous namespace
+
+InvertedListScanner* IndexIVFScalarQuantizerPanorama::get_InvertedListScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
+    if (metric_type == METRIC_L2) {
+        return new IVFSQScannerPanorama<CMax<float, idx_t>>(
+                *this, store_pairs, sel);
+    } else if (metric_type == METRIC_INNER_PRODUCT) {
+        return new IVFSQScannerPanorama<CMin<float, idx_t>>(
+                *this, store_pairs, sel);
+    } else {
+        FAISS_THROW_MSG("metric type not supported");
+    }
+}
+
+} // namespace faiss
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#ifndef FAISS_INDEX_IVF_SCALAR_QUANTIZER_PANORAMA_H
+#define FAISS_INDEX_IVF_SCALAR_QUANTIZER_PANORAMA_H
+
+#include <faiss/IndexScalarQuantizer.h>
+#include <faiss/impl/PanoramaCodes.h>
+
+namespace faiss {
+
+/// Panorama adaptation of IndexIVFScalarQuantizer
+/// (https://www.arxiv.org/pdf/2510.00566).
+///
+/// The distances to the codes of an inverted list are computed level by
+/// level (a level is a range of dimensions whose width is a multiple of 16)
+/// and the candidates that cannot enter the result set are pruned with
+/// Cauchy-Schwarz bounds, see PanoramaCodes. The results are the same as
+/// those of IndexIVFScalarQuantizer. As for IndexIVFFlatPanorama, the
+/// pruning is effective when an orthogonal transform upstream (PCA, ...)
+/// concentrates the energy in the first dimensions.
+///
+/// OVERHEAD: (n_levels - 1) floats per vector are stored after the SQ code.
+/// QT_mixed is not supported.
+struct IndexIVFScalarQuantizerPanorama : IndexIVFScalarQuantizer {
+    size_t n_levels = 0;
+
+    IndexIVFScalarQuantizerPanorama(
+            Index* quantizer,
+            size_t d,
+            size_t nlist,
+            ScalarQuantizer::QuantizerType qtype,
+            size_t n_levels,
+            MetricType metric = METRIC_L2,
+            bool by_residual = true,
+            bool own_invlists = true);
+
+    IndexIVFScalarQuantizerPanorama();
+
+    /// level split and layout of the codes
+    PanoramaCodes get_panorama_codes() const;
+
+    void train_encoder(idx_t n, const float* x, const idx_t* assign) override;
+
+    void encode_vectors(
+            idx_t n,
+            const float* x,
+            const idx_t* list_nos,
+            uint8_t* codes,
+            bool include_listnos = false) const override;
+
+    void decode_vectors(
+            idx_t n,
+            const uint8_t* codes,
+            const idx_t* list_nos,
+            float* x) const override;
+
+    void add_core(
+            idx_t n,
+            const float* x,
+            const idx_t* xids,
+            const idx_t* precomputed_idx,
+            void* inverted_list_context = nullptr) override;
+
+    InvertedListScanner* get_InvertedListScanner(
+            bool store_pairs,
+            const IDSelector* sel,
+            const IVFSearchParameters* params) const override;
+};
+
+} // namespace faiss
+
+#endif
@@ -163,7 +163,16 @@ void IndexNNDescent::add(idx_t n, const float* x) {
     ntotal = storage->ntotal;
 
     std::unique_ptr<DistanceComputer> dis(storage_distance_computer(storage));
-    nndescent.build(*dis, ntotal, verbose);
+    // the local joins on flat float vectors are computed by blocks
+    const IndexFlat* flat = dynamic_cast<const IndexFlat*>(storage);
+    if (flat &&
+        (flat->metric_type == METRIC_L2 ||
+         flat->metric_type == METRIC_INNER_PRODUCT)) {
+        nndescent.build(
+                *dis, ntotal, verbose, flat->get_xb(), flat->metric_type);
+    } else {
+        nndescent.build(*dis, ntotal, verbose);
+    }
 }
 
 void IndexNNDescent::reset() {
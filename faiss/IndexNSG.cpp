@@ -127,9 +127,14 @@ void IndexNSG::add(idx_t n, const float* x) {
             "instead of IndexNSG directly");
     FAISS_THROW_IF_NOT(is_trained);
 
-    FAISS_THROW_IF_NOT_MSG(
-            !is_built && ntotal == 0,
-            "NSG does not support incremental addition");
+    if (is_built) {
+        // incremental addition in the existing graph
+        storage->add(n, x);
+        nsg.add(storage, n, verbose);
+        ntotal = storage->ntotal;
+        return;
+    }
+    FAISS_THROW_IF_NOT_MSG(ntotal == 0, "the IndexNSG is not built");
 
     std::vector<idx_t> knng;
     if (verbose) {
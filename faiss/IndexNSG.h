@@ -53,6 +53,9 @@ struct IndexNSG : Index {
 
     void build(idx_t n, const float* x, idx_t* knn_graph, int GK);
 
+    /// The first call builds the graph. The following calls insert the
+    /// vectors in the existing graph (see NSG::add), which is cheaper than
+    /// a rebuild but gives a graph of slightly lower quality.
     void add(idx_t n, const float* x) override;
 
     /// Trains the storage if needed
@@ -10,6 +10,7 @@
 #include <faiss/IndexFlat.h>
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/QueryTrace.h>
 #include <faiss/utils/Heap.h>
 
 namespace faiss {
@@ -103,6 +104,8 @@ void IndexRefine::search(
         assert(base_labels[i] >= -1 && base_labels[i] < ntotal);
     }
 
+    QueryTraceTimer rerank_timer(QT_rerank);
+
     // parallelize over queries
 #pragma omp parallel if (n > 1)
     {
@@ -290,6 +293,8 @@ void IndexRefineFlat::search(
         assert(base_labels[i] >= -1 && base_labels[i] < ntotal);
     }
 
+    QueryTraceTimer rerank_timer(QT_rerank);
+
     // compute refined distances
     auto rf = dynamic_cast<const IndexFlat*>(refine_index);
     FAISS_THROW_IF_NOT(rf);
@@ -356,6 +361,8 @@ void IndexRefinePanorama::search(
         assert(base_labels[i] >= -1 && base_labels[i] < ntotal);
     }
 
+    QueryTraceTimer rerank_timer(QT_rerank);
+
     refine_index->search_subset(
             n, x, k_base, base_labels, k, distances, labels);
 }
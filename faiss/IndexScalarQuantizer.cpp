@@ -42,6 +42,8 @@ IndexScalarQuantizer::IndexScalarQuantizer()
 
 void IndexScalarQuantizer::train(idx_t n, const float* x) {
     sq.train(n, x);
+    // the code size of QT_mixed is known only after training
+    code_size = sq.code_size;
     is_trained = true;
 }
 
@@ -143,6 +145,14 @@ void IndexIVFScalarQuantizer::train_encoder(
         const float* x,
         const idx_t* assign) {
     sq.train(n, x);
+    if (sq.code_size != code_size) {
+        // the code size of QT_mixed is known only after training
+        FAISS_THROW_IF_NOT_MSG(ntotal == 0, "cannot change the code size");
+        code_size = sq.code_size;
+        if (invlists) {
+            invlists->code_size = code_size;
+        }
+    }
 }
 
 idx_t IndexIVFScalarQuantizer::train_encoder_num_vectors() const {
@@ -7,13 +7,25 @@
 
 #include <faiss/IndexShards.h>
 
+#include <omp.h>
+
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <typeinfo>
 
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexIVFFastScan.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/WorkerThread.h>
+#include <faiss/utils/utils.h>
 
 namespace faiss {
 
@@ -42,6 +54,155 @@ void translate_labels(int64_t n, idx_t* labels, int64_t translation) {
     }
 }
 
+// search a shard, results that are not better than thresholds[i] (if
+// non-null) may be omitted
+
+void shard_search(
+        const Index* index,
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params,
+        const float* thresholds) {
+    if (!thresholds) {
+        index->search(n, x, k, distances, labels, params);
+        return;
+    }
+    // the thresholds are passed to search_preassigned, which skips the
+    // search of the shard: it must not be overridden (IndexIVFFastScan
+    // overrides it, eg. to rescale the norms)
+    const IndexIVF* ivf = dynamic_cast<const IndexIVF*>(index);
+    FAISS_THROW_IF_NOT_MSG(
+            ivf && !dynamic_cast<const IndexIVFFastScan*>(index),
+            "share_threshold is supported only for IndexIVF shards that "
+            "use the search of IndexIVF");
+    // the thresholds are passed through SearchParametersIVF, which is
+    // copied per query slice, so subclasses of it are not supported
+    FAISS_THROW_IF_NOT_MSG(
+            !params || typeid(*params) == typeid(SearchParametersIVF),
+            "share_threshold requires shard_params of type "
+            "SearchParametersIVF");
+    if (ivf->parallel_mode != 0) {
+        // correct without the thresholds, just slower
+        index->search(n, x, k, distances, labels, params);
+        return;
+    }
+    SearchParametersIVF ivf_params;
+    if (params) {
+        ivf_params = *static_cast<const SearchParametersIVF*>(params);
+    } else {
+        ivf_params.nprobe = ivf->nprobe;
+        ivf_params.max_codes = ivf->max_codes;
+    }
+    size_t nprobe = std::min(ivf->nlist, ivf_params.nprobe);
+    FAISS_THROW_IF_NOT(nprobe > 0);
+    ivf_params.nprobe = nprobe;
+
+    std::vector<idx_t> keys(n * nprobe);
+    std::vector<float> coarse_dis(n * nprobe);
+    ivf->quantizer->search(
+            n,
+            x,
+            nprobe,
+            coarse_dis.data(),
+            keys.data(),
+            ivf_params.quantizer_params);
+
+    // same split over queries as IndexIVF::search
+    int nt = std::min(omp_get_max_threads(), int(n));
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel for if (nt > 1)
+    for (idx_t slice = 0; slice < nt; slice++) {
+        idx_t i0 = n * slice / nt;
+        idx_t i1 = n * (slice + 1) / nt;
+        if (i1 == i0) {
+            continue;
+        }
+        SearchParametersIVF slice_params = ivf_params;
+        slice_params.init_threshold = thresholds + i0;
+        try {
+            ivf->search_preassigned(
+                    i1 - i0,
+                    x + i0 * ivf->d,
+                    k,
+                    keys.data() + i0 * nprobe,
+                    coarse_dis.data() + i0 * nprobe,
+                    distances + i0 * k,
+                    labels + i0 * k,
+                    false,
+                    &slice_params);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
+        }
+    }
+
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+}
+
+void shard_search(
+        const IndexBinary* index,
+        idx_t n,
+        const uint8_t* x,
+        idx_t k,
+        int32_t* distances,
+        idx_t* labels,
+        const SearchParameters* params,
+        const int32_t* thresholds) {
+    FAISS_THROW_IF_NOT_MSG(
+            !thresholds, "share_threshold is not supported for IndexBinary");
+    index->search(n, x, k, distances, labels, params);
+}
+
+// The shards keep only the results strictly better than their threshold.
+// Moving the threshold by one ulp keeps the results that tie with the
+// current k-th result, so that merge_into_heaps breaks the ties by id
+// whatever the order of the shards.
+template <class C>
+typename C::T loosen_threshold(typename C::T t) {
+    using T = typename C::T;
+    if constexpr (std::is_floating_point_v<T>) {
+        T inf = std::numeric_limits<T>::infinity();
+        return std::nextafter(t, C::is_max ? inf : -inf);
+    } else {
+        return t;
+    }
+}
+
+// merge the sorted results of a shard into the result heaps. Ties are
+// broken by id so that the result does not depend on the order in which
+// the shards are merged.
+template <class C>
+void merge_into_heaps(
+        idx_t n,
+        idx_t k,
+        const typename C::T* shard_distances,
+        const idx_t* shard_labels,
+        typename C::T* distances,
+        idx_t* labels) {
+    for (idx_t i = 0; i < n; i++) {
+        typename C::T* heap_dis = distances + i * k;
+        idx_t* heap_ids = labels + i * k;
+        const typename C::T* dis_i = shard_distances + i * k;
+        const idx_t* ids_i = shard_labels + i * k;
+        for (idx_t j = 0; j < k; j++) {
+            if (ids_i[j] < 0 || C::cmp(dis_i[j], heap_dis[0])) {
+                // the next results are not better
+                break;
+            }
+            if (C::cmp2(heap_dis[0], dis_i[j], heap_ids[0], ids_i[j])) {
+                heap_replace_top<C>(k, heap_dis, heap_ids, dis_i[j], ids_i[j]);
+            }
+        }
+    }
+}
+
 } // anonymous namespace
 
 template <typename IndexT>
@@ -204,8 +365,31 @@ void IndexShardsTemplate<IndexT>::search(
 
     int64_t nshard = this->count();
 
-    std::vector<distance_t> all_distances(nshard * k * n);
-    std::vector<idx_t> all_labels(nshard * k * n);
+    const SearchParameters* shard_params = params;
+    idx_t bs = n;
+    double deadline = 0;
+    uint8_t* partial = nullptr;
+    bool share_threshold = false;
+    if (auto sparams = dynamic_cast<const SearchParametersShards*>(params)) {
+        FAISS_THROW_IF_NOT_MSG(
+                !sparams->sel, "the selector should be set in shard_params");
+        shard_params = sparams->shard_params;
+        if (sparams->query_block_size > 0) {
+            bs = std::min(n, sparams->query_block_size);
+        }
+        if (sparams->timeout_ms > 0) {
+            deadline = getmillisecs() + sparams->timeout_ms;
+        }
+        partial = sparams->partial;
+        share_threshold = sparams->share_threshold;
+    }
+    if (partial) {
+        memset(partial, 0, n);
+    }
+    if (n == 0) {
+        return;
+    }
+
     std::vector<int64_t> translations(nshard, 0);
 
     // Because we just called runOnIndex above, it is safe to access the
@@ -218,48 +402,88 @@ void IndexShardsTemplate<IndexT>::search(
         }
     }
 
-    auto fn = [n, k, x, params, &all_distances, &all_labels, &translations](
-                      int no, const IndexT* index) {
-        if (index->verbose) {
-            printf("begin query shard %d on %" PRId64 " points\n", no, n);
-        }
+    size_t components_per_vec =
+            sizeof(component_t) == 1 ? (this->d + 7) / 8 : this->d;
 
-        index->search(
-                n,
-                x,
-                k,
-                all_distances.data() + no * k * n,
-                all_labels.data() + no * k * n,
-                params);
+    // one result buffer per shard
+    std::vector<distance_t> all_distances(nshard * k * bs);
+    std::vector<idx_t> all_labels(nshard * k * bs);
 
-        translate_labels(
-                n * k, all_labels.data() + no * k * n, translations[no]);
+    auto search_and_merge = [&]<class C>() {
+        for (idx_t i = 0; i < n; i++) {
+            heap_heapify<C>(k, distances + i * k, labels + i * k);
+        }
 
-        if (index->verbose) {
-            printf("end query shard %d\n", no);
+        // protects the result heaps and partial
+        std::mutex merge_mutex;
+
+        auto fn = [&](int no, const IndexT* index) {
+            if (index->verbose) {
+                printf("begin query shard %d on %" PRId64 " points\n", no, n);
+            }
+            distance_t* shard_distances = all_distances.data() + no * k * bs;
+            idx_t* shard_labels = all_labels.data() + no * k * bs;
+            std::vector<distance_t> thresholds(share_threshold ? bs : 0);
+
+            for (idx_t i0 = 0; i0 < n; i0 += bs) {
+                idx_t i1 = std::min(i0 + bs, n);
+
+                if (deadline > 0 && getmillisecs() > deadline) {
+                    if (partial) {
+                        std::lock_guard<std::mutex> lock(merge_mutex);
+                        memset(partial + i0, 1, n - i0);
+                    }
+                    break;
+                }
+
+                if (share_threshold) {
+                    // current k-th result of the queries
+                    std::lock_guard<std::mutex> lock(merge_mutex);
+                    for (idx_t i = i0; i < i1; i++) {
+                        thresholds[i - i0] =
+                                loosen_threshold<C>(distances[i * k]);
+                    }
+                }
+
+                shard_search(
+                        index,
+                        i1 - i0,
+                        x + i0 * components_per_vec,
+                        k,
+                        shard_distances,
+                        shard_labels,
+                        shard_params,
+                        share_threshold ? thresholds.data() : nullptr);
+
+                translate_labels(
+                        (i1 - i0) * k, shard_labels, translations[no]);
+
+                std::lock_guard<std::mutex> lock(merge_mutex);
+                merge_into_heaps<C>(
+                        i1 - i0,
+                        k,
+                        shard_distances,
+                        shard_labels,
+                        distances + i0 * k,
+                        labels + i0 * k);
+            }
+
+            if (index->verbose) {
+                printf("end query shard %d\n", no);
+            }
+        };
+
+        this->runOnIndex(fn);
+
+        for (idx_t i = 0; i < n; i++) {
+            heap_reorder<C>(k, distances + i * k, labels + i * k);
         }
     };
 
-    this->runOnIndex(fn);
-
     if (this->metric_type == METRIC_L2) {
-        merge_knn_results<idx_t, CMin<distance_t, int>>(
-                n,
-                k,
-                nshard,
-                all_distances.data(),
-                all_labels.data(),
-                distances,
-                labels);
+        search_and_merge.template operator()<CMax<distance_t, idx_t>>();
     } else {
-        merge_knn_results<idx_t, CMax<distance_t, int>>(
-                n,
-                k,
-                nshard,
-                all_distances.data(),
-                all_labels.data(),
-                distances,
-                labels);
+        search_and_merge.template operator()<CMin<distance_t, idx_t>>();
     }
 }
 
@@ -13,8 +13,37 @@
 
 namespace faiss {
 
+/// Search parameters for IndexShards / IndexBinaryShards
+struct SearchParametersShards : SearchParameters {
+    /// parameters passed to the shards (sel must be set there)
+    SearchParameters* shard_params = nullptr;
+
+    /// the queries are sent to the shards by blocks of this size (0 = all
+    /// at once). The timeout and the threshold sharing act between blocks.
+    idx_t query_block_size = 1024;
+
+    /// time budget of the search in milliseconds (0 = unlimited). After the
+    /// deadline, the shards do not start new blocks of queries, so the
+    /// results of the remaining queries do not include these shards.
+    double timeout_ms = 0;
+
+    /// output, if non-null (size n): partial[i] is set to 1 if the results
+    /// of query i miss some shards because of the timeout, 0 otherwise
+    uint8_t* partial = nullptr;
+
+    /// pass the k-th distance of the results merged so far to the shards,
+    /// so that they can prune their search. Supported for IndexIVF shards
+    /// that use the search of IndexIVF (not the fast-scan ones), with
+    /// shard_params of type SearchParametersIVF (or null). Throws for the
+    /// other shard types.
+    bool share_threshold = false;
+};
+
 /**
- * Index that concatenates the results from several sub-indexes
+ * Index that concatenates the results from several sub-indexes.
+ *
+ * At search time, the results of each shard are merged into the output as
+ * soon as the shard returns them.
  */
 template <typename IndexT>
 struct IndexShardsTemplate : public ThreadedIndex<IndexT> {
@@ -81,6 +110,8 @@ struct IndexShardsTemplate : public ThreadedIndex<IndexT> {
     void add_with_ids(idx_t n, const component_t* x, const idx_t* xids)
             override;
 
+    /// params can be a SearchParametersShards, otherwise they are passed
+    /// as-is to the shards
     void search(
             idx_t n,
             const component_t* x,
@@ -71,7 +71,7 @@ void IndexShardsIVF::train(idx_t n, const component_t* x) {
 
     // probably not worth running in parallel
     for (size_t i = 0; i < indices_.size(); i++) {
-        Index* index = indices_[i].first;
+        Index* index = indices_[i];
         auto index_ivf = dynamic_cast<IndexIVFInterface*>(index);
         Index* quantizer = index_ivf->quantizer;
         if (!quantizer->is_trained) {
@@ -92,7 +92,7 @@ void IndexShardsIVF::add_with_ids(
     // IndexIVF exposes add_core that we can use to factorize the
     bool all_index_ivf = true;
     for (size_t i = 0; i < indices_.size(); i++) {
-        Index* index = indices_[i].first;
+        Index* index = indices_[i];
         all_index_ivf = all_index_ivf && dynamic_cast<IndexIVF*>(index);
     }
     if (!all_index_ivf) {
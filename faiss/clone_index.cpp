@@ -18,6 +18,7 @@
 #include <faiss/IndexBinaryFlat.h>
 #include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexBinaryIVFFastScan.h>
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexHNSW.h>
 #include <faiss/IndexIVF.h>
@@ -25,10 +26,12 @@
 #include <faiss/IndexIVFFlat.h>
 #include <faiss/IndexIVFFlatPanorama.h>
 #include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQPanorama.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
 #include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFRaBitQFastScan.h>
+#include <faiss/IndexIVFScalarQuantizerPanorama.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
@@ -85,6 +88,7 @@ VectorTransform* Cloner::clone_VectorTransform(const VectorTransform* vt) {
 
 IndexIVF* Cloner::clone_IndexIVF(const IndexIVF* ivf) {
     TRYCLONE(IndexIVFPQR, ivf)
+    TRYCLONE(IndexIVFPQPanorama, ivf)
     TRYCLONE(IndexIVFPQ, ivf)
 
     TRYCLONE(IndexIVFLocalSearchQuantizer, ivf)
@@ -107,6 +111,7 @@ IndexIVF* Cloner::clone_IndexIVF(const IndexIVF* ivf) {
 
     TRYCLONE(IndexIVFSpectralHash, ivf)
 
+    TRYCLONE(IndexIVFScalarQuantizerPanorama, ivf)
     TRYCLONE(IndexIVFScalarQuantizer, ivf) {
         FAISS_THROW_MSG("clone not supported for this type of IndexIVF");
     }
@@ -114,6 +119,7 @@ IndexIVF* Cloner::clone_IndexIVF(const IndexIVF* ivf) {
 }
 
 IndexBinaryIVF* clone_IndexBinaryIVF(const IndexBinaryIVF* ivf) {
+    TRYCLONE(IndexBinaryIVFFastScan, ivf)
     TRYCLONE(IndexBinaryIVF, ivf)
     return nullptr;
 }
@@ -14,6 +14,7 @@
 #include <faiss/IndexBinaryFlat.h>
 #include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexBinaryIVFFastScan.h>
 #include <faiss/IndexHNSW.h>
 #include <faiss/IndexIDMap.h>
 #include <faiss/IndexIVFFlat.h>
@@ -38,6 +39,7 @@ const std::map<faiss::ScalarQuantizer::QuantizerType, std::string> sq_types = {
         {faiss::ScalarQuantizer::QT_bf16, "SQbf16"},
         {faiss::ScalarQuantizer::QT_8bit_direct_signed, "SQ8_direct_signed"},
         {faiss::ScalarQuantizer::QT_8bit_direct, "SQ8_direct"},
+        {faiss::ScalarQuantizer::QT_mixed, "SQmixed"},
 };
 
 int get_hnsw_M(const faiss::IndexHNSW* index) {
@@ -196,6 +198,12 @@ std::string reverse_index_factory(const faiss::IndexBinary* index) {
         const faiss::IndexBinary* quantizer = ivf_index->quantizer;
 
         if (dynamic_cast<const faiss::IndexBinaryFlat*>(quantizer)) {
+            const auto* ivfs =
+                    dynamic_cast<const faiss::IndexBinaryIVFFastScan*>(
+                            ivf_index);
+            if (ivfs && ivfs->bbs == 32) {
+                return "BIVF" + std::to_string(ivf_index->nlist) + "_FS";
+            }
             return "BIVF" + std::to_string(ivf_index->nlist);
         } else if (
                 const faiss::IndexBinaryHNSW* hnsw_index =
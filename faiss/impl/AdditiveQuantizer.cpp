@@ -272,6 +272,31 @@ uint64_t AdditiveQuantizer::encode_norm(float norm) const {
     }
 }
 
+float AdditiveQuantizer::decode_norm(uint64_t code) const {
+    switch (search_type) {
+        case ST_norm_float: {
+            uint32_t inorm = code;
+            float norm;
+            memcpy(&norm, &inorm, 4);
+            return norm;
+        }
+        case ST_norm_qint8:
+            return decode_qint8(code, norm_min, norm_max);
+        case ST_norm_qint4:
+            return decode_qint4(code, norm_min, norm_max);
+        case ST_norm_lsq2x4:
+        case ST_norm_rq2x4:
+        case ST_norm_cqint8:
+        case ST_norm_cqint4:
+            return decode_qcint(code);
+        case ST_decompress:
+        case ST_LUT_nonorm:
+        case ST_norm_from_LUT:
+        default:
+            return 0;
+    }
+}
+
 void AdditiveQuantizer::pack_codes(
         size_t n,
         const int32_t* codes,
@@ -61,6 +61,9 @@ struct AdditiveQuantizer : Quantizer {
     /// encode a norm into norm_bits bits
     uint64_t encode_norm(float norm) const;
 
+    /// decode a norm encoded with encode_norm
+    float decode_norm(uint64_t code) const;
+
     /// encode norm by non-uniform scalar quantization
     uint32_t encode_qcint(float x) const;
 
@@ -10,6 +10,49 @@
 
 namespace faiss {
 
+/***********************************************************************
+ * IDSummary / IDSelector
+ ***********************************************************************/
+
+void IDSummary::add(size_t n, const idx_t* ids) {
+    for (size_t i = 0; i < n; i++) {
+        add(ids[i]);
+    }
+}
+
+void IDSelector::is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+        const {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = is_member(ids[i]);
+    }
+}
+
+namespace {
+
+/// the check_summary functions that enumerate ids do it only up to this
+/// number of ids, so that the check remains cheaper than a list scan
+constexpr size_t max_summary_enumerate = 256;
+
+/// check by enumerating the ids in the range of the summary
+IDSummaryCheck check_summary_range(const IDSelector& sel, const IDSummary& s) {
+    if (s.empty()) {
+        return IDSC_none;
+    }
+    if (uint64_t(s.max_id) - uint64_t(s.min_id) >= max_summary_enumerate) {
+        return IDSC_some;
+    }
+    size_t nsel = 0, ntot = 0;
+    for (idx_t id = s.min_id; id <= s.max_id; id++) {
+        if (s.may_contain(id)) {
+            ntot++;
+            nsel += sel.is_member(id);
+        }
+    }
+    return nsel == 0 ? IDSC_none : nsel == ntot ? IDSC_all : IDSC_some;
+}
+
+} // namespace
+
 /***********************************************************************
  * IDSelectorRange
  ***********************************************************************/
@@ -21,6 +64,24 @@ bool IDSelectorRange::is_member(idx_t id) const {
     return id >= imin && id < imax;
 }
 
+void IDSelectorRange::is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+        const {
+    // branch-free so that the loop is vectorized
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (ids[i] >= imin) & (ids[i] < imax);
+    }
+}
+
+IDSummaryCheck IDSelectorRange::check_summary(const IDSummary& s) const {
+    if (s.empty() || s.max_id < imin || s.min_id >= imax) {
+        return IDSC_none;
+    }
+    if (s.min_id >= imin && s.max_id < imax) {
+        return IDSC_all;
+    }
+    return IDSC_some;
+}
+
 void IDSelectorRange::find_sorted_ids_bounds(
         size_t list_size,
         const idx_t* ids,
@@ -78,6 +139,22 @@ bool IDSelectorArray::is_member(idx_t id) const {
     return false;
 }
 
+IDSummaryCheck IDSelectorArray::check_summary(const IDSummary& s) const {
+    if (s.empty()) {
+        return IDSC_none;
+    }
+    // is_member is linear in n, so the ids are not enumerated
+    if (n > max_summary_enumerate) {
+        return IDSC_some;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (s.may_contain(ids[i])) {
+            return IDSC_some;
+        }
+    }
+    return IDSC_none;
+}
+
 /***********************************************************************
  * IDSelectorBatch
  ***********************************************************************/
@@ -108,6 +185,35 @@ bool IDSelectorBatch::is_member(idx_t i) const {
     return set.count(i);
 }
 
+void IDSelectorBatch::is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+        const {
+    // Bloom filter tests first, the set is accessed only for the hits
+    for (size_t i = 0; i < n; i++) {
+        idx_t im = ids[i] & mask;
+        out[i] = (bloom[im >> 3] >> (im & 7)) & 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (out[i]) {
+            out[i] = set.count(ids[i]);
+        }
+    }
+}
+
+IDSummaryCheck IDSelectorBatch::check_summary(const IDSummary& s) const {
+    if (s.empty()) {
+        return IDSC_none;
+    }
+    if (set.size() > max_summary_enumerate) {
+        return check_summary_range(*this, s);
+    }
+    for (idx_t id : set) {
+        if (s.may_contain(id)) {
+            return IDSC_some;
+        }
+    }
+    return IDSC_none;
+}
+
 /***********************************************************************
  * IDSelectorBitmap
  ***********************************************************************/
@@ -123,4 +229,51 @@ bool IDSelectorBitmap::is_member(idx_t ii) const {
     return (bitmap[i >> 3] >> (i & 7)) & 1;
 }
 
+void IDSelectorBitmap::is_member_batch(
+        size_t nid,
+        const idx_t* ids,
+        uint8_t* out) const {
+    for (size_t j = 0; j < nid; j++) {
+        uint64_t i = ids[j];
+        out[j] = (i >> 3) < n ? (bitmap[i >> 3] >> (i & 7)) & 1 : 0;
+    }
+}
+
+IDSummaryCheck IDSelectorBitmap::check_summary(const IDSummary& s) const {
+    // negative ids are never selected
+    if (s.empty() || s.max_id < 0) {
+        return IDSC_none;
+    }
+    uint64_t i0 = std::max(s.min_id, idx_t(0));
+    if (i0 >= uint64_t(n) * 8) {
+        return IDSC_none;
+    }
+    uint64_t i1 = std::min(uint64_t(s.max_id) + 1, uint64_t(n) * 8);
+    // bits of bitmap in [i0, i1), only if they are few
+    if (i1 - i0 > max_summary_enumerate * 8) {
+        return IDSC_some;
+    }
+    bool any = false, all = true;
+    for (uint64_t i = i0; i < i1;) {
+        uint8_t b = bitmap[i >> 3];
+        if ((i & 7) == 0 && i + 8 <= i1) {
+            any |= b != 0;
+            all &= b == 0xff;
+            i += 8;
+        } else {
+            bool bit = (b >> (i & 7)) & 1;
+            any |= bit;
+            all &= bit;
+            i++;
+        }
+    }
+    if (!any) {
+        return IDSC_none;
+    }
+    // negative ids and ids beyond the bitmap are not selected
+    return all && s.min_id >= 0 && uint64_t(s.max_id) < uint64_t(n) * 8
+            ? IDSC_all
+            : IDSC_some;
+}
+
 } // namespace faiss
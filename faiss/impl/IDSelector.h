@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <unordered_set>
 #include <vector>
 
@@ -17,9 +20,63 @@
 
 namespace faiss {
 
+/** Conservative summary of a set of ids: their range and a small Bloom
+ * filter. It may match ids that are not in the set, never the opposite.
+ * Used to decide for a whole inverted list whether its ids can be selected.
+ */
+struct IDSummary {
+    idx_t min_id = std::numeric_limits<idx_t>::max();
+    idx_t max_id = -1;
+    static constexpr int bloom_bits = 512;
+    uint64_t bloom[bloom_bits / 64] = {};
+
+    void add(idx_t id) {
+        min_id = std::min(min_id, id);
+        max_id = std::max(max_id, id);
+        size_t h = bloom_hash(id);
+        bloom[h / 64] |= uint64_t(1) << (h % 64);
+    }
+
+    void add(size_t n, const idx_t* ids);
+
+    bool empty() const {
+        return max_id < min_id;
+    }
+
+    bool may_contain(idx_t id) const {
+        if (id < min_id || id > max_id) {
+            return false;
+        }
+        size_t h = bloom_hash(id);
+        return (bloom[h / 64] >> (h % 64)) & 1;
+    }
+
+    static size_t bloom_hash(idx_t id) {
+        return (uint64_t(id) * 0x9E3779B97F4A7C15ULL) >> (64 - 9);
+    }
+};
+
+/// result of IDSelector::check_summary
+enum IDSummaryCheck {
+    IDSC_none, ///< none of the ids of the set are selected
+    IDSC_some, ///< some may be selected
+    IDSC_all,  ///< all ids of the set are selected
+};
+
 /** Encapsulates a set of ids to handle. */
 struct IDSelector {
     virtual bool is_member(idx_t id) const = 0;
+
+    /// out[i] = is_member(ids[i]), can be overloaded to vectorize the tests
+    virtual void is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+            const;
+
+    /// whether none, some or all of the ids summarized by s are selected.
+    /// The default is the non-committal IDSC_some.
+    virtual IDSummaryCheck check_summary(const IDSummary& s) const {
+        return IDSC_some;
+    }
+
     virtual ~IDSelector() {}
 };
 
@@ -35,6 +92,11 @@ struct IDSelectorRange : IDSelector {
 
     bool is_member(idx_t id) const final;
 
+    void is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+            const override;
+
+    IDSummaryCheck check_summary(const IDSummary& s) const override;
+
     /// for sorted ids, find the range of list indices where the valid ids are
     /// stored
     void find_sorted_ids_bounds(
@@ -63,6 +125,7 @@ struct IDSelectorArray : IDSelector {
      */
     IDSelectorArray(size_t n, const idx_t* ids);
     bool is_member(idx_t id) const final;
+    IDSummaryCheck check_summary(const IDSummary& s) const override;
     ~IDSelectorArray() override {}
 };
 
@@ -93,6 +156,9 @@ struct IDSelectorBatch : IDSelector {
      */
     IDSelectorBatch(size_t n, const idx_t* indices);
     bool is_member(idx_t id) const final;
+    void is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+            const override;
+    IDSummaryCheck check_summary(const IDSummary& s) const override;
     ~IDSelectorBatch() override {}
 };
 
@@ -110,6 +176,9 @@ struct IDSelectorBitmap : IDSelector {
      */
     IDSelectorBitmap(size_t n, const uint8_t* bitmap);
     bool is_member(idx_t id) const final;
+    void is_member_batch(size_t n, const idx_t* ids, uint8_t* out)
+            const override;
+    IDSummaryCheck check_summary(const IDSummary& s) const override;
     ~IDSelectorBitmap() override {}
 };
 
@@ -120,6 +189,10 @@ struct IDSelectorNot : IDSelector {
     bool is_member(idx_t id) const final {
         return !sel->is_member(id);
     }
+    IDSummaryCheck check_summary(const IDSummary& s) const override {
+        IDSummaryCheck c = sel->check_summary(s);
+        return c == IDSC_none ? IDSC_all : c == IDSC_all ? IDSC_none : c;
+    }
     virtual ~IDSelectorNot() {}
 };
 
@@ -128,6 +201,9 @@ struct IDSelectorAll : IDSelector {
     bool is_member(idx_t id) const final {
         return true;
     }
+    IDSummaryCheck check_summary(const IDSummary&) const override {
+        return IDSC_all;
+    }
     virtual ~IDSelectorAll() {}
 };
 
@@ -141,6 +217,14 @@ struct IDSelectorAnd : IDSelector {
     bool is_member(idx_t id) const final {
         return lhs->is_member(id) && rhs->is_member(id);
     }
+    IDSummaryCheck check_summary(const IDSummary& s) const override {
+        IDSummaryCheck c1 = lhs->check_summary(s);
+        if (c1 == IDSC_none) {
+            return IDSC_none;
+        }
+        IDSummaryCheck c2 = rhs->check_summary(s);
+        return c1 == IDSC_all ? c2 : c2 == IDSC_none ? IDSC_none : IDSC_some;
+    }
     virtual ~IDSelectorAnd() {}
 };
 
@@ -154,6 +238,14 @@ struct IDSelectorOr : IDSelector {
     bool is_member(idx_t id) const final {
         return lhs->is_member(id) || rhs->is_member(id);
     }
+    IDSummaryCheck check_summary(const IDSummary& s) const override {
+        IDSummaryCheck c1 = lhs->check_summary(s);
+        if (c1 == IDSC_all) {
+            return IDSC_all;
+        }
+        IDSummaryCheck c2 = rhs->check_summary(s);
+        return c1 == IDSC_none ? c2 : c2 == IDSC_all ? IDSC_all : IDSC_some;
+    }
     virtual ~IDSelectorOr() {}
 };
 
@@ -20,16 +20,11 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/simd_dispatch.h>
 #include <faiss/utils/distances.h>
+#include <faiss/utils/prefetch.h>
 #include <faiss/utils/utils.h>
 
 #include <faiss/utils/approx_topk/approx_topk.h>
 
-// this is needed for prefetching
-
-#ifdef __AVX2__
-#include <xmmintrin.h>
-#endif
-
 extern "C" {
 // LU decomposition of a general matrix
 void sgetrf_(
@@ -306,6 +301,40 @@ void LocalSearchQuantizer::compute_codes_add_centroids(
     random_int32(codes, 0, K - 1, gen);
 
     icm_encode(codes.data(), x, n, encode_ils_iters, gen);
+
+    if (encode_nstarts > 1) {
+        // restart from other random codes and keep the best ones
+        std::vector<float> best_objs(n);
+        evaluate(codes.data(), x, n, best_objs.data());
+
+        std::vector<int32_t> codes_s(n * M);
+        std::vector<float> objs_s(n);
+        for (size_t s = 1; s < encode_nstarts; s++) {
+            random_int32(codes_s, 0, K - 1, gen);
+            icm_encode(codes_s.data(), x, n, encode_ils_iters, gen);
+            evaluate(codes_s.data(), x, n, objs_s.data());
+
+            LSQTimerScope select_scope(&lsq_timer, "select_starts");
+            size_t n_betters = 0;
+#pragma omp parallel for reduction(+ : n_betters)
+            for (int64_t i = 0; i < n; i++) {
+                if (objs_s[i] < best_objs[i]) {
+                    best_objs[i] = objs_s[i];
+                    memcpy(codes.data() + i * M,
+                           codes_s.data() + i * M,
+                           sizeof(int32_t) * M);
+                    n_betters++;
+                }
+            }
+            if (verbose) {
+                printf("\tstart %zd: n_betters/n = %zd/%zd\n",
+                       s,
+                       n_betters,
+                       n);
+            }
+        }
+    }
+
     pack_codes(n, codes.data(), codes_out, -1, nullptr, centroids);
 
     if (verbose) {
@@ -596,75 +625,78 @@ void LocalSearchQuantizer::icm_encode_step(
         size_t n_iters) const {
     FAISS_THROW_IF_NOT(M != 0 && K != 0);
     FAISS_THROW_IF_NOT(binaries != nullptr);
+    LSQTimerScope scope(&lsq_timer, "icm_encode_step");
 
-#pragma omp parallel for schedule(dynamic)
-    for (int64_t i = 0; i < n; i++) {
-        std::vector<float> objs(K);
-
-        for (size_t iter = 0; iter < n_iters; iter++) {
-            // condition on the m-th subcode
-            for (size_t m = 0; m < M; m++) {
-                // copy
-                auto u = unaries + m * n * K + i * K;
-                for (size_t code = 0; code < K; code++) {
-                    objs[code] = u[code];
-                }
+    // binaries[m1, m2, code1, :]
+    auto binary_row = [&](size_t m1, size_t m2, int32_t code1) {
+        return binaries + ((m1 * M + m2) * K + code1) * K;
+    };
 
-                // compute objective function by adding unary
-                // and binary terms together
-                for (size_t other_m = 0; other_m < M; other_m++) {
-                    if (other_m == m) {
-                        continue;
-                    }
+#pragma omp parallel
+    {
+        std::vector<float> objs(K);
 
-#ifdef __AVX2__
-                    // TODO: add platform-independent compiler-independent
-                    // prefetch utilities.
-                    if (other_m + 1 < M) {
-                        // do a single prefetch
-                        int32_t code2 = codes[i * M + other_m + 1];
-                        // for (int32_t code = 0; code < K; code += 64) {
-                        int32_t code = 0;
-                        {
-                            size_t binary_idx = (other_m + 1) * M * K * K +
-                                    m * K * K + code2 * K + code;
-                            _mm_prefetch(
-                                    (const char*)(binaries + binary_idx),
-                                    _MM_HINT_T0);
+#pragma omp for schedule(dynamic)
+        for (int64_t i = 0; i < n; i++) {
+            int32_t* codes_i = codes + i * M;
+
+            for (size_t iter = 0; iter < n_iters; iter++) {
+                // condition on the m-th subcode
+                for (size_t m = 0; m < M; m++) {
+                    // copy
+                    const float* u = unaries + m * n * K + i * K;
+                    memcpy(objs.data(), u, sizeof(float) * K);
+
+                    // compute objective function by adding unary
+                    // and binary terms together
+                    for (size_t other_m = 0; other_m < M; other_m++) {
+                        if (other_m == m) {
+                            continue;
                         }
-                    }
-#endif
-
-                    for (int32_t code = 0; code < K; code++) {
-                        int32_t code2 = codes[i * M + other_m];
-                        size_t binary_idx = other_m * M * K * K + m * K * K +
-                                code2 * K + code;
                         // binaries[m, other_m, code, code2].
                         // It is symmetric over (m <-> other_m)
                         //   and (code <-> code2).
                         // So, replace the op with
                         //   binaries[other_m, m, code2, code].
-                        objs[code] += binaries[binary_idx];
-                    }
-                }
+                        const float* row =
+                                binary_row(other_m, m, codes_i[other_m]);
+
+                        // the rows are scattered in a table of size
+                        // M * M * K * K, load the next one while
+                        // accumulating this one
+                        size_t next_m = other_m + 1 == m ? other_m + 2
+                                                         : other_m + 1;
+                        if (next_m < M) {
+                            const float* next_row =
+                                    binary_row(next_m, m, codes_i[next_m]);
+                            for (size_t k = 0; k < K; k += 16) {
+                                prefetch_L1(next_row + k);
+                            }
+                        }
 
-                // find the optimal value of the m-th subcode
-                float best_obj = HUGE_VALF;
-                int32_t best_code = 0;
+                        for (size_t code = 0; code < K; code++) {
+                            objs[code] += row[code];
+                        }
+                    }
 
-                // find one using SIMD. The following operation is similar
-                // to the search of the smallest element in objs
-                using C = CMax<float, int>;
-                HeapWithBuckets<C, 16, 1>::addn(
-                        K, objs.data(), 1, &best_obj, &best_code);
+                    // find the optimal value of the m-th subcode
+                    float best_obj = HUGE_VALF;
+                    int32_t best_code = 0;
 
-                // done
-                codes[i * M + m] = best_code;
+                    // find one using SIMD. The following operation is
+                    // similar to the search of the smallest element in objs
+                    using C = CMax<float, int>;
+                    HeapWithBuckets<C, 16, 1>::addn(
+                            K, objs.data(), 1, &best_obj, &best_code);
 
-            } // loop M
+                    // done
+                    codes_i[m] = best_code;
+                } // loop M
+            }
         }
     }
 }
+
 void LocalSearchQuantizer::perturb_codes(
         int32_t* codes,
         size_t n,
@@ -55,6 +55,10 @@ struct LocalSearchQuantizer : AdditiveQuantizer {
 
     size_t chunk_size = 10000; ///< nb of vectors to encode at a time
 
+    /// nb of random initializations of the codes in encoding, the best
+    /// codes of all the starts are kept for each vector
+    size_t encode_nstarts = 1;
+
     int random_seed = 0x12345; ///< seed for random generator
     size_t nperts = 4;         ///< number of perturbation in each code
 
@@ -245,4 +249,7 @@ struct LSQTimerScope {
 
 } // namespace lsq
 
+/// timings of the last call to train or compute_codes, by stage (in ms)
+FAISS_API extern lsq::LSQTimer lsq_timer;
+
 } // namespace faiss
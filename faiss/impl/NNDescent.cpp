@@ -9,11 +9,33 @@
 
 #include <faiss/impl/NNDescent.h>
 
+#include <cstring>
 #include <mutex>
 
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/DistanceComputer.h>
 #include <faiss/impl/VisitedTable.h>
+#include <faiss/utils/distances.h>
+
+extern "C" {
+
+/* declare BLAS functions, see http://www.netlib.org/clapack/cblas/ */
+
+int sgemm_(
+        const char* transa,
+        const char* transb,
+        FINTEGER* m,
+        FINTEGER* n,
+        FINTEGER* k,
+        const float* alpha,
+        const float* a,
+        FINTEGER* lda,
+        const float* b,
+        FINTEGER* ldb,
+        float* beta,
+        float* c,
+        FINTEGER* ldc);
+}
 
 namespace faiss {
 
@@ -53,14 +75,14 @@ Nhood::Nhood(const Nhood& other) {
 }
 
 /// Insert a point into the candidate pool
-void Nhood::insert(int id, float dist) {
+bool Nhood::insert(int id, float dist) {
     LockGuard guard(lock);
     if (dist > pool.front().distance) {
-        return;
+        return false;
     }
     for (int i = 0; i < pool.size(); i++) {
         if (id == pool[i].id) {
-            return;
+            return false;
         }
     }
     if (pool.size() < pool.capacity()) {
@@ -71,6 +93,7 @@ void Nhood::insert(int id, float dist) {
         pool[pool.size() - 1] = Neighbor(id, dist, true);
         std::push_heap(pool.begin(), pool.end());
     }
+    return true;
 }
 
 /// In local join, two objects are compared only if at least
@@ -159,22 +182,134 @@ NNDescent::NNDescent(const int d, const int K) : K(K), d(d) {
 
 NNDescent::~NNDescent() {}
 
-void NNDescent::join(DistanceComputer& qdis) {
+size_t NNDescent::join(DistanceComputer& qdis) {
+    size_t nupdate = 0;
     idx_t check_period = InterruptCallback::get_period_hint(d * search_L);
     for (idx_t i0 = 0; i0 < (idx_t)ntotal; i0 += check_period) {
         idx_t i1 = std::min(i0 + check_period, (idx_t)ntotal);
-#pragma omp parallel for default(shared) schedule(dynamic, 100)
+#pragma omp parallel for default(shared) schedule(dynamic, 100) \
+        reduction(+ : nupdate)
         for (idx_t n = i0; n < i1; n++) {
             graph[n].join([&](int i, int j) {
                 if (i != j) {
                     float dist = qdis.symmetric_dis(i, j);
-                    graph[i].insert(j, dist);
-                    graph[j].insert(i, dist);
+                    nupdate += graph[i].insert(j, dist);
+                    nupdate += graph[j].insert(i, dist);
                 }
             });
         }
         InterruptCallback::check();
     }
+    return nupdate;
+}
+
+size_t NNDescent::join_blocks(const float* x, MetricType metric) {
+    FAISS_THROW_IF_NOT(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    std::vector<float> norms;
+    if (metric == METRIC_L2) {
+        norms.resize(ntotal);
+        fvec_norms_L2sqr(norms.data(), x, d, ntotal);
+    }
+
+    // Nhood::insert rejects the distances above the max of the pool, which
+    // can only decrease. Filtering with a snapshot of the max avoids taking
+    // the lock for most pairs.
+    std::vector<float> pool_max(ntotal);
+    for (int i = 0; i < ntotal; i++) {
+        pool_max[i] = graph[i].pool.front().distance;
+    }
+
+    size_t nupdate = 0;
+    idx_t check_period = InterruptCallback::get_period_hint(d * search_L);
+    for (idx_t i0 = 0; i0 < (idx_t)ntotal; i0 += check_period) {
+        idx_t i1 = std::min(i0 + check_period, (idx_t)ntotal);
+#pragma omp parallel reduction(+ : nupdate)
+        {
+            std::vector<int> ids;
+            std::vector<float> xblock, ip, block_norms, block_max;
+#pragma omp for schedule(dynamic, 100)
+            for (idx_t n = i0; n < i1; n++) {
+                const Nhood& nhood = graph[n];
+                size_t nnew = nhood.nn_new.size();
+                size_t nb = nnew + nhood.nn_old.size();
+                if (nnew == 0) {
+                    continue;
+                }
+
+                // the new neighbors come first in the block
+                ids.resize(nb);
+                std::copy(nhood.nn_new.begin(), nhood.nn_new.end(), &ids[0]);
+                std::copy(
+                        nhood.nn_old.begin(),
+                        nhood.nn_old.end(),
+                        &ids[nnew]);
+                xblock.resize(nb * d);
+                block_norms.resize(nb);
+                block_max.resize(nb);
+                for (size_t i = 0; i < nb; i++) {
+                    memcpy(&xblock[i * d],
+                           x + size_t(ids[i]) * d,
+                           sizeof(float) * d);
+                    block_norms[i] = norms.empty() ? 0 : norms[ids[i]];
+                    block_max[i] = pool_max[ids[i]];
+                }
+
+                // ip(i, j) = <new_i, block_j>
+                ip.resize(nnew * nb);
+                if (nnew * nb * d < 4096) {
+                    for (size_t i = 0; i < nnew; i++) {
+                        fvec_inner_products_ny(
+                                &ip[i * nb], &xblock[i * d], &xblock[0], d, nb);
+                    }
+                } else {
+                    float one = 1, zero = 0;
+                    FINTEGER nbi = nb, nnewi = nnew, di = d;
+                    sgemm_("Transposed",
+                           "Not transposed",
+                           &nbi,
+                           &nnewi,
+                           &di,
+                           &one,
+                           xblock.data(),
+                           &di,
+                           xblock.data(),
+                           &di,
+                           &zero,
+                           ip.data(),
+                           &nbi);
+                }
+
+                // same pairs as Nhood::join: new-new once and new-old
+                for (size_t i = 0; i < nnew; i++) {
+                    const float* ipi = &ip[i * nb];
+                    int a = ids[i];
+                    for (size_t j = i + 1; j < nb; j++) {
+                        float dist;
+                        if (metric == METRIC_L2) {
+                            dist = block_norms[i] + block_norms[j] - 2 * ipi[j];
+                            dist = std::max(dist, 0.0f);
+                        } else {
+                            dist = -ipi[j];
+                        }
+                        bool to_a = dist <= block_max[i];
+                        bool to_b = dist <= block_max[j];
+                        int b = ids[j];
+                        if ((to_a || to_b) && a != b) {
+                            if (to_a) {
+                                nupdate += graph[a].insert(b, dist);
+                            }
+                            if (to_b) {
+                                nupdate += graph[b].insert(a, dist);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        InterruptCallback::check();
+    }
+    return nupdate;
 }
 
 /// Sample neighbors for each node to perform local join later
@@ -290,7 +425,11 @@ void NNDescent::update() {
     }
 }
 
-void NNDescent::nndescent(DistanceComputer& qdis, bool verbose) {
+void NNDescent::nndescent(
+        DistanceComputer& qdis,
+        bool verbose,
+        const float* x,
+        MetricType metric) {
     int num_eval_points = std::min(NUM_EVAL_POINTS, ntotal);
     std::vector<int> eval_points(num_eval_points);
     std::vector<std::vector<int>> acc_eval_set(num_eval_points);
@@ -298,12 +437,24 @@ void NNDescent::nndescent(DistanceComputer& qdis, bool verbose) {
     gen_random(rng, eval_points.data(), eval_points.size(), ntotal);
     generate_eval_set(qdis, eval_points, acc_eval_set, ntotal);
     for (int it = 0; it < iter; it++) {
-        join(qdis);
+        size_t nupdate = x ? join_blocks(x, metric) : join(qdis);
         update();
 
+        // the convergence is monitored on the sampled nodes
+        float recall = eval_recall(eval_points, acc_eval_set);
         if (verbose) {
-            float recall = eval_recall(eval_points, acc_eval_set);
-            printf("Iter: %d, recall@%d: %lf\n", it, K, recall);
+            printf("Iter: %d, recall@%d: %lf, updates: %zd\n",
+                   it,
+                   K,
+                   recall,
+                   nupdate);
+        }
+        if (recall >= target_recall ||
+            nupdate < delta * double(ntotal) * K) {
+            if (verbose) {
+                printf("Converged after %d iterations\n", it + 1);
+            }
+            break;
         }
     }
 }
@@ -387,7 +538,12 @@ void NNDescent::init_graph(DistanceComputer& qdis) {
     }
 }
 
-void NNDescent::build(DistanceComputer& qdis, const int n, bool verbose) {
+void NNDescent::build(
+        DistanceComputer& qdis,
+        const int n,
+        bool verbose,
+        const float* x,
+        MetricType metric) {
     FAISS_THROW_IF_NOT_MSG(L >= K, "L should be >= K in NNDescent.build");
     FAISS_THROW_IF_NOT_FMT(
             n > NUM_EVAL_POINTS,
@@ -405,7 +561,7 @@ void NNDescent::build(DistanceComputer& qdis, const int n, bool verbose) {
 
     ntotal = n;
     init_graph(qdis);
-    nndescent(qdis, verbose);
+    nndescent(qdis, verbose, x, metric);
 
     final_graph.resize(uint64_t(ntotal) * K);
 
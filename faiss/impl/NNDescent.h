@@ -80,7 +80,8 @@ struct Nhood {
 
     Nhood(const Nhood& other);
 
-    void insert(int id, float dist);
+    /// returns whether the point was added to the pool
+    bool insert(int id, float dist);
 
     template <typename C>
     void join(C callback) const;
@@ -97,7 +98,19 @@ struct NNDescent {
 
     ~NNDescent();
 
-    void build(DistanceComputer& qdis, const int n, bool verbose);
+    /** build the KNN graph of the n vectors
+     *
+     * @param x       if not null, the n * d vectors the distances of qdis
+     *                are computed on (METRIC_L2 or METRIC_INNER_PRODUCT,
+     *                negated). The local joins are then computed by blocks
+     *                with BLAS instead of one pair at a time.
+     */
+    void build(
+            DistanceComputer& qdis,
+            const int n,
+            bool verbose,
+            const float* x = nullptr,
+            MetricType metric = METRIC_L2);
 
     void search(
             DistanceComputer& qdis,
@@ -112,10 +125,20 @@ struct NNDescent {
     void init_graph(DistanceComputer& qdis);
 
     /// Perform NNDescent algorithm
-    void nndescent(DistanceComputer& qdis, bool verbose);
+    void nndescent(
+            DistanceComputer& qdis,
+            bool verbose,
+            const float* x = nullptr,
+            MetricType metric = METRIC_L2);
 
-    /// Perform local join on each node
-    void join(DistanceComputer& qdis);
+    /// Perform local join on each node, returns the nb of pool updates
+    size_t join(DistanceComputer& qdis);
+
+    /** Local join that gathers the new and old neighbors of each node and
+     * computes all their distances with one matrix multiplication.
+     * Returns the nb of pool updates.
+     */
+    size_t join_blocks(const float* x, MetricType metric);
 
     /// Sample new neighbors for each node to perform local join later
     void update();
@@ -141,6 +164,13 @@ struct NNDescent {
     int search_L = 0;       // size of candidate pool in searching
     int random_seed = 2021; // random seed for generators
 
+    /// stop iterating when an iteration updates less than
+    /// delta * ntotal * K pool entries (0 = run all iterations)
+    float delta = 0.001;
+    /// stop iterating when the recall estimated on a sample of the nodes
+    /// reaches this value (> 1 = disabled)
+    float target_recall = 1.0;
+
     int K; // K in KNN graph
     int d; // dimensions
     int L; // size of the candidate pool in building
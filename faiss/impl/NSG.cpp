@@ -8,12 +8,16 @@
 #include <faiss/impl/NSG.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <stack>
 
 #include <faiss/impl/DistanceComputer.h>
 #include <faiss/impl/VisitedTable.h>
+#include <faiss/utils/utils.h>
 
 namespace faiss {
 
@@ -24,6 +28,51 @@ using LockGuard = std::lock_guard<std::mutex>;
 // It needs to be smaller than 0
 constexpr int EMPTY_ID = -1;
 
+// max nb of locks for the reverse links, a node uses lock (node % nlocks)
+constexpr int max_reverse_link_locks = 1 << 16;
+
+// bounds of the nb of unreached nodes whose attachment points are
+// searched in parallel
+constexpr int tree_grow_min_batch = 16;
+constexpr int tree_grow_max_batch = 1024;
+
+/* Marks the nodes reachable from the frontier (which is already marked)
+ * with a level-synchronous BFS and returns the nb of nodes marked. The
+ * rows of the graph are terminated by EMPTY_ID. */
+size_t mark_reachable(
+        const nsg::Graph<int>& graph,
+        std::vector<std::atomic<bool>>& reached,
+        std::vector<int>& frontier) {
+    size_t nmarked = 0;
+    std::vector<int> next;
+    while (!frontier.empty()) {
+        next.clear();
+#pragma omp parallel if (frontier.size() > 1000)
+        {
+            std::vector<int> local;
+#pragma omp for schedule(dynamic, 64) nowait
+            for (size_t i = 0; i < frontier.size(); i++) {
+                int node = frontier[i];
+                for (int j = 0; j < graph.K; j++) {
+                    int id = graph.at(node, j);
+                    if (id == EMPTY_ID) {
+                        break;
+                    }
+                    if (!reached[id].load(std::memory_order_relaxed) &&
+                        !reached[id].exchange(true)) {
+                        local.push_back(id);
+                    }
+                }
+            }
+#pragma omp critical
+            next.insert(next.end(), local.begin(), local.end());
+        }
+        nmarked += next.size();
+        frontier.swap(next);
+    }
+    return nmarked;
+}
+
 } // anonymous namespace
 
 namespace nsg {
@@ -152,6 +201,7 @@ void NSG::build(
     init_graph(storage, knn_graph);
 
     std::vector<int> degrees(n, 0);
+    double t0 = getmillisecs();
     {
         nsg::Graph<Node> tmp_graph(n, R);
 
@@ -174,11 +224,18 @@ void NSG::build(
         }
     }
 
+    double t1 = getmillisecs();
     int num_attached = tree_grow(storage, degrees);
+    double t2 = getmillisecs();
     check_graph();
     is_built = true;
 
     if (verbose) {
+        printf("NSG::build with %d threads: link %.3f s, tree_grow %.3f s\n",
+               omp_get_max_threads(),
+               (t1 - t0) / 1000,
+               (t2 - t1) / 1000);
+
         int max = 0, min = 1e6;
         double avg = 0;
 
@@ -201,6 +258,155 @@ void NSG::build(
     }
 }
 
+namespace {
+
+/// view of a graph whose rows are read under striped locks, so that it
+/// can be searched while rows are updated
+struct LockedGraph : nsg::Graph<int> {
+    std::vector<std::mutex>& locks;
+
+    LockedGraph(const nsg::Graph<int>& graph, std::vector<std::mutex>& locks)
+            : nsg::Graph<int>(graph.data, graph.N, graph.K), locks(locks) {}
+
+    size_t get_neighbors(int i, int* neighbors) const override {
+        LockGuard guard(locks[i % locks.size()]);
+        return nsg::Graph<int>::get_neighbors(i, neighbors);
+    }
+};
+
+} // anonymous namespace
+
+void NSG::add(Index* storage, idx_t n, bool verbose) {
+    FAISS_THROW_IF_NOT(is_built && final_graph);
+    FAISS_THROW_IF_NOT(storage->ntotal == ntotal + n);
+    FAISS_THROW_IF_NOT(
+            storage->ntotal <= std::numeric_limits<storage_idx_t>::max());
+    if (n == 0) {
+        return;
+    }
+
+    double t0 = getmillisecs();
+    int n0 = ntotal;
+    int n1 = n0 + n;
+
+    // the rows keep R slots
+    auto new_graph = std::make_shared<nsg::Graph<int>>(n1, R);
+    memcpy(new_graph->data, final_graph->data, sizeof(int) * n0 * R);
+    std::fill_n(new_graph->data + (size_t)n0 * R, (size_t)n * R, EMPTY_ID);
+    final_graph = new_graph;
+    ntotal = n1;
+
+    std::vector<std::mutex> locks(std::min(n1, max_reverse_link_locks));
+    LockedGraph locked_graph(*final_graph, locks);
+
+#pragma omp parallel
+    {
+        std::unique_ptr<float[]> vec(new float[storage->d]);
+        std::vector<Neighbor> tmp;
+        std::vector<Node> pool, result, des_pool, des_result;
+        VisitedTable vt(ntotal, use_visited_hashset);
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+
+#pragma omp for schedule(dynamic, 100)
+        for (int q = n0; q < n1; q++) {
+            storage->reconstruct(q, vec.get());
+            dis->set_query(vec.get());
+
+            search_on_graph<true>(
+                    locked_graph, *dis, vt, enterpoint, L, tmp, pool);
+            std::sort(pool.begin(), pool.end());
+            occlusion_prune(q, pool, *dis, result);
+            pool.clear();
+            tmp.clear();
+            vt.advance();
+
+            {
+                // the row may already contain reverse links of nodes
+                // inserted concurrently
+                LockGuard guard(locks[q % locks.size()]);
+                int* row = &final_graph->at(q, 0);
+                int cnt = 0;
+                while (cnt < R && row[cnt] != EMPTY_ID) {
+                    cnt++;
+                }
+                for (const Node& nb : result) {
+                    if (cnt < R && std::find(row, row + cnt, nb.id) ==
+                                row + cnt) {
+                        row[cnt++] = nb.id;
+                    }
+                }
+            }
+
+            // reverse links, as in add_reverse_links
+            for (const Node& nb : result) {
+                int des = nb.id;
+                std::mutex& lock = locks[des % locks.size()];
+                des_pool.clear();
+                bool dup = false;
+                {
+                    LockGuard guard(lock);
+                    for (int j = 0; j < R; j++) {
+                        int id = final_graph->at(des, j);
+                        if (id == EMPTY_ID) {
+                            break;
+                        }
+                        if (id == q) {
+                            dup = true;
+                            break;
+                        }
+                        des_pool.emplace_back(id, 0);
+                    }
+                    if (!dup && des_pool.size() < R) {
+                        final_graph->at(des, des_pool.size()) = q;
+                        continue;
+                    }
+                }
+                if (dup) {
+                    continue;
+                }
+
+                // the row is full: prune it with q as an extra candidate
+                for (Node& node : des_pool) {
+                    node.distance = dis->symmetric_dis(des, node.id);
+                }
+                des_pool.emplace_back(q, nb.distance);
+                std::sort(des_pool.begin(), des_pool.end());
+                occlusion_prune(des, des_pool, *dis, des_result);
+
+                LockGuard guard(lock);
+                for (int j = 0; j < R; j++) {
+                    final_graph->at(des, j) =
+                            j < des_result.size() ? des_result[j].id : EMPTY_ID;
+                }
+            }
+        }
+    }
+
+    double t1 = getmillisecs();
+    std::vector<int> degrees(n1);
+#pragma omp parallel for
+    for (int i = 0; i < n1; i++) {
+        int cnt = 0;
+        while (cnt < R && final_graph->at(i, cnt) != EMPTY_ID) {
+            cnt++;
+        }
+        degrees[i] = cnt;
+    }
+    int num_attached = tree_grow(storage, degrees);
+    check_graph();
+
+    if (verbose) {
+        printf("NSG::add %zd nodes with %d threads: "
+               "insert %.3f s, tree_grow %.3f s, %d attached\n",
+               size_t(n),
+               omp_get_max_threads(),
+               (t1 - t0) / 1000,
+               (getmillisecs() - t1) / 1000,
+               num_attached);
+    }
+}
+
 void NSG::reset() {
     final_graph.reset();
     ntotal = 0;
@@ -363,7 +569,8 @@ void NSG::link(
         }
     } // omp parallel
 
-    std::vector<std::mutex> locks(ntotal);
+    // lock striping: a lock per node would take 40 bytes per node
+    std::vector<std::mutex> locks(std::min(ntotal, max_reverse_link_locks));
 #pragma omp parallel
     {
         std::unique_ptr<DistanceComputer> dis(
@@ -376,31 +583,23 @@ void NSG::link(
     } // omp parallel
 }
 
-void NSG::sync_prune(
+void NSG::occlusion_prune(
         int q,
-        std::vector<Node>& pool,
+        const std::vector<Node>& pool,
         DistanceComputer& dis,
-        VisitedTable& vt,
-        const nsg::Graph<idx_t>& knn_graph,
-        nsg::Graph<Node>& graph) {
-    for (int i = 0; i < knn_graph.K; i++) {
-        int id = knn_graph.at(q, i);
-        if (id < 0 || id >= ntotal || vt.get(id)) {
-            continue;
-        }
-
-        float dist = dis.symmetric_dis(q, id);
-        pool.emplace_back(id, dist);
+        std::vector<Node>& result) const {
+    result.clear();
+    if (pool.empty()) {
+        return;
     }
 
-    std::sort(pool.begin(), pool.end());
-
-    std::vector<Node> result;
-
     int start = 0;
     if (pool[start].id == q) {
         start++;
     }
+    if (start >= pool.size()) {
+        return;
+    }
     result.push_back(pool[start]);
 
     while (result.size() < R && (++start) < pool.size() && start < C) {
@@ -421,6 +620,29 @@ void NSG::sync_prune(
             result.push_back(p);
         }
     }
+}
+
+void NSG::sync_prune(
+        int q,
+        std::vector<Node>& pool,
+        DistanceComputer& dis,
+        VisitedTable& vt,
+        const nsg::Graph<idx_t>& knn_graph,
+        nsg::Graph<Node>& graph) {
+    for (int i = 0; i < knn_graph.K; i++) {
+        int id = knn_graph.at(q, i);
+        if (id < 0 || id >= ntotal || vt.get(id)) {
+            continue;
+        }
+
+        float dist = dis.symmetric_dis(q, id);
+        pool.emplace_back(id, dist);
+    }
+
+    std::sort(pool.begin(), pool.end());
+
+    std::vector<Node> result;
+    occlusion_prune(q, pool, dis, result);
 
     for (size_t i = 0; i < R; i++) {
         if (i < result.size()) {
@@ -438,17 +660,24 @@ void NSG::add_reverse_links(
         DistanceComputer& dis,
         nsg::Graph<Node>& graph) {
     for (size_t i = 0; i < R; i++) {
-        if (graph.at(q, i).id == EMPTY_ID) {
-            break;
+        int des;
+        Node sn;
+        {
+            // row q may be updated concurrently by the reverse links of
+            // another node
+            LockGuard guard(locks[q % locks.size()]);
+            if (graph.at(q, i).id == EMPTY_ID) {
+                break;
+            }
+            sn = Node(q, graph.at(q, i).distance);
+            des = graph.at(q, i).id;
         }
-
-        Node sn(q, graph.at(q, i).distance);
-        int des = graph.at(q, i).id;
+        std::mutex& lock = locks[des % locks.size()];
 
         std::vector<Node> tmp_pool;
         int dup = 0;
         {
-            LockGuard guard(locks[des]);
+            LockGuard guard(lock);
             for (int j = 0; j < R; j++) {
                 if (graph.at(des, j).id == EMPTY_ID) {
                     break;
@@ -494,14 +723,14 @@ void NSG::add_reverse_links(
             }
 
             {
-                LockGuard guard(locks[des]);
+                LockGuard guard(lock);
                 for (int t = 0; t < result.size(); t++) {
                     graph.at(des, t) = result[t];
                 }
             }
 
         } else {
-            LockGuard guard(locks[des]);
+            LockGuard guard(lock);
             for (int t = 0; t < R; t++) {
                 if (graph.at(des, t).id == EMPTY_ID) {
                     graph.at(des, t) = sn;
@@ -513,21 +742,110 @@ void NSG::add_reverse_links(
 }
 
 int NSG::tree_grow(Index* storage, std::vector<int>& degrees) {
-    int root = enterpoint;
-    VisitedTable vt(ntotal, use_visited_hashset);
-    VisitedTable vt2(ntotal, use_visited_hashset);
+    /* The unreached nodes are attached in order, as in attach_unlinked, to
+     * the nearest reached node of degree < R. The searches for the
+     * attachment points of a batch of unreached nodes run in parallel on
+     * the current graph, then the nodes of the batch that are still
+     * unreached are attached sequentially. The batch size adapts to the
+     * fraction of nodes of the previous batch that were still unreached
+     * (the others were reached through the previous attachments, so their
+     * search was wasted). It does not depend on the nb of threads, neither
+     * does the result. */
+    std::vector<std::atomic<bool>> reached(ntotal);
+    reached[enterpoint] = true;
+    std::vector<int> frontier(1, enterpoint);
+    size_t nreached = 1 + mark_reachable(*final_graph, reached, frontier);
+
+    int nt = omp_get_max_threads();
+    std::vector<std::unique_ptr<DistanceComputer>> dis(nt);
+    std::vector<std::unique_ptr<VisitedTable>> vts(nt);
+    for (int t = 0; t < nt; t++) {
+        dis[t].reset(storage_distance_computer(storage));
+        vts[t].reset(new VisitedTable(ntotal, use_visited_hashset));
+    }
 
     int num_attached = 0;
-    int cnt = 0;
-    while (true) {
-        cnt = dfs(vt, root, cnt);
-        if (cnt >= ntotal) {
-            break;
+    int batch_size = tree_grow_min_batch;
+    int cursor = 0; // the nodes before cursor are reached or in the batch
+    std::vector<int> batch;
+    std::vector<std::vector<int>> candidates;
+    while (nreached < ntotal) {
+        batch.clear();
+        for (; cursor < ntotal && batch.size() < batch_size; cursor++) {
+            if (!reached[cursor]) {
+                batch.push_back(cursor);
+            }
+        }
+        candidates.resize(batch.size());
+
+#pragma omp parallel
+        {
+            int rank = omp_get_thread_num();
+            std::unique_ptr<float[]> vec(new float[storage->d]);
+            std::vector<Neighbor> tmp;
+            std::vector<Node> pool;
+
+#pragma omp for schedule(dynamic)
+            for (int b = 0; b < batch.size(); b++) {
+                storage->reconstruct(batch[b], vec.get());
+                dis[rank]->set_query(vec.get());
+                search_on_graph<true>(
+                        *final_graph,
+                        *dis[rank],
+                        *vts[rank],
+                        enterpoint,
+                        search_L,
+                        tmp,
+                        pool);
+                std::sort(pool.begin(), pool.end());
+                candidates[b].clear();
+                for (const Node& node : pool) {
+                    candidates[b].push_back(node.id);
+                }
+                pool.clear();
+                tmp.clear();
+                vts[rank]->advance();
+            }
         }
 
-        root = attach_unlinked(storage, vt, vt2, degrees);
-        vt2.advance();
-        num_attached += 1;
+        int batch_attached = 0;
+        for (int b = 0; b < batch.size(); b++) {
+            int id = batch[b];
+            if (reached[id]) {
+                // attached with a previous node of the batch
+                continue;
+            }
+
+            int node = EMPTY_ID;
+            for (int cand : candidates[b]) {
+                if (reached[cand] && degrees[cand] < R) {
+                    node = cand;
+                    break;
+                }
+            }
+            // randomly choose another node
+            while (node == EMPTY_ID) {
+                int cand = rng.rand_int(ntotal);
+                if (reached[cand] && degrees[cand] < R) {
+                    node = cand;
+                }
+            }
+
+            final_graph->at(node, degrees[node]) = id;
+            degrees[node] += 1;
+            num_attached += 1;
+            batch_attached += 1;
+
+            reached[id] = true;
+            frontier.assign(1, id);
+            nreached += 1 + mark_reachable(*final_graph, reached, frontier);
+        }
+
+        if (batch_attached * 4 >= batch.size() * 3) {
+            batch_size = std::min(batch_size * 2, tree_grow_max_batch);
+        } else if (batch_attached * 4 < batch.size()) {
+            batch_size = std::max(batch_size / 2, tree_grow_min_batch);
+        }
     }
 
     return num_attached;
@@ -149,6 +149,12 @@ struct NSG {
             const nsg::Graph<idx_t>& knn_graph,
             bool verbose);
 
+    // insert the last n vectors of storage (storage->ntotal = ntotal + n)
+    // in a built graph. The nodes are inserted in parallel: each searches
+    // the graph, prunes its candidates with the sync_prune rule and adds
+    // reverse links, then the connectivity is repaired with tree_grow.
+    void add(Index* storage, idx_t n, bool verbose);
+
     // reset the graph
     void reset();
 
@@ -183,6 +189,14 @@ struct NSG {
             DistanceComputer& dis,
             nsg::Graph<Node>& graph);
 
+    // select the neighbors of q among the candidates of the pool, sorted
+    // by increasing distance, with the occlusion rule of NSG
+    void occlusion_prune(
+            int q,
+            const std::vector<Node>& pool,
+            DistanceComputer& dis,
+            std::vector<Node>& result) const;
+
     void sync_prune(
             int q,
             std::vector<Node>& pool,
@@ -197,14 +211,14 @@ struct NSG {
             nsg::Graph<Node>& graph,
             bool verbose);
 
-    // make NSG be fully connected
+    // make NSG be fully connected, returns the nb of attached nodes
     int tree_grow(Index* storage, std::vector<int>& degrees);
 
     // count the size of the connected component
     // using depth first search start by root
     int dfs(VisitedTable& vt, int root, int cnt) const;
 
-    // attach one unlinked node
+    // attach one unlinked node (sequential version of tree_grow)
     int attach_unlinked(
             Index* storage,
             VisitedTable& vt,
@@ -12,6 +12,7 @@
 #include <cstring>
 
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/random.h>
 
 namespace faiss {
 
@@ -24,9 +25,8 @@ template <typename OffsetFunc>
 inline void compute_cum_sums_impl(
         const float* vector,
         float* output,
-        size_t d,
         size_t n_levels,
-        size_t level_width_floats,
+        const std::vector<size_t>& level_bounds,
         OffsetFunc&& get_offset) {
     // Iterate backwards through levels, accumulating sum as we go.
     // This avoids computing the suffix sum for each vector, which takes
@@ -34,9 +34,8 @@ inline void compute_cum_sums_impl(
     float sum = 0.0f;
 
     for (int level = n_levels - 1; level >= 0; level--) {
-        size_t start_idx = level * level_width_floats;
-        size_t end_idx = std::min(
-                (level + 1) * level_width_floats, static_cast<size_t>(d));
+        size_t start_idx = level_bounds[level];
+        size_t end_idx = level_bounds[level + 1];
 
         for (size_t j = start_idx; j < end_idx; j++) {
             sum += vector[j] * vector[j];
@@ -48,6 +47,96 @@ inline void compute_cum_sums_impl(
     output[get_offset(n_levels)] = 0.0f;
 }
 
+std::vector<size_t> uniform_level_bounds(size_t d, size_t n_levels) {
+    size_t width = (d + n_levels - 1) / n_levels;
+    std::vector<size_t> bounds(n_levels + 1);
+    for (size_t level = 0; level <= n_levels; level++) {
+        bounds[level] = std::min(level * width, d);
+    }
+    return bounds;
+}
+
+/// overhead of processing one level for one candidate (bound computation,
+/// compaction of the active set), counted in dimensions
+const size_t panorama_level_overhead = 32;
+
+/// the codes and cumulative sums of a batch should fit in this cache size
+const size_t panorama_batch_cache_bytes = 256 * 1024;
+
+/// round the bounds up to multiples of align, remove empty levels
+std::vector<size_t> normalize_bounds(
+        const std::vector<size_t>& bounds,
+        size_t d,
+        size_t align) {
+    std::vector<size_t> res = {0};
+    for (size_t b : bounds) {
+        b = std::min((b + align - 1) / align * align, d);
+        if (b > res.back()) {
+            res.push_back(b);
+        }
+    }
+    if (res.back() != d) {
+        res.push_back(d);
+    }
+    return res;
+}
+
+/// simulate the progressive filtering of one query against a database
+/// sample, return the nb of dimensions scanned (including the per-level
+/// overhead) for each of the candidate level splits
+void simulate_progressive_filtering(
+        size_t d,
+        size_t nb,
+        const float* prefix_dots, // nb * (d + 1)
+        const float* y_suffix,    // nb * (d + 1)
+        const float* q_suffix,    // d + 1
+        bool is_l2,
+        float threshold,
+        const std::vector<std::vector<size_t>>& candidates,
+        std::vector<double>& costs) {
+    float q_norm2 = q_suffix[0] * q_suffix[0];
+    for (size_t c = 0; c < candidates.size(); c++) {
+        const std::vector<size_t>& bounds = candidates[c];
+        size_t n_levels = bounds.size() - 1;
+        double cost = 0;
+        for (size_t i = 0; i < nb; i++) {
+            const float* dots = prefix_dots + i * (d + 1);
+            const float* ys = y_suffix + i * (d + 1);
+            float y_norm2 = ys[0] * ys[0];
+            for (size_t level = 0; level < n_levels; level++) {
+                size_t b = bounds[level + 1];
+                cost += b - bounds[level] + panorama_level_overhead;
+                if (level + 1 == n_levels) {
+                    break;
+                }
+                bool keep;
+                if (is_l2) {
+                    float bound = q_norm2 + y_norm2 - 2 * dots[b] -
+                            2 * q_suffix[b] * ys[b];
+                    keep = threshold > bound;
+                } else {
+                    float bound = dots[b] + q_suffix[b] * ys[b];
+                    keep = threshold < bound;
+                }
+                if (!keep) {
+                    break;
+                }
+            }
+        }
+        costs[c] += cost;
+    }
+}
+
+/// suffix norms of a vector at every dimension, size d + 1
+void compute_suffix_norms(const float* x, size_t d, float* out) {
+    float sum = 0;
+    out[d] = 0;
+    for (size_t j = d; j-- > 0;) {
+        sum += x[j] * x[j];
+        out[j] = std::sqrt(sum);
+    }
+}
+
 } // namespace
 
 /**************************************************************
@@ -64,6 +153,144 @@ void Panorama::set_derived_values() {
     this->d = code_size / sizeof(float);
     this->level_width_floats = ((d + n_levels - 1) / n_levels);
     this->level_width = this->level_width_floats * sizeof(float);
+    this->level_bounds = uniform_level_bounds(d, n_levels);
+}
+
+void Panorama::set_level_bounds(const std::vector<size_t>& bounds) {
+    FAISS_THROW_IF_NOT_MSG(
+            bounds.size() >= 2 && bounds.front() == 0 && bounds.back() == d,
+            "Panorama: level bounds must go from 0 to d");
+    size_t max_width = 0;
+    for (size_t level = 0; level + 1 < bounds.size(); level++) {
+        FAISS_THROW_IF_NOT_MSG(
+                bounds[level] < bounds[level + 1],
+                "Panorama: level bounds must be increasing");
+        max_width = std::max(max_width, bounds[level + 1] - bounds[level]);
+    }
+    this->n_levels = bounds.size() - 1;
+    this->level_bounds = bounds;
+    this->level_width_floats = max_width;
+    this->level_width = max_width * sizeof(float);
+}
+
+bool Panorama::has_uniform_levels() const {
+    return level_bounds == uniform_level_bounds(d, n_levels);
+}
+
+void Panorama::calibrate(
+        size_t n,
+        const float* x,
+        MetricType metric,
+        size_t min_batch_size,
+        size_t max_batch_size) {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    FAISS_THROW_IF_NOT(min_batch_size > 0 && min_batch_size <= max_batch_size);
+    const size_t k = 10;
+    size_t nq = std::min(size_t(64), n / 4);
+    size_t nb = std::min(size_t(4096), n - nq);
+
+    if (nq > 0 && nb > k) {
+        // random split of the sample into queries and database
+        std::vector<int> perm(n);
+        rand_perm(perm.data(), n, 1234);
+
+        std::vector<float> y_suffix(nb * (d + 1));
+        std::vector<double> energy(d);
+        for (size_t i = 0; i < nb; i++) {
+            const float* yi = x + perm[nq + i] * d;
+            compute_suffix_norms(yi, d, y_suffix.data() + i * (d + 1));
+            for (size_t j = 0; j < d; j++) {
+                energy[j] += yi[j] * yi[j];
+            }
+        }
+
+        // candidate level splits
+        double total = 0;
+        std::vector<double> cum_energy(d + 1);
+        for (size_t j = 0; j < d; j++) {
+            cum_energy[j + 1] = (total += energy[j]);
+        }
+        auto first_dim_above = [&](double target) {
+            return size_t(
+                    std::lower_bound(
+                            cum_energy.begin(), cum_energy.end(), target) -
+                    cum_energy.begin());
+        };
+        size_t align = d >= 16 && d % 4 == 0 ? 4 : 1;
+        std::vector<std::vector<size_t>> candidates;
+        for (size_t nl : {1, 2, 3, 4, 6, 8, 12, 16, 24, 32}) {
+            if (nl > d) {
+                break;
+            }
+            std::vector<size_t> uniform, equal_energy, halving;
+            for (size_t level = 1; level < nl; level++) {
+                uniform.push_back(level * d / nl);
+                equal_energy.push_back(first_dim_above(total * level / nl));
+                // the suffix energy is halved at each level
+                double rest = std::ldexp(1.0, -int(level));
+                halving.push_back(first_dim_above(total * (1 - rest)));
+            }
+            candidates.push_back(normalize_bounds(uniform, d, align));
+            candidates.push_back(normalize_bounds(equal_energy, d, align));
+            candidates.push_back(normalize_bounds(halving, d, align));
+        }
+
+        std::vector<double> costs(candidates.size());
+        std::vector<float> prefix_dots(nb * (d + 1));
+        std::vector<float> q_suffix(d + 1);
+        std::vector<float> dis(nb);
+        bool is_l2 = metric == METRIC_L2;
+        for (size_t q = 0; q < nq; q++) {
+            const float* xq = x + perm[q] * d;
+            compute_suffix_norms(xq, d, q_suffix.data());
+            for (size_t i = 0; i < nb; i++) {
+                const float* yi = x + perm[nq + i] * d;
+                float* dots = prefix_dots.data() + i * (d + 1);
+                float dot = 0;
+                dots[0] = 0;
+                for (size_t j = 0; j < d; j++) {
+                    dot += xq[j] * yi[j];
+                    dots[j + 1] = dot;
+                }
+                float y_norm = y_suffix[i * (d + 1)];
+                dis[i] = is_l2 ? q_suffix[0] * q_suffix[0] + y_norm * y_norm -
+                                2 * dot
+                               : -dot;
+            }
+            // k-th nearest neighbor distance
+            std::nth_element(dis.begin(), dis.begin() + k - 1, dis.end());
+            float threshold = is_l2 ? dis[k - 1] : -dis[k - 1];
+
+            simulate_progressive_filtering(
+                    d,
+                    nb,
+                    prefix_dots.data(),
+                    y_suffix.data(),
+                    q_suffix.data(),
+                    is_l2,
+                    threshold,
+                    candidates,
+                    costs);
+        }
+
+        // the candidates are ordered by nb of levels, so ties go to the
+        // split with fewer levels
+        size_t best = 0;
+        for (size_t c = 1; c < candidates.size(); c++) {
+            if (costs[c] < costs[best]) {
+                best = c;
+            }
+        }
+        set_level_bounds(candidates[best]);
+    }
+
+    size_t entry_size = code_size + (n_levels + 1) * sizeof(float);
+    size_t bs = min_batch_size;
+    while (bs * 2 <= max_batch_size &&
+           bs * 2 * entry_size <= panorama_batch_cache_bytes) {
+        bs *= 2;
+    }
+    batch_size = bs;
 }
 
 /**
@@ -88,10 +315,9 @@ void Panorama::copy_codes_to_level_layout(
         // Copy entry into level-oriented layout for this batch.
         size_t batch_offset = batch_no * batch_size * code_size;
         for (size_t level = 0; level < n_levels; level++) {
-            size_t level_offset = level * level_width * batch_size;
-            size_t start_byte = level * level_width;
-            size_t actual_level_width =
-                    std::min(level_width, code_size - level * level_width);
+            size_t start_byte = level_bounds[level] * sizeof(float);
+            size_t level_offset = start_byte * batch_size;
+            size_t actual_level_width = level_size(level) * sizeof(float);
 
             const uint8_t* src = code + entry_idx * code_size + start_byte;
             uint8_t* dest = codes + batch_offset + level_offset +
@@ -120,12 +346,7 @@ void Panorama::compute_cumulative_sums(
         };
 
         compute_cum_sums_impl(
-                vector,
-                cumsum_base,
-                d,
-                n_levels,
-                level_width_floats,
-                get_offset);
+                vector, cumsum_base, n_levels, level_bounds, get_offset);
     }
 }
 
@@ -133,7 +354,7 @@ void Panorama::compute_query_cum_sums(const float* query, float* query_cum_sums)
         const {
     auto get_offset = [](size_t level) { return level; };
     compute_cum_sums_impl(
-            query, query_cum_sums, d, n_levels, level_width_floats, get_offset);
+            query, query_cum_sums, n_levels, level_bounds, get_offset);
 }
 
 void Panorama::reconstruct(idx_t key, float* recons, const uint8_t* codes_base)
@@ -145,12 +366,12 @@ void Panorama::reconstruct(idx_t key, float* recons, const uint8_t* codes_base)
     size_t batch_offset = batch_no * batch_size * code_size;
 
     for (size_t level = 0; level < n_levels; level++) {
-        size_t level_offset = level * level_width * batch_size;
+        size_t start_byte = level_bounds[level] * sizeof(float);
+        size_t level_offset = start_byte * batch_size;
+        size_t copy_size = level_size(level) * sizeof(float);
         const uint8_t* src = codes_base + batch_offset + level_offset +
-                pos_in_batch * level_width;
-        uint8_t* dest = recons_buffer + level * level_width;
-        size_t copy_size =
-                std::min(level_width, code_size - level * level_width);
+                pos_in_batch * copy_size;
+        uint8_t* dest = recons_buffer + start_byte;
         memcpy(dest, src, copy_size);
     }
 }
@@ -177,9 +398,8 @@ void Panorama::copy_entry(
 
     for (size_t level = 0; level < n_levels; level++) {
         // Copy code
-        size_t level_offset = level * level_width * batch_size;
-        size_t actual_level_width =
-                std::min(level_width, code_size - level * level_width);
+        size_t level_offset = level_bounds[level] * sizeof(float) * batch_size;
+        size_t actual_level_width = level_size(level) * sizeof(float);
 
         const uint8_t* src = src_codes + src_batch_offset + level_offset +
                 src_pos_in_batch * actual_level_width;
@@ -49,10 +49,48 @@ struct Panorama {
     size_t level_width_floats = 0;
     size_t batch_size = 0;
 
+    /// level l covers the dimensions [level_bounds[l], level_bounds[l + 1]).
+    /// The levels are uniform by default, see set_level_bounds.
+    std::vector<size_t> level_bounds;
+
     explicit Panorama(size_t code_size, size_t n_levels, size_t batch_size);
 
     void set_derived_values();
 
+    /// Use non-uniform levels, bounds is of size n_levels + 1 with
+    /// bounds[0] = 0 and bounds[n_levels] = d. This changes the storage
+    /// layout, so it must be called before adding vectors.
+    void set_level_bounds(const std::vector<size_t>& bounds);
+
+    /// whether the levels are the uniform ones of set_derived_values
+    bool has_uniform_levels() const;
+
+    /// number of dimensions in a level
+    size_t level_size(size_t level) const {
+        return level_bounds[level + 1] - level_bounds[level];
+    }
+
+    /** Calibrate the levels and the batch size on a sample of the data
+     * (after the orthogonal transform, if any).
+     *
+     * Candidate level splits are derived from the energy distribution over
+     * the dimensions (uniform, equal-energy and halving-energy splits for
+     * several level counts). For each of them, the progressive filtering is
+     * simulated on sample queries drawn from x, with the exact k-th nearest
+     * neighbor distance as threshold, and the split that minimizes the nb
+     * of dimensions scanned (plus a per-level overhead) is selected. The
+     * batch size is then chosen so that a batch of codes and cumulative
+     * sums fits in the L2 cache, within [min_batch_size, max_batch_size].
+     *
+     * As for set_level_bounds, this must be called before adding vectors.
+     */
+    void calibrate(
+            size_t n,
+            const float* x,
+            MetricType metric,
+            size_t min_batch_size,
+            size_t max_batch_size);
+
     /// Helper method to copy codes into level-oriented batch layout at a given
     /// offset in the list.
     void copy_codes_to_level_layout(
@@ -168,23 +206,22 @@ size_t Panorama::progressive_filter_batch(
 
     size_t total_active = num_active;
     for (size_t level = 0; level < n_levels; level++) {
-        local_stats.total_dims_scanned += num_active;
-        local_stats.total_dims += total_active;
+        size_t actual_level_width = level_size(level);
+        local_stats.total_dims_scanned += num_active * actual_level_width;
+        local_stats.total_dims += total_active * actual_level_width;
 
         float query_cum_norm = query_cum_sums[level + 1];
 
-        size_t level_offset = level * level_width * batch_size;
+        size_t level_offset = level_bounds[level] * sizeof(float) * batch_size;
         const float* level_storage =
                 (const float*)(storage_base + level_offset);
+        const float* query_level = query + level_bounds[level];
 
         size_t next_active = 0;
         for (size_t i = 0; i < num_active; i++) {
             uint32_t idx = active_indices[i];
-            size_t actual_level_width = std::min(
-                    level_width_floats, d - level * level_width_floats);
 
             const float* yj = level_storage + idx * actual_level_width;
-            const float* query_level = query + level * level_width_floats;
 
             float dot_product =
                     fvec_inner_product(query_level, yj, actual_level_width);
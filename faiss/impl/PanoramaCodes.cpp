@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <faiss/impl/PanoramaCodes.h>
+
+#include <cmath>
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+PanoramaCodes::PanoramaCodes(
+        size_t d,
+        size_t n_levels_in,
+        size_t granularity,
+        size_t norms_offset)
+        : d(d), norms_offset(norms_offset) {
+    FAISS_THROW_IF_NOT_MSG(
+            n_levels_in > 0, "PanoramaCodes: n_levels must be > 0");
+    FAISS_THROW_IF_NOT(granularity > 0);
+    size_t nunit = (d + granularity - 1) / granularity;
+    size_t width = (nunit + n_levels_in - 1) / n_levels_in * granularity;
+    n_levels = (d + width - 1) / width;
+    level_dims.resize(n_levels + 1);
+    for (size_t l = 0; l <= n_levels; l++) {
+        level_dims[l] = std::min(l * width, d);
+    }
+}
+
+void PanoramaCodes::compute_suffix_norms(const float* x, float* norms) const {
+    // accumulate backwards so that each dimension is visited once
+    float sum = 0;
+    norms[n_levels] = 0;
+    for (size_t l = n_levels; l-- > 0;) {
+        for (size_t j = level_dims[l]; j < level_dims[l + 1]; j++) {
+            sum += x[j] * x[j];
+        }
+        norms[l] = std::sqrt(sum);
+    }
+}
+
+void PanoramaCodes::encode_norms(const float* x, uint8_t* code) const {
+    std::vector<float> norms(n_levels + 1);
+    compute_suffix_norms(x, norms.data());
+    memcpy(code + norms_offset, norms.data() + 1, norms_size());
+}
+
+} // namespace faiss
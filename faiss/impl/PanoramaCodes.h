@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#ifndef FAISS_PANORAMA_CODES_H
+#define FAISS_PANORAMA_CODES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/MetricType.h>
+#include <faiss/impl/PanoramaStats.h>
+#include <faiss/impl/ResultHandler.h>
+#include <faiss/invlists/InvertedLists.h>
+#include <faiss/utils/ordered_key_value.h>
+
+namespace faiss {
+
+/**
+ * Panorama progressive filtering for compressed codes
+ * (see Panorama.h for the float version).
+ *
+ * The dimensions are split into n_levels contiguous levels. Level l covers
+ * the dimensions [level_dims[l], level_dims[l + 1]), and the code of a
+ * vector is laid out so that the partial distance of each level can be
+ * computed independently (a range of bytes of an SQ code, a range of
+ * sub-quantizers of a PQ code).
+ *
+ * The codes keep their usual layout, followed by the norms of the
+ * reconstructed vector restricted to the dimensions of levels l..n_levels-1,
+ * for l = 1..n_levels-1 (float32, so that the bounds are tight). The
+ * distance to a code is accumulated level by level, and a candidate is
+ * dropped as soon as the Cauchy-Schwarz bound on the remaining levels
+ * shows that it cannot enter the result set:
+ *
+ *   L2: ||q - y||^2 >= partial + (||q_rest|| - ||y_rest||)^2
+ *   IP: <q, y>      <= partial + ||q_rest|| * ||y_rest||
+ *
+ * Since the partial distances are exact, the results are the same as those
+ * of the scan without pruning (up to floating-point rounding).
+ */
+struct PanoramaCodes {
+    size_t d = 0;
+    size_t n_levels = 0;
+
+    /// level l covers dimensions [level_dims[l], level_dims[l + 1])
+    std::vector<size_t> level_dims;
+
+    /// offset of the norms in a code (= size of the quantizer code)
+    size_t norms_offset = 0;
+
+    /// number of codes processed at a time by the scanners
+    static constexpr size_t kBatchSize = 128;
+
+    PanoramaCodes() {}
+
+    /** @param n_levels     requested nb of levels. The level width is rounded
+     *                      up to a multiple of granularity, so the effective
+     *                      number of levels may be smaller.
+     *  @param granularity  level boundaries (except d) are multiples of
+     *                      this nb of dimensions (eg. the PQ sub-vector
+     *                      size)
+     *  @param norms_offset size of the quantizer code
+     */
+    PanoramaCodes(
+            size_t d,
+            size_t n_levels,
+            size_t granularity,
+            size_t norms_offset);
+
+    /// size of the norms appended to each code
+    size_t norms_size() const {
+        return (n_levels - 1) * sizeof(float);
+    }
+
+    /// total code size
+    size_t code_size() const {
+        return norms_offset + norms_size();
+    }
+
+    /// norms[l] = norm of x restricted to dims >= level_dims[l], for
+    /// l = 0..n_levels (norms[n_levels] = 0)
+    void compute_suffix_norms(const float* x, float* norms) const;
+
+    /// store the suffix norms of the reconstructed vector x in code
+    void encode_norms(const float* x, uint8_t* code) const;
+
+    /// suffix norm of level l >= 1 stored in a code
+    float suffix_norm(const uint8_t* code, size_t l) const {
+        float norm;
+        memcpy(&norm,
+               code + norms_offset + (l - 1) * sizeof(float),
+               sizeof(norm));
+        return norm;
+    }
+};
+
+/** Base class for the scanners of IVF indexes with Panorama codes.
+ *
+ * The derived class computes the partial distance of a level with
+ *
+ *     float partial_distance(size_t l, const uint8_t* code) const;
+ *
+ * and fills in accu0 (constant term of the distance) and q_norms (suffix
+ * norms of the query, or of its residual, see compute_suffix_norms) in
+ * set_query / set_list. C is CMax for L2 and CMin for inner product.
+ */
+template <class C, class Scanner>
+struct IVFPanoramaScanner : InvertedListScanner {
+    PanoramaCodes pano;
+
+    float accu0 = 0;
+    std::vector<float> q_norms;
+
+    IVFPanoramaScanner(
+            const PanoramaCodes& pano,
+            bool store_pairs,
+            const IDSelector* sel)
+            : InvertedListScanner(store_pairs, sel),
+              pano(pano),
+              q_norms(pano.n_levels + 1) {
+        keep_max = !C::is_max;
+        code_size = pano.code_size();
+    }
+
+    const Scanner& scanner() const {
+        return *static_cast<const Scanner*>(this);
+    }
+
+    float distance_to_code(const uint8_t* code) const override {
+        float dis = accu0;
+        for (size_t l = 0; l < pano.n_levels; l++) {
+            dis += scanner().partial_distance(l, code);
+        }
+        return dis;
+    }
+
+    size_t scan_codes(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            ResultHandler& handler) const override {
+        constexpr size_t bs = PanoramaCodes::kBatchSize;
+        size_t n_levels = pano.n_levels;
+        std::vector<uint32_t> active(bs);
+        std::vector<float> dis(bs);
+
+        PanoramaStats local_stats;
+        local_stats.reset();
+
+        size_t nup = 0;
+        for (size_t j0 = 0; j0 < list_size; j0 += bs) {
+            size_t j1 = std::min(j0 + bs, list_size);
+
+            // ID-filtered candidates of the batch
+            size_t num_active = 0;
+            for (size_t j = j0; j < j1; j++) {
+                if (sel) {
+                    idx_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                    if (!sel->is_member(id)) {
+                        continue;
+                    }
+                }
+                dis[j - j0] = accu0;
+                active[num_active++] = j - j0;
+            }
+            size_t total_active = num_active;
+
+            float threshold = handler.threshold;
+            for (size_t l = 0; l < n_levels; l++) {
+                size_t level_width =
+                        pano.level_dims[l + 1] - pano.level_dims[l];
+                local_stats.total_dims_scanned += num_active * level_width;
+                local_stats.total_dims += total_active * level_width;
+
+                float q_rest = q_norms[l + 1];
+                bool last_level = l + 1 == n_levels;
+
+                size_t next_active = 0;
+                for (size_t i = 0; i < num_active; i++) {
+                    uint32_t idx = active[i];
+                    const uint8_t* code = codes + (j0 + idx) * code_size;
+                    float di = dis[idx] + scanner().partial_distance(l, code);
+                    dis[idx] = di;
+
+                    float bound = di;
+                    if (!last_level) {
+                        float y_rest = pano.suffix_norm(code, l + 1);
+                        if constexpr (C::is_max) {
+                            bound += (q_rest - y_rest) * (q_rest - y_rest);
+                        } else {
+                            bound += q_rest * y_rest;
+                        }
+                    }
+
+                    active[next_active] = idx;
+                    next_active += C::cmp(threshold, bound) ? 1 : 0;
+                }
+                num_active = next_active;
+            }
+
+            // survivors have exact distances
+            for (size_t i = 0; i < num_active; i++) {
+                uint32_t idx = active[i];
+                size_t j = j0 + idx;
+                if (C::cmp(handler.threshold, dis[idx])) {
+                    idx_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                    handler.add_result(dis[idx], id);
+                    nup++;
+                }
+            }
+        }
+
+        indexPanorama_stats.add(local_stats);
+        return nup;
+    }
+};
+
+} // namespace faiss
+
+#endif
@@ -9,10 +9,12 @@
 
 #include <faiss/impl/ProductQuantizer.h>
 
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <vector>
 
 #include <algorithm>
 
@@ -21,6 +23,7 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/simd_dispatch.h>
 #include <faiss/utils/distances.h>
+#include <faiss/utils/random.h>
 
 extern "C" {
 
@@ -124,7 +127,212 @@ static void init_hypercube_pca(
     }
 }
 
+namespace {
+
+/* k-means on sub-vector m of the training set, run by a single thread.
+ * The training vectors are x[subset[i]] (or x[i] if subset is empty).
+ *
+ * Each step assigns a batch of points and moves the centroids towards the
+ * means of their assigned points with a per-centroid learning rate of
+ * (batch count) / (total count), as in Sculley, "Web-scale k-means
+ * clustering", WWW'10. When the batch is the whole training set, the counts
+ * are reset at each iteration, so that this reduces to a Lloyd iteration.
+ *
+ * Returns the number of iterations that were run. */
+int train_subquantizer(
+        const ProductQuantizer& pq,
+        size_t m,
+        size_t n,
+        const float* x,
+        const std::vector<int>& subset,
+        bool hot_start,
+        float* centroids) {
+    const size_t dsub = pq.dsub, ksub = pq.ksub;
+    const ClusteringParameters& cp = pq.cp;
+
+    auto get_x = [&](size_t i) {
+        return x + (subset.empty() ? i : subset[i]) * pq.d + m * dsub;
+    };
+
+    RandomGenerator rng(cp.seed + 15486557L * m);
+
+    if (!hot_start) {
+        std::vector<int> perm(n);
+        rand_perm(perm.data(), n, cp.seed + 15486557L * m);
+        for (size_t c = 0; c < ksub; c++) {
+            memcpy(centroids + c * dsub,
+                   get_x(perm[c]),
+                   sizeof(float) * dsub);
+        }
+    }
+
+    const bool full_batch =
+            pq.train_batch_size == 0 || pq.train_batch_size >= n;
+    const size_t bs = full_batch ? n : pq.train_batch_size;
+    // an iteration sees as many points as a full iteration on the
+    // subsampled training set
+    size_t npoints = std::min(n, size_t(cp.max_points_per_centroid) * ksub);
+    const size_t nstep = (npoints + bs - 1) / bs;
+
+    std::vector<float> sums(ksub * dsub);
+    // the assignment is done by blocks of points with a single-threaded
+    // sgemm, as in exhaustive_L2sqr_blas
+    const size_t bs_assign = std::min(bs, size_t(1024));
+    std::vector<float> xblock(bs_assign * dsub);
+    std::vector<float> ip_block(bs_assign * ksub);
+    std::vector<float> xnorms(bs_assign);
+    std::vector<float> centroids_norms(ksub);
+    std::vector<int64_t> counts(ksub);
+    std::vector<int64_t> batch_counts(ksub);
+    std::vector<size_t> batch(bs);
+
+    double prev_obj = 0;
+    for (int iter = 0; iter < cp.niter; iter++) {
+        double obj = 0;
+        for (size_t step = 0; step < nstep; step++) {
+            for (size_t i = 0; i < bs; i++) {
+                batch[i] = full_batch ? i : rng.rand_int64() % n;
+            }
+            std::fill(sums.begin(), sums.end(), 0);
+            std::fill(batch_counts.begin(), batch_counts.end(), 0);
+
+            fvec_norms_L2sqr(centroids_norms.data(), centroids, dsub, ksub);
+            for (size_t i0 = 0; i0 < bs; i0 += bs_assign) {
+                size_t i1 = std::min(bs, i0 + bs_assign);
+                for (size_t i = i0; i < i1; i++) {
+                    memcpy(xblock.data() + (i - i0) * dsub,
+                           get_x(batch[i]),
+                           sizeof(float) * dsub);
+                }
+                {
+                    float one = 1, zero = 0;
+                    FINTEGER nyi = ksub, nxi = i1 - i0, di = dsub;
+                    sgemm_("Transposed",
+                           "Not transposed",
+                           &nyi,
+                           &nxi,
+                           &di,
+                           &one,
+                           centroids,
+                           &di,
+                           xblock.data(),
+                           &di,
+                           &zero,
+                           ip_block.data(),
+                           &nyi);
+                }
+                fvec_norms_L2sqr(xnorms.data(), xblock.data(), dsub, i1 - i0);
+                for (size_t i = i0; i < i1; i++) {
+                    const float* xi = xblock.data() + (i - i0) * dsub;
+                    float* ip_line = ip_block.data() + (i - i0) * ksub;
+                    // ip_line = ||c||^2 - 2 <x, c>
+                    int c = fvec_madd_and_argmin(
+                            ksub,
+                            centroids_norms.data(),
+                            -2,
+                            ip_line,
+                            ip_line);
+                    obj += ip_line[c] + xnorms[i - i0];
+                    batch_counts[c]++;
+                    float* sum_c = sums.data() + c * dsub;
+                    for (size_t j = 0; j < dsub; j++) {
+                        sum_c[j] += xi[j];
+                    }
+                }
+            }
+
+            for (size_t c = 0; c < ksub; c++) {
+                int64_t bc = batch_counts[c];
+                if (full_batch) {
+                    counts[c] = 0;
+                }
+                float* cent = centroids + c * dsub;
+                if (bc == 0) {
+                    if (counts[c] == 0) {
+                        // empty cluster: re-seed it with a random point
+                        memcpy(cent,
+                               get_x(batch[rng.rand_int64() % bs]),
+                               sizeof(float) * dsub);
+                    }
+                    continue;
+                }
+                counts[c] += bc;
+                float eta = float(bc) / counts[c];
+                const float* sum_c = sums.data() + c * dsub;
+                for (size_t j = 0; j < dsub; j++) {
+                    cent[j] = (1 - eta) * cent[j] + eta * (sum_c[j] / bc);
+                }
+            }
+
+            if (cp.spherical) {
+                fvec_renorm_L2(dsub, ksub, centroids);
+            }
+            if (cp.int_centroids) {
+                for (size_t i = 0; i < ksub * dsub; i++) {
+                    centroids[i] = roundf(centroids[i]);
+                }
+            }
+        }
+
+        if (pq.train_early_stop_tol > 0 && iter > 0 &&
+            prev_obj - obj < pq.train_early_stop_tol * prev_obj) {
+            return iter + 1;
+        }
+        prev_obj = obj;
+    }
+    return cp.niter;
+}
+
+} // anonymous namespace
+
 void ProductQuantizer::train(size_t n, const float* x) {
+    if (parallel_train && !assign_index &&
+        (train_type == Train_default || train_type == Train_hot_start)) {
+        FAISS_THROW_IF_NOT_FMT(
+                n >= ksub,
+                "Number of training points (%zd) should be at least "
+                "as large as number of clusters (%zd)",
+                n,
+                ksub);
+
+        // subsample the training set as Clustering does
+        std::vector<int> subset;
+        size_t max_points = size_t(cp.max_points_per_centroid) * ksub;
+        if (train_batch_size == 0 && n > max_points) {
+            if (verbose) {
+                printf("Sampling a subset of %zd / %zd for training\n",
+                       max_points,
+                       n);
+            }
+            subset.resize(n);
+            rand_perm(subset.data(), n, cp.seed);
+            subset.resize(max_points);
+            n = max_points;
+        }
+
+        std::vector<int> niters(M);
+#pragma omp parallel for schedule(dynamic)
+        for (int m = 0; m < M; m++) {
+            niters[m] = train_subquantizer(
+                    *this,
+                    m,
+                    n,
+                    x,
+                    subset,
+                    train_type == Train_hot_start,
+                    get_centroids(m, 0));
+        }
+        if (verbose) {
+            for (int m = 0; m < M; m++) {
+                printf("Trained PQ slice %d/%zd in %d iterations\n",
+                       m,
+                       M,
+                       niters[m]);
+            }
+        }
+        return;
+    }
+
     if (train_type != Train_shared) {
         train_type_t final_train_type;
         final_train_type = train_type;
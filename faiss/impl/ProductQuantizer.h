@@ -47,6 +47,24 @@ struct ProductQuantizer : Quantizer {
 
     ClusteringParameters cp; ///< parameters used during clustering
 
+    /** train the M sub-quantizers concurrently, one sub-quantizer per
+     * thread, with a single-threaded (mini-batch) k-means instead of running
+     * a multi-threaded Clustering on each of them in sequence. This is faster
+     * when ksub is small w.r.t. the number of threads. Applies to
+     * Train_default and Train_hot_start (warm start from the current
+     * centroids) when assign_index is not set. Uses cp.niter, cp.seed,
+     * cp.max_points_per_centroid, cp.spherical and cp.int_centroids. */
+    bool parallel_train = false;
+
+    /// size of the mini-batches for parallel_train (0 = each iteration is a
+    /// full k-means iteration on the subsampled training set)
+    size_t train_batch_size = 0;
+
+    /// parallel_train stops iterating when the objective of an iteration
+    /// improves by less than this fraction over the previous one (0 = run
+    /// cp.niter iterations)
+    float train_early_stop_tol = 0;
+
     /// if non-NULL, use this index for assignment (should be of size
     /// d / M)
     Index* assign_index;
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/QueryTrace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <unordered_set>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexIVFFastScan.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/HNSW.h>
+#include <faiss/impl/PanoramaStats.h>
+#include <faiss/impl/RaBitQStats.h>
+
+namespace faiss {
+
+/*************************************************************
+ * QueryTrace
+ *************************************************************/
+
+double QueryTraceStageStats::quantile_ns(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = uint64_t(q * (count - 1));
+    uint64_t seen = 0;
+    for (int i = 0; i < nbucket; i++) {
+        seen += histogram[i];
+        if (seen > rank) {
+            // geometric middle of the bucket
+            double v = i == 0 ? 1.0 : double(uint64_t(1) << i) * 1.4142;
+            return v < max_ns ? v : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+void QueryTrace::reset() {
+    *this = QueryTrace();
+}
+
+void QueryTrace::add(const QueryTrace& other) {
+    for (int s = 0; s < QT_nstage; s++) {
+        QueryTraceStageStats& a = stages[s];
+        const QueryTraceStageStats& b = other.stages[s];
+        a.count += b.count;
+        a.total_ns += b.total_ns;
+        a.max_ns = std::max(a.max_ns, b.max_ns);
+        for (int i = 0; i < QueryTraceStageStats::nbucket; i++) {
+            a.histogram[i] += b.histogram[i];
+        }
+    }
+    for (int c = 0; c < QTC_ncounter; c++) {
+        counters[c] += other.counters[c];
+    }
+}
+
+const char* QueryTrace::stage_name(int stage) {
+    static const char* names[QT_nstage] = {
+            "coarse_quantization",
+            "lut_build",
+            "list_scan",
+            "graph_search",
+            "rerank",
+            "io_wait"};
+    FAISS_THROW_IF_NOT(stage >= 0 && stage < QT_nstage);
+    return names[stage];
+}
+
+const char* QueryTrace::counter_name(int counter) {
+    static const char* names[QTC_ncounter] = {
+            "nq", "nlist", "ndis", "nheap_updates", "nhops", "nbytes_read"};
+    FAISS_THROW_IF_NOT(counter >= 0 && counter < QTC_ncounter);
+    return names[counter];
+}
+
+namespace {
+
+void append_fmt(std::string& s, const char* fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    FAISS_THROW_IF_NOT(len >= 0 && len < int(sizeof(buf)));
+    s += buf;
+}
+
+} // namespace
+
+std::string QueryTrace::to_json() const {
+    std::string s = "{\"stages\": {";
+    for (int st = 0; st < QT_nstage; st++) {
+        const QueryTraceStageStats& ss = stages[st];
+        append_fmt(
+                s,
+                "%s\"%s\": {\"count\": %" PRIu64 ", \"total_ns\": %" PRIu64
+                ", \"max_ns\": %" PRIu64 ", \"histogram_log2_ns\": {",
+                st == 0 ? "" : ", ",
+                stage_name(st),
+                ss.count,
+                ss.total_ns,
+                ss.max_ns);
+        bool first = true;
+        for (int i = 0; i < QueryTraceStageStats::nbucket; i++) {
+            if (ss.histogram[i] == 0) {
+                continue;
+            }
+            append_fmt(
+                    s,
+                    "%s\"%d\": %" PRIu64,
+                    first ? "" : ", ",
+                    i,
+                    ss.histogram[i]);
+            first = false;
+        }
+        s += "}}";
+    }
+    s += "}, \"counters\": {";
+    for (int c = 0; c < QTC_ncounter; c++) {
+        append_fmt(
+                s,
+                "%s\"%s\": %" PRIu64,
+                c == 0 ? "" : ", ",
+                counter_name(c),
+                counters[c]);
+    }
+    s += "}}";
+    return s;
+}
+
+/*************************************************************
+ * Thread-local traces
+ *************************************************************/
+
+std::atomic<bool> query_trace_enabled{false};
+
+namespace {
+
+/* The trace of a thread is written only by that thread, so the updates
+ * are plain relaxed load + store, and other threads can read it without
+ * data race. */
+struct ThreadTrace {
+    struct Stage {
+        std::atomic<uint64_t> count{0}, total_ns{0}, max_ns{0};
+        std::atomic<uint64_t> histogram[QueryTraceStageStats::nbucket] = {};
+    };
+    Stage stages[QT_nstage];
+    std::atomic<uint64_t> counters[QTC_ncounter] = {};
+
+    ThreadTrace();
+    ~ThreadTrace();
+
+    static void incr(std::atomic<uint64_t>& x, uint64_t v) {
+        x.store(x.load(std::memory_order_relaxed) + v,
+                std::memory_order_relaxed);
+    }
+
+    void add_time(int stage, uint64_t ns) {
+        Stage& s = stages[stage];
+        incr(s.count, 1);
+        incr(s.total_ns, ns);
+        if (ns > s.max_ns.load(std::memory_order_relaxed)) {
+            s.max_ns.store(ns, std::memory_order_relaxed);
+        }
+        int bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+        incr(s.histogram[bucket], 1);
+    }
+
+    void read(QueryTrace& out) const {
+        for (int st = 0; st < QT_nstage; st++) {
+            QueryTraceStageStats& o = out.stages[st];
+            o.count = stages[st].count.load(std::memory_order_relaxed);
+            o.total_ns = stages[st].total_ns.load(std::memory_order_relaxed);
+            o.max_ns = stages[st].max_ns.load(std::memory_order_relaxed);
+            for (int i = 0; i < QueryTraceStageStats::nbucket; i++) {
+                o.histogram[i] =
+                        stages[st].histogram[i].load(std::memory_order_relaxed);
+            }
+        }
+        for (int c = 0; c < QTC_ncounter; c++) {
+            out.counters[c] = counters[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    void clear() {
+        for (int st = 0; st < QT_nstage; st++) {
+            stages[st].count.store(0, std::memory_order_relaxed);
+            stages[st].total_ns.store(0, std::memory_order_relaxed);
+            stages[st].max_ns.store(0, std::memory_order_relaxed);
+            for (int i = 0; i < QueryTraceStageStats::nbucket; i++) {
+                stages[st].histogram[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        for (int c = 0; c < QTC_ncounter; c++) {
+            counters[c].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+/// live thread traces + sum of the traces of the exited threads
+struct TraceRegistry {
+    std::mutex mutex;
+    std::unordered_set<ThreadTrace*> live;
+    QueryTrace exited;
+};
+
+TraceRegistry& registry() {
+    // never destroyed, so that threads exiting after the static
+    // destructors can still unregister
+    static TraceRegistry* r = new TraceRegistry();
+    return *r;
+}
+
+ThreadTrace::ThreadTrace() {
+    TraceRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.insert(this);
+}
+
+ThreadTrace::~ThreadTrace() {
+    TraceRegistry& r = registry();
+    QueryTrace t;
+    read(t);
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.exited.add(t);
+    r.live.erase(this);
+}
+
+ThreadTrace& thread_trace() {
+    thread_local ThreadTrace t;
+    return t;
+}
+
+} // namespace
+
+void query_trace_set_enabled(bool enabled) {
+    query_trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void query_trace_add_time(QueryTraceStage stage, uint64_t ns) {
+    thread_trace().add_time(stage, ns);
+}
+
+void query_trace_add_count(QueryTraceCounter counter, uint64_t n) {
+    if (query_trace_is_enabled()) {
+        ThreadTrace::incr(thread_trace().counters[counter], n);
+    }
+}
+
+QueryTrace query_trace_collect() {
+    TraceRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    QueryTrace res = r.exited;
+    for (const ThreadTrace* t : r.live) {
+        QueryTrace tt;
+        t->read(tt);
+        res.add(tt);
+    }
+    return res;
+}
+
+void query_trace_reset() {
+    TraceRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.exited.reset();
+    for (ThreadTrace* t : r.live) {
+        t->clear();
+    }
+}
+
+std::string query_trace_to_json() {
+    std::string s = query_trace_collect().to_json();
+    s.pop_back(); // closing brace
+
+    const IndexIVFStats& ivf = indexIVF_stats;
+    append_fmt(
+            s,
+            ", \"indexIVF_stats\": {\"nq\": %zd, \"nlist\": %zd, "
+            "\"ndis\": %zd, \"nheap_updates\": %zd, ",
+            ivf.nq,
+            ivf.nlist,
+            ivf.ndis,
+            ivf.nheap_updates);
+    append_fmt(
+            s,
+            "\"quantization_time_ms\": %g, \"search_time_ms\": %g}",
+            ivf.quantization_time,
+            ivf.search_time);
+
+    const HNSWStats& hnsw = hnsw_stats;
+    append_fmt(
+            s,
+            ", \"hnsw_stats\": {\"n1\": %zd, \"n2\": %zd, \"ndis\": %zd, "
+            "\"nhops\": %zd}",
+            hnsw.n1,
+            hnsw.n2,
+            hnsw.ndis,
+            hnsw.nhops);
+
+    const IVFFastScanStats& fs = IVFFastScan_stats;
+    append_fmt(
+            s,
+            ", \"IVFFastScan_stats\": {\"t_compute_distance_tables\": %" PRIu64
+            ", \"t_round\": %" PRIu64 ", ",
+            fs.t_compute_distance_tables,
+            fs.t_round);
+    append_fmt(
+            s,
+            "\"t_copy_pack\": %" PRIu64 ", \"t_scan\": %" PRIu64
+            ", \"t_to_flat\": %" PRIu64 "}",
+            fs.t_copy_pack,
+            fs.t_scan,
+            fs.t_to_flat);
+
+    const PanoramaStats& pano = indexPanorama_stats;
+    append_fmt(
+            s,
+            ", \"indexPanorama_stats\": {\"total_dims_scanned\": %" PRIu64
+            ", \"total_dims\": %" PRIu64 ", \"ratio_dims_scanned\": %g}",
+            uint64_t(pano.total_dims_scanned),
+            uint64_t(pano.total_dims),
+            pano.ratio_dims_scanned);
+
+    const RaBitQStats& rq = rabitq_stats;
+    append_fmt(
+            s,
+            ", \"rabitq_stats\": {\"n_1bit_evaluations\": %zd, "
+            "\"n_multibit_evaluations\": %zd}}",
+            rq.n_1bit_evaluations,
+            rq.n_multibit_evaluations);
+    return s;
+}
+
+} // namespace faiss
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <faiss/impl/platform_macros.h>
+
+namespace faiss {
+
+/** Per-stage profiling of the searches.
+ *
+ * When enabled with query_trace_set_enabled(true), the search functions
+ * record the time spent in each stage of a query and a few counters in a
+ * thread-local trace, so that the recording does not need any
+ * synchronization. query_trace_collect() sums up the traces of all
+ * threads, and query_trace_to_json() exports them together with the
+ * existing per-index statistics (indexIVF_stats, hnsw_stats, ...).
+ *
+ * Each timed section is one sample of the histogram of its stage, eg. one
+ * list scan or one coarse quantization of a batch of queries. The
+ * histograms have power-of-2 buckets: bucket i counts the samples that
+ * took between 2^i and 2^(i+1) ns.
+ *
+ * When disabled (the default), the instrumentation costs an inlined
+ * relaxed load of a global flag per timed section.
+ */
+
+enum QueryTraceStage : int {
+    QT_coarse_quantization = 0, ///< assignment to the inverted lists
+    QT_lut_build,               ///< distance tables and per-list setup
+    QT_list_scan,               ///< scan of the inverted lists
+    QT_graph_search,            ///< traversal of a graph index
+    QT_rerank,                  ///< re-ranking with exact distances
+    QT_io_wait,                 ///< waiting for reads from storage
+    QT_nstage
+};
+
+enum QueryTraceCounter : int {
+    QTC_nq = 0,         ///< nb of queries
+    QTC_nlist,          ///< nb of inverted lists scanned
+    QTC_ndis,           ///< nb of distances computed
+    QTC_nheap_updates,  ///< nb of result heap updates
+    QTC_nhops,          ///< nb of graph edges traversed
+    QTC_nbytes_read,    ///< nb of bytes read from storage
+    QTC_ncounter
+};
+
+/// timings of a stage
+struct QueryTraceStageStats {
+    static constexpr int nbucket = 64;
+
+    uint64_t count = 0;    ///< nb of timed sections
+    uint64_t total_ns = 0; ///< total time
+    uint64_t max_ns = 0;   ///< longest section
+    uint64_t histogram[nbucket] = {};
+
+    /// approximate quantile (0 <= q <= 1) from the histogram, in ns
+    double quantile_ns(double q) const;
+};
+
+/// all stages and counters, for one thread or summed over threads
+struct QueryTrace {
+    QueryTraceStageStats stages[QT_nstage];
+    uint64_t counters[QTC_ncounter] = {};
+
+    void reset();
+    void add(const QueryTrace& other);
+
+    static const char* stage_name(int stage);
+    static const char* counter_name(int counter);
+
+    /// JSON object with the non-empty histogram buckets
+    std::string to_json() const;
+};
+
+/// whether the recording is enabled, read inline by the instrumentation
+FAISS_API extern std::atomic<bool> query_trace_enabled;
+
+/// enable or disable the recording (not thread-safe w.r.t. the searches
+/// in progress, that may or may not see the change)
+FAISS_API void query_trace_set_enabled(bool enabled);
+
+inline bool query_trace_is_enabled() {
+    return query_trace_enabled.load(std::memory_order_relaxed);
+}
+
+/// sum of the traces of all threads, including the ones that exited
+FAISS_API QueryTrace query_trace_collect();
+
+/// clear the traces of all threads. Should not be called during a search.
+FAISS_API void query_trace_reset();
+
+/** JSON export of query_trace_collect(), with the current values of the
+ * global statistics of the indexes:
+ *
+ *   {"stages": {...}, "counters": {...}, "indexIVF_stats": {...},
+ *    "hnsw_stats": {...}, "IVFFastScan_stats": {...},
+ *    "indexPanorama_stats": {...}, "rabitq_stats": {...}}
+ */
+FAISS_API std::string query_trace_to_json();
+
+/// record a section of duration ns for the calling thread
+FAISS_API void query_trace_add_time(QueryTraceStage stage, uint64_t ns);
+
+/// increment a counter of the calling thread
+FAISS_API void query_trace_add_count(QueryTraceCounter counter, uint64_t n);
+
+/// times the section from construction to destruction (or stop())
+struct QueryTraceTimer {
+    using clock = std::chrono::steady_clock;
+
+    QueryTraceStage stage;
+    bool active;
+    clock::time_point t0;
+
+    explicit QueryTraceTimer(QueryTraceStage stage)
+            : stage(stage), active(query_trace_is_enabled()) {
+        if (active) {
+            t0 = clock::now();
+        }
+    }
+
+    void stop() {
+        if (active) {
+            auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - t0);
+            query_trace_add_time(stage, dt.count());
+            active = false;
+        }
+    }
+
+    ~QueryTraceTimer() {
+        stop();
+    }
+};
+
+} // namespace faiss
@@ -290,6 +290,37 @@ void set_bit_fastscan(uint8_t* code, size_t bit_index) {
     }
 }
 
+void decode_multibit_reconstruction(
+        const uint8_t* sign_bits,
+        const uint8_t* ex_code,
+        size_t d,
+        size_t ex_bits,
+        float* out) {
+    FAISS_THROW_IF_NOT(ex_bits >= 1 && ex_bits <= 8);
+    const float cb = -(static_cast<float>(1 << ex_bits) - 0.5f);
+    const float sign_val = static_cast<float>(1 << ex_bits);
+    const uint32_t mask = (1u << ex_bits) - 1;
+
+    // bit stream reader over ex_code, LSB first
+    uint64_t buf = 0;
+    size_t nbuf = 0;
+    const uint8_t* p = ex_code;
+
+    for (size_t i = 0; i < d; i++) {
+        while (nbuf < ex_bits) {
+            buf |= uint64_t(*p++) << nbuf;
+            nbuf += 8;
+        }
+        const uint32_t ex_code_val = buf & mask;
+        buf >>= ex_bits;
+        nbuf -= ex_bits;
+
+        const bool sign_bit = (sign_bits[i >> 3] >> (i & 7)) & 1;
+        out[i] = (sign_bit ? sign_val : 0.0f) +
+                static_cast<float>(ex_code_val) + cb;
+    }
+}
+
 size_t compute_per_vector_storage_size(size_t nb_bits, size_t d) {
     const size_t ex_bits = nb_bits - 1;
     if (ex_bits == 0) {
@@ -308,6 +308,55 @@ inline int extract_code_inline(
     return code_value;
 }
 
+/** Convert the inner product between the rotated query and the multi-bit
+ * reconstruction of a vector to a distance.
+ *
+ * @param ex_ip           inner product between rotated query and the
+ *                        reconstruction (see decode_multibit_reconstruction)
+ * @param ex_fac          ex-bit factors (f_add_ex, f_rescale_ex)
+ * @param qr_to_c_L2sqr   precomputed ||query_rotated - centroid||^2
+ * @param qr_norm_L2sqr   precomputed ||query_rotated||^2 (0 for L2 metric)
+ * @param metric_type     distance metric (L2 or Inner Product)
+ * @return                full multi-bit distance
+ */
+inline float multibit_distance_from_ip(
+        float ex_ip,
+        const ExtraBitsFactors& ex_fac,
+        float qr_to_c_L2sqr,
+        float qr_norm_L2sqr,
+        MetricType metric_type) {
+    float dist = qr_to_c_L2sqr + ex_fac.f_add_ex + ex_fac.f_rescale_ex * ex_ip;
+
+    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
+        dist = -0.5f * (dist - qr_norm_L2sqr);
+    } else {
+        dist = std::max(0.0f, dist);
+    }
+
+    return dist;
+}
+
+/** Decode the sign bits and ex-bit codes of a vector to the float values
+ * whose inner product with the rotated query is used by the multi-bit
+ * distance: out[i] = (sign_i << ex_bits) + ex_code_i - (2^ex_bits - 0.5).
+ *
+ * The ex-bit codes are read as a bit stream, so the cost is independent of
+ * ex_bits. The output is meant to be fed to batched inner product kernels
+ * (fvec_inner_products_ny).
+ *
+ * @param sign_bits   unpacked sign bits (1-bit codes in standard format)
+ * @param ex_code     packed ex-bit codes
+ * @param d           dimensionality
+ * @param ex_bits     number of extra bits (nb_bits - 1), 1..8
+ * @param out         output array, size d
+ */
+void decode_multibit_reconstruction(
+        const uint8_t* sign_bits,
+        const uint8_t* ex_code,
+        size_t d,
+        size_t ex_bits,
+        float* out);
+
 /** Compute full multi-bit distance from sign bits and ex-bit codes.
  * This is the core distance computation shared by RaBitQFastScan handlers.
  *
@@ -352,15 +401,8 @@ inline float compute_full_multibit_distance(
         ex_ip += rotated_q[i] * reconstructed;
     }
 
-    float dist = qr_to_c_L2sqr + ex_fac.f_add_ex + ex_fac.f_rescale_ex * ex_ip;
-
-    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
-        dist = -0.5f * (dist - qr_norm_L2sqr);
-    } else {
-        dist = std::max(0.0f, dist);
-    }
-
-    return dist;
+    return multibit_distance_from_ip(
+            ex_ip, ex_fac, qr_to_c_L2sqr, qr_norm_L2sqr, metric_type);
 }
 
 /** Compute pointer to a vector's auxiliary data within block layout. */
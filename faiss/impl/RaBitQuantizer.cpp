@@ -369,6 +369,69 @@ void RaBitQDistanceComputerNotQ::set_query(const float* x) {
     }
 }
 
+//
+// rearrange the bits of the quantized query (qr - c) for the popcount-based
+//   scheme from 3.3. out has (d + 7) / 8 * qb bytes.
+void rearrange_query_bits(
+        const uint8_t* rotated_qq,
+        size_t d,
+        uint8_t qb,
+        uint8_t* out) {
+    size_t offset = (d + 7) / 8;
+    std::fill(out, out + offset * qb, 0);
+
+    for (size_t idim = 0; idim < d; idim++) {
+        for (size_t iv = 0; iv < qb; iv++) {
+            const bool bit = ((rotated_qq[idim] & (1 << iv)) != 0);
+            out[iv * offset + idim / 8] |= bit ? (1 << (idim % 8)) : 0;
+        }
+    }
+}
+
+// 1-bit distance from the popcount-based dot product of the quantized query
+//   with the sign bits. dot_qo is the xor product if centered, the and
+//   product otherwise. sum_q is the number of set sign bits (unused if
+//   centered).
+float distance_from_1bit_dot(
+        const QueryFactorsData& query_fac,
+        const SignBitFactors& base_fac,
+        uint64_t dot_qo,
+        uint64_t sum_q,
+        size_t d,
+        uint8_t qb,
+        bool centered,
+        MetricType metric_type) {
+    // this is ||or - c||^2 - (IP ? ||or||^2 : 0)
+    float final_dot = 0;
+    if (centered) {
+        int64_t int_dot = ((1 << qb) - 1) * d;
+        // See RaBitDistanceComputerNotQ::distance_to_code() for baseline code.
+        int_dot -= 2 * dot_qo;
+        final_dot += int_dot * query_fac.int_dot_scale;
+    } else {
+        // dot-product itself
+        final_dot += query_fac.c1 * dot_qo;
+        // normalizer coefficients
+        final_dot += query_fac.c2 * sum_q;
+        // normalizer coefficients
+        final_dot -= query_fac.c34;
+    }
+
+    // pre_dist = ||or - c||^2 + ||qr - c||^2 -
+    //     2 * ||or - c|| * ||qr - c|| * <q,o> - (IP ? ||or||^2 : 0)
+    const float pre_dist = base_fac.or_minus_c_l2sqr +
+            query_fac.qr_to_c_L2sqr - 2 * base_fac.dp_multiplier * final_dot;
+
+    if (metric_type == MetricType::METRIC_L2) {
+        // ||or - q||^ 2
+        return pre_dist;
+    } else {
+        // metric == MetricType::METRIC_INNER_PRODUCT
+        // 2 * (or, q) = (||or - q||^2 - ||q||^2 - ||or||^2)
+        return -0.5f * (pre_dist - query_fac.qr_norm_L2sqr);
+    }
+}
+
 //
 struct RaBitQDistanceComputerQ : RaBitQDistanceComputer {
     // the rotated and quantized query (qr - c)
@@ -419,43 +482,22 @@ float RaBitQDistanceComputerQ::distance_to_code_1bit(const uint8_t* code) {
             ? reinterpret_cast<const SignBitFactors*>(code + size)
             : reinterpret_cast<const SignBitFactorsWithError*>(code + size);
 
-    // this is ||or - c||^2 - (IP ? ||or||^2 : 0)
-    float final_dot = 0;
+    uint64_t dot_qo = 0;
+    uint64_t sum_q = 0;
     if (centered) {
-        int64_t int_dot = ((1 << qb) - 1) * d;
-        // See RaBitDistanceComputerNotQ::distance_to_code() for baseline code.
-        int_dot -= 2 *
-                rabitq::bitwise_xor_dot_product(
-                           rearranged_rotated_qq.data(), binary_data, size, qb);
-        final_dot += int_dot * query_fac.int_dot_scale;
+        dot_qo = rabitq::bitwise_xor_dot_product(
+                rearranged_rotated_qq.data(), binary_data, size, qb);
     } else {
-        auto dot_qo = rabitq::bitwise_and_dot_product(
+        dot_qo = rabitq::bitwise_and_dot_product(
                 rearranged_rotated_qq.data(), binary_data, size, qb);
         // It was a willful decision (after the discussion) to not to pre-cache
         // the sum of all bits, just in order to reduce the overhead per vector.
         // process 64-bit popcounts
-        auto sum_q = rabitq::popcount(binary_data, size);
-        // dot-product itself
-        final_dot += query_fac.c1 * dot_qo;
-        // normalizer coefficients
-        final_dot += query_fac.c2 * sum_q;
-        // normalizer coefficients
-        final_dot -= query_fac.c34;
+        sum_q = rabitq::popcount(binary_data, size);
     }
 
-    // pre_dist = ||or - c||^2 + ||qr - c||^2 -
-    //     2 * ||or - c|| * ||qr - c|| * <q,o> - (IP ? ||or||^2 : 0)
-    const float pre_dist = base_fac->or_minus_c_l2sqr +
-            query_fac.qr_to_c_L2sqr - 2 * base_fac->dp_multiplier * final_dot;
-
-    if (metric_type == MetricType::METRIC_L2) {
-        // ||or - q||^ 2
-        return pre_dist;
-    } else {
-        // metric == MetricType::METRIC_INNER_PRODUCT
-        // 2 * (or, q) = (||or - q||^2 - ||q||^2 - ||or||^2)
-        return -0.5f * (pre_dist - query_fac.qr_norm_L2sqr);
-    }
+    return distance_from_1bit_dot(
+            query_fac, *base_fac, dot_qo, sum_q, d, qb, centered, metric_type);
 }
 
 float RaBitQDistanceComputerQ::distance_to_code_full(const uint8_t* code) {
@@ -519,15 +561,8 @@ void RaBitQDistanceComputerQ::set_query(const float* x) {
     size_t offset = (d + 7) / 8;
 
     rearranged_rotated_qq.resize(offset * qb);
-    std::fill(rearranged_rotated_qq.begin(), rearranged_rotated_qq.end(), 0);
-
-    for (size_t idim = 0; idim < d; idim++) {
-        for (size_t iv = 0; iv < qb; iv++) {
-            const bool bit = ((rotated_qq[idim] & (1 << iv)) != 0);
-            rearranged_rotated_qq[iv * offset + idim / 8] |=
-                    bit ? (1 << (idim % 8)) : 0;
-        }
-    }
+    rearrange_query_bits(
+            rotated_qq.data(), d, qb, rearranged_rotated_qq.data());
 }
 
 } // anonymous namespace
@@ -557,4 +592,139 @@ FlatCodesDistanceComputer* RaBitQuantizer::get_distance_computer(
     }
 }
 
+RaBitQMultiQueryDistanceComputer::RaBitQMultiQueryDistanceComputer(
+        const RaBitQuantizer& rabitq,
+        uint8_t qb,
+        const float* centroid,
+        bool centered)
+        : d(rabitq.d),
+          centroid(centroid),
+          metric_type(rabitq.metric_type),
+          nb_bits(rabitq.nb_bits),
+          qb(qb),
+          centered(centered) {
+    FAISS_THROW_IF_NOT(qb <= 8);
+    FAISS_THROW_IF_NOT(qb > 0);
+}
+
+void RaBitQMultiQueryDistanceComputer::set_queries(
+        size_t nq_in,
+        const float* const* x) {
+    FAISS_THROW_IF_NOT(nq_in <= max_nq);
+    FAISS_ASSERT(
+            (metric_type == MetricType::METRIC_L2 ||
+             metric_type == MetricType::METRIC_INNER_PRODUCT));
+    nq = nq_in;
+
+    const size_t size = (d + 7) / 8;
+    rearranged_rotated_qq.resize(nq * size * qb);
+    rotated_q.resize(nq * d);
+    query_facs.resize(nq);
+    g_errors.resize(nq);
+
+    std::vector<float> rotated_q_1;
+    std::vector<uint8_t> rotated_qq_1;
+    for (size_t iq = 0; iq < nq; iq++) {
+        FAISS_ASSERT(x[iq] != nullptr);
+        // same computations as RaBitQDistanceComputerQ::set_query()
+        query_facs[iq] = rabitq_utils::compute_query_factors(
+                x[iq],
+                d,
+                centroid,
+                qb,
+                centered,
+                metric_type,
+                rotated_q_1,
+                rotated_qq_1);
+        g_errors[iq] = std::sqrt(query_facs[iq].qr_to_c_L2sqr);
+        std::copy(
+                rotated_q_1.begin(),
+                rotated_q_1.end(),
+                rotated_q.begin() + iq * d);
+        rearrange_query_bits(
+                rotated_qq_1.data(),
+                d,
+                qb,
+                rearranged_rotated_qq.data() + iq * size * qb);
+    }
+}
+
+void RaBitQMultiQueryDistanceComputer::distances_to_code_1bit(
+        const uint8_t* code,
+        float* dis) const {
+    FAISS_ASSERT(code != nullptr);
+    const size_t size = (d + 7) / 8;
+    const uint8_t* binary_data = code;
+
+    size_t ex_bits = nb_bits - 1;
+    const SignBitFactors* base_fac = (ex_bits == 0)
+            ? reinterpret_cast<const SignBitFactors*>(code + size)
+            : reinterpret_cast<const SignBitFactorsWithError*>(code + size);
+
+    uint64_t dot_qo[max_nq];
+    uint64_t sum_q = 0;
+    if (centered) {
+        rabitq::bitwise_dot_product_multi<true>(
+                rearranged_rotated_qq.data(),
+                nq,
+                binary_data,
+                size,
+                qb,
+                dot_qo);
+    } else {
+        rabitq::bitwise_dot_product_multi<false>(
+                rearranged_rotated_qq.data(),
+                nq,
+                binary_data,
+                size,
+                qb,
+                dot_qo);
+        // the sum of the bits is shared by all the queries
+        sum_q = rabitq::popcount(binary_data, size);
+    }
+
+    for (size_t iq = 0; iq < nq; iq++) {
+        dis[iq] = distance_from_1bit_dot(
+                query_facs[iq],
+                *base_fac,
+                dot_qo[iq],
+                sum_q,
+                d,
+                qb,
+                centered,
+                metric_type);
+    }
+}
+
+float RaBitQMultiQueryDistanceComputer::distance_to_code_full(
+        size_t iq,
+        const uint8_t* code) const {
+    FAISS_ASSERT(code != nullptr);
+    FAISS_ASSERT(iq < nq);
+
+    size_t ex_bits = nb_bits - 1;
+    if (ex_bits == 0) {
+        float dis[max_nq];
+        distances_to_code_1bit(code, dis);
+        return dis[iq];
+    }
+
+    const uint8_t* binary_data = code;
+    size_t offset = (d + 7) / 8 + sizeof(SignBitFactorsWithError);
+    const uint8_t* ex_code = code + offset;
+    const ExtraBitsFactors* ex_fac = reinterpret_cast<const ExtraBitsFactors*>(
+            ex_code + (d * ex_bits + 7) / 8);
+
+    return rabitq_utils::compute_full_multibit_distance(
+            binary_data,
+            ex_code,
+            *ex_fac,
+            rotated_q.data() + iq * d,
+            query_facs[iq].qr_to_c_L2sqr,
+            query_facs[iq].qr_norm_L2sqr,
+            d,
+            ex_bits,
+            metric_type);
+}
+
 } // namespace faiss
@@ -9,10 +9,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include <faiss/MetricType.h>
 #include <faiss/impl/DistanceComputer.h>
 #include <faiss/impl/Quantizer.h>
+#include <faiss/impl/RaBitQUtils.h>
 
 namespace faiss {
 
@@ -136,4 +138,46 @@ struct RaBitQDistanceComputer : FlatCodesDistanceComputer {
     }
 };
 
+// Computes the distances of a batch of SQ-quantized queries (qb > 0) to the
+// same codes, all relative to the same centroid. The 1-bit estimates of the
+// whole batch are computed with a single pass over each code, which is what
+// makes grouping the queries that visit the same inverted list worthwhile.
+// The results are identical to those of get_distance_computer(qb, ...).
+struct RaBitQMultiQueryDistanceComputer {
+    // the maximum number of queries that share one pass over a code
+    static constexpr size_t max_nq = 16;
+
+    size_t d = 0;
+    const float* centroid = nullptr;
+    MetricType metric_type = MetricType::METRIC_L2;
+    size_t nb_bits = 1;
+    uint8_t qb = 4;
+    bool centered = false;
+
+    // number of queries currently set, <= max_nq
+    size_t nq = 0;
+    // rearranged quantized queries, (d + 7) / 8 * qb bytes per query
+    std::vector<uint8_t> rearranged_rotated_qq;
+    // rotated queries (qr - c), d floats per query, for full distances
+    std::vector<float> rotated_q;
+    std::vector<rabitq_utils::QueryFactorsData> query_facs;
+    // query error factors, see RaBitQDistanceComputer::g_error
+    std::vector<float> g_errors;
+
+    RaBitQMultiQueryDistanceComputer(
+            const RaBitQuantizer& rabitq,
+            uint8_t qb,
+            const float* centroid = nullptr,
+            bool centered = false);
+
+    // x is a table of nq pointers to queries
+    void set_queries(size_t nq, const float* const* x);
+
+    // 1-bit distance estimates of all the queries to a code, dis has size nq
+    void distances_to_code_1bit(const uint8_t* code, float* dis) const;
+
+    // full multi-bit distance of query iq to a code
+    float distance_to_code_full(size_t iq, const uint8_t* code) const;
+};
+
 } // namespace faiss
@@ -435,6 +435,12 @@ void ResidualQuantizer::compute_codes_add_centroids(
 
     //
     size_t mem = memory_per_point();
+    if (use_beam_LUT == 1) {
+        // the LUT encoding does not store residuals, but the dot products
+        // of the query with all the centroids and the beams of codes
+        mem = total_codebook_size * sizeof(float);
+        mem += max_beam_size * 3 * ((M + 1) * sizeof(int32_t) + sizeof(float));
+    }
 
     size_t bs = max_mem_distances / mem;
     if (bs == 0) {
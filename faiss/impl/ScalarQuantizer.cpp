@@ -190,11 +190,31 @@ SQDistanceComputer* select_distance_computer(
         case ScalarQuantizer::QT_8bit_direct_signed:
             return new DCTemplate<Quantizer8bitDirectSigned<SL>, Sim, SL>(
                     d, trained);
+        case ScalarQuantizer::QT_mixed:
+            return new DCMixed<Sim>(d, trained);
         default:
             FAISS_THROW_MSG("unknown qtype");
     }
 }
 
+/// returns nullptr if qtype is not supported by DCInt8Query
+template <class Sim>
+SQDistanceComputer* select_int8_query_distance_computer(
+        QuantizerType qtype,
+        size_t d,
+        const std::vector<float>& trained) {
+    switch (qtype) {
+        case ScalarQuantizer::QT_8bit:
+        case ScalarQuantizer::QT_8bit_uniform:
+            return new DCInt8Query<8, Sim>(d, trained);
+        case ScalarQuantizer::QT_4bit:
+        case ScalarQuantizer::QT_4bit_uniform:
+            return new DCInt8Query<4, Sim>(d, trained);
+        default:
+            return nullptr;
+    }
+}
+
 template <SIMDLevel SL>
 ScalarQuantizer::SQuantizer* select_quantizer_1(
         QuantizerType qtype,
@@ -234,6 +254,8 @@ ScalarQuantizer::SQuantizer* select_quantizer_1(
             return new Quantizer8bitDirect<SL>(d, trained);
         case ScalarQuantizer::QT_8bit_direct_signed:
             return new Quantizer8bitDirectSigned<SL>(d, trained);
+        case ScalarQuantizer::QT_mixed:
+            return new QuantizerMixed(d, trained);
         default:
             FAISS_THROW_MSG("unknown qtype");
     }
@@ -280,6 +302,16 @@ void ScalarQuantizer::set_derived_sizes() {
             code_size = d * 2;
             bits = 16;
             break;
+        case QT_mixed:
+            if (bits == 0) {
+                bits = 4;
+            }
+            if (trained.size() == 3 * d) {
+                code_size = MixedBitLayout(d, trained).code_size;
+            } else {
+                code_size = (d * bits + 7) / 8;
+            }
+            break;
         default:
             break;
     }
@@ -316,6 +348,18 @@ void ScalarQuantizer::train(size_t n, const float* x) {
                     x,
                     trained);
             break;
+        case QT_mixed:
+            FAISS_THROW_IF_NOT(bits > 0 && bits <= 8);
+            train_Mixed(
+                    rangestat,
+                    rangestat_arg,
+                    n,
+                    int(d),
+                    (d * bits + 7) / 8,
+                    x,
+                    trained);
+            set_derived_sizes();
+            break;
         case QT_fp16:
         case QT_8bit_direct:
         case QT_bf16:
@@ -369,6 +413,16 @@ void ScalarQuantizer::decode(const uint8_t* codes, float* x, size_t n) const {
 SQDistanceComputer* ScalarQuantizer::get_distance_computer(
         MetricType metric) const {
     FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    if (int8_query) {
+        SQDistanceComputer* dc = metric == METRIC_L2
+                ? select_int8_query_distance_computer<
+                          SimilarityL2<SIMDLevel::NONE>>(qtype, d, trained)
+                : select_int8_query_distance_computer<
+                          SimilarityIP<SIMDLevel::NONE>>(qtype, d, trained);
+        if (dc) {
+            return dc;
+        }
+    }
 #if defined(USE_AVX512_F16C)
     if (d % 16 == 0) {
         if (metric == METRIC_L2) {
@@ -555,6 +609,37 @@ InvertedListScanner* ScalarQuantizer::select_InvertedListScanner(
         }
     };
 
+    if (int8_query) {
+        auto select_int8_query =
+                [&]<class Similarity>() -> InvertedListScanner* {
+            switch (qtype) {
+                case QT_8bit:
+                case QT_8bit_uniform:
+                    return scan.template
+                    operator()<DCInt8Query<8, Similarity>>();
+                case QT_4bit:
+                case QT_4bit_uniform:
+                    return scan.template
+                    operator()<DCInt8Query<4, Similarity>>();
+                default:
+                    return nullptr;
+            }
+        };
+        InvertedListScanner* scanner = nullptr;
+        if (mt == METRIC_L2) {
+            scanner = select_int8_query
+                              .template operator()<
+                                      SimilarityL2<SIMDLevel::NONE>>();
+        } else if (mt == METRIC_INNER_PRODUCT) {
+            scanner = select_int8_query
+                              .template operator()<
+                                      SimilarityIP<SIMDLevel::NONE>>();
+        }
+        if (scanner) {
+            return scanner;
+        }
+    }
+
     auto select_by_simd_and_metric =
             [&,
              this]<SIMDLevel SL, class Similarity>() -> InvertedListScanner* {
@@ -631,6 +716,8 @@ InvertedListScanner* ScalarQuantizer::select_InvertedListScanner(
                         Quantizer8bitDirectSigned<SL>,
                         Similarity,
                         SL>>();
+            case QT_mixed:
+                return scan.template operator()<DCMixed<Similarity>>();
             default:
                 FAISS_THROW_MSG("unknown qtype");
         }
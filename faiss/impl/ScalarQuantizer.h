@@ -33,6 +33,7 @@ struct ScalarQuantizer : Quantizer {
         QT_bf16,
         QT_8bit_direct_signed, ///< fast indexing of signed int8s ranging from
                                ///< [-128 to 127]
+        QT_mixed, ///< 8, 4, 2 or 0 bits per component, allocated at training
     };
 
     QuantizerType qtype = QT_8bit;
@@ -52,12 +53,22 @@ struct ScalarQuantizer : Quantizer {
     RangeStat rangestat = RS_minmax;
     float rangestat_arg = 0;
 
-    /// bits per scalar code
+    /** bits per scalar code. For QT_mixed, this is the average number of
+     * bits per component, that sets the code size before training
+     * (default 4). The training allocates the bits to the components
+     * depending on their reconstruction error, which may end up in a
+     * smaller code size. */
     size_t bits = 0;
 
     /// trained values (including the range)
     std::vector<float> trained;
 
+    /** For QT_8bit, QT_4bit and their uniform variants: compute the
+     * distances in the integer domain, with the query quantized to int8
+     * (see DCInt8Query). This is faster but the distances are
+     * approximate. Not serialized. */
+    bool int8_query = false;
+
     ScalarQuantizer(size_t d, QuantizerType qtype);
     ScalarQuantizer();
 
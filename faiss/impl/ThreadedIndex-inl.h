@@ -8,6 +8,8 @@
 #pragma once
 
 #include <faiss/impl/FaissAssert.h>
+#include <omp.h>
+#include <algorithm>
 #include <exception>
 #include <iostream>
 
@@ -24,21 +26,12 @@ ThreadedIndex<IndexT>::ThreadedIndex(int d, bool threaded)
 
 template <typename IndexT>
 ThreadedIndex<IndexT>::~ThreadedIndex() {
-    for (auto& p : indices_) {
-        if (isThreaded_) {
-            // should have worker thread
-            FAISS_ASSERT((bool)p.second);
-
-            // This will also flush all pending work
-            p.second->stop();
-            p.second->waitForThreadExit();
-        } else {
-            // should not have worker thread
-            FAISS_ASSERT(!(bool)p.second);
-        }
+    // joins the threads
+    pool_.reset();
 
-        if (own_indices) {
-            delete p.first;
+    if (own_indices) {
+        for (auto index : indices_) {
+            delete index;
         }
     }
 }
@@ -61,7 +54,7 @@ void ThreadedIndex<IndexT>::addIndex(IndexT* index) {
             index->d);
 
     if (!indices_.empty()) {
-        auto& existing = indices_.front().first;
+        auto& existing = indices_.front();
 
         FAISS_THROW_IF_NOT_MSG(
                 index->metric_type == existing->metric_type,
@@ -69,19 +62,15 @@ void ThreadedIndex<IndexT>::addIndex(IndexT* index) {
                 "of different metric type than old index");
 
         // Make sure this index is not duplicated
-        for (auto& p : indices_) {
+        for (auto p : indices_) {
             FAISS_THROW_IF_NOT_MSG(
-                    p.first != index,
+                    p != index,
                     "addIndex: attempting to add index "
                     "that is already in the collection");
         }
     }
 
-    indices_.emplace_back(
-            std::make_pair(
-                    index,
-                    std::unique_ptr<WorkerThread>(
-                            isThreaded_ ? new WorkerThread : nullptr)));
+    indices_.push_back(index);
 
     onAfterAddIndex(index);
 }
@@ -89,19 +78,8 @@ void ThreadedIndex<IndexT>::addIndex(IndexT* index) {
 template <typename IndexT>
 void ThreadedIndex<IndexT>::removeIndex(IndexT* index) {
     for (auto it = indices_.begin(); it != indices_.end(); ++it) {
-        if (it->first == index) {
-            // This is our index; stop the worker thread before removing it,
-            // to ensure that it has finished before function exit
-            if (isThreaded_) {
-                // should have worker thread
-                FAISS_ASSERT((bool)it->second);
-                it->second->stop();
-                it->second->waitForThreadExit();
-            } else {
-                // should not have worker thread
-                FAISS_ASSERT(!(bool)it->second);
-            }
-
+        if (*it == index) {
+            // the pool is resized lazily by the next runOnIndex
             indices_.erase(it);
             onAfterRemoveIndex(index);
 
@@ -119,34 +97,36 @@ void ThreadedIndex<IndexT>::removeIndex(IndexT* index) {
 
 template <typename IndexT>
 void ThreadedIndex<IndexT>::runOnIndex(std::function<void(int, IndexT*)> f) {
-    if (isThreaded_) {
-        std::vector<std::future<bool>> v;
-
-        for (int i = 0; i < this->indices_.size(); ++i) {
-            auto& p = this->indices_[i];
-            auto indexPtr = p.first;
-            v.emplace_back(
-                    p.second->add([f, i, indexPtr]() { f(i, indexPtr); }));
-        }
+    // Multiple exceptions may be thrown; gather them as we encounter them,
+    // while letting everything else run to completion
+    std::vector<std::pair<int, std::exception_ptr>> exceptions;
 
-        waitAndHandleFutures(v);
+    if (isThreaded_ && indices_.size() > 1) {
+        int ompThreads = omp_threads_per_index > 0
+                ? omp_threads_per_index
+                : std::max(1, omp_get_max_threads() / count());
+        getPool()->run(
+                count(),
+                [this, &f](int i) { f(i, indices_[i]); },
+                ompThreads,
+                exceptions);
+        // the pool does not report the exceptions in task order
+        std::sort(
+                exceptions.begin(),
+                exceptions.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
     } else {
-        // Multiple exceptions may be thrown; gather them as we encounter them,
-        // while letting everything else run to completion
-        std::vector<std::pair<int, std::exception_ptr>> exceptions;
-
         for (int i = 0; i < this->indices_.size(); ++i) {
-            auto& p = this->indices_[i];
             try {
-                f(i, p.first);
+                f(i, indices_[i]);
             } catch (...) {
                 exceptions.emplace_back(
                         std::make_pair(i, std::current_exception()));
             }
         }
-
-        handleExceptions(exceptions);
     }
+
+    handleExceptions(exceptions);
 }
 
 template <typename IndexT>
@@ -170,24 +150,20 @@ template <typename IndexT>
 void ThreadedIndex<IndexT>::onAfterRemoveIndex(IndexT* index) {}
 
 template <typename IndexT>
-void ThreadedIndex<IndexT>::waitAndHandleFutures(
-        std::vector<std::future<bool>>& v) {
-    // Blocking wait for completion for all of the indices, capturing any
-    // exceptions that are generated
-    std::vector<std::pair<int, std::exception_ptr>> exceptions;
-
-    for (int i = 0; i < v.size(); ++i) {
-        auto& fut = v[i];
-
-        try {
-            fut.get();
-        } catch (...) {
-            exceptions.emplace_back(
-                    std::make_pair(i, std::current_exception()));
-        }
+WorkerThreadPool* ThreadedIndex<IndexT>::getPool() {
+    int cpusPerThread = 0;
+    if (pin_threads) {
+        cpusPerThread = omp_threads_per_index > 0
+                ? omp_threads_per_index
+                : std::max(1, omp_get_max_threads() / count());
     }
-
-    handleExceptions(exceptions);
+    std::lock_guard<std::mutex> guard(poolMutex_);
+    if (!pool_ || pool_->size() != count() - 1 ||
+        pool_->cpus_per_thread() != cpusPerThread) {
+        pool_.reset();
+        pool_.reset(new WorkerThreadPool(count() - 1, cpusPerThread));
+    }
+    return pool_.get();
 }
 
 } // namespace faiss
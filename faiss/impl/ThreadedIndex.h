@@ -11,11 +11,19 @@
 #include <faiss/IndexBinary.h>
 #include <faiss/utils/WorkerThread.h>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace faiss {
 
 /// A holder of indices in a collection of threads
+///
+/// In threaded mode, the calls to the sub-indices are run by a pool of
+/// count() - 1 persistent threads plus the calling thread, with work
+/// stealing between them. A sub-index may be called from any of these
+/// threads. Each call gets a budget of omp_threads_per_index OpenMP
+/// threads.
+///
 /// The interface to this class itself is not thread safe
 template <typename IndexT>
 class ThreadedIndex : public IndexT {
@@ -26,18 +34,17 @@ class ThreadedIndex : public IndexT {
     ~ThreadedIndex() override;
 
     /// override an index that is managed by ourselves.
-    /// WARNING: once an index is added, it becomes unsafe to touch it from any
-    /// other thread than that on which is managing it, until we are shut
-    /// down. Use runOnIndex to perform work on it instead.
+    /// WARNING: once an index is added, it becomes unsafe to touch it
+    /// concurrently with the calls we make on it, until we are shut down.
+    /// Use runOnIndex to perform work on it instead.
     virtual void addIndex(IndexT* index);
 
     /// Remove an index that is managed by ourselves.
-    /// This will flush all pending work on that index, and then shut
-    /// down its managing thread, and will remove the index.
+    /// There is no pending work on the index outside of runOnIndex, so
+    /// this only removes the index.
     void removeIndex(IndexT* index);
 
-    /// Run a function on all indices, in the thread that the index is
-    /// managed in.
+    /// Run a function on all indices, in parallel in threaded mode.
     /// Function arguments are (index in collection, index pointer)
     void runOnIndex(std::function<void(int, IndexT*)> f);
     void runOnIndex(std::function<void(int, const IndexT*)> f) const;
@@ -53,17 +60,25 @@ class ThreadedIndex : public IndexT {
 
     /// Returns the i-th sub-index
     IndexT* at(size_t i) {
-        return indices_[i].first;
+        return indices_[i];
     }
 
     /// Returns the i-th sub-index (const version)
     const IndexT* at(size_t i) const {
-        return indices_[i].first;
+        return indices_[i];
     }
 
     /// Whether or not we are responsible for deleting our contained indices
     bool own_indices = false;
 
+    /// OpenMP threads used by each sub-index call in threaded mode
+    /// (0 = split omp_get_max_threads() evenly between the sub-indices)
+    int omp_threads_per_index = 0;
+
+    /// pin the threads of the pool to disjoint groups of
+    /// omp_threads_per_index CPUs (Linux only)
+    bool pin_threads = false;
+
    protected:
     /// Called just after an index is added
     virtual void onAfterAddIndex(IndexT* index);
@@ -72,10 +87,18 @@ class ThreadedIndex : public IndexT {
     virtual void onAfterRemoveIndex(IndexT* index);
 
    protected:
-    static void waitAndHandleFutures(std::vector<std::future<bool>>& v);
+    /// Returns the thread pool, (re)created if the nb of indices or the
+    /// pinning parameters changed
+    WorkerThreadPool* getPool();
+
+    /// Collection of Index instances
+    std::vector<IndexT*> indices_;
+
+    /// Threads shared by the sub-indices in threaded mode, created lazily
+    std::unique_ptr<WorkerThreadPool> pool_;
 
-    /// Collection of Index instances, with their managing worker thread if any
-    std::vector<std::pair<IndexT*, std::unique_ptr<WorkerThread>>> indices_;
+    /// Protects the lazy creation of pool_ by concurrent const calls
+    std::mutex poolMutex_;
 
     /// Is this index multi-threaded?
     bool isThreaded_;
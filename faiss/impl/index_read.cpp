@@ -37,15 +37,20 @@
 #include <faiss/IndexIVFFlatPanorama.h>
 #include <faiss/IndexIVFIndependentQuantizer.h>
 #include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQPanorama.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
 #include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFRaBitQFastScan.h>
+#include <faiss/IndexIVFScalarQuantizerPanorama.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
 #include <faiss/IndexNNDescent.h>
 #include <faiss/IndexNSG.h>
+#ifndef _WIN32
+#include <faiss/IndexDiskGraph.h>
+#endif
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/IndexPreTransform.h>
@@ -69,6 +74,7 @@
 #include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexBinaryHash.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexBinaryIVFFastScan.h>
 
 // mmap-ing and viewing facilities
 #include <faiss/impl/maybe_owned_vector.h>
@@ -359,21 +365,31 @@ std::unique_ptr<InvertedLists> read_InvertedLists_up(
                 "read_InvertedLists:"
                 " WARN! inverted lists not stored with IVF object\n");
         return nullptr;
-    } else if (h == fourcc("ilpn") && !(io_flags & IO_FLAG_SKIP_IVF_DATA)) {
+    } else if (
+            (h == fourcc("ilpn") || h == fourcc("ilpb")) &&
+            !(io_flags & IO_FLAG_SKIP_IVF_DATA)) {
         size_t nlist, code_size, n_levels;
         READ1(nlist);
         READ1(code_size);
         READ1(n_levels);
         auto ailp = std::make_unique<ArrayInvertedListsPanorama>(
                 nlist, code_size, n_levels);
+        if (h == fourcc("ilpb")) {
+            Panorama pano = ailp->pano;
+            READ1(pano.batch_size);
+            std::vector<size_t> level_bounds;
+            READVECTOR(level_bounds);
+            pano.set_level_bounds(level_bounds);
+            FAISS_THROW_IF_NOT(pano.n_levels == n_levels);
+            ailp->set_panorama(pano);
+        }
+        size_t batch_size = ailp->pano.batch_size;
         std::vector<size_t> sizes(nlist);
         read_ArrayInvertedLists_sizes(f, sizes);
         for (size_t i = 0; i < nlist; i++) {
             ailp->ids[i].resize(sizes[i]);
             size_t num_elems =
-                    ((sizes[i] + ArrayInvertedListsPanorama::kBatchSize - 1) /
-                     ArrayInvertedListsPanorama::kBatchSize) *
-                    ArrayInvertedListsPanorama::kBatchSize;
+                    (sizes[i] + batch_size - 1) / batch_size * batch_size;
             ailp->codes[i].resize(num_elems * code_size);
             ailp->cum_sums[i].resize(num_elems * (n_levels + 1));
         }
@@ -921,7 +937,9 @@ std::unique_ptr<Index> read_index_up(IOReader* f, int io_flags) {
     if (h == fourcc("null")) {
         // denotes a missing index, useful for some cases
         return idx;
-    } else if (h == fourcc("IxFP") || h == fourcc("IxFp")) {
+    } else if (
+            h == fourcc("IxFP") || h == fourcc("IxFp") ||
+            h == fourcc("IxFB") || h == fourcc("IxFb")) {
         int d;
         size_t n_levels, batch_size;
         READ1(d);
@@ -929,13 +947,20 @@ std::unique_ptr<Index> read_index_up(IOReader* f, int io_flags) {
         FAISS_THROW_IF_NOT_FMT(n_levels > 0, "invalid n_levels %zd", n_levels);
         READ1(batch_size);
         std::unique_ptr<IndexFlatPanorama> idxp;
-        if (h == fourcc("IxFP")) {
+        if (h == fourcc("IxFP") || h == fourcc("IxFB")) {
             idxp = std::make_unique<IndexFlatL2Panorama>(
                     d, n_levels, batch_size);
         } else {
             idxp = std::make_unique<IndexFlatIPPanorama>(
                     d, n_levels, batch_size);
         }
+        if (h == fourcc("IxFB") || h == fourcc("IxFb")) {
+            // non-uniform levels, eg. from auto-tuning
+            std::vector<size_t> level_bounds;
+            READVECTOR(level_bounds);
+            idxp->pano.set_level_bounds(level_bounds);
+            FAISS_THROW_IF_NOT(idxp->pano.n_levels == n_levels);
+        }
         READ1(idxp->ntotal);
         READ1(idxp->is_trained);
         READVECTOR(idxp->codes);
@@ -1265,6 +1290,28 @@ std::unique_ptr<Index> read_index_up(IOReader* f, int io_flags) {
         }
         read_InvertedLists(*ivsc, f, io_flags);
         idx = std::move(ivsc);
+    } else if (h == fourcc("IwSn")) {
+        auto ivsp = std::make_unique<IndexIVFScalarQuantizerPanorama>();
+        read_ivf_header(ivsp.get(), f);
+        read_ScalarQuantizer(&ivsp->sq, f);
+        READ1(ivsp->code_size);
+        READ1(ivsp->by_residual);
+        READ1(ivsp->n_levels);
+        FAISS_THROW_IF_NOT(
+                ivsp->code_size == ivsp->get_panorama_codes().code_size());
+        read_InvertedLists(*ivsp, f, io_flags);
+        idx = std::move(ivsp);
+    } else if (h == fourcc("IwQn")) {
+        auto ivpp = std::make_unique<IndexIVFPQPanorama>();
+        read_ivf_header(ivpp.get(), f);
+        READ1(ivpp->by_residual);
+        READ1(ivpp->code_size);
+        read_ProductQuantizer(&ivpp->pq, f);
+        READ1(ivpp->n_levels);
+        FAISS_THROW_IF_NOT(
+                ivpp->code_size == ivpp->get_panorama_codes().code_size());
+        read_InvertedLists(*ivpp, f, io_flags);
+        idx = std::move(ivpp);
     } else if (
             h == fourcc("IwLS") || h == fourcc("IwRQ") || h == fourcc("IwPL") ||
             h == fourcc("IwPR")) {
@@ -1297,6 +1344,15 @@ std::unique_ptr<Index> read_index_up(IOReader* f, int io_flags) {
         READ1(iva->by_residual);
         READ1(iva->use_precomputed_table);
         read_InvertedLists(*iva, f, io_flags);
+        // the precomputed table is not stored, recompute it unless it was
+        // disabled
+        if (iva->is_trained && iva->by_residual &&
+            iva->use_precomputed_table != -1 &&
+            (io_flags & IO_FLAG_SKIP_PRECOMPUTE_TABLE) == 0) {
+            iva->precompute_table();
+        } else if (iva->use_precomputed_table == 1) {
+            iva->use_precomputed_table = 0;
+        }
         idx = std::move(iva);
     } else if (h == fourcc("IwSh")) {
         auto ivsp = std::make_unique<IndexIVFSpectralHash>();
@@ -1479,6 +1535,35 @@ std::unique_ptr<Index> read_index_up(IOReader* f, int io_flags) {
         idxnsg->storage = read_index(f, io_flags);
         idxnsg->own_fields = true;
         idx = std::move(idxnsg);
+#ifndef _WIN32
+    } else if (h == fourcc("IxDG")) {
+        auto idxdg = std::make_unique<IndexDiskGraph>();
+        read_index_header(*idxdg, f);
+        {
+            std::vector<char> x;
+            READVECTOR(x);
+            idxdg->filename.assign(x.begin(), x.end());
+        }
+        READ1(idxdg->R);
+        READ1(idxdg->GK);
+        READ1(idxdg->build_type);
+        READ1(idxdg->search_L);
+        READ1(idxdg->beam_width);
+        READ1(idxdg->entry_point);
+        READ1(idxdg->node_size);
+        READ1(idxdg->nodes_per_sector);
+        READ1(idxdg->sectors_per_node);
+        {
+            std::unique_ptr<Index> sub(read_index(f, io_flags));
+            IndexPQ* pq_index = dynamic_cast<IndexPQ*>(sub.get());
+            FAISS_THROW_IF_NOT(pq_index);
+            idxdg->pq_index = *pq_index;
+        }
+        if (idxdg->ntotal > 0) {
+            idxdg->open();
+        }
+        idx = std::move(idxdg);
+#endif
     } else if (h == fourcc("INNf")) {
         auto idxnnd = std::make_unique<IndexNNDescentFlat>();
         read_index_header(*idxnnd, f);
@@ -1830,7 +1915,9 @@ static void read_InvertedLists(IndexBinaryIVF& ivf, IOReader* f, int io_flags) {
     auto ils = read_InvertedLists_up(f, io_flags);
     FAISS_THROW_IF_NOT(
             !ils ||
-            (ils->nlist == ivf.nlist && ils->code_size == ivf.code_size));
+            (ils->nlist == ivf.nlist &&
+             (ils->code_size == ivf.code_size ||
+              ils->code_size == InvertedLists::INVALID_CODE_SIZE)));
     ivf.invlists = ils.release();
     ivf.own_invlists = true;
 }
@@ -1947,6 +2034,14 @@ std::unique_ptr<IndexBinary> read_index_binary_up(IOReader* f, int io_flags) {
         read_binary_ivf_header(*ivf, f);
         read_InvertedLists(*ivf, f, io_flags);
         idx = std::move(ivf);
+    } else if (h == fourcc("IBwS")) {
+        auto ivfs = std::make_unique<IndexBinaryIVFFastScan>();
+        read_binary_ivf_header(*ivfs, f);
+        READ1(ivfs->bbs);
+        FAISS_THROW_IF_NOT(ivfs->bbs > 0 && ivfs->bbs % 32 == 0);
+        read_InvertedLists(*ivfs, f, io_flags);
+        ivfs->init_code_packer();
+        idx = std::move(ivfs);
     } else if (h == fourcc("IBFf")) {
         auto idxff = std::make_unique<IndexBinaryFromFloat>();
         read_index_binary_header(*idxff, f);
@@ -2009,6 +2104,7 @@ std::unique_ptr<IndexBinary> read_index_binary_up(IOReader* f, int io_flags) {
             read_binary_multi_hash_map(
                     idxmh->maps[i], idxmh->b, idxmh->ntotal, f);
         }
+        idxmh->compact();
         idx = std::move(idxmh);
     } else {
         FAISS_THROW_FMT(
@@ -34,15 +34,20 @@
 #include <faiss/IndexIVFFlatPanorama.h>
 #include <faiss/IndexIVFIndependentQuantizer.h>
 #include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQPanorama.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
 #include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFRaBitQFastScan.h>
+#include <faiss/IndexIVFScalarQuantizerPanorama.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
 #include <faiss/IndexNNDescent.h>
 #include <faiss/IndexNSG.h>
+#ifndef _WIN32
+#include <faiss/IndexDiskGraph.h>
+#endif
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/IndexPreTransform.h>
@@ -66,6 +71,7 @@
 #include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexBinaryHash.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexBinaryIVFFastScan.h>
 
 /*************************************************************
  * The I/O format is the content of the class. For objects that are
@@ -262,11 +268,18 @@ void write_InvertedLists(const InvertedLists* ils, IOWriter* f) {
     } else if (
             const auto& ailp =
                     dynamic_cast<const ArrayInvertedListsPanorama*>(ils)) {
-        uint32_t h = fourcc("ilpn");
+        // the default layout keeps the original format
+        bool default_layout = ailp->pano.has_uniform_levels() &&
+                ailp->pano.batch_size == ArrayInvertedListsPanorama::kBatchSize;
+        uint32_t h = fourcc(default_layout ? "ilpn" : "ilpb");
         WRITE1(h);
         WRITE1(ailp->nlist);
         WRITE1(ailp->code_size);
         WRITE1(ailp->n_levels);
+        if (!default_layout) {
+            WRITE1(ailp->pano.batch_size);
+            WRITEVECTOR(ailp->pano.level_bounds);
+        }
         uint32_t list_type = fourcc("full");
         WRITE1(list_type);
         std::vector<size_t> sizes;
@@ -452,11 +465,17 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
     } else if (
             const IndexFlatPanorama* idxpan =
                     dynamic_cast<const IndexFlatPanorama*>(idx)) {
-        uint32_t h = fourcc(idxpan->metric_type == METRIC_L2 ? "IxFP" : "IxFp");
+        bool uniform = idxpan->pano.has_uniform_levels();
+        uint32_t h = fourcc(
+                idxpan->metric_type == METRIC_L2 ? (uniform ? "IxFP" : "IxFB")
+                                                 : (uniform ? "IxFp" : "IxFb"));
         WRITE1(h);
         WRITE1(idxpan->d);
         WRITE1(idxpan->n_levels);
         WRITE1(idxpan->batch_size);
+        if (!uniform) {
+            WRITEVECTOR(idxpan->pano.level_bounds);
+        }
         WRITE1(idxpan->ntotal);
         WRITE1(idxpan->is_trained);
         WRITEVECTOR(idxpan->codes);
@@ -712,6 +731,18 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         WRITE1(h);
         write_ivf_header(ivfl_2, f);
         write_InvertedLists(ivfl_2->invlists, f);
+    } else if (
+            const IndexIVFScalarQuantizerPanorama* ivsp =
+                    dynamic_cast<const IndexIVFScalarQuantizerPanorama*>(
+                            idx)) {
+        uint32_t h = fourcc("IwSn");
+        WRITE1(h);
+        write_ivf_header(ivsp, f);
+        write_ScalarQuantizer(&ivsp->sq, f);
+        WRITE1(ivsp->code_size);
+        WRITE1(ivsp->by_residual);
+        WRITE1(ivsp->n_levels);
+        write_InvertedLists(ivsp->invlists, f);
     } else if (
             const IndexIVFScalarQuantizer* ivsc =
                     dynamic_cast<const IndexIVFScalarQuantizer*>(idx)) {
@@ -767,6 +798,17 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         WRITE1(ivsp->threshold_type);
         WRITEVECTOR(ivsp->trained);
         write_InvertedLists(ivsp->invlists, f);
+    } else if (
+            const IndexIVFPQPanorama* ivpp =
+                    dynamic_cast<const IndexIVFPQPanorama*>(idx)) {
+        uint32_t h = fourcc("IwQn");
+        WRITE1(h);
+        write_ivf_header(ivpp, f);
+        WRITE1(ivpp->by_residual);
+        WRITE1(ivpp->code_size);
+        write_ProductQuantizer(&ivpp->pq, f);
+        WRITE1(ivpp->n_levels);
+        write_InvertedLists(ivpp->invlists, f);
     } else if (const IndexIVFPQ* ivpq = dynamic_cast<const IndexIVFPQ*>(idx)) {
         const IndexIVFPQR* ivfpqr = dynamic_cast<const IndexIVFPQR*>(idx);
 
@@ -884,6 +926,29 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         WRITE1(idxnsg->nndescent_iter);
         write_NSG(&idxnsg->nsg, f);
         write_index(idxnsg->storage, f);
+#ifndef _WIN32
+    } else if (
+            const IndexDiskGraph* idxdg =
+                    dynamic_cast<const IndexDiskGraph*>(idx)) {
+        uint32_t h = fourcc("IxDG");
+        WRITE1(h);
+        write_index_header(idxdg, f);
+        {
+            std::vector<char> x(
+                    idxdg->filename.begin(), idxdg->filename.end());
+            WRITEVECTOR(x);
+        }
+        WRITE1(idxdg->R);
+        WRITE1(idxdg->GK);
+        WRITE1(idxdg->build_type);
+        WRITE1(idxdg->search_L);
+        WRITE1(idxdg->beam_width);
+        WRITE1(idxdg->entry_point);
+        WRITE1(idxdg->node_size);
+        WRITE1(idxdg->nodes_per_sector);
+        WRITE1(idxdg->sectors_per_node);
+        write_index(&idxdg->pq_index, f);
+#endif
     } else if (
             const IndexNNDescent* idxnnd =
                     dynamic_cast<const IndexNNDescent*>(idx)) {
@@ -1153,20 +1218,39 @@ static void write_binary_hash_invlists(
 }
 
 static void write_binary_multi_hash_map(
-        const IndexBinaryMultiHash::Map& map,
-        int b,
-        size_t ntotal,
+        const IndexBinaryMultiHash& idxmh,
+        int h,
         IOWriter* f) {
+    // the flat table and the map are written as a single map: buckets
+    // that appear in both are merged back at read time
+    const IndexBinaryMultiHash::Map& map = idxmh.maps[h];
+    const IndexBinaryMultiHash::FlatTable* table =
+            idxmh.flat_tables.empty() ? nullptr : &idxmh.flat_tables[h];
+    int b = idxmh.b;
+    size_t ntotal = idxmh.ntotal;
     int id_bits = 0;
     while ((ntotal > ((idx_t)1 << id_bits))) {
         id_bits++;
     }
     WRITE1(id_bits);
-    size_t sz = map.size();
+    size_t sz = map.size() + (table ? table->nbucket() : 0);
     WRITE1(sz);
     size_t nbit = (b + id_bits) * sz + ntotal * id_bits;
     std::vector<uint8_t> buf((nbit + 7) / 8);
     BitstringWriter wr(buf.data(), buf.size());
+    if (table) {
+        for (size_t i = 0; i + 1 < table->lims.size(); i++) {
+            int64_t j0 = table->lims[i], j1 = table->lims[i + 1];
+            if (j0 == j1) {
+                continue;
+            }
+            wr.write(table->hashes.empty() ? i : table->hashes[i], b);
+            wr.write(j1 - j0, id_bits);
+            for (int64_t j = j0; j < j1; j++) {
+                wr.write(table->ids[j], id_bits);
+            }
+        }
+    }
     for (auto it = map.begin(); it != map.end(); ++it) {
         wr.write(it->first, b);
         wr.write(it->second.size(), id_bits);
@@ -1184,6 +1268,14 @@ void write_index_binary(const IndexBinary* idx, IOWriter* f) {
         WRITE1(h);
         write_index_binary_header(idx, f);
         WRITEVECTOR(idxf->xb);
+    } else if (
+            const IndexBinaryIVFFastScan* ivfs =
+                    dynamic_cast<const IndexBinaryIVFFastScan*>(idx)) {
+        uint32_t h = fourcc("IBwS");
+        WRITE1(h);
+        write_binary_ivf_header(ivfs, f);
+        WRITE1(ivfs->bbs);
+        write_InvertedLists(ivfs->invlists, f);
     } else if (
             const IndexBinaryIVF* ivf =
                     dynamic_cast<const IndexBinaryIVF*>(idx)) {
@@ -1248,8 +1340,7 @@ void write_index_binary(const IndexBinary* idx, IOWriter* f) {
         WRITE1(idxmh->nhash);
         WRITE1(idxmh->nflip);
         for (int i = 0; i < idxmh->nhash; i++) {
-            write_binary_multi_hash_map(
-                    idxmh->maps[i], idxmh->b, idxmh->ntotal, f);
+            write_binary_multi_hash_map(*idxmh, i, f);
         }
     } else {
         FAISS_THROW_MSG("don't know how to serialize this type of index");
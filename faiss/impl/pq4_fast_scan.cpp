@@ -172,8 +172,11 @@ size_t get_vector_specific_address(
         size_t vector_id,
         size_t sq,
         bool& shift) {
-    // get the vector_id inside the block
+    // get the vector_id inside the block, the block is made of sub-blocks
+    // of 32 vectors for each pair of sub-quantizers
     vector_id = vector_id % bbs;
+    size_t sub_block = vector_id / 32;
+    vector_id = vector_id % 32;
     shift = vector_id > 15;
     vector_id = vector_id & 15;
 
@@ -187,7 +190,7 @@ size_t get_vector_specific_address(
     if (sq & 1) {
         address += 16;
     }
-    return (sq >> 1) * bbs + address;
+    return (sq >> 1) * bbs + sub_block * 32 + address;
 }
 
 } // anonymous namespace
@@ -7,6 +7,8 @@
 
 #include <faiss/impl/pq4_fast_scan.h>
 
+#include <type_traits>
+
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/LookupTableScaler.h>
 #include <faiss/impl/simd_result_handlers.h>
@@ -15,6 +17,7 @@ namespace faiss {
 
 // declared in simd_result_handlers.h
 bool simd_result_handlers_accept_virtual = true;
+bool pq4_qbs_accumulate_2_blocks = true;
 
 using namespace simd_result_handlers;
 
@@ -555,6 +558,177 @@ void kernel_accumulate_block(
     }
 }
 
+/*
+ * Version that processes 2 blocks of 32 database vectors per step (an
+ * effective bbs of 64). The blocks are block_stride bytes apart, as
+ * produced by pq4_pack_codes with bbs=32. Each 64-byte LUT register is
+ * applied to both blocks, which halves the number of LUT loads. There are
+ * 8 * NQ accumulators, so this is only used for NQ <= 2.
+ */
+FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
+template <int NQ, class ResultHandler, class Scaler>
+void kernel_accumulate_2_blocks_avx512(
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res,
+        const Scaler& scaler,
+        size_t block_stride) {
+    // layout: accu[q][bb][b]: distance accumulator for block bb
+    simd32uint16 accu[NQ][2][4];
+
+    for (int q = 0; q < NQ; q++) {
+        for (int bb = 0; bb < 2; bb++) {
+            for (int b = 0; b < 4; b++) {
+                accu[q][bb][b].clear();
+            }
+        }
+    }
+
+    const uint8_t* codes_bb[2] = {codes, codes + block_stride};
+
+    // process nsq_part sub-quantizers, with or without scaling
+    auto accumulate_part = [&](int nsq_part, auto scaled) {
+        const int nsq_part_4 = (nsq_part / 4) * 4;
+
+        // process in chunks of 4
+        for (int sq = 0; sq < nsq_part_4; sq += 4) {
+            simd64uint8 mask(0xf);
+            simd64uint8 clo[2], chi[2];
+            for (int bb = 0; bb < 2; bb++) {
+                simd64uint8 c(codes_bb[bb]);
+                codes_bb[bb] += 64;
+                // shift op does not exist for int8...
+                chi[bb] = simd64uint8(simd32uint16(c) >> 4) & mask;
+                clo[bb] = c & mask;
+            }
+
+            for (int q = 0; q < NQ; q++) {
+                // load LUTs for 4 quantizers
+                simd64uint8 lut;
+                if constexpr (NQ == 1) {
+                    lut = simd64uint8(LUT);
+                } else {
+                    lut = simd64uint8(
+                            simd32uint8(LUT), simd32uint8(LUT + NQ * 32));
+                }
+                LUT += 32;
+
+                for (int bb = 0; bb < 2; bb++) {
+                    if constexpr (decltype(scaled)::value) {
+                        simd64uint8 res0 = scaler.lookup(lut, clo[bb]);
+                        accu[q][bb][0] += scaler.scale_lo(res0);
+                        accu[q][bb][1] += scaler.scale_hi(res0);
+
+                        simd64uint8 res1 = scaler.lookup(lut, chi[bb]);
+                        accu[q][bb][2] += scaler.scale_lo(res1);
+                        accu[q][bb][3] += scaler.scale_hi(res1);
+                    } else {
+                        simd64uint8 res0 = lut.lookup_4_lanes(clo[bb]);
+                        simd64uint8 res1 = lut.lookup_4_lanes(chi[bb]);
+
+                        accu[q][bb][0] += simd32uint16(res0);
+                        accu[q][bb][1] += simd32uint16(res0) >> 8;
+
+                        accu[q][bb][2] += simd32uint16(res1);
+                        accu[q][bb][3] += simd32uint16(res1) >> 8;
+                    }
+                }
+            }
+
+            LUT += NQ * 32;
+        }
+
+        // process leftovers: a single chunk of size 2
+        if (nsq_part_4 != nsq_part) {
+            simd32uint8 mask(0xf);
+            simd32uint8 clo[2], chi[2];
+            for (int bb = 0; bb < 2; bb++) {
+                simd32uint8 c(codes_bb[bb]);
+                codes_bb[bb] += 32;
+                // shift op does not exist for int8...
+                chi[bb] = simd32uint8(simd16uint16(c) >> 4) & mask;
+                clo[bb] = c & mask;
+            }
+
+            for (int q = 0; q < NQ; q++) {
+                // load LUTs for 2 quantizers
+                simd32uint8 lut(LUT);
+                LUT += 32;
+
+                for (int bb = 0; bb < 2; bb++) {
+                    if constexpr (decltype(scaled)::value) {
+                        simd32uint8 res0 = scaler.lookup(lut, clo[bb]);
+                        accu[q][bb][0] += simd32uint16(scaler.scale_lo(res0));
+                        accu[q][bb][1] += simd32uint16(scaler.scale_hi(res0));
+
+                        simd32uint8 res1 = scaler.lookup(lut, chi[bb]);
+                        accu[q][bb][2] += simd32uint16(scaler.scale_lo(res1));
+                        accu[q][bb][3] += simd32uint16(scaler.scale_hi(res1));
+                    } else {
+                        simd32uint8 res0 = lut.lookup_2_lanes(clo[bb]);
+                        simd32uint8 res1 = lut.lookup_2_lanes(chi[bb]);
+
+                        accu[q][bb][0] += simd32uint16(simd16uint16(res0));
+                        accu[q][bb][1] +=
+                                simd32uint16(simd16uint16(res0) >> 8);
+
+                        accu[q][bb][2] += simd32uint16(simd16uint16(res1));
+                        accu[q][bb][3] +=
+                                simd32uint16(simd16uint16(res1) >> 8);
+                    }
+                }
+            }
+        }
+    };
+
+    accumulate_part(nsq - scaler.nscale, std::false_type());
+    accumulate_part(scaler.nscale, std::true_type());
+
+    for (int q = 0; q < NQ; q++) {
+        for (int bb = 0; bb < 2; bb++) {
+            accu[q][bb][0] -= accu[q][bb][1] << 8;
+            simd16uint16 dis0 = combine4x2(accu[q][bb][0], accu[q][bb][1]);
+            accu[q][bb][2] -= accu[q][bb][3] << 8;
+            simd16uint16 dis1 = combine4x2(accu[q][bb][2], accu[q][bb][3]);
+            res.handle(q, bb, dis0, dis1);
+        }
+    }
+}
+
+// forwards the results to another handler, shifted by b0 database blocks
+template <class ResultHandler>
+struct BlockOffsetHandler {
+    ResultHandler& res;
+    size_t b0;
+
+    void handle(size_t q, size_t b, simd16uint16 d0, simd16uint16 d1) {
+        res.handle(q, b + b0, d0, d1);
+    }
+};
+
+// accumulate results for NQ queries and 2 consecutive blocks of 32 database
+// elements, reported as blocks b=0 and b=1 to the result handler
+template <int NQ, class ResultHandler, class Scaler>
+void kernel_accumulate_2_blocks(
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res,
+        const Scaler& scaler,
+        size_t block_stride) {
+    if constexpr (NQ >= 1 && NQ <= 2) {
+        kernel_accumulate_2_blocks_avx512<NQ, ResultHandler, Scaler>(
+                nsq, codes, LUT, res, scaler, block_stride);
+    } else {
+        // not enough registers to hold the accumulators
+        kernel_accumulate_block<NQ>(nsq, codes, LUT, res, scaler);
+        BlockOffsetHandler<ResultHandler> res1{res, 1};
+        kernel_accumulate_block<NQ>(
+                nsq, codes + block_stride, LUT, res1, scaler);
+    }
+}
+
 #endif
 
 // handle at most 4 blocks of queries
@@ -573,7 +747,40 @@ void accumulate_q_4step(
     constexpr int Q4 = (QBS >> 12) & 15;
     constexpr int SQ = Q1 + Q2 + Q3 + Q4;
 
-    for (size_t j0 = 0; j0 < ntotal2; j0 += 32) {
+    size_t j0 = 0;
+#ifdef __AVX512F__
+    if (pq4_qbs_accumulate_2_blocks) {
+        for (; j0 + 64 <= ntotal2; j0 += 64) {
+            FixedStorageHandler<SQ, 4> res2;
+            const uint8_t* LUT = LUT0;
+            kernel_accumulate_2_blocks<Q1>(
+                    nsq, codes, LUT, res2, scaler, block_stride);
+            LUT += Q1 * nsq * 16;
+            if (Q2 > 0) {
+                res2.set_block_origin(Q1, 0);
+                kernel_accumulate_2_blocks<Q2>(
+                        nsq, codes, LUT, res2, scaler, block_stride);
+                LUT += Q2 * nsq * 16;
+            }
+            if (Q3 > 0) {
+                res2.set_block_origin(Q1 + Q2, 0);
+                kernel_accumulate_2_blocks<Q3>(
+                        nsq, codes, LUT, res2, scaler, block_stride);
+                LUT += Q3 * nsq * 16;
+            }
+            if (Q4 > 0) {
+                res2.set_block_origin(Q1 + Q2 + Q3, 0);
+                kernel_accumulate_2_blocks<Q4>(
+                        nsq, codes, LUT, res2, scaler, block_stride);
+            }
+            res.set_block_origin(0, j0);
+            res2.to_other_handler(res);
+            codes += 2 * block_stride;
+        }
+    }
+#endif
+    // remaining blocks of 32 elements
+    for (; j0 < ntotal2; j0 += 32) {
         FixedStorageHandler<SQ, 2> res2;
         const uint8_t* LUT = LUT0;
         kernel_accumulate_block<Q1>(nsq, codes, LUT, res2, scaler);
@@ -607,7 +814,18 @@ void kernel_accumulate_block_loop(
         ResultHandler& res,
         const Scaler& scaler,
         size_t block_stride) {
-    for (size_t j0 = 0; j0 < ntotal2; j0 += 32) {
+    size_t j0 = 0;
+#ifdef __AVX512F__
+    if (pq4_qbs_accumulate_2_blocks) {
+        for (; j0 + 64 <= ntotal2; j0 += 64) {
+            res.set_block_origin(0, j0);
+            kernel_accumulate_2_blocks<NQ, ResultHandler>(
+                    nsq, codes, LUT, res, scaler, block_stride);
+            codes += 2 * block_stride;
+        }
+    }
+#endif
+    for (; j0 < ntotal2; j0 += 32) {
         res.set_block_origin(0, j0);
         kernel_accumulate_block<NQ, ResultHandler>(
                 nsq, codes, LUT, res, scaler);
@@ -7,6 +7,8 @@
 
 #include <faiss/impl/residual_quantizer_encode_steps.h>
 
+#include <algorithm>
+
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/ResidualQuantizer.h>
@@ -221,6 +223,268 @@ void accum_and_finalize_tab(
     }
 }
 
+/** Selects the k best values (the smallest for C = CMax) of a stream of
+ * values, and their indices. The selected values and indices are the same
+ * as with heap_addn + heap_reorder, but equal values are sorted by
+ * increasing index, which heap_reorder does not guarantee. So the order of
+ * ties may differ from the heap-based selection.
+ *
+ * The beam search steps select a few best values out of beam_size * K, so
+ * most values are discarded after a single comparison. They are processed
+ * by blocks of 16: the best value of a block is computed with a branch-free
+ * reduction that the compiler vectorizes, and the block is skipped if it is
+ * not better than the threshold. The values of the other blocks are
+ * appended to a buffer without branching. When the buffer is full, it is
+ * reduced to its k best entries with nth_element, and the threshold becomes
+ * the k-th best value. This replaces the heap updates, whose branches are
+ * hard to predict.
+ */
+template <class C>
+struct TopkSelector {
+    using Entry = std::pair<float, int>;
+
+    size_t k = 0;
+    size_t capacity = 0;
+    std::vector<Entry> buf;
+    size_t nbuf = 0;
+    float threshold = C::neutral();
+
+    void reset(size_t k_in) {
+        k = k_in;
+        capacity = std::max(2 * k, size_t(64));
+        // room for a block appended to a full buffer
+        buf.resize(capacity + 16);
+        nbuf = 0;
+        threshold = C::neutral();
+    }
+
+    // lexicographic order, as heap_addn keeps the first of equal values
+    static bool better(const Entry& a, const Entry& b) {
+        return C::cmp(b.first, a.first) ||
+                (a.first == b.first && a.second < b.second);
+    }
+
+    /// add the values x[0..n-1] with indices id0..id0+n-1
+    void add(const float* x, size_t n, int id0) {
+        for (size_t i0 = 0; i0 < n; i0 += 16) {
+            const size_t i1 = std::min(i0 + 16, n);
+            if (i1 == i0 + 16) {
+                const float* xi = x + i0;
+                float best[8];
+                for (size_t j = 0; j < 8; j++) {
+                    best[j] = C::cmp(xi[j], xi[j + 8]) ? xi[j + 8] : xi[j];
+                }
+                for (size_t j = 0; j < 4; j++) {
+                    best[j] = C::cmp(best[j], best[j + 4]) ? best[j + 4]
+                                                           : best[j];
+                }
+                for (size_t j = 0; j < 2; j++) {
+                    best[j] = C::cmp(best[j], best[j + 2]) ? best[j + 2]
+                                                           : best[j];
+                }
+                if (!C::cmp(threshold, best[0]) &&
+                    !C::cmp(threshold, best[1])) {
+                    continue;
+                }
+            }
+            for (size_t i = i0; i < i1; i++) {
+                buf[nbuf] = Entry(x[i], id0 + int(i));
+                nbuf += C::cmp(threshold, x[i]) ? 1 : 0;
+            }
+            if (nbuf >= capacity) {
+                std::nth_element(
+                        buf.begin(),
+                        buf.begin() + k - 1,
+                        buf.begin() + nbuf,
+                        better);
+                nbuf = k;
+                threshold = buf[k - 1].first;
+            }
+        }
+    }
+
+    /// store the k best values, sorted, and their indices
+    void finish(float* bh_val, int* bh_ids) {
+        size_t nres = std::min(k, nbuf);
+        std::partial_sort(
+                buf.begin(), buf.begin() + nres, buf.begin() + nbuf, better);
+        for (size_t j = 0; j < nres; j++) {
+            bh_val[j] = buf[j].first;
+            bh_ids[j] = buf[j].second;
+        }
+        for (size_t j = nres; j < k; j++) {
+            bh_val[j] = C::neutral();
+            bh_ids[j] = -1;
+        }
+    }
+};
+
+bool is_exact_topk(ApproxTopK_mode_t mode) {
+    switch (mode) {
+        case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B32_D2:
+        case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B8_D3:
+        case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B16_D2:
+        case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B8_D2:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/** Computes the rows b0..b1-1 of cent_distances (size beam_size * K) for
+ * beam_search_encode_step_tab. dp is a temporary buffer of size K.
+ */
+void compute_tab_distances(
+        size_t K,
+        const float* codebook_cross_norms,
+        size_t ldc,
+        const uint64_t* codebook_offsets,
+        const float* cd_common,
+        size_t m,
+        const int32_t* codes_i,
+        const float* distances_i,
+        size_t b0,
+        size_t b1,
+        float* dp,
+        float* cent_distances) {
+    bool use_baseline_implementation = false;
+
+    // This is the baseline implementation. Its primary flaw
+    //   that it writes way too many info to the temporary buffer
+    //   called dp.
+    //
+    // This baseline code is kept intentionally because it is easy to
+    // understand what an optimized version optimizes exactly.
+    //
+    if (use_baseline_implementation) {
+        for (size_t b = b0; b < b1; b++) {
+            std::fill(dp, dp + K, 0.0f);
+
+            for (size_t m1 = 0; m1 < m; m1++) {
+                size_t c = codes_i[b * m + m1];
+                const float* cb =
+                        &codebook_cross_norms[(codebook_offsets[m1] + c) * ldc];
+                fvec_add(K, cb, dp, dp);
+            }
+
+            for (size_t k = 0; k < K; k++) {
+                cent_distances[b * K + k] =
+                        distances_i[b] + cd_common[k] + 2 * dp[k];
+            }
+        }
+        return;
+    }
+
+    // An optimized implementation that avoids using a temporary buffer
+    // and does the accumulation in registers.
+
+    // Compute a sum of NK AQ codes.
+#define ACCUM_AND_FINALIZE_TAB(NK)          \
+    case NK:                                \
+        for (size_t b = b0; b < b1; b++) {  \
+            accum_and_finalize_tab<NK, 4>(  \
+                    codebook_cross_norms,   \
+                    codebook_offsets,       \
+                    codes_i,                \
+                    b,                      \
+                    ldc,                    \
+                    K,                      \
+                    distances_i,            \
+                    cd_common,              \
+                    cent_distances);        \
+        }                                   \
+        break;
+
+    // this version contains many switch-case scenarios, but
+    // they won't affect branch predictor.
+    switch (m) {
+        case 0:
+            // trivial case
+            for (size_t b = b0; b < b1; b++) {
+                for (size_t k = 0; k < K; k++) {
+                    cent_distances[b * K + k] = distances_i[b] + cd_common[k];
+                }
+            }
+            break;
+
+            ACCUM_AND_FINALIZE_TAB(1)
+            ACCUM_AND_FINALIZE_TAB(2)
+            ACCUM_AND_FINALIZE_TAB(3)
+            ACCUM_AND_FINALIZE_TAB(4)
+            ACCUM_AND_FINALIZE_TAB(5)
+            ACCUM_AND_FINALIZE_TAB(6)
+            ACCUM_AND_FINALIZE_TAB(7)
+
+        default: {
+            // m >= 8 case.
+
+            // A temporary buffer has to be used due to the lack of
+            // registers. But we'll try to accumulate up to 8 AQ codes
+            // in registers and issue a single write operation to the
+            // buffer, while the baseline does no accumulation. So, the
+            // number of write operations to the temporary buffer is
+            // reduced 8x.
+
+            for (size_t b = b0; b < b1; b++) {
+                // Initialize it. Compute a sum of first 8 AQ codes
+                // because m >= 8 .
+                accum_and_store_tab<8, 4>(
+                        m,
+                        codebook_cross_norms,
+                        codebook_offsets,
+                        codes_i,
+                        b,
+                        ldc,
+                        K,
+                        dp);
+
+#define ACCUM_AND_ADD_TAB(NK)          \
+    case NK:                           \
+        accum_and_add_tab<NK, 4>(      \
+                m,                     \
+                codebook_cross_norms,  \
+                codebook_offsets + im, \
+                codes_i + im,          \
+                b,                     \
+                ldc,                   \
+                K,                     \
+                dp);                   \
+        break;
+
+                // accumulate up to 8 additional AQ codes into
+                // a temporary buffer
+                for (size_t im = 8; im < ((m + 7) / 8) * 8; im += 8) {
+                    size_t m_left = m - im;
+                    if (m_left > 8) {
+                        m_left = 8;
+                    }
+
+                    switch (m_left) {
+                        ACCUM_AND_ADD_TAB(1)
+                        ACCUM_AND_ADD_TAB(2)
+                        ACCUM_AND_ADD_TAB(3)
+                        ACCUM_AND_ADD_TAB(4)
+                        ACCUM_AND_ADD_TAB(5)
+                        ACCUM_AND_ADD_TAB(6)
+                        ACCUM_AND_ADD_TAB(7)
+                        ACCUM_AND_ADD_TAB(8)
+                    }
+                }
+
+#undef ACCUM_AND_ADD_TAB
+
+                // done. finalize the result
+                for (size_t k = 0; k < K; k++) {
+                    cent_distances[b * K + k] =
+                            distances_i[b] + cd_common[k] + 2 * dp[k];
+                }
+            }
+        }
+    }
+
+#undef ACCUM_AND_FINALIZE_TAB
+}
+
 } // anonymous namespace
 
 /********************************************************************
@@ -276,7 +540,9 @@ void beam_search_encode_step(
     }
     InterruptCallback::check();
 
-#pragma omp parallel for if (n > 100)
+    // the selection of a vector scans beam_size * K distances, so small
+    // batches are worth parallelizing when the beam is large
+#pragma omp parallel for if (n > 1 && n * beam_size * K > 65536)
     for (int64_t i = 0; i < n; i++) {
         const int32_t* codes_i = codes + i * m * beam_size;
         int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
@@ -331,15 +597,16 @@ void beam_search_encode_step(
             }
             std::vector<int> perm(new_beam_size, -1);
 
-#define HANDLE_APPROX(NB, BD)                                  \
-    case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD: \
-        HeapWithBuckets<C, NB, BD>::bs_addn(                   \
-                beam_size,                                     \
-                K,                                             \
-                cent_distances_i,                              \
-                new_beam_size,                                 \
-                new_distances_i,                               \
-                perm.data());                                  \
+#define HANDLE_APPROX(NB, BD)                                         \
+    case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD:        \
+        HeapWithBuckets<C, NB, BD>::bs_addn(                          \
+                beam_size,                                            \
+                K,                                                    \
+                cent_distances_i,                                     \
+                new_beam_size,                                        \
+                new_distances_i,                                      \
+                perm.data());                                         \
+        heap_reorder<C>(new_beam_size, new_distances_i, perm.data()); \
         break;
 
             switch (approx_topk_mode) {
@@ -347,16 +614,14 @@ void beam_search_encode_step(
                 HANDLE_APPROX(8, 2)
                 HANDLE_APPROX(16, 2)
                 HANDLE_APPROX(32, 2)
-                default:
-                    heap_addn<C>(
-                            new_beam_size,
-                            new_distances_i,
-                            perm.data(),
-                            cent_distances_i,
-                            nullptr,
-                            beam_size * K);
+                default: {
+                    TopkSelector<C> selector;
+                    selector.reset(new_beam_size);
+                    selector.add(cent_distances_i, beam_size * K, 0);
+                    selector.finish(new_distances_i, perm.data());
+                    break;
+                }
             }
-            heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
 
 #undef HANDLE_APPROX
 
@@ -400,209 +665,101 @@ void beam_search_encode_step_tab(
 {
     FAISS_THROW_IF_NOT(ldc >= K);
 
-#pragma omp parallel for if (n > 100) schedule(dynamic)
-    for (int64_t i = 0; i < n; i++) {
+    // the work per vector is O(beam_size * K * m), see
+    // beam_search_encode_step for the parallelization of small batches
+#pragma omp parallel if (n > 1 && n * beam_size * K > 65536)
+    {
+        using C = CMax<float, int>;
         std::vector<float> cent_distances(beam_size * K);
         std::vector<float> cd_common(K);
-
-        const int32_t* codes_i = codes + i * m * beam_size;
-        const float* query_cp_i = query_cp + i * ldqc;
-        const float* distances_i = distances + i * beam_size;
-
-        for (size_t k = 0; k < K; k++) {
-            cd_common[k] = cent_norms_i[k] - 2 * query_cp_i[k];
-        }
-
-        bool use_baseline_implementation = false;
-
-        // This is the baseline implementation. Its primary flaw
-        //   that it writes way too many info to the temporary buffer
-        //   called dp.
-        //
-        // This baseline code is kept intentionally because it is easy to
-        // understand what an optimized version optimizes exactly.
-        //
-        if (use_baseline_implementation) {
-            for (size_t b = 0; b < beam_size; b++) {
-                std::vector<float> dp(K);
-
-                for (size_t m1 = 0; m1 < m; m1++) {
-                    size_t c = codes_i[b * m + m1];
-                    const float* cb =
-                            &codebook_cross_norms
-                                    [(codebook_offsets[m1] + c) * ldc];
-                    fvec_add(K, cb, dp.data(), dp.data());
-                }
-
-                for (size_t k = 0; k < K; k++) {
-                    cent_distances[b * K + k] =
-                            distances_i[b] + cd_common[k] + 2 * dp[k];
-                }
+        std::vector<float> dp(K);
+        std::vector<int> perm(new_beam_size);
+        TopkSelector<C> selector;
+        const bool exact_topk = is_exact_topk(approx_topk_mode);
+
+        // The exact top-k is computed on tiles of rows of cent_distances
+        // while they are in cache.
+        const size_t tile_rows = std::max(size_t(1), size_t(2048) / K);
+
+#pragma omp for schedule(dynamic)
+        for (int64_t i = 0; i < n; i++) {
+            const int32_t* codes_i = codes + i * m * beam_size;
+            const float* query_cp_i = query_cp + i * ldqc;
+            const float* distances_i = distances + i * beam_size;
+
+            for (size_t k = 0; k < K; k++) {
+                cd_common[k] = cent_norms_i[k] - 2 * query_cp_i[k];
             }
 
-        } else {
-            // An optimized implementation that avoids using a temporary buffer
-            // and does the accumulation in registers.
-
-            // Compute a sum of NK AQ codes.
-#define ACCUM_AND_FINALIZE_TAB(NK)               \
-    case NK:                                     \
-        for (size_t b = 0; b < beam_size; b++) { \
-            accum_and_finalize_tab<NK, 4>(       \
-                    codebook_cross_norms,        \
-                    codebook_offsets,            \
-                    codes_i,                     \
-                    b,                           \
-                    ldc,                         \
-                    K,                           \
-                    distances_i,                 \
-                    cd_common.data(),            \
-                    cent_distances.data());      \
-        }                                        \
-        break;
-
-            // this version contains many switch-case scenarios, but
-            // they won't affect branch predictor.
-            switch (m) {
-                case 0:
-                    // trivial case
-                    for (size_t b = 0; b < beam_size; b++) {
-                        for (size_t k = 0; k < K; k++) {
-                            cent_distances[b * K + k] =
-                                    distances_i[b] + cd_common[k];
-                        }
-                    }
-                    break;
-
-                    ACCUM_AND_FINALIZE_TAB(1)
-                    ACCUM_AND_FINALIZE_TAB(2)
-                    ACCUM_AND_FINALIZE_TAB(3)
-                    ACCUM_AND_FINALIZE_TAB(4)
-                    ACCUM_AND_FINALIZE_TAB(5)
-                    ACCUM_AND_FINALIZE_TAB(6)
-                    ACCUM_AND_FINALIZE_TAB(7)
-
-                default: {
-                    // m >= 8 case.
-
-                    // A temporary buffer has to be used due to the lack of
-                    // registers. But we'll try to accumulate up to 8 AQ codes
-                    // in registers and issue a single write operation to the
-                    // buffer, while the baseline does no accumulation. So, the
-                    // number of write operations to the temporary buffer is
-                    // reduced 8x.
-
-                    // allocate a temporary buffer
-                    std::vector<float> dp(K);
-
-                    for (size_t b = 0; b < beam_size; b++) {
-                        // Initialize it. Compute a sum of first 8 AQ codes
-                        // because m >= 8 .
-                        accum_and_store_tab<8, 4>(
-                                m,
-                                codebook_cross_norms,
-                                codebook_offsets,
-                                codes_i,
-                                b,
-                                ldc,
-                                K,
-                                dp.data());
-
-#define ACCUM_AND_ADD_TAB(NK)          \
-    case NK:                           \
-        accum_and_add_tab<NK, 4>(      \
-                m,                     \
-                codebook_cross_norms,  \
-                codebook_offsets + im, \
-                codes_i + im,          \
-                b,                     \
-                ldc,                   \
-                K,                     \
-                dp.data());            \
-        break;
-
-                        // accumulate up to 8 additional AQ codes into
-                        // a temporary buffer
-                        for (size_t im = 8; im < ((m + 7) / 8) * 8; im += 8) {
-                            size_t m_left = m - im;
-                            if (m_left > 8) {
-                                m_left = 8;
-                            }
-
-                            switch (m_left) {
-                                ACCUM_AND_ADD_TAB(1)
-                                ACCUM_AND_ADD_TAB(2)
-                                ACCUM_AND_ADD_TAB(3)
-                                ACCUM_AND_ADD_TAB(4)
-                                ACCUM_AND_ADD_TAB(5)
-                                ACCUM_AND_ADD_TAB(6)
-                                ACCUM_AND_ADD_TAB(7)
-                                ACCUM_AND_ADD_TAB(8)
-                            }
-                        }
-
-                        // done. finalize the result
-                        for (size_t k = 0; k < K; k++) {
-                            cent_distances[b * K + k] =
-                                    distances_i[b] + cd_common[k] + 2 * dp[k];
-                        }
-                    }
+            selector.reset(new_beam_size);
+
+            for (size_t b0 = 0; b0 < beam_size; b0 += tile_rows) {
+                const size_t b1 = std::min(b0 + tile_rows, beam_size);
+                compute_tab_distances(
+                        K,
+                        codebook_cross_norms,
+                        ldc,
+                        codebook_offsets,
+                        cd_common.data(),
+                        m,
+                        codes_i,
+                        distances_i,
+                        b0,
+                        b1,
+                        dp.data(),
+                        cent_distances.data());
+                if (exact_topk) {
+                    selector.add(
+                            cent_distances.data() + b0 * K,
+                            (b1 - b0) * K,
+                            b0 * K);
                 }
             }
 
-            // the optimized implementation ends here
-        }
-        using C = CMax<float, int>;
-        int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
-        float* new_distances_i = new_distances + i * new_beam_size;
+            int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
+            float* new_distances_i = new_distances + i * new_beam_size;
 
-        const float* cent_distances_i = cent_distances.data();
+            const float* cent_distances_i = cent_distances.data();
 
-        // then we have to select the best results
-        for (int j = 0; j < new_beam_size; j++) {
-            new_distances_i[j] = C::neutral();
-        }
-        std::vector<int> perm(new_beam_size, -1);
-
-#define HANDLE_APPROX(NB, BD)                                  \
-    case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD: \
-        HeapWithBuckets<C, NB, BD>::bs_addn(                   \
-                beam_size,                                     \
-                K,                                             \
-                cent_distances_i,                              \
-                new_beam_size,                                 \
-                new_distances_i,                               \
-                perm.data());                                  \
+            // then we have to select the best results
+            for (int j = 0; j < new_beam_size; j++) {
+                new_distances_i[j] = C::neutral();
+            }
+            std::fill(perm.begin(), perm.end(), -1);
+
+#define HANDLE_APPROX(NB, BD)                                         \
+    case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD:        \
+        HeapWithBuckets<C, NB, BD>::bs_addn(                          \
+                beam_size,                                            \
+                K,                                                    \
+                cent_distances_i,                                     \
+                new_beam_size,                                        \
+                new_distances_i,                                      \
+                perm.data());                                         \
+        heap_reorder<C>(new_beam_size, new_distances_i, perm.data()); \
         break;
 
-        switch (approx_topk_mode) {
-            HANDLE_APPROX(8, 3)
-            HANDLE_APPROX(8, 2)
-            HANDLE_APPROX(16, 2)
-            HANDLE_APPROX(32, 2)
-            default:
-                heap_addn<C>(
-                        new_beam_size,
-                        new_distances_i,
-                        perm.data(),
-                        cent_distances_i,
-                        nullptr,
-                        beam_size * K);
-                break;
-        }
-
-        heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
+            switch (approx_topk_mode) {
+                HANDLE_APPROX(8, 3)
+                HANDLE_APPROX(8, 2)
+                HANDLE_APPROX(16, 2)
+                HANDLE_APPROX(32, 2)
+                default:
+                    selector.finish(new_distances_i, perm.data());
+                    break;
+            }
 
 #undef HANDLE_APPROX
 
-        for (int j = 0; j < new_beam_size; j++) {
-            int js = perm[j] / K;
-            int ls = perm[j] % K;
-            if (m > 0) {
-                memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+            for (int j = 0; j < new_beam_size; j++) {
+                int js = perm[j] / K;
+                int ls = perm[j] % K;
+                if (m > 0) {
+                    memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+                }
+                new_codes_i[m] = ls;
+                new_codes_i += m + 1;
             }
-            new_codes_i[m] = ls;
-            new_codes_i += m + 1;
         }
     }
 }
@@ -11,6 +11,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cinttypes>
+#include <cmath>
 #include <cstring>
 #include <execinfo.h>
 #include <limits>
@@ -887,5 +888,574 @@ struct DistanceComputerByte<Similarity, SIMDLevel::ARM_NEON>
 
 #endif
 
+/*******************************************************************
+ * DCInt8Query: distances to QT_8bit / QT_4bit codes computed in the
+ * integer domain.
+ *
+ * Component i is reconstructed as a_i + b_i * c_i, where c_i is the
+ * integer code. Therefore
+ *
+ *   <q, x>       = sum_i q_i a_i + sum_i (q_i b_i) c_i
+ *   ||q - x||^2  = sum_i (q_i - a_i)^2 - 2 sum_i (q_i - a_i) b_i c_i
+ *                  + sum_i b_i^2 c_i^2
+ *
+ * The per-query weights on c_i are quantized to int8 in set_query (ie.
+ * once per inverted list when encoding residuals) and the weights
+ * b_i^2 of the L2 norm term once and for all. The dot products between
+ * the codes and the int8 weights are then computed with integer SIMD
+ * (vpdpbusd with AVX512-VNNI, vpmaddwd otherwise, sdot on NEON). The
+ * rounding of the weights makes the distances approximate.
+ *******************************************************************/
+
+namespace int8_query {
+
+/// squares of the 4-bit values, to compute c_i^2 with a table lookup
+alignas(32) static const uint8_t squares_4bit[32] = {
+        0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225,
+        0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225};
+
+/** dw = sum_j c[j] * w[j] and, if SQ, dv = sum_j c[j]^2 * v[j] for n
+ * 8-bit codes */
+template <bool SQ>
+inline void dots_8bit(
+        const uint8_t* c,
+        const int8_t* w,
+        const int8_t* v,
+        size_t n,
+        int32_t& dw,
+        int32_t& dv) {
+    size_t j = 0;
+    dw = dv = 0;
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    __m512i aw = _mm512_setzero_si512();
+    __m512i av = _mm512_setzero_si512();
+#ifdef __AVX512VNNI__
+    __m256i aw8 = _mm256_setzero_si256();
+#endif
+    for (; j + 32 <= n; j += 32) {
+        __m256i c8 = _mm256_loadu_si256((const __m256i*)(c + j));
+        __m512i c16 = _mm512_cvtepu8_epi16(c8);
+#ifdef __AVX512VNNI__
+        aw8 = _mm256_dpbusd_epi32(
+                aw8, c8, _mm256_loadu_si256((const __m256i*)(w + j)));
+#else
+        __m512i w16 = _mm512_cvtepi8_epi16(
+                _mm256_loadu_si256((const __m256i*)(w + j)));
+        aw = _mm512_add_epi32(aw, _mm512_madd_epi16(c16, w16));
+#endif
+        if (SQ) {
+            __m512i v16 = _mm512_cvtepi8_epi16(
+                    _mm256_loadu_si256((const __m256i*)(v + j)));
+            // c * v <= 255 * 127 fits in 16 bits
+            __m512i cv = _mm512_mullo_epi16(c16, v16);
+            av = _mm512_add_epi32(av, _mm512_madd_epi16(cv, c16));
+        }
+    }
+#ifdef __AVX512VNNI__
+    // zero-extend: the upper lanes of a cast are undefined
+    aw = _mm512_zextsi256_si512(aw8);
+#endif
+    dw = _mm512_reduce_add_epi32(aw);
+    dv = _mm512_reduce_add_epi32(av);
+#elif defined(__AVX2__)
+    __m256i aw = _mm256_setzero_si256();
+    __m256i av = _mm256_setzero_si256();
+    for (; j + 16 <= n; j += 16) {
+        __m256i c16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(c + j)));
+        __m256i w16 = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128((const __m128i*)(w + j)));
+        aw = _mm256_add_epi32(aw, _mm256_madd_epi16(c16, w16));
+        if (SQ) {
+            __m256i v16 = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(v + j)));
+            __m256i cv = _mm256_mullo_epi16(c16, v16);
+            av = _mm256_add_epi32(av, _mm256_madd_epi16(cv, c16));
+        }
+    }
+    alignas(32) int32_t tw[8], tv[8];
+    _mm256_store_si256((__m256i*)tw, aw);
+    _mm256_store_si256((__m256i*)tv, av);
+    for (int k = 0; k < 8; k++) {
+        dw += tw[k];
+        dv += tv[k];
+    }
+#elif defined(USE_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    if (!SQ) {
+        // sdot works on signed bytes: c - 128 is accumulated, and
+        // 128 * sum_j w[j] is added back
+        int32x4_t aw = vdupq_n_s32(0);
+        int32x4_t sw = vdupq_n_s32(0);
+        const int8x16_t ones = vdupq_n_s8(1);
+        const uint8x16_t bias = vdupq_n_u8(0x80);
+        for (; j + 16 <= n; j += 16) {
+            int8x16_t cs = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(c + j), bias));
+            int8x16_t ws = vld1q_s8(w + j);
+            aw = vdotq_s32(aw, cs, ws);
+            sw = vdotq_s32(sw, ones, ws);
+        }
+        dw = vaddvq_s32(aw) + 128 * vaddvq_s32(sw);
+    }
+#endif
+    for (; j < n; j++) {
+        int32_t cj = c[j];
+        dw += cj * w[j];
+        if (SQ) {
+            dv += cj * cj * v[j];
+        }
+    }
+}
+
+/** same as dots_8bit for 4-bit codes: the low nibbles of the n bytes
+ * are weighted by w[0:n] (v[0:n]) and the high nibbles by w[n:2n]
+ * (v[n:2n]) */
+template <bool SQ>
+inline void dots_4bit(
+        const uint8_t* c,
+        const int8_t* w,
+        const int8_t* v,
+        size_t n,
+        int32_t& dw,
+        int32_t& dv) {
+    size_t j = 0;
+    dw = dv = 0;
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+    const __m256i m4 = _mm256_set1_epi8(0x0f);
+    const __m256i sq = _mm256_load_si256((const __m256i*)squares_4bit);
+    __m256i aw = _mm256_setzero_si256();
+    __m256i av = _mm256_setzero_si256();
+    for (; j + 32 <= n; j += 32) {
+        __m256i c8 = _mm256_loadu_si256((const __m256i*)(c + j));
+        __m256i lo = _mm256_and_si256(c8, m4);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c8, 4), m4);
+        aw = _mm256_dpbusd_epi32(
+                aw, lo, _mm256_loadu_si256((const __m256i*)(w + j)));
+        aw = _mm256_dpbusd_epi32(
+                aw, hi, _mm256_loadu_si256((const __m256i*)(w + n + j)));
+        if (SQ) {
+            // the squares of 4-bit values fit in 8 bits
+            av = _mm256_dpbusd_epi32(
+                    av,
+                    _mm256_shuffle_epi8(sq, lo),
+                    _mm256_loadu_si256((const __m256i*)(v + j)));
+            av = _mm256_dpbusd_epi32(
+                    av,
+                    _mm256_shuffle_epi8(sq, hi),
+                    _mm256_loadu_si256((const __m256i*)(v + n + j)));
+        }
+    }
+    alignas(32) int32_t tw[8], tv[8];
+    _mm256_store_si256((__m256i*)tw, aw);
+    _mm256_store_si256((__m256i*)tv, av);
+    for (int k = 0; k < 8; k++) {
+        dw += tw[k];
+        dv += tv[k];
+    }
+#elif defined(__AVX2__)
+    const __m128i m4 = _mm_set1_epi8(0x0f);
+    __m256i aw = _mm256_setzero_si256();
+    __m256i av = _mm256_setzero_si256();
+    for (; j + 16 <= n; j += 16) {
+        __m128i c8 = _mm_loadu_si128((const __m128i*)(c + j));
+        __m256i lo = _mm256_cvtepu8_epi16(_mm_and_si128(c8, m4));
+        __m256i hi = _mm256_cvtepu8_epi16(
+                _mm_and_si128(_mm_srli_epi16(c8, 4), m4));
+        __m256i wlo = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128((const __m128i*)(w + j)));
+        __m256i whi = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128((const __m128i*)(w + n + j)));
+        aw = _mm256_add_epi32(aw, _mm256_madd_epi16(lo, wlo));
+        aw = _mm256_add_epi32(aw, _mm256_madd_epi16(hi, whi));
+        if (SQ) {
+            __m256i vlo = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(v + j)));
+            __m256i vhi = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(v + n + j)));
+            av = _mm256_add_epi32(
+                    av, _mm256_madd_epi16(_mm256_mullo_epi16(lo, lo), vlo));
+            av = _mm256_add_epi32(
+                    av, _mm256_madd_epi16(_mm256_mullo_epi16(hi, hi), vhi));
+        }
+    }
+    alignas(32) int32_t tw[8], tv[8];
+    _mm256_store_si256((__m256i*)tw, aw);
+    _mm256_store_si256((__m256i*)tv, av);
+    for (int k = 0; k < 8; k++) {
+        dw += tw[k];
+        dv += tv[k];
+    }
+#elif defined(USE_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    // 4-bit values are valid signed bytes
+    const uint8x16_t m4 = vdupq_n_u8(0x0f);
+    const uint8x16_t sq = vld1q_u8(squares_4bit);
+    int32x4_t aw = vdupq_n_s32(0);
+    int32x4_t av = vdupq_n_s32(0);
+    for (; j + 16 <= n; j += 16) {
+        uint8x16_t c8 = vld1q_u8(c + j);
+        uint8x16_t lo = vandq_u8(c8, m4);
+        uint8x16_t hi = vshrq_n_u8(c8, 4);
+        aw = vdotq_s32(aw, vreinterpretq_s8_u8(lo), vld1q_s8(w + j));
+        aw = vdotq_s32(aw, vreinterpretq_s8_u8(hi), vld1q_s8(w + n + j));
+        if (SQ) {
+            // squares up to 225 do not fit in signed bytes: use udot with
+            // the (non-negative) weights
+            av = vreinterpretq_s32_u32(vdotq_u32(
+                    vreinterpretq_u32_s32(av),
+                    vqtbl1q_u8(sq, lo),
+                    vreinterpretq_u8_s8(vld1q_s8(v + j))));
+            av = vreinterpretq_s32_u32(vdotq_u32(
+                    vreinterpretq_u32_s32(av),
+                    vqtbl1q_u8(sq, hi),
+                    vreinterpretq_u8_s8(vld1q_s8(v + n + j))));
+        }
+    }
+    dw = vaddvq_s32(aw);
+    dv = vaddvq_s32(av);
+#endif
+    for (; j < n; j++) {
+        int32_t lo = c[j] & 15, hi = c[j] >> 4;
+        dw += lo * w[j] + hi * w[n + j];
+        if (SQ) {
+            dv += lo * lo * v[j] + hi * hi * v[n + j];
+        }
+    }
+}
+
+/// quantizes x[0:d] to int8 with a symmetric scale, returns the scale
+inline float quantize_weights(
+        const float* x,
+        size_t d,
+        int8_t* x8,
+        const std::vector<size_t>& perm) {
+    float vmax = 0;
+    for (size_t i = 0; i < d; i++) {
+        vmax = std::max(vmax, std::abs(x[i]));
+    }
+    if (vmax == 0) {
+        for (size_t i = 0; i < d; i++) {
+            x8[perm[i]] = 0;
+        }
+        return 0;
+    }
+    float scale = vmax / 127;
+    float inv_scale = 1 / scale;
+    for (size_t i = 0; i < d; i++) {
+        int v = std::lrint(x[i] * inv_scale);
+        x8[perm[i]] = std::min(127, std::max(-127, v));
+    }
+    return scale;
+}
+
+} // namespace int8_query
+
+template <int NBITS, class Similarity>
+struct DCInt8Query : SQDistanceComputer {
+    static_assert(NBITS == 8 || NBITS == 4, "only 8 and 4 bit codes");
+    using Sim = Similarity;
+    static constexpr bool is_l2 = Sim::metric_type == METRIC_L2;
+
+    const size_t d;
+    const size_t nbytes;
+
+    /// reconstruction of component i: a[i] + b[i] * c_i
+    std::vector<float> a, b;
+
+    /// position of the weight of component i (4-bit: low nibbles first)
+    std::vector<size_t> perm;
+
+    /// quantized b_i^2 for the L2 norm term
+    std::vector<int8_t> v8;
+    float v_scale = 0;
+
+    /// quantized weights of the current query
+    std::vector<int8_t> w8;
+    float w_scale = 0;
+    float bias = 0;
+
+    std::vector<float> tmp;
+
+    DCInt8Query(size_t d, const std::vector<float>& trained)
+            : d(d),
+              nbytes(NBITS == 8 ? d : (d + 1) / 2),
+              a(d),
+              b(d),
+              perm(d),
+              v8(NBITS == 8 ? d : 2 * nbytes),
+              w8(NBITS == 8 ? d : 2 * nbytes),
+              tmp(d) {
+        const float K = (1 << NBITS) - 1;
+        // trained has 2 values for uniform quantizers
+        bool uniform = trained.size() == 2;
+        for (size_t i = 0; i < d; i++) {
+            float vmin = uniform ? trained[0] : trained[i];
+            float vdiff = uniform ? trained[1] : trained[d + i];
+            b[i] = vdiff / K;
+            a[i] = vmin + 0.5f * b[i];
+            perm[i] = NBITS == 8 ? i : (i & 1) * nbytes + i / 2;
+        }
+        if (is_l2) {
+            for (size_t i = 0; i < d; i++) {
+                tmp[i] = b[i] * b[i];
+            }
+            v_scale = int8_query::quantize_weights(
+                    tmp.data(), d, v8.data(), perm);
+        }
+    }
+
+    void set_query(const float* x) final {
+        q = x;
+        bias = 0;
+        for (size_t i = 0; i < d; i++) {
+            if (is_l2) {
+                float diff = x[i] - a[i];
+                bias += diff * diff;
+                tmp[i] = -2 * diff * b[i];
+            } else {
+                bias += x[i] * a[i];
+                tmp[i] = x[i] * b[i];
+            }
+        }
+        w_scale =
+                int8_query::quantize_weights(tmp.data(), d, w8.data(), perm);
+        // the rounding error of the weights times the mid-range code value
+        // is compensated exactly, so the remaining error is proportional
+        // to the distance of the codes to the mid-range
+        const float mid = ((1 << NBITS) - 1) / 2.0f;
+        for (size_t i = 0; i < d; i++) {
+            bias += (tmp[i] - w_scale * w8[perm[i]]) * mid;
+        }
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        int32_t dw, dv;
+        if (NBITS == 8) {
+            int8_query::dots_8bit<is_l2>(
+                    code, w8.data(), v8.data(), nbytes, dw, dv);
+        } else {
+            int8_query::dots_4bit<is_l2>(
+                    code, w8.data(), v8.data(), nbytes, dw, dv);
+        }
+        return bias + w_scale * dw + (is_l2 ? v_scale * dv : 0);
+    }
+
+    float reconstruct_component(const uint8_t* code, size_t i) const {
+        int c = NBITS == 8 ? code[i] : (code[i / 2] >> ((i & 1) * 4)) & 15;
+        return a[i] + b[i] * c;
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const uint8_t* code1 = codes + i * code_size;
+        const uint8_t* code2 = codes + j * code_size;
+        float accu = 0;
+        for (size_t k = 0; k < d; k++) {
+            float x1 = reconstruct_component(code1, k);
+            float x2 = reconstruct_component(code2, k);
+            accu += is_l2 ? (x1 - x2) * (x1 - x2) : x1 * x2;
+        }
+        return accu;
+    }
+};
+
+/*******************************************************************
+ * DCMixed: distance computer for QT_mixed.
+ *
+ * The code is processed in chunks of 16 bytes. Each byte contains up to 4
+ * components, that are extracted with per-lane shifts and masks, so that
+ * the 8, 4 and 2-bit groups are handled by the same SIMD loop. The last
+ * chunk is aligned on the end of the code (its lanes that overlap the
+ * previous chunk have zero weights), so there is no tail to handle.
+ *******************************************************************/
+
+template <class Similarity>
+struct DCMixed : SQDistanceComputer {
+    using Sim = Similarity;
+    static constexpr bool is_l2 = Sim::metric_type == METRIC_L2;
+    static constexpr size_t W = 16;
+    static constexpr size_t chunk_size = 4 * W;
+
+    const QuantizerMixed quant;
+
+    size_t nchunk;
+    /// byte offset of each chunk in the code
+    std::vector<size_t> chunk_offset;
+    /// number of components per byte of each chunk (1, 2 or 4)
+    std::vector<int> chunk_nsub;
+
+    /// per chunk, sub-component and lane, size nchunk * chunk_size
+    std::vector<int32_t> shift, mask;
+    /// reconstruction of a component: a + s * c
+    std::vector<float> a, s;
+    /// for L2: q - a, for IP: q * s
+    std::vector<float> u;
+
+    /// position of each component in the arrays above (unused for 0 bits)
+    std::vector<size_t> pos;
+
+    /// contribution of the constant terms to the distance
+    float bias = 0;
+
+    std::vector<float> tmp;
+
+    DCMixed(size_t d, const std::vector<float>& trained)
+            : quant(d, trained), pos(d), tmp(2 * d) {
+        const MixedBitLayout& layout = quant.layout;
+        size_t cs = layout.code_size;
+        nchunk = (cs + W - 1) / W;
+        chunk_offset.resize(nchunk);
+        chunk_nsub.resize(nchunk, 1);
+        for (size_t c = 0; c < nchunk; c++) {
+            chunk_offset[c] = c * W;
+        }
+        if (nchunk > 1) {
+            chunk_offset[nchunk - 1] = cs - W;
+        }
+        shift.resize(nchunk * chunk_size);
+        mask.resize(nchunk * chunk_size);
+        a.resize(nchunk * chunk_size);
+        s.resize(nchunk * chunk_size);
+        u.resize(nchunk * chunk_size);
+        for (size_t i = 0; i < d; i++) {
+            int nbits = layout.nbits[i];
+            if (nbits == 0) {
+                continue;
+            }
+            size_t byte = layout.byte[i];
+            size_t c = std::min(byte / W, nchunk - 1);
+            int sub = layout.shift[i] / nbits;
+            size_t k = c * chunk_size + sub * W + byte - chunk_offset[c];
+            chunk_nsub[c] = std::max(chunk_nsub[c], 8 / nbits);
+            pos[i] = k;
+            shift[k] = layout.shift[i];
+            mask[k] = (1 << nbits) - 1;
+            s[k] = quant.vdiff[i] / ((1 << nbits) - 1);
+            a[k] = quant.vmin[i] + 0.5f * s[k];
+        }
+    }
+
+    void set_query(const float* x) final {
+        const MixedBitLayout& layout = quant.layout;
+        q = x;
+        bias = 0;
+        for (size_t i = 0; i < quant.d; i++) {
+            if (layout.nbits[i] == 0) {
+                float vi = quant.vmin[i];
+                bias += is_l2 ? (x[i] - vi) * (x[i] - vi) : x[i] * vi;
+                continue;
+            }
+            size_t k = pos[i];
+            if (is_l2) {
+                u[k] = x[i] - a[k];
+            } else {
+                bias += x[i] * a[k];
+                u[k] = x[i] * s[k];
+            }
+        }
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        uint8_t buf[W];
+        if (quant.layout.code_size < W) {
+            // too short for a full chunk
+            memset(buf, 0, W);
+            memcpy(buf, code, quant.layout.code_size);
+            code = buf;
+        }
+#if defined(__AVX512F__)
+        __m512 accu = _mm512_setzero_ps();
+        for (size_t c = 0; c < nchunk; c++) {
+            __m512i ci = _mm512_cvtepu8_epi32(
+                    _mm_loadu_si128((const __m128i*)(code + chunk_offset[c])));
+            for (int sub = 0; sub < chunk_nsub[c]; sub++) {
+                size_t k = c * chunk_size + sub * W;
+                __m512i cs = _mm512_and_si512(
+                        _mm512_srlv_epi32(
+                                ci, _mm512_loadu_si512(shift.data() + k)),
+                        _mm512_loadu_si512(mask.data() + k));
+                __m512 cf = _mm512_cvtepi32_ps(cs);
+                if (is_l2) {
+                    __m512 t = _mm512_fnmadd_ps(
+                            _mm512_loadu_ps(s.data() + k),
+                            cf,
+                            _mm512_loadu_ps(u.data() + k));
+                    accu = _mm512_fmadd_ps(t, t, accu);
+                } else {
+                    accu = _mm512_fmadd_ps(
+                            _mm512_loadu_ps(u.data() + k), cf, accu);
+                }
+            }
+        }
+        return bias + _mm512_reduce_add_ps(accu);
+#elif defined(__AVX2__)
+        __m256 accu = _mm256_setzero_ps();
+        for (size_t c = 0; c < nchunk; c++) {
+            const uint8_t* cc = code + chunk_offset[c];
+            __m256i ci[2] = {
+                    _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)cc)),
+                    _mm256_cvtepu8_epi32(
+                            _mm_loadl_epi64((const __m128i*)(cc + 8)))};
+            for (int sub = 0; sub < chunk_nsub[c]; sub++) {
+                for (int h = 0; h < 2; h++) {
+                    size_t k = c * chunk_size + sub * W + h * 8;
+                    __m256i cs = _mm256_and_si256(
+                            _mm256_srlv_epi32(
+                                    ci[h],
+                                    _mm256_loadu_si256(
+                                            (const __m256i*)(shift.data() +
+                                                             k))),
+                            _mm256_loadu_si256(
+                                    (const __m256i*)(mask.data() + k)));
+                    __m256 cf = _mm256_cvtepi32_ps(cs);
+                    if (is_l2) {
+                        __m256 t = _mm256_fnmadd_ps(
+                                _mm256_loadu_ps(s.data() + k),
+                                cf,
+                                _mm256_loadu_ps(u.data() + k));
+                        accu = _mm256_fmadd_ps(t, t, accu);
+                    } else {
+                        accu = _mm256_fmadd_ps(
+                                _mm256_loadu_ps(u.data() + k), cf, accu);
+                    }
+                }
+            }
+        }
+        const __m128 sum = _mm_add_ps(
+                _mm256_castps256_ps128(accu), _mm256_extractf128_ps(accu, 1));
+        const __m128 sum2 = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        return bias + _mm_cvtss_f32(_mm_add_ss(sum2, _mm_movehdup_ps(sum2)));
+#else
+        float accu = 0;
+        for (size_t c = 0; c < nchunk; c++) {
+            const uint8_t* cc = code + chunk_offset[c];
+            for (int sub = 0; sub < chunk_nsub[c]; sub++) {
+                size_t k = c * chunk_size + sub * W;
+                for (size_t l = 0; l < W; l++) {
+                    float cf = (cc[l] >> shift[k + l]) & mask[k + l];
+                    if (is_l2) {
+                        float t = u[k + l] - s[k + l] * cf;
+                        accu += t * t;
+                    } else {
+                        accu += u[k + l] * cf;
+                    }
+                }
+            }
+        }
+        return bias + accu;
+#endif
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const size_t d = quant.d;
+        float* x1 = tmp.data();
+        float* x2 = tmp.data() + d;
+        quant.decode_vector(codes + i * code_size, x1);
+        quant.decode_vector(codes + j * code_size, x2);
+        float accu = 0;
+        for (size_t k = 0; k < d; k++) {
+            accu += is_l2 ? (x1[k] - x2[k]) * (x1[k] - x2[k]) : x1[k] * x2[k];
+        }
+        return accu;
+    }
+};
+
 } // namespace scalar_quantizer
 } // namespace faiss
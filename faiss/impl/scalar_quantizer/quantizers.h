@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/ScalarQuantizer.h>
+#include <faiss/impl/scalar_quantizer/training.h>
 #include <faiss/utils/simd_levels.h>
 #include <faiss/utils/simdlib.h>
 
@@ -641,6 +643,112 @@ struct Quantizer8bitDirectSigned<SIMDLevel::ARM_NEON>
 
 #endif
 
+/*******************************************************************
+ * QT_mixed: 8, 4, 2 or 0 bits per component
+ *******************************************************************/
+
+/** Code layout of QT_mixed. The components are grouped by number of bits,
+ * in increasing order of component index within a group. The code is the
+ * concatenation of
+ *
+ * - n8 bytes for the 8-bit components
+ * - nb4 bytes for the 4-bit components: the j-th 4-bit component is in
+ *   byte j % nb4 of the group, at bit offset 4 * (j / nb4)
+ * - nb2 bytes for the 2-bit components, with the same interleaving
+ *
+ * so that the components of a group can be decoded with byte-aligned
+ * loads.
+ */
+struct MixedBitLayout {
+    size_t d;
+    size_t n8 = 0, n4 = 0, n2 = 0;
+    size_t nb4 = 0, nb2 = 0;
+    size_t code_size = 0;
+
+    /// number of bits, byte offset and bit shift of each component
+    std::vector<int> nbits;
+    std::vector<size_t> byte;
+    std::vector<int> shift;
+
+    MixedBitLayout(size_t d, const std::vector<float>& trained)
+            : d(d), nbits(d), byte(d), shift(d) {
+        FAISS_THROW_IF_NOT_MSG(trained.size() == 3 * d, "QT_mixed not trained");
+        for (size_t i = 0; i < d; i++) {
+            nbits[i] = int(trained[2 * d + i]);
+            FAISS_THROW_IF_NOT(
+                    nbits[i] == 0 || nbits[i] == 2 || nbits[i] == 4 ||
+                    nbits[i] == 8);
+            n8 += nbits[i] == 8;
+            n4 += nbits[i] == 4;
+            n2 += nbits[i] == 2;
+        }
+        nb4 = (n4 + 1) / 2;
+        nb2 = (n2 + 3) / 4;
+        code_size = mixed_code_size(n8, n4, n2);
+        size_t j8 = 0, j4 = 0, j2 = 0;
+        for (size_t i = 0; i < d; i++) {
+            if (nbits[i] == 8) {
+                byte[i] = j8++;
+                shift[i] = 0;
+            } else if (nbits[i] == 4) {
+                byte[i] = n8 + j4 % nb4;
+                shift[i] = 4 * (j4++ / nb4);
+            } else if (nbits[i] == 2) {
+                byte[i] = n8 + nb4 + j2 % nb2;
+                shift[i] = 2 * (j2++ / nb2);
+            }
+        }
+    }
+};
+
+struct QuantizerMixed : ScalarQuantizer::SQuantizer {
+    const size_t d;
+    const MixedBitLayout layout;
+    const float *vmin, *vdiff;
+
+    QuantizerMixed(size_t d, const std::vector<float>& trained)
+            : d(d),
+              layout(d, trained),
+              vmin(trained.data()),
+              vdiff(trained.data() + d) {}
+
+    void encode_vector(const float* x, uint8_t* code) const final {
+        for (size_t i = 0; i < d; i++) {
+            int nbits = layout.nbits[i];
+            if (nbits == 0 || vdiff[i] == 0) {
+                continue;
+            }
+            float xi = (x[i] - vmin[i]) / vdiff[i];
+            if (xi < 0) {
+                xi = 0;
+            }
+            if (xi > 1.0) {
+                xi = 1.0;
+            }
+            int c = (int)(xi * ((1 << nbits) - 1));
+            code[layout.byte[i]] |= c << layout.shift[i];
+        }
+    }
+
+    FAISS_ALWAYS_INLINE float reconstruct_component(
+            const uint8_t* code,
+            size_t i) const {
+        int nbits = layout.nbits[i];
+        if (nbits == 0) {
+            return vmin[i];
+        }
+        int K = (1 << nbits) - 1;
+        int c = (code[layout.byte[i]] >> layout.shift[i]) & K;
+        return vmin[i] + (c + 0.5f) / K * vdiff[i];
+    }
+
+    void decode_vector(const uint8_t* code, float* x) const final {
+        for (size_t i = 0; i < d; i++) {
+            x[i] = reconstruct_component(code, i);
+        }
+    }
+};
+
 } // namespace scalar_quantizer
 
 } // namespace faiss
@@ -198,6 +198,104 @@ void train_NonUniform(
     }
 }
 
+void train_Mixed(
+        RangeStat rs,
+        float rs_arg,
+        idx_t n,
+        int d,
+        size_t code_size,
+        const float* x,
+        std::vector<float>& trained) {
+    FAISS_THROW_IF_NOT(n > 0);
+    constexpr int nopt = 4;
+    const int opt_bits[nopt] = {0, 2, 4, 8};
+
+    // ranges and reconstruction error of each component for each option
+    std::vector<float> ranges[nopt];
+    std::vector<double> mse(nopt * d);
+    ranges[0].resize(2 * d);
+    {
+        std::vector<double> sum(d), sum2(d);
+        for (idx_t i = 0; i < n; i++) {
+            const float* xi = x + i * d;
+            for (int j = 0; j < d; j++) {
+                sum[j] += xi[j];
+                sum2[j] += double(xi[j]) * xi[j];
+            }
+        }
+        for (int j = 0; j < d; j++) {
+            double mean = sum[j] / n;
+            ranges[0][j] = mean;
+            ranges[0][d + j] = 0;
+            mse[j] = std::max(sum2[j] / n - mean * mean, 0.0);
+        }
+    }
+    for (int o = 1; o < nopt; o++) {
+        int k = 1 << opt_bits[o];
+        train_NonUniform(rs, rs_arg, n, d, k, x, ranges[o]);
+        const float* vmin = ranges[o].data();
+        const float* vdiff = ranges[o].data() + d;
+        double* err = mse.data() + o * d;
+#pragma omp parallel for if (n * d > 100000)
+        for (int j = 0; j < d; j++) {
+            double accu = 0;
+            for (idx_t i = 0; i < n; i++) {
+                float xi = x[i * d + j];
+                float y = vmin[j];
+                if (vdiff[j] != 0) {
+                    // same rounding as the codecs
+                    float t = std::clamp((xi - vmin[j]) / vdiff[j], 0.f, 1.f);
+                    int c = (int)(t * (k - 1));
+                    y += (c + 0.5f) / (k - 1) * vdiff[j];
+                }
+                accu += sqr(xi - y);
+            }
+            err[j] = accu / n;
+        }
+    }
+
+    // greedy allocation
+    std::vector<int> opt(d, 0);
+    size_t count[nopt] = {size_t(d), 0, 0, 0};
+    for (;;) {
+        int best_j = -1, best_o = -1;
+        double best_ratio = 0;
+        for (int j = 0; j < d; j++) {
+            int o0 = opt[j];
+            for (int o = o0 + 1; o < nopt; o++) {
+                double ratio = (mse[o0 * d + j] - mse[o * d + j]) /
+                        (opt_bits[o] - opt_bits[o0]);
+                if (ratio <= best_ratio) {
+                    continue;
+                }
+                size_t c[nopt] = {count[0], count[1], count[2], count[3]};
+                c[o0]--;
+                c[o]++;
+                if (mixed_code_size(c[3], c[2], c[1]) > code_size) {
+                    continue;
+                }
+                best_ratio = ratio;
+                best_j = j;
+                best_o = o;
+            }
+        }
+        if (best_j < 0) {
+            break;
+        }
+        count[opt[best_j]]--;
+        count[best_o]++;
+        opt[best_j] = best_o;
+    }
+
+    trained.resize(3 * d);
+    for (int j = 0; j < d; j++) {
+        const std::vector<float>& r = ranges[opt[j]];
+        trained[j] = r[j];
+        trained[d + j] = r[d + j];
+        trained[2 * d + j] = opt_bits[opt[j]];
+    }
+}
+
 } // namespace scalar_quantizer
 
 } // namespace faiss
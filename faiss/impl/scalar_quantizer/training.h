@@ -37,6 +37,29 @@ void train_NonUniform(
         int k,
         const float* x,
         std::vector<float>& trained);
+
+/// size of a QT_mixed code with n8, n4 and n2 components on 8, 4 and 2 bits
+inline size_t mixed_code_size(size_t n8, size_t n4, size_t n2) {
+    return n8 + (n4 + 1) / 2 + (n2 + 3) / 4;
+}
+
+/** Training for QT_mixed: allocates 8, 4, 2 or 0 bits to each component.
+ *
+ * The allocation is greedy: starting from 0 bits everywhere, the
+ * component whose reconstruction error on the training set decreases most
+ * per additional bit is upgraded, as long as the code fits in code_size
+ * bytes. The output is [vmin, vdiff, nbits] of size 3 * d. Components
+ * with 0 bits are reconstructed as their mean (vmin = mean, vdiff = 0).
+ */
+void train_Mixed(
+        RangeStat rs,
+        float rs_arg,
+        idx_t n,
+        int d,
+        size_t code_size,
+        const float* x,
+        std::vector<float>& trained);
+
 } // namespace scalar_quantizer
 
 } // namespace faiss
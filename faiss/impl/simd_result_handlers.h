@@ -96,6 +96,11 @@ struct SIMDResultHandlerToFloat : SIMDResultHandler {
 
 FAISS_API extern bool simd_result_handlers_accept_virtual;
 
+/// On AVX512 builds, the qbs accumulation kernels process 2 blocks of 32
+/// database vectors per step so that each LUT register is used twice.
+/// Set to false to fall back to the one-block-at-a-time kernels.
+FAISS_API extern bool pq4_qbs_accumulate_2_blocks;
+
 namespace simd_result_handlers {
 
 /** Dummy structure that just computes a checksum on results
@@ -29,10 +29,12 @@
 #include <faiss/IndexIVFFlat.h>
 #include <faiss/IndexIVFFlatPanorama.h>
 #include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQPanorama.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
 #include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFRaBitQFastScan.h>
+#include <faiss/IndexIVFScalarQuantizerPanorama.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
@@ -52,6 +54,7 @@
 #include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexBinaryHash.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexBinaryIVFFastScan.h>
 
 #ifdef FAISS_ENABLE_SVS
 #include <faiss/svs/IndexSVSFlat.h>
@@ -155,9 +158,10 @@ std::map<std::string, ScalarQuantizer::QuantizerType> sq_types = {
         {"SQbf16", ScalarQuantizer::QT_bf16},
         {"SQ8_direct_signed", ScalarQuantizer::QT_8bit_direct_signed},
         {"SQ8_direct", ScalarQuantizer::QT_8bit_direct},
+        {"SQmixed", ScalarQuantizer::QT_mixed},
 };
 const std::string sq_pattern =
-        "(SQ4|SQ8|SQ6|SQfp16|SQbf16|SQ8_direct_signed|SQ8_direct)";
+        "(SQ4|SQ8|SQ6|SQfp16|SQbf16|SQ8_direct_signed|SQ8_direct|SQmixed)";
 
 std::map<std::string, AdditiveQuantizer::Search_type_t> aq_search_type = {
         {"_Nfloat", AdditiveQuantizer::ST_norm_float},
@@ -341,6 +345,18 @@ IndexIVF* parse_IndexIVF(
         int nlevels = mres_to_int(sm[1], 8); // default to 8 levels
         return new IndexIVFFlatPanorama(get_q(), d, nlist, nlevels, mt, own_il);
     }
+    if (match(sq_pattern + "Panorama([0-9]+)?")) {
+        int nlevels = mres_to_int(sm[2], 8); // default to 8 levels
+        return new IndexIVFScalarQuantizerPanorama(
+                get_q(),
+                d,
+                nlist,
+                sq_types[sm[1].str()],
+                nlevels,
+                mt,
+                /*by_residual=*/true,
+                own_il);
+    }
     if (match(sq_pattern)) {
         return new IndexIVFScalarQuantizer(
                 get_q(),
@@ -358,6 +374,12 @@ IndexIVF* parse_IndexIVF(
         index_ivf->do_polysemous_training = sm[3].str() != "np";
         return index_ivf;
     }
+    if (match("PQ([0-9]+)(x[0-9]+)?Panorama([0-9]+)?")) {
+        int M = mres_to_int(sm[1]), nbit = mres_to_int(sm[2], 8, 1);
+        int nlevels = mres_to_int(sm[3], 8);
+        return new IndexIVFPQPanorama(
+                get_q(), d, nlist, M, nbit, nlevels, mt, own_il);
+    }
     if (match("PQ([0-9]+)\\+([0-9]+)")) {
         FAISS_THROW_IF_NOT_MSG(
                 mt == METRIC_L2,
@@ -1162,7 +1184,14 @@ IndexBinary* index_binary_factory(
     int ncentroids = -1;
     int M, nhash, b;
 
-    if (sscanf(description, "BIVF%d_HNSW%d", &ncentroids, &M) == 2) {
+    if (re_match(desc_str, "BIVF([0-9]+)_FS", sm)) {
+        ncentroids = std::stoi(sm[1].str());
+        IndexBinaryIVF* index_ivf = new IndexBinaryIVFFastScan(
+                new IndexBinaryFlat(d), d, ncentroids);
+        index_ivf->own_fields = true;
+        index = index_ivf;
+
+    } else if (sscanf(description, "BIVF%d_HNSW%d", &ncentroids, &M) == 2) {
         IndexBinaryIVF* index_ivf = new IndexBinaryIVF(
                 new IndexBinaryHNSW(d, M), d, ncentroids, own_invlists);
         index_ivf->own_fields = true;
@@ -55,11 +55,11 @@ size_t BlockInvertedLists::add_entries(
     memcpy(&ids[list_no][o], ids_in, sizeof(ids_in[0]) * n_entry);
     size_t n_block = (o + n_entry + n_per_block - 1) / n_per_block;
     codes[list_no].resize(n_block * block_size);
-    if (o % block_size == 0) {
+    if (o % n_per_block == 0) {
         // copy whole blocks
-        memcpy(&codes[list_no][o * packer->code_size],
+        memcpy(&codes[list_no][o / n_per_block * block_size],
                code,
-               n_block * block_size);
+               (n_entry + n_per_block - 1) / n_per_block * block_size);
     } else {
         FAISS_THROW_IF_NOT_MSG(packer, "missing code packer");
         std::vector<uint8_t> buffer(packer->code_size);
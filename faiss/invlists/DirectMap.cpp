@@ -160,15 +160,23 @@ size_t DirectMap::remove_ids(const IDSelector& sel, InvertedLists* invlists) {
 #pragma omp parallel for
         for (idx_t i = 0; i < nlist; i++) {
             idx_t l0 = invlists->list_size(i), l = l0, j = 0;
+            const IDSummary* summary = invlists->get_id_summary(i);
+            if (l0 == 0 ||
+                (summary && sel.check_summary(*summary) == IDSC_none)) {
+                continue;
+            }
             ScopedIds idsi(invlists, i);
+            std::vector<uint8_t> is_member(l0);
+            sel.is_member_batch(l0, idsi.get(), is_member.data());
             while (j < l) {
-                if (sel.is_member(idsi[j])) {
+                if (is_member[j]) {
                     l--;
                     invlists->update_entry(
                             i,
                             j,
                             invlists->get_single_id(i, l),
                             ScopedCodes(invlists, i, l).get());
+                    is_member[j] = is_member[l];
                 } else {
                     j++;
                 }
@@ -40,6 +40,10 @@ void InvertedLists::release_ids(size_t, const idx_t*) const {}
 
 void InvertedLists::prefetch_lists(const idx_t*, int) const {}
 
+const IDSummary* InvertedLists::get_id_summary(size_t) const {
+    return nullptr;
+}
+
 const uint8_t* InvertedLists::get_single_code(size_t list_no, size_t offset)
         const {
     assert(offset < list_size(list_no));
@@ -289,6 +293,7 @@ size_t ArrayInvertedLists::add_entries(
     memcpy(&ids[list_no][o], ids_in, sizeof(ids_in[0]) * n_entry);
     codes[list_no].resize((o + n_entry) * code_size);
     memcpy(&codes[list_no][o * code_size], code, code_size * n_entry);
+    update_id_summary(list_no, n_entry, ids_in);
     return o;
 }
 
@@ -316,6 +321,10 @@ const idx_t* ArrayInvertedLists::get_ids(size_t list_no) const {
 void ArrayInvertedLists::resize(size_t list_no, size_t new_size) {
     ids[list_no].resize(new_size);
     codes[list_no].resize(new_size * code_size);
+    // a shrunk list keeps its summary, that is still a superset of its ids
+    if (new_size == 0 && !id_summaries.empty()) {
+        id_summaries[list_no] = IDSummary();
+    }
 }
 
 void ArrayInvertedLists::update_entries(
@@ -328,6 +337,7 @@ void ArrayInvertedLists::update_entries(
     assert(n_entry + offset <= ids[list_no].size());
     memcpy(&ids[list_no][offset], ids_in, sizeof(ids_in[0]) * n_entry);
     memcpy(&codes[list_no][offset * code_size], codes_in, code_size * n_entry);
+    update_id_summary(list_no, n_entry, ids_in);
 }
 
 void ArrayInvertedLists::permute_invlists(const idx_t* map) {
@@ -342,6 +352,44 @@ void ArrayInvertedLists::permute_invlists(const idx_t* map) {
     }
     std::swap(codes, new_codes);
     std::swap(ids, new_ids);
+
+    if (!id_summaries.empty()) {
+        std::vector<IDSummary> new_summaries(nlist);
+        for (size_t i = 0; i < nlist; i++) {
+            new_summaries[i] = id_summaries[map[i]];
+        }
+        std::swap(id_summaries, new_summaries);
+    }
+}
+
+void ArrayInvertedLists::set_id_summaries(bool enable) {
+    id_summaries.clear();
+    if (enable) {
+        id_summaries.resize(nlist);
+        for (size_t i = 0; i < nlist; i++) {
+            recompute_id_summary(i);
+        }
+    }
+}
+
+const IDSummary* ArrayInvertedLists::get_id_summary(size_t list_no) const {
+    return id_summaries.empty() ? nullptr : &id_summaries[list_no];
+}
+
+void ArrayInvertedLists::update_id_summary(
+        size_t list_no,
+        size_t n,
+        const idx_t* ids_in) {
+    if (!id_summaries.empty()) {
+        id_summaries[list_no].add(n, ids_in);
+    }
+}
+
+void ArrayInvertedLists::recompute_id_summary(size_t list_no) {
+    if (!id_summaries.empty()) {
+        id_summaries[list_no] = IDSummary();
+        id_summaries[list_no].add(ids[list_no].size(), ids[list_no].data());
+    }
 }
 
 ArrayInvertedLists::~ArrayInvertedLists() {}
@@ -370,6 +418,19 @@ ArrayInvertedListsPanorama::ArrayInvertedListsPanorama(
     cum_sums.resize(nlist);
 }
 
+void ArrayInvertedListsPanorama::set_panorama(const Panorama& new_pano) {
+    FAISS_THROW_IF_NOT(new_pano.code_size == code_size);
+    FAISS_THROW_IF_NOT(new_pano.batch_size > 0);
+    for (size_t i = 0; i < nlist; i++) {
+        FAISS_THROW_IF_NOT_MSG(
+                ids[i].size() == 0,
+                "cannot change the layout of non-empty lists");
+    }
+    pano = new_pano;
+    n_levels = pano.n_levels;
+    level_width = pano.level_width;
+}
+
 const float* ArrayInvertedListsPanorama::get_cum_sums(size_t list_no) const {
     assert(list_no < nlist);
     return cum_sums[list_no].data();
@@ -387,15 +448,17 @@ size_t ArrayInvertedListsPanorama::add_entries(
     memcpy(&ids[list_no][o], ids_in, sizeof(ids_in[0]) * n_entry);
 
     size_t new_size = o + n_entry;
-    size_t num_batches = (new_size + kBatchSize - 1) / kBatchSize;
-    codes[list_no].resize(num_batches * kBatchSize * code_size);
-    cum_sums[list_no].resize(num_batches * kBatchSize * (n_levels + 1));
+    size_t batch_size = pano.batch_size;
+    size_t num_batches = (new_size + batch_size - 1) / batch_size;
+    codes[list_no].resize(num_batches * batch_size * code_size);
+    cum_sums[list_no].resize(num_batches * batch_size * (n_levels + 1));
 
     // Cast to float* is safe here as we guarantee codes are always float
     // vectors for `IndexIVFFlatPanorama` (verified by the constructor).
     const float* vectors = reinterpret_cast<const float*>(code);
     pano.copy_codes_to_level_layout(codes[list_no].data(), o, n_entry, code);
     pano.compute_cumulative_sums(cum_sums[list_no].data(), o, n_entry, vectors);
+    update_id_summary(list_no, n_entry, ids_in);
 
     return o;
 }
@@ -418,14 +481,19 @@ void ArrayInvertedListsPanorama::update_entries(
             codes[list_no].data(), offset, n_entry, code);
     pano.compute_cumulative_sums(
             cum_sums[list_no].data(), offset, n_entry, vectors);
+    update_id_summary(list_no, n_entry, ids_in);
 }
 
 void ArrayInvertedListsPanorama::resize(size_t list_no, size_t new_size) {
     ids[list_no].resize(new_size);
+    if (new_size == 0 && !id_summaries.empty()) {
+        id_summaries[list_no] = IDSummary();
+    }
 
-    size_t num_batches = (new_size + kBatchSize - 1) / kBatchSize;
-    codes[list_no].resize(num_batches * kBatchSize * code_size);
-    cum_sums[list_no].resize(num_batches * kBatchSize * (n_levels + 1));
+    size_t batch_size = pano.batch_size;
+    size_t num_batches = (new_size + batch_size - 1) / batch_size;
+    codes[list_no].resize(num_batches * batch_size * code_size);
+    cum_sums[list_no].resize(num_batches * batch_size * (n_levels + 1));
 }
 
 const uint8_t* ArrayInvertedListsPanorama::get_single_code(
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include <faiss/MetricType.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/impl/Panorama.h>
 #include <faiss/impl/maybe_owned_vector.h>
 
@@ -89,6 +90,11 @@ struct InvertedLists {
     /// a list can be -1 hence the signed long
     virtual void prefetch_lists(const idx_t* list_nos, int nlist) const;
 
+    /// conservative summary of the ids of a list, used to skip or fully
+    /// accept lists in searches with an IDSelector. nullptr if not
+    /// available (default)
+    virtual const IDSummary* get_id_summary(size_t list_no) const;
+
     /*****************************************
      * Iterator interface (with context)     */
 
@@ -247,8 +253,26 @@ struct ArrayInvertedLists : InvertedLists {
     std::vector<MaybeOwnedVector<uint8_t>> codes; // binary codes, size nlist
     std::vector<MaybeOwnedVector<idx_t>> ids; ///< Inverted lists for indexes
 
+    /// per-list summaries of the ids, empty if disabled (default). They are
+    /// kept up to date by add_entries / update_entries / resize. Code that
+    /// modifies the ids directly must call recompute_id_summary. Not
+    /// serialized.
+    std::vector<IDSummary> id_summaries;
+
     ArrayInvertedLists(size_t nlist, size_t code_size);
 
+    /// compute the id summaries of all lists (enable = true) or remove them
+    void set_id_summaries(bool enable);
+
+    const IDSummary* get_id_summary(size_t list_no) const override;
+
+    /// add ids to the summary of a list, if summaries are enabled
+    void update_id_summary(size_t list_no, size_t n, const idx_t* ids_in);
+
+    /// recompute the summary of a list from its ids, if summaries are
+    /// enabled
+    void recompute_id_summary(size_t list_no);
+
     size_t list_size(size_t list_no) const override;
     const uint8_t* get_codes(size_t list_no) const override;
     const idx_t* get_ids(size_t list_no) const override;
@@ -280,14 +304,19 @@ struct ArrayInvertedLists : InvertedLists {
 /// Level-oriented storage as defined in the IVFFlat section of Panorama
 /// (https://www.arxiv.org/pdf/2510.00566).
 struct ArrayInvertedListsPanorama : ArrayInvertedLists {
+    /// default batch size, the actual one is pano.batch_size
     static constexpr size_t kBatchSize = 128;
     std::vector<MaybeOwnedVector<float>> cum_sums;
-    const size_t n_levels;
-    const size_t level_width; // in code units
+    size_t n_levels;
+    size_t level_width; // in code units, widest level
     Panorama pano;
 
     ArrayInvertedListsPanorama(size_t nlist, size_t code_size, size_t n_levels);
 
+    /// replace the level split and batch size (eg. after
+    /// Panorama::calibrate), the lists must be empty
+    void set_panorama(const Panorama& new_pano);
+
     const float* get_cum_sums(size_t list_no) const;
 
     size_t add_entries(
@@ -1081,6 +1081,7 @@ class LocalSearchQuantizer(AdditiveQuantizer):
 
     # Processing parameters
     chunk_size: int  # vectors to encode at a time
+    encode_nstarts: int  # random initializations of the codes in encoding
     random_seed: int  # seed for random generator
     nperts: int  # number of perturbations in each code
 
@@ -7,8 +7,13 @@
 
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/WorkerThread.h>
+#include <omp.h>
 #include <exception>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 namespace faiss {
 
 namespace {
@@ -23,6 +28,32 @@ void runCallback(std::function<void()>& fn, std::promise<bool>& promise) {
     }
 }
 
+// pin the calling thread to the group-th group of n CPUs of its affinity
+// mask (wrapping around)
+void pinCurrentThread(int group, int n) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &allowed)) {
+            cpus.push_back(c);
+        }
+    }
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int i = 0; i < n; i++) {
+        CPU_SET(cpus[(group * n + i) % cpus.size()], &mask);
+    }
+    sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+}
+
 } // namespace
 
 WorkerThread::WorkerThread() : wantStop_(false) {
@@ -114,4 +145,131 @@ void WorkerThread::waitForThreadExit() {
     }
 }
 
+/***********************************************************
+ * WorkerThreadPool
+ ***********************************************************/
+
+WorkerThreadPool::WorkerThreadPool(int nthreads, int cpus_per_thread)
+        : cpusPerThread_(cpus_per_thread) {
+    FAISS_THROW_IF_NOT(nthreads >= 0);
+    for (int t = 0; t < nthreads; t++) {
+        threads_.emplace_back([this, t]() { threadMain(t); });
+    }
+}
+
+WorkerThreadPool::~WorkerThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        wantStop_ = true;
+    }
+    workMonitor_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+void WorkerThreadPool::threadMain(int threadNo) {
+    if (cpusPerThread_ > 0) {
+        pinCurrentThread(threadNo + 1, cpusPerThread_);
+    }
+
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workMonitor_.wait(lock, [&]() {
+                return wantStop_ || (batchActive_ && generation_ != seen);
+            });
+            if (wantStop_) {
+                return;
+            }
+            seen = generation_;
+            busy_++;
+        }
+
+        runTasks(threadNo + 1);
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            busy_--;
+        }
+        doneMonitor_.notify_all();
+    }
+}
+
+void WorkerThreadPool::runTasks(int preferred) {
+    auto tryRun = [&](int i) {
+        bool expected = false;
+        if (!claimed_[i].compare_exchange_strong(expected, true)) {
+            return;
+        }
+        int ntSave = omp_get_max_threads();
+        if (ompThreads_ > 0) {
+            omp_set_num_threads(ompThreads_);
+        }
+        try {
+            (*fn_)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(mutex_);
+            exceptions_->emplace_back(i, std::current_exception());
+        }
+        if (ompThreads_ > 0) {
+            omp_set_num_threads(ntSave);
+        }
+        if (remaining_.fetch_sub(1) == 1) {
+            // take the lock so that the notification cannot be missed
+            std::lock_guard<std::mutex> guard(mutex_);
+            doneMonitor_.notify_all();
+        }
+    };
+
+    if (preferred < ntask_) {
+        tryRun(preferred);
+    }
+    for (int i = 0; i < ntask_; i++) {
+        tryRun(i);
+    }
+}
+
+void WorkerThreadPool::run(
+        int ntask,
+        const std::function<void(int)>& f,
+        int omp_threads,
+        std::vector<std::pair<int, std::exception_ptr>>& exceptions) {
+    if (ntask == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> runGuard(runMutex_);
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (ntask > claimedCapacity_) {
+            claimed_.reset(new std::atomic<bool>[ntask]);
+            claimedCapacity_ = ntask;
+        }
+        for (int i = 0; i < ntask; i++) {
+            claimed_[i].store(false, std::memory_order_relaxed);
+        }
+        fn_ = &f;
+        ntask_ = ntask;
+        ompThreads_ = omp_threads;
+        exceptions_ = &exceptions;
+        remaining_.store(ntask);
+        batchActive_ = true;
+        generation_++;
+    }
+    if (ntask > 1) {
+        workMonitor_.notify_all();
+    }
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneMonitor_.wait(lock, [&]() { return remaining_.load() == 0; });
+    // no new thread joins the batch, wait for those that did
+    batchActive_ = false;
+    doneMonitor_.wait(lock, [&]() { return busy_ == 0; });
+    fn_ = nullptr;
+    exceptions_ = nullptr;
+}
+
 } // namespace faiss
@@ -7,11 +7,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <exception>
 #include <functional>
 #include <future>
+#include <memory>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace faiss {
 
@@ -58,4 +63,87 @@ class WorkerThread {
     std::deque<std::pair<std::function<void()>, std::promise<bool>>> queue_;
 };
 
+/** Pool of persistent threads that run batches of tasks.
+ *
+ * run() executes the tasks 0..ntask-1 of a batch: task 0 is run by the
+ * calling thread, task i > 0 preferably by thread i - 1 of the pool, and
+ * the threads that are done steal the tasks that are still pending. There
+ * is no allocation per batch (unless ntask grows).
+ */
+class WorkerThreadPool {
+   public:
+    /**
+     * @param nthreads         nb of threads of the pool
+     * @param cpus_per_thread  if > 0, pin thread t of the pool to the
+     *                         (t + 1)-th group of cpus_per_thread
+     *                         consecutive CPUs of the process affinity mask
+     *                         (the first group is left to the calling
+     *                         thread). Consecutive CPUs are usually on the
+     *                         same NUMA node. Linux only, ignored otherwise.
+     */
+    explicit WorkerThreadPool(int nthreads, int cpus_per_thread = 0);
+
+    /// Stops and joins the threads
+    ~WorkerThreadPool();
+
+    int size() const {
+        return threads_.size();
+    }
+
+    int cpus_per_thread() const {
+        return cpusPerThread_;
+    }
+
+    /** Run f(0), ..., f(ntask - 1) and wait for their completion.
+     *
+     * @param omp_threads if > 0, OpenMP parallel sections within the tasks
+     *                    use this nb of threads
+     * @param exceptions  filled with the (task number, exception) pairs of
+     *                    the tasks that threw
+     *
+     * Batches submitted concurrently are run one after the other.
+     */
+    void run(
+            int ntask,
+            const std::function<void(int)>& f,
+            int omp_threads,
+            std::vector<std::pair<int, std::exception_ptr>>& exceptions);
+
+   private:
+    void threadMain(int threadNo);
+
+    /// run task preferred, then steal the remaining tasks of the batch
+    void runTasks(int preferred);
+
+    std::vector<std::thread> threads_;
+    int cpusPerThread_;
+
+    /// Serializes the calls to run()
+    std::mutex runMutex_;
+
+    /// Mutex for the batch state and exit status
+    std::mutex mutex_;
+
+    /// Signals a new batch or exit request to the threads
+    std::condition_variable workMonitor_;
+
+    /// Signals the end of the tasks to the calling thread
+    std::condition_variable doneMonitor_;
+
+    bool wantStop_ = false;
+
+    /// current batch
+    bool batchActive_ = false;
+    uint64_t generation_ = 0;
+    const std::function<void(int)>* fn_ = nullptr;
+    int ntask_ = 0;
+    int ompThreads_ = 0;
+    std::unique_ptr<std::atomic<bool>[]> claimed_;
+    int claimedCapacity_ = 0;
+    std::atomic<int> remaining_{0};
+    /// nb of pool threads working on the current batch
+    int busy_ = 0;
+    std::vector<std::pair<int, std::exception_ptr>>* exceptions_ = nullptr;
+};
+
 } // namespace faiss
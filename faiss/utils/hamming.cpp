@@ -25,9 +25,14 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <memory>
 #include <vector>
 
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
@@ -239,6 +244,262 @@ void hammings_knn_hc(
     }
 }
 
+/***************************************************************************
+ * Tiled kernels: the distances between a tile of 4 queries and 8 database
+ * codes are accumulated in registers, one 64-bit word at a time, so that
+ * each database word that is loaded is reused for 4 queries. The distances
+ * of a tile are fed to the result handler directly, without going through
+ * a distance table.
+ ***************************************************************************/
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+constexpr size_t tile_nq = 4;
+constexpr size_t tile_nb = 8;
+#else
+// the accumulators of larger tiles do not fit in the scalar registers
+constexpr size_t tile_nq = 2;
+constexpr size_t tile_nb = 4;
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+
+/// per-lane popcount of 64-bit words
+inline __m512i popcount_epi64(__m512i x) {
+#ifdef __AVX512VPOPCNTDQ__
+    return _mm512_popcnt_epi64(x);
+#else
+    // nibble lookup table, the byte counts are summed per 64-bit lane
+    const __m512i lut = _mm512_set4_epi32(
+            0x04030302, 0x03020201, 0x03020201, 0x02010100);
+    const __m512i m4 = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_shuffle_epi8(lut, _mm512_and_si512(x, m4));
+    __m512i hi = _mm512_shuffle_epi8(
+            lut, _mm512_and_si512(_mm512_srli_epi64(x, 4), m4));
+    return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+#endif
+}
+
+#endif
+
+/* NW is the number of 64-bit words per code, 0 = known only at runtime */
+template <size_t NW>
+struct HammingTile {
+    const size_t nwords;
+
+    explicit HammingTile(size_t nwords) : nwords(NW > 0 ? NW : nwords) {}
+
+    /** dis[qi * tile_nb + c] = distance between query qi and code c.
+     * Returns the mask of the distances that are below thres[qi], bit
+     * qi * tile_nb + c */
+    uint32_t compute(
+            const uint64_t* q,
+            const uint64_t* b,
+            const int32_t* thres,
+            int32_t* dis) const {
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+        const int64_t nw = nwords;
+        // code c of the tile starts at word c * nw
+        const __m512i offsets = _mm512_setr_epi64(
+                0, nw, 2 * nw, 3 * nw, 4 * nw, 5 * nw, 6 * nw, 7 * nw);
+        __m512i acc[tile_nq];
+        for (size_t qi = 0; qi < tile_nq; qi++) {
+            acc[qi] = _mm512_setzero_si512();
+        }
+        for (size_t w = 0; w < nwords; w++) {
+            __m512i bw = _mm512_i64gather_epi64(offsets, b + w, 8);
+            for (size_t qi = 0; qi < tile_nq; qi++) {
+                __m512i qw = _mm512_set1_epi64(q[qi * nwords + w]);
+                acc[qi] = _mm512_add_epi64(
+                        acc[qi], popcount_epi64(_mm512_xor_si512(bw, qw)));
+            }
+        }
+        uint32_t mask = 0;
+        for (size_t qi = 0; qi < tile_nq; qi++) {
+            __m256i d = _mm512_cvtepi64_epi32(acc[qi]);
+            _mm256_storeu_si256((__m256i*)(dis + qi * tile_nb), d);
+            __mmask8 m = _mm256_cmpgt_epi32_mask(
+                    _mm256_set1_epi32(thres[qi]), d);
+            mask |= uint32_t(m) << (qi * tile_nb);
+        }
+        return mask;
+#else
+        // popcount64 maps to popcnt on x86 and to vcnt on aarch64
+        int32_t acc[tile_nq][tile_nb] = {};
+        for (size_t w = 0; w < nwords; w++) {
+            for (size_t c = 0; c < tile_nb; c++) {
+                uint64_t bw = b[c * nwords + w];
+                for (size_t qi = 0; qi < tile_nq; qi++) {
+                    acc[qi][c] += popcount64(q[qi * nwords + w] ^ bw);
+                }
+            }
+        }
+        uint32_t mask = 0;
+        for (size_t qi = 0; qi < tile_nq; qi++) {
+            for (size_t c = 0; c < tile_nb; c++) {
+                dis[qi * tile_nb + c] = acc[qi][c];
+                mask |= uint32_t(acc[qi][c] < thres[qi])
+                        << (qi * tile_nb + c);
+            }
+        }
+        return mask;
+#endif
+    }
+
+    int32_t compute_1(const uint64_t* q, const uint64_t* b) const {
+        int32_t dis = 0;
+        for (size_t w = 0; w < nwords; w++) {
+            dis += popcount64(q[w] ^ b[w]);
+        }
+        return dis;
+    }
+};
+
+template <size_t NW, class ResultHandler>
+void hammings_knn_tiled_nw(
+        size_t nwords,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        ResultHandler& res) {
+    HammingTile<NW> tile(nwords);
+    nwords = tile.nwords;
+    const uint64_t* a64 = (const uint64_t*)a;
+    const uint64_t* b64 = (const uint64_t*)b;
+
+    // blocks of about 256 kB of database codes are visited by all the
+    // query tiles while they are in cache
+    const size_t bs = std::max(
+            tile_nb, (size_t(1) << 18) / (nwords * 8) / tile_nb * tile_nb);
+    const int64_t ntile = (na + tile_nq - 1) / tile_nq;
+
+#pragma omp parallel
+    {
+        // the last query tile is padded by repeating its last query
+        std::vector<uint64_t> qpad(tile_nq * nwords);
+        int32_t dis[tile_nq * tile_nb];
+
+        for (size_t j0 = 0; j0 < nb; j0 += bs) {
+            const size_t j1 = std::min(j0 + bs, nb);
+            const size_t j1_tile = j0 + (j1 - j0) / tile_nb * tile_nb;
+
+            // the schedule is the same for all the database blocks, so a
+            // query (and its result heap) is always handled by the same
+            // thread and no barrier is needed between blocks
+#pragma omp for schedule(static) nowait
+            for (int64_t t = 0; t < ntile; t++) {
+                const size_t i0 = t * tile_nq;
+                const size_t nqi = std::min(tile_nq, na - i0);
+                const uint64_t* q = a64 + i0 * nwords;
+                if (nqi < tile_nq) {
+                    for (size_t qi = 0; qi < tile_nq; qi++) {
+                        memcpy(qpad.data() + qi * nwords,
+                               q + std::min(qi, nqi - 1) * nwords,
+                               nwords * 8);
+                    }
+                    q = qpad.data();
+                }
+                // distances >= thres[qi] cannot enter the results
+                int32_t thres[tile_nq];
+                for (size_t qi = 0; qi < tile_nq; qi++) {
+                    // padding queries never enter the results
+                    thres[qi] = qi < nqi ? res.threshold(i0 + qi) : 0;
+                }
+                for (size_t j = j0; j < j1_tile; j += tile_nb) {
+                    uint32_t mask =
+                            tile.compute(q, b64 + j * nwords, thres, dis);
+                    while (mask) {
+                        const int bit = __builtin_ctz(mask);
+                        mask &= mask - 1;
+                        const size_t qi = bit / tile_nb;
+                        // the threshold may have decreased in the meantime
+                        if (dis[bit] < thres[qi]) {
+                            res.add(i0 + qi, dis[bit], j + bit % tile_nb);
+                            thres[qi] = res.threshold(i0 + qi);
+                        }
+                    }
+                }
+                for (size_t j = j1_tile; j < j1; j++) {
+                    for (size_t qi = 0; qi < nqi; qi++) {
+                        int32_t d = tile.compute_1(
+                                q + qi * nwords, b64 + j * nwords);
+                        if (d < thres[qi]) {
+                            res.add(i0 + qi, d, j);
+                            thres[qi] = res.threshold(i0 + qi);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class ResultHandler>
+void hammings_knn_tiled(
+        size_t bytes_per_code,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        ResultHandler& res) {
+    FAISS_THROW_IF_NOT_MSG(
+            bytes_per_code % 8 == 0,
+            "tiled Hamming kernels require a code size multiple of 8");
+    const size_t nwords = bytes_per_code / 8;
+    switch (nwords) {
+        case 1:
+            hammings_knn_tiled_nw<1>(nwords, a, b, na, nb, res);
+            break;
+        case 2:
+            hammings_knn_tiled_nw<2>(nwords, a, b, na, nb, res);
+            break;
+        case 4:
+            hammings_knn_tiled_nw<4>(nwords, a, b, na, nb, res);
+            break;
+        case 8:
+            hammings_knn_tiled_nw<8>(nwords, a, b, na, nb, res);
+            break;
+        default:
+            hammings_knn_tiled_nw<0>(nwords, a, b, na, nb, res);
+    }
+}
+
+/* fused top-k with the result heaps. add() is called only for distances
+ * below threshold() */
+struct HeapTileResultHandler {
+    int_maxheap_array_t* ha;
+    const IDSelector* sel;
+
+    int32_t threshold(size_t i) const {
+        return ha->val[i * ha->k];
+    }
+
+    void add(size_t i, int32_t dis, size_t j) {
+        if (!sel || sel->is_member(j)) {
+            const size_t k = ha->k;
+            maxheap_replace_top<hamdis_t>(
+                    k, ha->val + i * k, ha->ids + i * k, dis, j);
+        }
+    }
+};
+
+/* fused top-k with counting */
+template <class HammingComputer>
+struct CounterTileResultHandler {
+    HCounterState<HammingComputer>* cs;
+    const IDSelector* sel;
+
+    int32_t threshold(size_t i) const {
+        return cs[i].thres + 1;
+    }
+
+    void add(size_t i, int32_t dis, size_t j) {
+        if (!sel || sel->is_member(j)) {
+            cs[i].update_counter_dis(dis, j);
+        }
+    }
+};
+
 /* Return closest neighbors w.r.t Hamming distance, using max count. */
 template <class HammingComputer>
 void hammings_knn_mc(
@@ -250,7 +511,8 @@ void hammings_knn_mc(
         size_t k,
         int32_t* __restrict distances,
         int64_t* __restrict labels,
-        const faiss::IDSelector* sel) {
+        const faiss::IDSelector* sel,
+        bool tiled = false) {
     const int nBuckets = bytes_per_code * 8 + 1;
     std::vector<int> all_counters(na * nBuckets, 0);
     std::unique_ptr<int64_t[]> all_ids_per_dis(new int64_t[na * nBuckets * k]);
@@ -266,14 +528,19 @@ void hammings_knn_mc(
                         k));
     }
 
-    const size_t block_size = hamming_batch_size;
-    for (size_t j0 = 0; j0 < nb; j0 += block_size) {
-        const size_t j1 = std::min(j0 + block_size, nb);
+    if (tiled) {
+        CounterTileResultHandler<HammingComputer> res = {cs.data(), sel};
+        hammings_knn_tiled(bytes_per_code, a, b, na, nb, res);
+    } else {
+        const size_t block_size = hamming_batch_size;
+        for (size_t j0 = 0; j0 < nb; j0 += block_size) {
+            const size_t j1 = std::min(j0 + block_size, nb);
 #pragma omp parallel for
-        for (int64_t i = 0; i < na; ++i) {
-            for (size_t j = j0; j < j1; ++j) {
-                if (!sel || sel->is_member(j)) {
-                    cs[i].update_counter(b + j * bytes_per_code, j);
+            for (int64_t i = 0; i < na; ++i) {
+                for (size_t j = j0; j < j1; ++j) {
+                    if (!sel || sel->is_member(j)) {
+                        cs[i].update_counter(b + j * bytes_per_code, j);
+                    }
                 }
             }
         }
@@ -541,6 +808,37 @@ void hammings_knn_mc(
             ncodes, r, ncodes, a, b, na, nb, k, distances, labels, sel);
 }
 
+void hammings_knn_hc_tiled(
+        int_maxheap_array_t* __restrict ha,
+        const uint8_t* __restrict a,
+        const uint8_t* __restrict b,
+        size_t nb,
+        size_t ncodes,
+        int order,
+        const faiss::IDSelector* sel) {
+    ha->heapify();
+    HeapTileResultHandler res = {ha, sel};
+    hammings_knn_tiled(ncodes, a, b, ha->nh, nb, res);
+    if (order) {
+        ha->reorder();
+    }
+}
+
+void hammings_knn_mc_tiled(
+        const uint8_t* __restrict a,
+        const uint8_t* __restrict b,
+        size_t na,
+        size_t nb,
+        size_t k,
+        size_t ncodes,
+        int32_t* __restrict distances,
+        int64_t* __restrict labels,
+        const faiss::IDSelector* sel) {
+    // the HammingComputer of the counter states is not used
+    hammings_knn_mc<HammingComputerDefault>(
+            ncodes, a, b, na, nb, k, distances, labels, sel, true);
+}
+
 void hamming_range_search(
         const uint8_t* a,
         const uint8_t* b,
@@ -171,6 +171,36 @@ void hammings_knn_mc(
         int64_t* labels,
         const faiss::IDSelector* sel = nullptr);
 
+/** Same as hammings_knn_hc with exact top-k selection, but the distances
+ * are computed by tiles of 4 queries x 8 database codes that are kept in
+ * registers and fed directly to the result heaps. This amortizes the
+ * loads of the database codes over several queries. It is faster than
+ * hammings_knn_hc on AVX512 (especially with VPOPCNTDQ), but typically
+ * not with scalar popcounts.
+ * @param ncodes  size of the codes in bytes, must be a multiple of 8
+ */
+void hammings_knn_hc_tiled(
+        int_maxheap_array_t* ha,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t nb,
+        size_t ncodes,
+        int ordered,
+        const faiss::IDSelector* sel = nullptr);
+
+/** Same as hammings_knn_mc, with the tiled distance computations of
+ * hammings_knn_hc_tiled. */
+void hammings_knn_mc_tiled(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        size_t k,
+        size_t ncodes,
+        int32_t* distances,
+        int64_t* labels,
+        const faiss::IDSelector* sel = nullptr);
+
 /** same as hammings_knn except we are doing a range search with radius */
 void hamming_range_search(
         const uint8_t* a,
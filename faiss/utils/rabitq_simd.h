@@ -422,4 +422,153 @@ inline uint64_t popcount(const uint8_t* data, size_t size) {
     return sum;
 }
 
+/**
+ * Multi-query version of bitwise_and_dot_product() and
+ * bitwise_xor_dot_product(): computes the dot products of NQ rearranged
+ * queries with the same binary data. Each chunk of the binary data is loaded
+ * once and reused for all the queries.
+ *
+ * @param queries        NQ rearranged rotated queries, stored contiguously
+ *                       (qb * size bytes per query)
+ * @param data           Pointer to binary data
+ * @param size           Size of the binary data in bytes
+ * @param qb             Number of quantization bits
+ * @param out            Output dot products, size NQ
+ */
+template <size_t NQ, bool is_xor>
+inline void bitwise_dot_product_nq(
+        const uint8_t* queries,
+        const uint8_t* data,
+        size_t size,
+        size_t qb,
+        uint64_t* out) {
+    const size_t query_stride = qb * size;
+    uint64_t sum[NQ] = {};
+    size_t offset = 0;
+#if defined(__AVX512F__)
+    if (size_t step = 512 / 8; offset + step <= size) {
+        __m512i sum_512[NQ];
+        for (size_t q = 0; q < NQ; q++) {
+            sum_512[q] = _mm512_setzero_si512();
+        }
+        for (; offset + step <= size; offset += step) {
+            __m512i v_x = _mm512_loadu_si512((const __m512i*)(data + offset));
+            for (size_t q = 0; q < NQ; q++) {
+                const uint8_t* query = queries + q * query_stride + offset;
+                for (int j = 0; j < qb; j++) {
+                    __m512i v_q = _mm512_loadu_si512(
+                            (const __m512i*)(query + j * size));
+                    __m512i v_op = is_xor ? _mm512_xor_si512(v_q, v_x)
+                                          : _mm512_and_si512(v_q, v_x);
+                    __m512i v_popcnt = popcount_512(v_op);
+                    __m512i v_shifted = _mm512_slli_epi64(v_popcnt, j);
+                    sum_512[q] = _mm512_add_epi64(sum_512[q], v_shifted);
+                }
+            }
+        }
+        for (size_t q = 0; q < NQ; q++) {
+            sum[q] += _mm512_reduce_add_epi64(sum_512[q]);
+        }
+    }
+#endif // defined(__AVX512F__)
+#if defined(__AVX2__)
+    if (size_t step = 256 / 8; offset + step <= size) {
+        __m256i sum_256[NQ];
+        for (size_t q = 0; q < NQ; q++) {
+            sum_256[q] = _mm256_setzero_si256();
+        }
+        for (; offset + step <= size; offset += step) {
+            __m256i v_x = _mm256_loadu_si256((const __m256i*)(data + offset));
+            for (size_t q = 0; q < NQ; q++) {
+                const uint8_t* query = queries + q * query_stride + offset;
+                for (int j = 0; j < qb; j++) {
+                    __m256i v_q = _mm256_loadu_si256(
+                            (const __m256i*)(query + j * size));
+                    __m256i v_op = is_xor ? _mm256_xor_si256(v_q, v_x)
+                                          : _mm256_and_si256(v_q, v_x);
+                    __m256i v_popcnt = popcount_256(v_op);
+                    __m256i v_shifted = _mm256_slli_epi64(v_popcnt, j);
+                    sum_256[q] = _mm256_add_epi64(sum_256[q], v_shifted);
+                }
+            }
+        }
+        for (size_t q = 0; q < NQ; q++) {
+            sum[q] += reduce_add_256(sum_256[q]);
+        }
+    }
+#endif // defined(__AVX2__)
+    // the 128-bit path of the single-query kernels uses scalar popcounts as
+    // well, so the remainder is handled with 64-bit words directly
+    for (size_t step = 64 / 8; offset + step <= size; offset += step) {
+        const auto yv = *(const uint64_t*)(data + offset);
+        for (size_t q = 0; q < NQ; q++) {
+            const uint8_t* query = queries + q * query_stride + offset;
+            for (int j = 0; j < qb; j++) {
+                const auto qv = *(const uint64_t*)(query + j * size);
+                sum[q] += __builtin_popcountll(is_xor ? (qv ^ yv) : (qv & yv))
+                        << j;
+            }
+        }
+    }
+    for (; offset < size; ++offset) {
+        const auto yv = *(data + offset);
+        for (size_t q = 0; q < NQ; q++) {
+            const uint8_t* query = queries + q * query_stride + offset;
+            for (int j = 0; j < qb; j++) {
+                const auto qv = *(query + j * size);
+                sum[q] += __builtin_popcount(is_xor ? (qv ^ yv) : (qv & yv))
+                        << j;
+            }
+        }
+    }
+    for (size_t q = 0; q < NQ; q++) {
+        out[q] = sum[q];
+    }
+}
+
+/**
+ * Compute the dot products between nq rearranged queries and the same binary
+ * data. The queries are processed in groups of up to 16 that share the loads
+ * of the binary data.
+ *
+ * @param queries        nq rearranged rotated queries, stored contiguously
+ * @param nq             Number of queries
+ * @param data           Pointer to binary data
+ * @param size           Size of the binary data in bytes
+ * @param qb             Number of quantization bits
+ * @param out            Output dot products, size nq
+ */
+template <bool is_xor>
+inline void bitwise_dot_product_multi(
+        const uint8_t* queries,
+        size_t nq,
+        const uint8_t* data,
+        size_t size,
+        size_t qb,
+        uint64_t* out) {
+    const size_t query_stride = qb * size;
+    while (nq > 0) {
+        size_t nq_step;
+        if (nq >= 16) {
+            nq_step = 16;
+            bitwise_dot_product_nq<16, is_xor>(queries, data, size, qb, out);
+        } else if (nq >= 8) {
+            nq_step = 8;
+            bitwise_dot_product_nq<8, is_xor>(queries, data, size, qb, out);
+        } else if (nq >= 4) {
+            nq_step = 4;
+            bitwise_dot_product_nq<4, is_xor>(queries, data, size, qb, out);
+        } else if (nq >= 2) {
+            nq_step = 2;
+            bitwise_dot_product_nq<2, is_xor>(queries, data, size, qb, out);
+        } else {
+            nq_step = 1;
+            bitwise_dot_product_nq<1, is_xor>(queries, data, size, qb, out);
+        }
+        queries += nq_step * query_stride;
+        out += nq_step;
+        nq -= nq_step;
+    }
+}
+
 } // namespace faiss::rabitq
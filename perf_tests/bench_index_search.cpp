@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/* Search benchmark of the main index types.
+ *
+ * For each factory string of --indexes and each thread count of
+ * --threads, reports:
+ *  - qps: queries per second of batch searches of the --nq queries
+ *  - p50_us, p99_us: latency of single-query searches
+ *  - recall_1: fraction of queries whose nearest neighbor is ranked first
+ *  - build_s: train + add time (with all threads)
+ *  - index_MB: size of the serialized index, which stands in for its
+ *    memory use (no RSS or allocation measurement)
+ *
+ * The data is synthetic unless --base / --query (and optionally --train)
+ * point to .fvecs files. For machine-readable output, use
+ * --benchmark_format=json or --benchmark_out=<file>.
+ */
+
+#include <gflags/gflags.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <faiss/IVFlib.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexNSG.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+#include <faiss/utils/random.h>
+#include <faiss/utils/utils.h>
+#include "utils.h"
+
+using namespace faiss;
+
+DEFINE_string(
+        indexes,
+        "Flat;IVF1024,Flat;IVF1024,SQ8;IVF1024,PQ16;IVF1024,PQ32x4fs;"
+        "PQ32x4fs;HNSW32;NSG32;RaBitQ;IVF1024,RaBitQ",
+        "index factory strings, separated by ';'");
+DEFINE_string(threads, "1,8", "thread counts, separated by ','");
+DEFINE_uint32(d, 64, "dimension of the synthetic data");
+DEFINE_uint32(nb, 100000, "nb of database vectors");
+DEFINE_uint32(nt, 50000, "nb of training vectors");
+DEFINE_uint32(nq, 1000, "nb of queries");
+DEFINE_uint32(k, 10, "nb of results per query");
+DEFINE_string(base, "", "fvecs file of the database vectors");
+DEFINE_string(query, "", "fvecs file of the queries");
+DEFINE_string(train, "", "fvecs file of the training vectors (default: base)");
+DEFINE_string(metric, "L2", "L2 or IP");
+DEFINE_uint32(nprobe, 16, "nprobe of the IVF indexes");
+DEFINE_uint32(efSearch, 64, "efSearch of the HNSW indexes");
+DEFINE_uint32(search_L, 64, "search_L of the NSG indexes");
+DEFINE_uint32(iterations, 5, "iterations of the batch search");
+
+namespace {
+
+struct Dataset {
+    size_t d = 0, nb = 0, nt = 0, nq = 0;
+    std::vector<float> xb, xt, xq;
+    /// nearest neighbor of each query
+    std::vector<idx_t> gt;
+};
+
+/// gaussian data with decreasing variance along the dimensions, so that
+/// the intrinsic dimension is lower than d
+std::vector<float> synthetic_data(size_t n, size_t d, int64_t seed) {
+    std::vector<float> x(n * d);
+    float_randn(x.data(), x.size(), seed);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < d; j++) {
+            x[i * d + j] *= std::exp(-4.0 * j / d);
+        }
+    }
+    return x;
+}
+
+MetricType metric_type() {
+    FAISS_THROW_IF_NOT_FMT(
+            FLAGS_metric == "L2" || FLAGS_metric == "IP",
+            "unknown metric %s",
+            FLAGS_metric.c_str());
+    return FLAGS_metric == "L2" ? METRIC_L2 : METRIC_INNER_PRODUCT;
+}
+
+const Dataset& get_dataset() {
+    static std::unique_ptr<Dataset> ds;
+    if (ds) {
+        return *ds;
+    }
+    ds = std::make_unique<Dataset>();
+    if (!FLAGS_base.empty()) {
+        FAISS_THROW_IF_NOT_MSG(
+                !FLAGS_query.empty(), "--query is required with --base");
+        size_t d2;
+        ds->xb = perf_tests::fvecs_read(FLAGS_base, FLAGS_nb, &ds->d, &ds->nb);
+        ds->xq = perf_tests::fvecs_read(FLAGS_query, FLAGS_nq, &d2, &ds->nq);
+        FAISS_THROW_IF_NOT(d2 == ds->d);
+        if (!FLAGS_train.empty()) {
+            ds->xt = perf_tests::fvecs_read(
+                    FLAGS_train, FLAGS_nt, &d2, &ds->nt);
+            FAISS_THROW_IF_NOT(d2 == ds->d);
+        } else {
+            ds->nt = std::min(ds->nb, size_t(FLAGS_nt));
+            ds->xt.assign(ds->xb.begin(), ds->xb.begin() + ds->nt * ds->d);
+        }
+    } else {
+        ds->d = FLAGS_d;
+        ds->nb = FLAGS_nb;
+        ds->nt = FLAGS_nt;
+        ds->nq = FLAGS_nq;
+        ds->xb = synthetic_data(ds->nb, ds->d, 123);
+        ds->xt = synthetic_data(ds->nt, ds->d, 456);
+        ds->xq = synthetic_data(ds->nq, ds->d, 789);
+    }
+
+    IndexFlat flat(ds->d, metric_type());
+    flat.add(ds->nb, ds->xb.data());
+    std::vector<float> D(ds->nq);
+    ds->gt.resize(ds->nq);
+    flat.search(ds->nq, ds->xq.data(), 1, D.data(), ds->gt.data());
+    return *ds;
+}
+
+struct BuiltIndex {
+    std::unique_ptr<Index> index;
+    double build_s = 0;
+    size_t nbytes = 0;
+};
+
+int max_threads = 1;
+
+void set_search_params(Index* index) {
+    if (IndexIVF* ivf = ivflib::try_extract_index_ivf(index)) {
+        ivf->nprobe = FLAGS_nprobe;
+    }
+    if (IndexHNSW* hnsw = dynamic_cast<IndexHNSW*>(index)) {
+        hnsw->hnsw.efSearch = FLAGS_efSearch;
+    }
+    if (IndexNSG* nsg = dynamic_cast<IndexNSG*>(index)) {
+        nsg->nsg.search_L = FLAGS_search_L;
+    }
+}
+
+/// the indexes are built once, when they are first benchmarked
+BuiltIndex& get_index(const std::string& key) {
+    static std::map<std::string, BuiltIndex> indexes;
+    auto it = indexes.find(key);
+    if (it != indexes.end()) {
+        return it->second;
+    }
+    const Dataset& ds = get_dataset();
+    BuiltIndex& bi = indexes[key];
+    omp_set_num_threads(max_threads);
+    double t0 = getmillisecs();
+    bi.index.reset(index_factory(ds.d, key.c_str(), metric_type()));
+    bi.index->train(ds.nt, ds.xt.data());
+    bi.index->add(ds.nb, ds.xb.data());
+    bi.build_s = (getmillisecs() - t0) / 1000;
+    set_search_params(bi.index.get());
+
+    VectorIOWriter writer;
+    write_index(bi.index.get(), &writer);
+    bi.nbytes = writer.data.size();
+    return bi;
+}
+
+void bench_search(benchmark::State& state, std::string key, int nthreads) {
+    const Dataset& ds = get_dataset();
+    BuiltIndex& bi = get_index(key);
+    const Index& index = *bi.index;
+    size_t nq = ds.nq, k = FLAGS_k;
+
+    omp_set_num_threads(nthreads);
+    std::vector<float> D(nq * k);
+    std::vector<idx_t> I(nq * k);
+    for (auto _ : state) {
+        index.search(nq, ds.xq.data(), k, D.data(), I.data());
+    }
+
+    size_t n_ok = 0;
+    for (size_t q = 0; q < nq; q++) {
+        n_ok += I[q * k] == ds.gt[q];
+    }
+
+    // latencies of single queries
+    std::vector<double> latencies(nq);
+    for (size_t q = 0; q < nq; q++) {
+        double t0 = getmillisecs();
+        index.search(1, ds.xq.data() + q * ds.d, k, D.data(), I.data());
+        latencies[q] = (getmillisecs() - t0) * 1000;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    state.counters["qps"] = benchmark::Counter(
+            double(nq) * state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["p50_us"] = latencies[nq / 2];
+    state.counters["p99_us"] = latencies[std::min(nq - 1, nq * 99 / 100)];
+    state.counters["recall_1"] = double(n_ok) / nq;
+    state.counters["build_s"] = bi.build_s;
+    state.counters["index_MB"] = bi.nbytes / double(1 << 20);
+    state.counters["threads"] = nthreads;
+}
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> res;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        if (!item.empty()) {
+            res.push_back(item);
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    gflags::AllowCommandLineReparsing();
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    max_threads = omp_get_max_threads();
+
+    for (const std::string& key : split(FLAGS_indexes, ';')) {
+        for (const std::string& nt : split(FLAGS_threads, ',')) {
+            int nthreads = std::stoi(nt);
+            std::string name = key + "/threads:" + nt;
+            benchmark::RegisterBenchmark(
+                    name.c_str(), bench_search, key, nthreads)
+                    ->Iterations(FLAGS_iterations)
+                    ->UseRealTime()
+                    ->Unit(benchmark::kMillisecond);
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -24,13 +24,15 @@ static void bench_distance(
         benchmark::State& state,
         ScalarQuantizer::QuantizerType type,
         int d,
-        int n) {
+        int n,
+        bool int8_query) {
     std::vector<float> x(d * n);
 
     float_rand(x.data(), d * n, 12345);
 
     // make sure it's idempotent
     ScalarQuantizer sq(d, type);
+    sq.int8_query = int8_query;
 
     omp_set_num_threads(1);
 
@@ -70,8 +72,24 @@ int main(int argc, char** argv) {
 
     for (auto& [bench_name, quantizer_type] : benchs) {
         benchmark::RegisterBenchmark(
-                bench_name.c_str(), bench_distance, quantizer_type, d, n)
+                bench_name.c_str(),
+                bench_distance,
+                quantizer_type,
+                d,
+                n,
+                false)
                 ->Iterations(iterations);
+        if (quantizer_type == ScalarQuantizer::QT_8bit ||
+            quantizer_type == ScalarQuantizer::QT_4bit) {
+            benchmark::RegisterBenchmark(
+                    (bench_name + "_int8_query").c_str(),
+                    bench_distance,
+                    quantizer_type,
+                    d,
+                    n,
+                    true)
+                    ->Iterations(iterations);
+        }
     }
     benchmark::RunSpecifiedBenchmarks();
     benchmark::Shutdown();
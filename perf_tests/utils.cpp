@@ -6,6 +6,13 @@
  */
 
 #include "utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include <faiss/impl/FaissAssert.h>
+
 namespace faiss::perf_tests {
 std::map<std::string, faiss::ScalarQuantizer::QuantizerType> sq_types() {
     static std::map<std::string, faiss::ScalarQuantizer::QuantizerType>
@@ -21,7 +28,43 @@ std::map<std::string, faiss::ScalarQuantizer::QuantizerType> sq_types() {
                     {"QT_6bit", faiss::ScalarQuantizer::QT_6bit},
                     {"QT_bf16", faiss::ScalarQuantizer::QT_bf16},
                     {"QT_8bit_direct_signed",
-                     faiss::ScalarQuantizer::QT_8bit_direct_signed}};
+                     faiss::ScalarQuantizer::QT_8bit_direct_signed},
+                    {"QT_mixed", faiss::ScalarQuantizer::QT_mixed}};
     return sq_types;
 }
+
+std::vector<float> fvecs_read(
+        const std::string& fname,
+        size_t max_n,
+        size_t* d_out,
+        size_t* n_out) {
+    std::unique_ptr<FILE, decltype(&fclose)> f(
+            fopen(fname.c_str(), "rb"), &fclose);
+    FAISS_THROW_IF_NOT_FMT(f, "could not open %s", fname.c_str());
+    int d;
+    FAISS_THROW_IF_NOT(fread(&d, sizeof(int), 1, f.get()) == 1);
+    FAISS_THROW_IF_NOT_FMT(d > 0 && d < 1000000, "bad dimension %d", d);
+    fseek(f.get(), 0, SEEK_END);
+    long fsize = ftell(f.get());
+    FAISS_THROW_IF_NOT_FMT(
+            fsize >= 0, "could not get the size of %s", fname.c_str());
+    size_t n = size_t(fsize) / ((size_t(d) + 1) * sizeof(float));
+    if (max_n > 0 && max_n < n) {
+        n = max_n;
+    }
+    fseek(f.get(), 0, SEEK_SET);
+
+    std::vector<float> x(n * d);
+    std::vector<float> row(d + 1);
+    for (size_t i = 0; i < n; i++) {
+        FAISS_THROW_IF_NOT(
+                fread(row.data(), sizeof(float), d + 1, f.get()) ==
+                size_t(d) + 1);
+        memcpy(x.data() + i * d, row.data() + 1, d * sizeof(float));
+    }
+    *d_out = d;
+    *n_out = n;
+    return x;
+}
+
 } // namespace faiss::perf_tests
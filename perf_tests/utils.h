@@ -8,9 +8,19 @@
 #pragma once
 #include <faiss/impl/ScalarQuantizer.h>
 #include <map>
+#include <string>
+#include <vector>
 
 namespace faiss::perf_tests {
 
 std::map<std::string, faiss::ScalarQuantizer::QuantizerType> sq_types();
 
+/// reads at most max_n vectors of a .fvecs file (all if max_n == 0), sets
+/// the dimension and the nb of vectors read
+std::vector<float> fvecs_read(
+        const std::string& fname,
+        size_t max_n,
+        size_t* d_out,
+        size_t* n_out);
+
 } // namespace faiss::perf_tests
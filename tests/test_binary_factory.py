@@ -18,6 +18,13 @@ class TestBinaryFactory(unittest.TestCase):
         assert index.nlist == 10
         assert index.code_size == 2
 
+    def test_factory_IVF_FS(self):
+
+        index = faiss.index_binary_factory(64, "BIVF10_FS")
+        assert isinstance(index, faiss.IndexBinaryIVFFastScan)
+        assert index.nlist == 10
+        assert index.bbs == 32
+
     def test_factory_Flat(self):
 
         index = faiss.index_binary_factory(16, "BFlat")
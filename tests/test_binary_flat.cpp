@@ -60,3 +60,35 @@ TEST(BinaryFlat, accuracy) {
         }
     }
 }
+
+TEST(BinaryFlat, tiled_kernel) {
+    int d = 256;
+    size_t nb = 2000, nq = 50;
+    int k = 7;
+
+    std::vector<uint8_t> database(nb * (d / 8));
+    std::vector<uint8_t> queries(nq * (d / 8));
+    for (auto& x : database) {
+        x = rand() % 0x100;
+    }
+    for (auto& x : queries) {
+        x = rand() % 0x100;
+    }
+
+    faiss::IndexBinaryFlat index(d);
+    index.add(nb, database.data());
+
+    for (bool use_heap : {true, false}) {
+        index.use_heap = use_heap;
+        std::vector<faiss::idx_t> I_ref(k * nq), I_new(k * nq);
+        std::vector<int> D_ref(k * nq), D_new(k * nq);
+
+        index.use_tiled_kernel = false;
+        index.search(nq, queries.data(), k, D_ref.data(), I_ref.data());
+        index.use_tiled_kernel = true;
+        index.search(nq, queries.data(), k, D_new.data(), I_new.data());
+
+        EXPECT_EQ(I_ref, I_new);
+        EXPECT_EQ(D_ref, D_new);
+    }
+}
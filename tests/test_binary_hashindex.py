@@ -204,6 +204,52 @@ class TestKnn(unittest.TestCase):
     def test_result_order_multihash(self):
         self.subtest_result_order(3)
 
+    def subtest_compact(self, nbit):
+        d = 128
+        nq = 100
+        nb = 3000
+
+        (_, xb, xq) = make_binary_dataset(d, 0, nb, nq)
+
+        index_ref = faiss.IndexBinaryMultiHash(d, 3, nbit)
+        index_ref.nflip = 2
+        index_ref.add(xb)
+        Dref, Iref = index_ref.search(xq, 10)
+        Lref, _, Iref_r = index_ref.range_search(xq, 40)
+
+        # half of the vectors in flat tables, the other half in maps
+        index = faiss.IndexBinaryMultiHash(d, 3, nbit)
+        index.nflip = 2
+        index.add(xb[:nb // 2])
+        index.compact()
+        index.add(xb[nb // 2:])
+        self.assertGreaterEqual(
+            index.hashtable_size(), index_ref.hashtable_size())
+
+        for _ in range(2):
+            Dnew, Inew = index.search(xq, 10)
+            np.testing.assert_array_equal(Dref, Dnew)
+            Lnew, _, Inew_r = index.range_search(xq, 40)
+            np.testing.assert_array_equal(Lref, Lnew)
+            for i in range(nq):
+                self.assertEqual(
+                    set(Iref_r[Lref[i]:Lref[i + 1]]),
+                    set(Inew_r[Lnew[i]:Lnew[i + 1]])
+                )
+            index2 = faiss.deserialize_index_binary(
+                faiss.serialize_index_binary(index))
+            D2, I2 = index2.search(xq, 10)
+            np.testing.assert_array_equal(Dref, D2)
+            index.compact()
+            self.assertEqual(
+                index.hashtable_size(), index_ref.hashtable_size())
+
+    def test_compact_dense(self):
+        self.subtest_compact(8)
+
+    def test_compact_sparse(self):
+        self.subtest_compact(20)
+
 
 
 
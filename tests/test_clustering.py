@@ -316,3 +316,46 @@ class TestEarlyStopping(unittest.TestCase):
 
         num_iterations = clus.iteration_stats.size()
         self.assertLess(num_iterations, max_iter)
+
+
+class TestMiniBatchClustering(unittest.TestCase):
+
+    def do_test(self, fvecs_format):
+        d, n, k = 16, 20000, 50
+        rs = np.random.RandomState(123)
+        x = rs.normal(size=(n, d)).astype('float32')
+
+        def quantization_error(centroids):
+            D, _ = faiss.knn(x, centroids, 1)
+            return D.sum()
+
+        km = faiss.Kmeans(d, k, niter=20)
+        km.train(x)
+        err_ref = quantization_error(km.centroids)
+
+        if fvecs_format:
+            xdata = np.hstack((np.full((n, 1), d, dtype='int32'),
+                               x.view('int32'))).view('uint8')
+        else:
+            xdata = x.view('uint8')
+        reader = faiss.VectorIOReader()
+        faiss.copy_array_to_vector(xdata.ravel(), reader.data)
+        source = faiss.IOReaderBatchSource(reader, d, fvecs_format)
+
+        clus = faiss.Clustering(d, k)
+        clus.minibatch_size = 2000
+        clus.minibatch_npass = 3
+        index = faiss.IndexFlatL2(d)
+        clus.train_minibatch(source, index)
+
+        # one stats entry per batch
+        self.assertEqual(clus.iteration_stats.size(), 3 * n // 2000)
+        self.assertEqual(index.ntotal, k)
+        centroids = faiss.vector_to_array(clus.centroids).reshape(k, d)
+        self.assertLess(quantization_error(centroids), err_ref * 1.05)
+
+    def test_raw(self):
+        self.do_test(False)
+
+    def test_fvecs(self):
+        self.do_test(True)
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <faiss/IndexDiskGraph.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/index_io.h>
+#include <faiss/utils/random.h>
+
+namespace {
+
+struct Tempfilename {
+    std::string filename = "/tmp/faiss_tmp_XXXXXX";
+
+    Tempfilename() {
+        int fd = mkstemp(&filename[0]);
+        close(fd);
+    }
+
+    ~Tempfilename() {
+        unlink(filename.c_str());
+    }
+
+    const char* c_str() {
+        return filename.c_str();
+    }
+};
+
+// data with a low intrinsic dimension, so that the graph is navigable
+std::vector<float> make_data(size_t n, size_t d, int64_t seed) {
+    size_t d_in = 8;
+    std::vector<float> x_in(n * d_in), proj(d_in * d), x(n * d);
+    faiss::float_randn(x_in.data(), x_in.size(), seed);
+    faiss::float_randn(proj.data(), proj.size(), 1234);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < d; j++) {
+            float v = 0;
+            for (size_t l = 0; l < d_in; l++) {
+                v += x_in[i * d_in + l] * proj[l * d + j];
+            }
+            x[i * d + j] = v;
+        }
+    }
+    return x;
+}
+
+double recall_at_1(
+        const std::vector<faiss::idx_t>& Iref,
+        const std::vector<faiss::idx_t>& I,
+        size_t nq,
+        size_t k) {
+    size_t n_ok = 0;
+    for (size_t q = 0; q < nq; q++) {
+        for (size_t j = 0; j < k; j++) {
+            if (I[q * k + j] == Iref[q * k]) {
+                n_ok++;
+            }
+        }
+    }
+    return n_ok / double(nq);
+}
+
+} // namespace
+
+TEST(DiskGraph, search) {
+    size_t d = 32, nb = 5000, nq = 100, k = 10;
+    std::vector<float> xb = make_data(nb, d, 123);
+    std::vector<float> xq = make_data(nq, d, 456);
+
+    for (faiss::MetricType metric :
+         {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::IndexFlat ref(d, metric);
+        ref.add(nb, xb.data());
+        std::vector<float> Dref(nq * k);
+        std::vector<faiss::idx_t> Iref(nq * k);
+        ref.search(nq, xq.data(), k, Dref.data(), Iref.data());
+
+        Tempfilename filename;
+        faiss::IndexDiskGraph index(d, 8, filename.c_str(), 32, metric);
+        index.train(nb, xb.data());
+        index.add(nb, xb.data());
+
+        std::vector<float> D(nq * k);
+        std::vector<faiss::idx_t> I(nq * k);
+        faiss::indexDiskGraph_stats.reset();
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        EXPECT_GT(recall_at_1(Iref, I, nq, k), 0.95);
+
+        // the results are ranked by exact distances
+        for (size_t q = 0; q < nq; q++) {
+            if (I[q * k] == Iref[q * k]) {
+                EXPECT_NEAR(
+                        D[q * k], Dref[q * k], 1e-3 * fabs(Dref[q * k]));
+            }
+        }
+
+        // about search_L reads per query
+        const faiss::IndexDiskGraphStats& stats =
+                faiss::indexDiskGraph_stats;
+        EXPECT_EQ(stats.nq, nq);
+        EXPECT_LE(stats.nreads, nq * 2 * index.search_L);
+        EXPECT_EQ(stats.nbytes, stats.nreads * 4096);
+    }
+}
+
+TEST(DiskGraph, multi_sector_and_io) {
+    // records of 2 sectors
+    size_t d = 1500, nb = 500, nq = 20, k = 5;
+    std::vector<float> xb = make_data(nb, d, 123);
+    std::vector<float> xq = make_data(nq, d, 456);
+
+    Tempfilename filename, index_filename;
+    faiss::IndexDiskGraph index(d, 10, filename.c_str(), 16);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    EXPECT_EQ(index.nodes_per_sector, 0);
+    EXPECT_EQ(index.sectors_per_node, 2);
+
+    std::vector<float> recons(d);
+    for (faiss::idx_t i : {0, 1, 250, 499}) {
+        index.reconstruct(i, recons.data());
+        std::vector<float> ref(xb.begin() + i * d, xb.begin() + (i + 1) * d);
+        EXPECT_EQ(ref, recons);
+    }
+
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data());
+
+    // the index refers to the graph file, which is not copied
+    faiss::write_index(&index, index_filename.c_str());
+    std::unique_ptr<faiss::Index> index2(
+            faiss::read_index(index_filename.c_str()));
+    ASSERT_TRUE(dynamic_cast<faiss::IndexDiskGraph*>(index2.get()));
+
+    std::vector<float> D2(nq * k);
+    std::vector<faiss::idx_t> I2(nq * k);
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I, I2);
+    EXPECT_EQ(D, D2);
+}
+
+TEST(DiskGraph, search_parameters) {
+    size_t d = 16, nb = 2000, nq = 50, k = 10;
+    std::vector<float> xb = make_data(nb, d, 123);
+    std::vector<float> xq = make_data(nq, d, 456);
+
+    Tempfilename filename;
+    faiss::IndexDiskGraph index(d, 4, filename.c_str(), 24);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+
+    faiss::IDSelectorRange sel(0, nb / 2);
+    faiss::SearchParametersDiskGraph params;
+    params.sel = &sel;
+    params.search_L = 128;
+    params.beam_width = 8;
+
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data(), &params);
+    for (size_t i = 0; i < nq * k; i++) {
+        EXPECT_LT(I[i], nb / 2);
+    }
+
+    faiss::SearchParameters wrong_params;
+    EXPECT_THROW(
+            index.search(nq, xq.data(), k, D.data(), I.data(), &wrong_params),
+            faiss::FaissException);
+}
+
+TEST(DiskGraph, read_error) {
+    size_t d = 16, nb = 1000, nq = 20, k = 5;
+    std::vector<float> xb = make_data(nb, d, 123);
+    std::vector<float> xq = make_data(nq, d, 456);
+
+    Tempfilename filename;
+    faiss::IndexDiskGraph index(d, 4, filename.c_str(), 16);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+
+    // the reads hit the end of the file, the error is reported to the
+    // caller instead of leaving the parallel section
+    ASSERT_EQ(truncate(filename.c_str(), 0), 0);
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+    EXPECT_THROW(
+            index.search(nq, xq.data(), k, D.data(), I.data()),
+            faiss::FaissException);
+}
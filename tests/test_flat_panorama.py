@@ -715,3 +715,35 @@ class TestIndexFlatPanorama(unittest.TestCase):
                 np.testing.assert_allclose(ratios, expected_ratios, atol=1e-3)
 
                 faiss.omp_set_num_threads(nt)
+
+    def test_auto_tune(self):
+        """Test that the calibrated levels and batch size give exact results
+        and survive serialization"""
+        d, nb, nt, nq, k = 64, 20000, 5000, 50, 10
+        xt, xb, xq = self.generate_data(d, nt, nb, nq)
+        # decaying energy, as after a PCA
+        scale = np.exp(-0.1 * np.arange(d)).astype("float32")
+        xt, xb, xq = xt * scale, xb * scale, xq * scale
+
+        for metric in self.METRICS:
+            with self.subTest(metric=metric):
+                index_regular = self.create_flat(d, xb, metric=metric)
+                D_regular, I_regular = index_regular.search(xq, k)
+
+                index = faiss.IndexFlatPanorama(d, metric, 8, 512)
+                index.auto_tune = True
+                index.train(xt)
+                index.add(xb)
+                self.assertGreaterEqual(index.batch_size, k)
+                D, I = index.search(xq, k)
+                self.assert_search_results_equal(D_regular, I_regular, D, I)
+
+                data = faiss.serialize_index(index)
+                index_after = faiss.deserialize_index(data)
+                self.assertEqual(index_after.n_levels, index.n_levels)
+                self.assertEqual(index_after.batch_size, index.batch_size)
+                D_after, I_after = index_after.search(xq, k)
+                np.testing.assert_array_equal(I, I_after)
+                np.testing.assert_array_equal(D, D_after)
+                np.testing.assert_array_equal(
+                    data, faiss.serialize_index(index_after))
@@ -379,6 +379,25 @@ class TestNSG(unittest.TestCase):
         knn_graph[:100, 5] = -111
         self.subtest_build(knn_graph, 480, faiss.METRIC_INNER_PRODUCT)
 
+    def test_build_disconnected_knng(self):
+        """The knn graph links only the vectors of a same block of 10, so
+        tree_grow has to attach many components."""
+        n, d = self.xb.shape
+        knn_graph = np.zeros((n, 8), dtype=np.int64)
+        for i in range(n):
+            i0 = i // 10 * 10
+            knn_graph[i] = i0 + (i - i0 + 1 + np.arange(8)) % 10
+
+        index = faiss.IndexNSGFlat(d, 16)
+        index.verbose = True
+        index.build(self.xb, knn_graph)
+        self.subtest_connectivity(index, n)
+
+        # the vectors can be found
+        index.nsg.search_L = 64
+        _, I = index.search(self.xb[::50], 1)
+        self.assertGreaterEqual((I.ravel() == np.arange(0, n, 50)).sum(), 24)
+
     def test_reset(self):
         """test IndexNSG.reset()"""
         d = self.xq.shape[1]
@@ -431,25 +450,38 @@ class TestNSG(unittest.TestCase):
         index.search(self.xq, k=1)
         self.assertTrue(index.is_built)
 
-    def test_nsg_with_pre_built_knn_graph_throws_when_rebuilding_via_add(self):
-        """Test IndexNSGBuild"""
+    def test_nsg_add_after_pre_built_knn_graph(self):
+        """add() on a built index inserts in the existing graph"""
         knn_graph = self.make_knn_graph(faiss.METRIC_L2)
 
         d = self.xq.shape[1]
+        n0 = 1000
         index = faiss.IndexNSGFlat(d, 16)
-        index.build(self.xb, knn_graph)
-        index.search(self.xq, k=1)
+        # approximate knn graph of the first n0 vectors
+        index.build(self.xb[:n0], knn_graph[:n0].clip(max=n0 - 1))
         self.assertTrue(index.is_built)
 
-        index.GK = 32
-        index.train(self.xb)
-        with self.assertRaises(RuntimeError) as context:
-            index.add(self.xb)
+        index.add(self.xb[n0:])
+        self.assertEqual(index.ntotal, self.xb.shape[0])
+        self.subtest_connectivity(index, self.xb.shape[0])
 
-        self.assertIn(
-            "NSG does not support incremental addition",
-            str(context.exception)
-        )
+    def test_nsg_incremental_add(self):
+        d = self.xq.shape[1]
+        flat_index = faiss.IndexFlat(d)
+        flat_index.add(self.xb)
+        Dref, Iref = flat_index.search(self.xq, 1)
+
+        index = faiss.IndexNSGFlat(d, 16)
+        index.GK = self.GK
+        index.add(self.xb[:1000])
+        index.add(self.xb[1000:1250])
+        index.add(self.xb[1250:])
+        self.subtest_connectivity(index, self.xb.shape[0])
+
+        Dnsg, Insg = index.search(self.xq, 1)
+        recalls = (Iref == Insg).sum()
+        self.assertGreaterEqual(recalls, 450)
+        self.subtest_io_and_clone(index, Dnsg, Insg)
 
     def test_nsg_rebuild_throws_with_pre_built_knn_graph(self):
         """Test IndexNSGBuild"""
@@ -618,6 +650,37 @@ class TestNNDescentKNNG(unittest.TestCase):
         recall = 1.0 * recalls / (nb * K)
         assert recall > 0.99
 
+    def test_convergence_monitor(self):
+        d, K, nb = 32, 10, 1000
+        _, xb, _ = get_dataset_2(d, 0, nb, 0)
+        _, knn = faiss.knn(xb, xb, K + 1)
+        knn = knn[:, 1:]
+
+        def build_recall(**kwargs):
+            index = faiss.IndexNNDescentFlat(d, K)
+            index.nndescent.S = 10
+            index.nndescent.R = 32
+            index.nndescent.L = K + 20
+            index.nndescent.iter = 10
+            for name, val in kwargs.items():
+                setattr(index.nndescent, name, val)
+            index.add(xb)
+            graph = faiss.vector_to_array(index.nndescent.final_graph)
+            graph = graph.reshape(nb, K)
+            return np.mean([
+                len(np.intersect1d(graph[i], knn[i])) for i in range(nb)
+            ]) / K
+
+        # all iterations
+        recall_ref = build_recall(delta=0, target_recall=2)
+        self.assertGreater(recall_ref, 0.99)
+        # stop when the sampled recall is 1 or the graph stops changing
+        recall = build_recall()
+        self.assertGreater(recall, 0.99)
+        # stop after the first iteration
+        recall_1 = build_recall(target_recall=0)
+        self.assertLess(recall_1, 0.9)
+
     def test_small_nndescent(self):
         """ building a too small graph used to crash, make sure it raises
         an exception instead.
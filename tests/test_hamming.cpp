@@ -8,7 +8,9 @@
 #include <gtest/gtest.h>
 
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/utils/hamming.h>
+#include <cstring>
 #include <random>
 
 using namespace ::testing;
@@ -333,3 +335,74 @@ TEST(TestHamming, test_hamming_knn) {
         EXPECT_EQ(dist_gen, *true_bit_distances) << assert_str.str();
     }
 }
+
+TEST(TestHamming, test_hamming_knn_tiled) {
+    std::default_random_engine rng(123);
+    std::uniform_int_distribution<int> uniform(0, 255);
+
+    // sizes that are not multiples of the tile sizes
+    const size_t na = 23;
+    const size_t nb = 1037;
+    const size_t k = 10;
+
+    faiss::IDSelectorRange sel(100, 900);
+
+    for (size_t code_size : {8, 16, 24, 32, 64, 72}) {
+        std::vector<uint8_t> a(na * code_size), b(nb * code_size);
+        for (auto& x : a) {
+            x = uniform(rng);
+        }
+        for (auto& x : b) {
+            x = uniform(rng);
+        }
+        // make some ties
+        memcpy(b.data() + 10 * code_size, b.data(), code_size);
+
+        for (const faiss::IDSelector* s :
+             {(const faiss::IDSelector*)nullptr,
+              (const faiss::IDSelector*)&sel}) {
+            std::vector<faiss::idx_t> I_ref(na * k), I_new(na * k);
+            std::vector<int> D_ref(na * k), D_new(na * k);
+
+            faiss::int_maxheap_array_t res = {
+                    na, k, I_ref.data(), D_ref.data()};
+            faiss::hammings_knn_hc(
+                    &res,
+                    a.data(),
+                    b.data(),
+                    nb,
+                    code_size,
+                    true,
+                    ApproxTopK_mode_t::EXACT_TOPK,
+                    s);
+            res = {na, k, I_new.data(), D_new.data()};
+            faiss::hammings_knn_hc_tiled(
+                    &res, a.data(), b.data(), nb, code_size, true, s);
+            EXPECT_EQ(I_ref, I_new) << "code_size=" << code_size;
+            EXPECT_EQ(D_ref, D_new) << "code_size=" << code_size;
+
+            faiss::hammings_knn_mc(
+                    a.data(),
+                    b.data(),
+                    na,
+                    nb,
+                    k,
+                    code_size,
+                    D_ref.data(),
+                    I_ref.data(),
+                    s);
+            faiss::hammings_knn_mc_tiled(
+                    a.data(),
+                    b.data(),
+                    na,
+                    nb,
+                    k,
+                    code_size,
+                    D_new.data(),
+                    I_new.data(),
+                    s);
+            EXPECT_EQ(I_ref, I_new) << "code_size=" << code_size;
+            EXPECT_EQ(D_ref, D_new) << "code_size=" << code_size;
+        }
+    }
+}
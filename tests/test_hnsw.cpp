@@ -13,7 +13,10 @@
 #include <unordered_set>
 #include <vector>
 
+#include <faiss/IndexBinaryHNSW.h>
 #include <faiss/IndexHNSW.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/impl/HNSW.h>
 #include <faiss/impl/ResultHandler.h>
 #include <faiss/impl/VisitedTable.h>
@@ -661,3 +664,54 @@ TEST_F(HNSWTest, TEST_search_level_0) {
     EXPECT_GT(stats1.n1, stats2.n1);
     EXPECT_GT(stats1.n2, stats2.n2);
 }
+
+TEST(HNSW, Test_IndexBinaryHNSW_integer_search) {
+    // the integer search must give the same results as HNSW::search with
+    // the float distance computer
+    int d = 128;
+    size_t nb = 3000, nq = 100;
+    int k = 10;
+    std::vector<uint8_t> xb(nb * d / 8), xq(nq * d / 8);
+    faiss::byte_rand(xb.data(), xb.size(), 123);
+    faiss::byte_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexBinaryHNSW index(d, 16);
+    index.add(nb, xb.data());
+
+    faiss::IDSelectorRange sel(500, 2500);
+
+    for (int variant = 0; variant < 3; variant++) {
+        faiss::SearchParametersHNSW params;
+        params.efSearch = 32;
+        if (variant == 1) {
+            params.check_relative_distance = false;
+        } else if (variant == 2) {
+            params.sel = &sel;
+        }
+
+        std::vector<int32_t> D(nq * k);
+        std::vector<faiss::idx_t> I(nq * k);
+        index.search(nq, xq.data(), k, D.data(), I.data(), &params);
+
+        std::vector<float> Dref(nq * k);
+        std::vector<faiss::idx_t> Iref(nq * k);
+        faiss::HeapBlockResultHandler<faiss::HNSW::C> bres(
+                nq, Dref.data(), Iref.data(), k);
+        faiss::HeapBlockResultHandler<faiss::HNSW::C>::SingleResultHandler res(
+                bres);
+        faiss::VisitedTable vt(nb);
+        std::unique_ptr<faiss::DistanceComputer> dis(
+                index.get_distance_computer());
+        for (size_t i = 0; i < nq; i++) {
+            res.begin(i);
+            dis->set_query((const float*)(xq.data() + i * d / 8));
+            index.hnsw.search(*dis, nullptr, res, vt, &params);
+            res.end();
+        }
+
+        EXPECT_EQ(I, Iref) << "variant=" << variant;
+        for (size_t i = 0; i < nq * k; i++) {
+            EXPECT_EQ(D[i], Dref[i]) << "variant=" << variant;
+        }
+    }
+}
@@ -313,6 +313,111 @@ class TestBinaryIVF(unittest.TestCase):
         compare_binary_result_lists(Dref, Iref, D2, I2)
 
 
+class TestBinaryIVFFastScan(unittest.TestCase):
+
+    def do_test(self, d, bbs):
+        (xt, xb, xq) = make_binary_dataset(d, 2000, 3000, 200)
+        quantizer = faiss.IndexBinaryFlat(d)
+        index_ref = faiss.IndexBinaryIVF(quantizer, d, 16)
+        index_ref.train(xt)
+        index_ref.add(xb)
+        index_ref.nprobe = 4
+
+        index = faiss.IndexBinaryIVFFastScan(quantizer, d, 16, bbs)
+        index.add(xb[:1000])
+        index.add(xb[1000:])
+        index.nprobe = 4
+
+        Dref, Iref = index_ref.search(xq, 10)
+        Dnew, Inew = index.search(xq, 10)
+        compare_binary_result_lists(Dref, Iref, Dnew, Inew)
+
+        radius = int(np.median(Dref[:, 4]))
+        Lref, Dr_ref, Ir_ref = index_ref.range_search(xq, radius)
+        Lnew, Dr_new, Ir_new = index.range_search(xq, radius)
+        np.testing.assert_array_equal(Lref, Lnew)
+        for i in range(len(xq)):
+            self.assertEqual(
+                set(zip(Ir_ref[Lref[i]:Lref[i + 1]],
+                        Dr_ref[Lref[i]:Lref[i + 1]])),
+                set(zip(Ir_new[Lnew[i]:Lnew[i + 1]],
+                        Dr_new[Lnew[i]:Lnew[i + 1]]))
+            )
+
+        index.make_direct_map()
+        for i in range(0, len(xb), 37):
+            np.testing.assert_array_equal(index.reconstruct(i), xb[i])
+
+        index2 = faiss.deserialize_index_binary(
+            faiss.serialize_index_binary(index))
+        D2, I2 = index2.search(xq, 10)
+        np.testing.assert_array_equal(Dnew, D2)
+        np.testing.assert_array_equal(Inew, I2)
+
+    def test_32(self):
+        self.do_test(32, 32)
+
+    def test_256(self):
+        self.do_test(256, 32)
+
+    def test_256_bbs64(self):
+        self.do_test(256, 64)
+
+    def do_test_merge(self, nlist, n1):
+        d = 64
+        (xt, xb, xq) = make_binary_dataset(d, 2000, 3000, 200)
+        quantizer = faiss.IndexBinaryFlat(d)
+        index_ref = faiss.IndexBinaryIVF(quantizer, d, nlist)
+        index_ref.train(xt)
+        index_ref.add(xb)
+        index_ref.nprobe = 4
+
+        index = faiss.IndexBinaryIVFFastScan(quantizer, d, nlist)
+        index.add(xb[:n1])
+        index2 = faiss.IndexBinaryIVFFastScan(quantizer, d, nlist)
+        index2.add(xb[n1:])
+        index.merge_from(index2, n1)
+        self.assertEqual(index.ntotal, len(xb))
+        self.assertEqual(index2.ntotal, 0)
+        index.nprobe = 4
+
+        Dref, Iref = index_ref.search(xq, 10)
+        Dnew, Inew = index.search(xq, 10)
+        compare_binary_result_lists(Dref, Iref, Dnew, Inew)
+
+    def test_merge(self):
+        self.do_test_merge(16, 1000)
+
+    def test_merge_block_boundary(self):
+        # the first list ends on a block boundary, so the codes of the
+        # second index are appended as whole blocks
+        self.do_test_merge(1, 256)
+        self.do_test_merge(1, 64)
+
+    def test_remove_ids(self):
+        d = 64
+        (xt, xb, xq) = make_binary_dataset(d, 2000, 3000, 200)
+        quantizer = faiss.IndexBinaryFlat(d)
+        index_ref = faiss.IndexBinaryIVF(quantizer, d, 16)
+        index_ref.train(xt)
+        index_ref.add(xb)
+        index_ref.nprobe = 4
+
+        index = faiss.IndexBinaryIVFFastScan(quantizer, d, 16)
+        index.add(xb)
+        index.nprobe = 4
+
+        sel = faiss.IDSelectorRange(500, 1500)
+        self.assertEqual(index_ref.remove_ids(sel), 1000)
+        self.assertEqual(index.remove_ids(sel), 1000)
+        self.assertEqual(index.ntotal, 2000)
+
+        Dref, Iref = index_ref.search(xq, 10)
+        Dnew, Inew = index.search(xq, 10)
+        self.assertFalse(np.any((Inew >= 500) & (Inew < 1500)))
+        compare_binary_result_lists(Dref, Iref, Dnew, Inew)
+
+
 class TestHNSW(unittest.TestCase):
 
     def __init__(self, *args, **kwargs):
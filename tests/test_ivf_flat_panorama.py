@@ -750,3 +750,40 @@ class TestIndexIVFFlatPanorama(unittest.TestCase):
                 np.testing.assert_allclose(ratios, expected_ratios, atol=1e-3)
 
                 faiss.omp_set_num_threads(nt)
+
+    def test_auto_tune(self):
+        """Test that the calibrated levels and batch size give exact results
+        and survive serialization"""
+        d, nb, nt, nq, nlist, k = 64, 20000, 10000, 50, 32, 10
+        xt, xb, xq = self.generate_data(d, nt, nb, nq)
+        # decaying energy, as after a PCA
+        scale = np.exp(-0.1 * np.arange(d)).astype("float32")
+        xt, xb, xq = xt * scale, xb * scale, xq * scale
+
+        for metric in self.METRICS:
+            with self.subTest(metric=metric):
+                index_regular = self.create_ivf_flat(
+                    d, nlist, xt, xb, nprobe=8, metric=metric
+                )
+                D_regular, I_regular = index_regular.search(xq, k)
+
+                quantizer = faiss.IndexFlat(d, metric)
+                index = faiss.IndexIVFFlatPanorama(
+                    quantizer, d, nlist, 8, metric
+                )
+                index.auto_tune = True
+                index.train(xt)
+                index.add(xb)
+                index.nprobe = 8
+                D, I = index.search(xq, k)
+                self.assert_search_results_equal(D_regular, I_regular, D, I)
+
+                data = faiss.serialize_index(index)
+                index_after = faiss.deserialize_index(data)
+                self.assertEqual(index_after.n_levels, index.n_levels)
+                D_after, I_after = index_after.search(xq, k)
+                np.testing.assert_array_equal(I, I_after)
+                np.testing.assert_array_equal(D, D_after)
+                np.testing.assert_array_equal(
+                    data, faiss.serialize_index(index_after)
+                )
@@ -14,9 +14,12 @@
 
 #include <gtest/gtest.h>
 
+#include <faiss/IVFlib.h>
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexIVFFlat.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/invlists/InvertedLists.h>
 
 namespace {
 
@@ -252,3 +255,160 @@ TEST(IVF, list_context) {
                 << "should return the query vector";
     }
 }
+
+TEST(IVF, id_summaries) {
+    // ids are clustered by inverted list, so that the summaries of the lists
+    // are informative
+    int d = 16, nb = 5000, nq = 20, k = 10, nlist = 50;
+    std::mt19937 rng(123);
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& x : xb) {
+        x = distrib(rng);
+    }
+    for (auto& x : xq) {
+        x = distrib(rng);
+    }
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, nlist);
+    index.train(nb, xb.data());
+    std::vector<faiss::idx_t> assign(nb), ids(nb);
+    quantizer.assign(nb, xb.data(), assign.data());
+    std::vector<int> list_sizes(nlist);
+    for (int i = 0; i < nb; i++) {
+        ids[i] = assign[i] * 1000 + list_sizes[assign[i]]++;
+    }
+    index.add_with_ids(nb, xb.data(), ids.data());
+    index.nprobe = 10;
+
+    auto invlists = dynamic_cast<faiss::ArrayInvertedLists*>(index.invlists);
+    ASSERT_TRUE(invlists);
+    invlists->set_id_summaries(true);
+
+    // lists 10 to 19, plus part of list 20
+    faiss::IDSelectorRange sel_range(10000, 20010);
+    std::vector<faiss::idx_t> batch;
+    for (int i = 0; i < 30; i++) {
+        batch.push_back(5000 + i);
+    }
+    faiss::IDSelectorBatch sel_batch(batch.size(), batch.data());
+    faiss::IDSelectorNot sel_not(&sel_range);
+
+    std::vector<faiss::IDSelector*> sels = {&sel_range, &sel_batch, &sel_not};
+    for (faiss::IDSelector* sel : sels) {
+        faiss::SearchParametersIVF params;
+        params.sel = sel;
+        params.nprobe = index.nprobe;
+
+        std::vector<float> D(nq * k), Dref(nq * k);
+        std::vector<faiss::idx_t> I(nq * k), Iref(nq * k);
+        faiss::indexIVF_stats.reset();
+        index.search(nq, xq.data(), k, D.data(), I.data(), &params);
+        size_t nlist_scanned = faiss::indexIVF_stats.nlist;
+
+        invlists->set_id_summaries(false);
+        faiss::indexIVF_stats.reset();
+        index.search(nq, xq.data(), k, Dref.data(), Iref.data(), &params);
+        invlists->set_id_summaries(true);
+
+        EXPECT_EQ(I, Iref);
+        EXPECT_EQ(D, Dref);
+        // some lists were skipped
+        EXPECT_LT(nlist_scanned, faiss::indexIVF_stats.nlist);
+    }
+
+    // the summaries are updated when removing and adding ids
+    faiss::IDSelectorRange sel_remove(0, 40000);
+    index.remove_ids(sel_remove);
+    EXPECT_EQ(invlists->get_id_summary(0)->empty(), true);
+    index.add_with_ids(1, xb.data(), ids.data());
+    const faiss::IDSummary* s = invlists->get_id_summary(assign[0]);
+    EXPECT_TRUE(s->may_contain(ids[0]));
+    bool in_range = ids[0] >= 10000 && ids[0] < 20010;
+    EXPECT_EQ(
+            sel_range.check_summary(*s),
+            in_range ? faiss::IDSC_all : faiss::IDSC_none);
+}
+
+TEST(IVF, id_summaries_set_invlist_range) {
+    int d = 8, nb = 1000, nlist = 10;
+    std::vector<float> xb(nb * d);
+    std::mt19937 rng(123);
+    std::uniform_real_distribution<float> distrib;
+    for (auto& x : xb) {
+        x = distrib(rng);
+    }
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, nlist);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    auto invlists = dynamic_cast<faiss::ArrayInvertedLists*>(index.invlists);
+    invlists->set_id_summaries(true);
+
+    // same vectors with shifted ids
+    faiss::IndexIVFFlat index2(&quantizer, d, nlist);
+    std::vector<faiss::idx_t> ids2(nb);
+    for (int i = 0; i < nb; i++) {
+        ids2[i] = i + 10000;
+    }
+    index2.add_with_ids(nb, xb.data(), ids2.data());
+
+    faiss::ArrayInvertedLists* il =
+            faiss::ivflib::get_invlist_range(&index2, 0, nlist);
+    faiss::ivflib::set_invlist_range(&index, 0, nlist, il);
+    delete il;
+
+    // the summaries must not rule out the new ids
+    faiss::IDSelectorRange sel(10000, 10000 + nb);
+    faiss::SearchParametersIVF params;
+    params.sel = &sel;
+    params.nprobe = nlist;
+    std::vector<float> D(5);
+    std::vector<faiss::idx_t> I(5);
+    index.search(1, xb.data(), 5, D.data(), I.data(), &params);
+    EXPECT_EQ(I[0], 10000);
+}
+
+TEST(IVF, is_member_batch) {
+    std::vector<faiss::idx_t> ids = {-1, 0, 3, 7, 8, 12, 100, 1000};
+    std::vector<faiss::idx_t> subset = {3, 8, 100};
+    uint8_t bitmap[2] = {1 << 3, 1 << 0}; // ids 3 and 8
+    faiss::IDSelectorRange sel_range(3, 12);
+    faiss::IDSelectorBatch sel_batch(subset.size(), subset.data());
+    faiss::IDSelectorBitmap sel_bitmap(2, bitmap);
+    faiss::IDSelectorArray sel_array(subset.size(), subset.data());
+    std::vector<const faiss::IDSelector*> sels = {
+            &sel_range, &sel_batch, &sel_bitmap, &sel_array};
+    for (const faiss::IDSelector* sel : sels) {
+        std::vector<uint8_t> out(ids.size());
+        sel->is_member_batch(ids.size(), ids.data(), out.data());
+        for (size_t i = 0; i < ids.size(); i++) {
+            EXPECT_EQ(out[i], sel->is_member(ids[i]));
+        }
+    }
+
+    faiss::IDSummary s;
+    s.add(4);
+    s.add(6);
+    EXPECT_EQ(sel_range.check_summary(s), faiss::IDSC_all);
+    EXPECT_EQ(sel_batch.check_summary(s), faiss::IDSC_none);
+    EXPECT_EQ(sel_bitmap.check_summary(s), faiss::IDSC_none);
+    s.add(8);
+    EXPECT_EQ(sel_bitmap.check_summary(s), faiss::IDSC_some);
+    faiss::IDSelectorNot sel_not(&sel_range);
+    EXPECT_EQ(sel_not.check_summary(s), faiss::IDSC_none);
+
+    // negative ids are never selected by a bitmap
+    uint8_t full_bitmap[2] = {0xff, 0xff};
+    faiss::IDSelectorBitmap sel_full(2, full_bitmap);
+    faiss::IDSummary sneg;
+    sneg.add(-5);
+    EXPECT_EQ(sel_full.check_summary(sneg), faiss::IDSC_none);
+    sneg.add(3);
+    EXPECT_EQ(sel_bitmap.check_summary(sneg), faiss::IDSC_some);
+    EXPECT_EQ(sel_full.check_summary(sneg), faiss::IDSC_some);
+    sneg.add(-1000);
+    EXPECT_EQ(sel_full.check_summary(sneg), faiss::IDSC_some);
+}
@@ -0,0 +1,123 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Tests for IndexIVFScalarQuantizerPanorama and IndexIVFPQPanorama.
+
+The Panorama variants prune candidates with Cauchy-Schwarz bounds on the
+remaining levels, so they must return the same results as the plain
+IndexIVFScalarQuantizer / IndexIVFPQ.
+"""
+
+import unittest
+
+import faiss
+import numpy as np
+from faiss.contrib.datasets import SyntheticDataset
+
+
+class TestIVFPanoramaCodes(unittest.TestCase):
+
+    METRICS = [faiss.METRIC_L2, faiss.METRIC_INNER_PRODUCT]
+
+    # (baseline, Panorama) factory strings
+    CODECS = [
+        ("SQ8", "SQ8Panorama4"),
+        ("SQ4", "SQ4Panorama8"),
+        ("SQ6", "SQ6Panorama3"),
+        ("SQfp16", "SQfp16Panorama8"),
+        ("PQ16np", "PQ16Panorama8"),
+        ("PQ8np", "PQ8Panorama3"),
+    ]
+
+    def generate_data(self, d=64, nt=5000, nb=10000, nq=100, seed=1234):
+        ds = SyntheticDataset(d, nt, nb, nq, seed=seed)
+        # concentrate the energy in the first dimensions, as a PCA would,
+        # which is what Panorama relies on for pruning
+        scale = np.exp(-0.05 * np.arange(d)).astype("float32")
+        return (
+            ds.get_train() * scale,
+            ds.get_database() * scale,
+            ds.get_queries() * scale,
+        )
+
+    def build(self, key, xt, xb, metric, nlist=32, nprobe=8):
+        d = xt.shape[1]
+        index = faiss.index_factory(d, f"IVF{nlist},{key}", metric)
+        index.train(xt)
+        index.add(xb)
+        index.nprobe = nprobe
+        return index
+
+    def assert_same_results(self, Dref, Iref, Dnew, Inew):
+        self.assertGreater(np.mean(Iref == Inew), 0.999)
+        np.testing.assert_allclose(Dref, Dnew, rtol=1e-5, atol=1e-5)
+
+    def test_exact_match(self):
+        xt, xb, xq = self.generate_data()
+        for metric in self.METRICS:
+            for ref_key, pano_key in self.CODECS:
+                with self.subTest(metric=metric, codec=pano_key):
+                    index_ref = self.build(ref_key, xt, xb, metric)
+                    index = self.build(pano_key, xt, xb, metric)
+                    Dref, Iref = index_ref.search(xq, 10)
+                    faiss.cvar.indexPanorama_stats.reset()
+                    D, I = index.search(xq, 10)
+                    self.assert_same_results(Dref, Iref, D, I)
+                    ratio = faiss.cvar.indexPanorama_stats.ratio_dims_scanned
+                    self.assertLess(ratio, 0.9)
+
+    def test_range_search(self):
+        xt, xb, xq = self.generate_data(nq=20)
+        for metric in self.METRICS:
+            for ref_key, pano_key in [self.CODECS[0], self.CODECS[4]]:
+                with self.subTest(metric=metric, codec=pano_key):
+                    index_ref = self.build(ref_key, xt, xb, metric)
+                    index = self.build(pano_key, xt, xb, metric)
+                    Dref, _ = index_ref.search(xq, 20)
+                    radius = float(np.median(Dref[:, -1]))
+                    _, _, Iref = index_ref.range_search(xq, radius)
+                    _, _, I = index.range_search(xq, radius)
+                    # ignore ties at the radius boundary
+                    self.assertLessEqual(abs(len(Iref) - len(I)), len(xq))
+                    common = np.intersect1d(Iref, I)
+                    self.assertGreater(len(common), 0.99 * len(Iref))
+
+    def test_id_selector(self):
+        xt, xb, xq = self.generate_data()
+        sel = faiss.IDSelectorRange(0, len(xb) // 2)
+        params = faiss.SearchParametersIVF(sel=sel, nprobe=8)
+        for ref_key, pano_key in [self.CODECS[0], self.CODECS[4]]:
+            with self.subTest(codec=pano_key):
+                index_ref = self.build(ref_key, xt, xb, faiss.METRIC_L2)
+                index = self.build(pano_key, xt, xb, faiss.METRIC_L2)
+                Dref, Iref = index_ref.search(xq, 10, params=params)
+                D, I = index.search(xq, 10, params=params)
+                self.assert_same_results(Dref, Iref, D, I)
+                self.assertTrue(np.all(I < len(xb) // 2))
+
+    def test_serialization_and_clone(self):
+        xt, xb, xq = self.generate_data()
+        for _, pano_key in [self.CODECS[0], self.CODECS[4]]:
+            with self.subTest(codec=pano_key):
+                index = self.build(pano_key, xt, xb, faiss.METRIC_L2)
+                D, I = index.search(xq, 10)
+                index2 = faiss.deserialize_index(faiss.serialize_index(index))
+                D2, I2 = index2.search(xq, 10)
+                np.testing.assert_array_equal(I, I2)
+                np.testing.assert_array_equal(D, D2)
+                index3 = faiss.clone_index(index)
+                D3, I3 = index3.search(xq, 10)
+                np.testing.assert_array_equal(I, I3)
+
+    def test_standalone_codec(self):
+        xt, xb, _ = self.generate_data()
+        for ref_key, pano_key in [self.CODECS[0], self.CODECS[4]]:
+            with self.subTest(codec=pano_key):
+                index_ref = self.build(ref_key, xt, xb[:0], faiss.METRIC_L2)
+                index = self.build(pano_key, xt, xb[:0], faiss.METRIC_L2)
+                ref = index_ref.sa_decode(index_ref.sa_encode(xb[:100]))
+                new = index.sa_decode(index.sa_encode(xb[:100]))
+                np.testing.assert_allclose(ref, new, rtol=1e-5, atol=1e-5)
@@ -354,6 +354,28 @@ class TestLocalSearchQuantizer(unittest.TestCase):
 
         self.assertLess(err_lsq, err_pq)
 
+    def test_encode_nstarts(self):
+        """the first start is the same as without restarts, so the error
+        of each vector can only decrease"""
+        ds = datasets.SyntheticDataset(32, 3000, 1000, 0)
+
+        lsq = faiss.LocalSearchQuantizer(ds.d, 4, 4)
+        lsq.train_iters = 4
+        lsq.train(ds.get_train())
+
+        xb = ds.get_database()
+        codes1 = lsq.compute_codes(xb)
+        err1 = ((xb - lsq.decode(codes1)) ** 2).sum(1)
+
+        lsq.encode_nstarts = 3
+        codes3 = lsq.compute_codes(xb)
+        err3 = ((xb - lsq.decode(codes3)) ** 2).sum(1)
+        self.assertTrue(np.all(err3 <= err1 + 1e-5))
+        self.assertLess(err3.sum(), err1.sum())
+
+        # the timings of the stages are exported
+        self.assertGreater(faiss.cvar.lsq_timer.get("icm_encode_step"), 0)
+
 
 class TestIndexLocalSearchQuantizer(unittest.TestCase):
 
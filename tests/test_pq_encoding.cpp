@@ -14,6 +14,8 @@
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/impl/ProductQuantizer.h>
 #include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/simd_result_handlers.h>
+#include <faiss/utils/AlignedTable.h>
 
 namespace {
 
@@ -143,3 +145,62 @@ TEST(PQFastScan, set_packed_element) {
         }
     }
 }
+
+TEST(PQFastScan, accumulate_loop_qbs) {
+    // nsq = 6 exercises the leftover chunk of 2 sub-quantizers, nb = 5 blocks
+    // of 32 exercises the single-block tail after the 2-block steps
+    int M = 6, nsq = 6;
+    size_t ntotal = 150, nb = 160;
+    size_t block_stride = 32 * nsq / 2;
+
+    std::vector<uint8_t> codes(ntotal * (M + 1) / 2);
+    for (auto& c : codes) {
+        c = rand();
+    }
+    faiss::AlignedTable<uint8_t> blocks(nb * nsq / 2);
+    blocks.clear();
+    faiss::pq4_pack_codes(
+            codes.data(), ntotal, M, nb, 32, nsq, blocks.get());
+
+    bool saved_flag = faiss::pq4_qbs_accumulate_2_blocks;
+    for (int qbs : {0x1, 0x2, 0x3, 0x33, 0x123}) {
+        int nq = faiss::pq4_qbs_to_nq(qbs);
+        std::vector<uint8_t> LUT(nq * nsq * 16);
+        for (auto& l : LUT) {
+            l = rand();
+        }
+        faiss::AlignedTable<uint8_t> packed_LUT(nq * nsq * 16);
+        faiss::pq4_pack_LUT_qbs(qbs, nsq, LUT.data(), packed_LUT.get());
+
+        for (bool two_blocks : {false, true}) {
+            faiss::pq4_qbs_accumulate_2_blocks = two_blocks;
+            std::vector<uint16_t> accu(nq * nb);
+            faiss::simd_result_handlers::StoreResultHandler handler(
+                    accu.data(), nb);
+            faiss::pq4_accumulate_loop_qbs(
+                    qbs,
+                    nb,
+                    nsq,
+                    blocks.get(),
+                    packed_LUT.get(),
+                    handler,
+                    nullptr,
+                    block_stride);
+
+            for (int q = 0; q < nq; q++) {
+                for (size_t i = 0; i < ntotal; i++) {
+                    uint16_t ref = 0;
+                    for (int sq = 0; sq < M; sq++) {
+                        uint8_t c = faiss::pq4_get_packed_element(
+                                blocks.get(), 32, nsq, i, sq);
+                        ref += LUT[(q * nsq + sq) * 16 + c];
+                    }
+                    EXPECT_EQ(accu[q * nb + i], ref)
+                            << "qbs=" << qbs << " two_blocks=" << two_blocks
+                            << " q=" << q << " i=" << i;
+                }
+            }
+        }
+    }
+    faiss::pq4_qbs_accumulate_2_blocks = saved_flag;
+}
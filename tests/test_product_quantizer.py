@@ -40,6 +40,36 @@ class TestProductQuantizer(unittest.TestCase):
         diff10 = ((x - x10)**2).sum()
         self.assertGreater(diff, diff10)
 
+    def test_parallel_train(self):
+        d = 64
+        n = 5000
+        rs = np.random.RandomState(123)
+        x = rs.random(size=(n, d)).astype('float32')
+
+        def train_err(**kwargs):
+            pq = faiss.ProductQuantizer(d, 16, 4)
+            for name, val in kwargs.items():
+                setattr(pq, name, val)
+            pq.train(x)
+            x2 = pq.decode(pq.compute_codes(x))
+            return pq, ((x - x2) ** 2).sum()
+
+        _, err_ref = train_err()
+        pq, err_par = train_err(parallel_train=True)
+        self.assertLess(err_par, err_ref * 1.02)
+        _, err_mb = train_err(parallel_train=True, train_batch_size=1024)
+        self.assertLess(err_mb, err_ref * 1.1)
+        _, err_stop = train_err(
+            parallel_train=True, train_early_stop_tol=0.01)
+        self.assertLess(err_stop, err_ref * 1.1)
+
+        # warm start from the trained codebooks
+        pq.train_type = faiss.ProductQuantizer.Train_hot_start
+        pq.cp.niter = 2
+        pq.train(x)
+        x2 = pq.decode(pq.compute_codes(x))
+        self.assertLessEqual(((x - x2) ** 2).sum(), err_par * 1.001)
+
     def do_test_codec(self, nbit):
         pq = faiss.ProductQuantizer(16, 2, nbit)
 
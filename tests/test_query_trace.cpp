@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/impl/QueryTrace.h>
+#include <faiss/utils/random.h>
+
+namespace {
+
+struct EnableTrace {
+    EnableTrace() {
+        faiss::query_trace_reset();
+        faiss::query_trace_set_enabled(true);
+    }
+    ~EnableTrace() {
+        faiss::query_trace_set_enabled(false);
+        faiss::query_trace_reset();
+    }
+};
+
+} // namespace
+
+TEST(QueryTrace, ivf) {
+    int d = 16, nb = 2000, nq = 50, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, 20);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    index.nprobe = 4;
+
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+
+    // nothing recorded when disabled
+    faiss::query_trace_reset();
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    faiss::QueryTrace trace = faiss::query_trace_collect();
+    EXPECT_EQ(trace.counters[faiss::QTC_nq], 0);
+    EXPECT_EQ(trace.stages[faiss::QT_list_scan].count, 0);
+
+    EnableTrace enable;
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    trace = faiss::query_trace_collect();
+    EXPECT_EQ(trace.counters[faiss::QTC_nq], nq);
+    EXPECT_EQ(trace.counters[faiss::QTC_nlist], nq * index.nprobe);
+    EXPECT_GT(trace.counters[faiss::QTC_ndis], 0);
+
+    const faiss::QueryTraceStageStats& cq =
+            trace.stages[faiss::QT_coarse_quantization];
+    EXPECT_GE(cq.count, 1);
+    EXPECT_GT(cq.total_ns, 0);
+
+    const faiss::QueryTraceStageStats& scan =
+            trace.stages[faiss::QT_list_scan];
+    EXPECT_EQ(scan.count, nq * index.nprobe);
+    EXPECT_EQ(trace.stages[faiss::QT_lut_build].count, scan.count);
+    uint64_t nhist = 0;
+    for (int i = 0; i < faiss::QueryTraceStageStats::nbucket; i++) {
+        nhist += scan.histogram[i];
+    }
+    EXPECT_EQ(nhist, scan.count);
+    EXPECT_LE(scan.quantile_ns(0.5), scan.quantile_ns(0.99));
+    EXPECT_LE(scan.quantile_ns(0.99), scan.max_ns);
+
+    std::string json = faiss::query_trace_to_json();
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_NE(json.find("\"list_scan\": {\"count\": "), std::string::npos);
+    EXPECT_NE(json.find("\"indexIVF_stats\""), std::string::npos);
+    EXPECT_NE(json.find("\"rabitq_stats\""), std::string::npos);
+
+    faiss::query_trace_reset();
+    trace = faiss::query_trace_collect();
+    EXPECT_EQ(trace.counters[faiss::QTC_nq], 0);
+    EXPECT_EQ(trace.stages[faiss::QT_list_scan].count, 0);
+}
+
+TEST(QueryTrace, hnsw) {
+    int d = 16, nb = 1000, nq = 20, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexHNSWFlat index(d, 16);
+    index.add(nb, xb.data());
+
+    EnableTrace enable;
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    faiss::QueryTrace trace = faiss::query_trace_collect();
+    EXPECT_EQ(trace.counters[faiss::QTC_nq], nq);
+    EXPECT_EQ(trace.stages[faiss::QT_graph_search].count, nq);
+    EXPECT_GT(trace.counters[faiss::QTC_nhops], 0);
+}
+
+TEST(QueryTrace, exited_threads) {
+    EnableTrace enable;
+    std::thread t([] {
+        faiss::query_trace_add_time(faiss::QT_io_wait, 1000);
+        faiss::query_trace_add_count(faiss::QTC_nbytes_read, 4096);
+    });
+    t.join();
+    faiss::QueryTrace trace = faiss::query_trace_collect();
+    const faiss::QueryTraceStageStats& io = trace.stages[faiss::QT_io_wait];
+    EXPECT_EQ(io.count, 1);
+    EXPECT_EQ(io.total_ns, 1000);
+    EXPECT_EQ(io.histogram[9], 1); // 512 <= 1000 < 1024
+    EXPECT_EQ(trace.counters[faiss::QTC_nbytes_read], 4096);
+}
@@ -505,6 +505,44 @@ class TestIVFRaBitQ(unittest.TestCase):
     def test_serde_ivfrabitq(self):
         do_test_serde("IVF16,RaBitQ")
 
+    def do_test_query_batching(self, metric, nb_bits):
+        ds = datasets.SyntheticDataset(64, 1000, 2000, 50, metric=metric)
+        mt = faiss.METRIC_L2 if metric == "L2" else faiss.METRIC_INNER_PRODUCT
+        index = faiss.index_factory(
+            ds.d, f"IVF16,RaBitQ{nb_bits if nb_bits > 1 else ''}", mt)
+        index.train(ds.get_train())
+        index.add(ds.get_database())
+        index.nprobe = 4
+
+        for qb, centered in [(4, False), (8, False), (4, True)]:
+            params = faiss.IVFRaBitQSearchParameters()
+            params.nprobe = 4
+            params.qb = qb
+            params.centered = centered
+            index.query_batch_size = 0
+            Dref, Iref = index.search(ds.get_queries(), 10, params=params)
+            for bs in [3, 20, 256]:
+                index.query_batch_size = bs
+                D, I = index.search(ds.get_queries(), 10, params=params)
+                if nb_bits == 1:
+                    # the same distances are computed, only the order in
+                    # which the lists are visited changes
+                    np.testing.assert_array_equal(D, Dref)
+                    self.assertLess((I != Iref).sum(), 5)
+                else:
+                    # the multi-bit refinement depends on the heap state
+                    ninter = faiss.eval_intersection(I, Iref)
+                    self.assertGreater(ninter, ds.nq * 10 * 0.95)
+
+    def test_query_batching_L2(self):
+        self.do_test_query_batching("L2", 1)
+
+    def test_query_batching_IP(self):
+        self.do_test_query_batching("IP", 1)
+
+    def test_query_batching_multibit(self):
+        self.do_test_query_batching("L2", 4)
+
 
 class TestRaBitQuantizerEncodeDecode(unittest.TestCase):
     def do_test_encode_decode(self, d, metric):
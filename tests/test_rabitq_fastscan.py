@@ -736,6 +736,48 @@ class TestMultiBitRaBitQFastScan(unittest.TestCase):
 
                     self.assertLess(abs(recall_ref - recall_test), 0.05)
 
+    def test_ivf_refine_vs_scalar_distances(self):
+        """The batched multi-bit refinement of IndexIVFRaBitQFastScan
+        computes the same distances as the scalar path of IndexIVFRaBitQ
+        with unquantized queries."""
+        d, nlist, k = 64, 8, 10
+        ds = datasets.SyntheticDataset(d, 2000, 2000, 20)
+
+        for metric in [faiss.METRIC_L2, faiss.METRIC_INNER_PRODUCT]:
+            for nb_bits in [2, 4, 8]:
+                with self.subTest(metric=metric, nb_bits=nb_bits):
+                    quantizer = faiss.IndexFlat(d, metric)
+                    index_ref = faiss.IndexIVFRaBitQ(
+                        quantizer, d, nlist, metric, True, nb_bits
+                    )
+                    index_ref.qb = 0
+                    index_ref.nprobe = nlist
+                    index_ref.train(ds.get_train())
+                    index_ref.add(ds.get_database())
+                    Dref, Iref = index_ref.search(ds.get_queries(), k)
+
+                    # the quantizer is already trained, so the codes are
+                    # the same
+                    index_fs = faiss.IndexIVFRaBitQFastScan(
+                        quantizer, d, nlist, metric, 32, True, nb_bits
+                    )
+                    index_fs.nprobe = nlist
+                    index_fs.train(ds.get_train())
+                    index_fs.add(ds.get_database())
+                    D, I = index_fs.search(ds.get_queries(), k)
+
+                    ncommon = 0
+                    for i in range(ds.nq):
+                        ref = dict(zip(Iref[i], Dref[i]))
+                        for j in range(k):
+                            if I[i, j] in ref:
+                                ncommon += 1
+                                np.testing.assert_allclose(
+                                    D[i, j], ref[I[i, j]],
+                                    rtol=1e-5, atol=1e-5
+                                )
+                    self.assertGreater(ncommon, ds.nq * k * 0.9)
+
     # ==================== Serialization Tests ====================
 
     def test_serialization(self):
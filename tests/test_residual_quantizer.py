@@ -9,6 +9,7 @@ import faiss
 import unittest
 
 from faiss.contrib import datasets
+from faiss.contrib import inspect_tools
 from faiss.contrib.inspect_tools import get_additive_quantizer_codebooks
 
 ###########################################################
@@ -895,6 +896,67 @@ class TestIVFResidualQuantizer(unittest.TestCase):
     def test_norm_from_LUT(self):
         self.do_test_accuracy(True, faiss.AdditiveQuantizer.ST_norm_from_LUT)
 
+    def test_8bit_codes(self):
+        """ with 8-bit codebooks, the lists are scanned 4 codes at a time,
+        check that the results are the same as with distance_to_code """
+        ds = datasets.SyntheticDataset(32, 3000, 1000, 10)
+        xq = ds.get_queries()
+        AQ = faiss.AdditiveQuantizer
+        for st in (AQ.ST_LUT_nonorm, AQ.ST_norm_float, AQ.ST_norm_qint8,
+                   AQ.ST_norm_qint4, AQ.ST_norm_cqint8, AQ.ST_norm_cqint4):
+            with self.subTest(st=st):
+                quantizer = faiss.IndexFlatL2(ds.d)
+                index = faiss.IndexIVFResidualQuantizer(
+                    quantizer, ds.d, 10, 2, 8, faiss.METRIC_L2, st)
+                index.train(ds.get_train())
+                index.add(ds.get_database())
+                index.nprobe = index.nlist
+                D, I = index.search(xq, 10)
+
+                Dq, Iq = index.quantizer.search(xq, index.nlist)
+                scanner = index.get_InvertedListScanner()
+                for i in range(len(xq)):
+                    scanner.set_query(faiss.swig_ptr(xq[i]))
+                    dis = []
+                    ids = []
+                    for l, coarse_dis in zip(Iq[i], Dq[i]):
+                        scanner.set_list(int(l), float(coarse_dis))
+                        list_ids, codes = inspect_tools.get_invlist(
+                            index.invlists, int(l))
+                        for code in codes:
+                            dis.append(scanner.distance_to_code(
+                                faiss.swig_ptr(code)))
+                        ids.append(list_ids)
+                    dis = np.array(dis)
+                    ids = np.hstack(ids)
+                    o = np.argsort(dis, kind="stable")[:10]
+                    np.testing.assert_allclose(D[i], dis[o], rtol=1e-5)
+                    self.assertLess((I[i] != ids[o]).sum(), 2)
+
+    def test_precomputed_table(self):
+        ds = datasets.SyntheticDataset(32, 3000, 1000, 10)
+        xq = ds.get_queries()
+        index = faiss.index_factory(ds.d, "IVF20,RQ4x6_Nfloat")
+        index.train(ds.get_train())
+        index.add(ds.get_database())
+        index.nprobe = 4
+        self.assertEqual(index.use_precomputed_table, 1)
+        D, I = index.search(xq, 10)
+
+        # the table is recomputed at load time
+        index2 = faiss.deserialize_index(faiss.serialize_index(index))
+        self.assertEqual(index2.use_precomputed_table, 1)
+        D2, I2 = index2.search(xq, 10)
+        np.testing.assert_array_equal(I, I2)
+        np.testing.assert_array_equal(D, D2)
+
+        index.use_precomputed_table = -1
+        index.precompute_table()
+        self.assertEqual(index.precomputed_table.size(), 0)
+        D3, I3 = index.search(xq, 10)
+        np.testing.assert_allclose(D, D3, rtol=1e-5)
+        self.assertLess((I != I3).sum(), 10)
+
     def test_factory(self):
         index = faiss.index_factory(12, "IVF1024,RQ8x8_Nfloat")
         self.assertEqual(index.nlist, 1024)
@@ -1167,6 +1229,24 @@ class TestCrossCodebookComputations(unittest.TestCase):
         codes_new = rq.compute_codes(xb)
         np.testing.assert_array_equal(codes_ref_residuals, codes_new)
 
+    def test_small_batches(self):
+        """ small batches are encoded in parallel over their vectors when
+        n * beam_size * K > 65536, check that they give the same codes as
+        a large batch """
+        ds = datasets.SyntheticDataset(32, 3000, 200, 0)
+        rq = faiss.ResidualQuantizer(ds.d, 3, 8)
+        rq.train(ds.get_train())
+        # 8 * 64 * 256 = 131072 from the second step on
+        rq.max_beam_size = 64
+        xb = ds.get_database()
+        for use_beam_LUT in 0, 1:
+            rq.use_beam_LUT = use_beam_LUT
+            codes_ref = rq.compute_codes(xb)
+            codes = np.vstack([
+                rq.compute_codes(xb[i:i + 8]) for i in range(0, len(xb), 8)
+            ])
+            np.testing.assert_array_equal(codes_ref, codes)
+
 
 class TestProductResidualQuantizer(unittest.TestCase):
 
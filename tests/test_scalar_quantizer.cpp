@@ -7,9 +7,23 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <memory>
+#include <random>
 #include <vector>
 
 #include <faiss/impl/ScalarQuantizer.h>
+#include <faiss/utils/bf16.h>
+#include <faiss/utils/fp16.h>
+
+// same include order as ScalarQuantizer.cpp, that distance_computers.h
+// relies on
+#include <faiss/impl/scalar_quantizer/codecs.h>
+#include <faiss/impl/scalar_quantizer/quantizers.h>
+#include <faiss/impl/scalar_quantizer/similarities.h>
+#include <faiss/impl/scalar_quantizer/distance_computers.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/random.h>
 
 TEST(ScalarQuantizer, RSQuantilesClamping) {
     int d = 8;
@@ -95,3 +109,191 @@ TEST(ScalarQuantizer, RSQuantilesSmallDataset) {
 
     ASSERT_NO_THROW(sq.train(n, x.data()));
 }
+
+TEST(ScalarQuantizer, Int8QueryDistances) {
+    int n = 200;
+    for (auto qtype :
+         {faiss::ScalarQuantizer::QT_8bit, faiss::ScalarQuantizer::QT_4bit}) {
+        for (int d : {16, 37, 128}) {
+            for (auto metric :
+                 {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+                std::vector<float> x(d * n);
+                faiss::float_randn(x.data(), x.size(), 1234 + d);
+
+                faiss::ScalarQuantizer sq(d, qtype);
+                sq.train(n, x.data());
+                std::vector<uint8_t> codes(sq.code_size * n);
+                sq.compute_codes(x.data(), codes.data(), n);
+
+                std::unique_ptr<faiss::ScalarQuantizer::SQDistanceComputer>
+                        dc_ref(sq.get_distance_computer(metric));
+                sq.int8_query = true;
+                std::unique_ptr<faiss::ScalarQuantizer::SQDistanceComputer>
+                        dc(sq.get_distance_computer(metric));
+                sq.int8_query = false;
+                for (auto* c : {dc_ref.get(), dc.get()}) {
+                    c->codes = codes.data();
+                    c->code_size = sq.code_size;
+                }
+
+                for (int q = 0; q < 10; q++) {
+                    dc_ref->set_query(x.data() + q * d);
+                    dc->set_query(x.data() + q * d);
+                    double err = 0, norm = 0;
+                    for (int i = 0; i < n; i++) {
+                        float ref = (*dc_ref)(i);
+                        float dis = (*dc)(i);
+                        err += (dis - ref) * (dis - ref);
+                        norm += ref * ref;
+                    }
+                    EXPECT_LT(err, 1e-3 * norm)
+                            << "qtype=" << qtype << " d=" << d
+                            << " metric=" << metric;
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+// data with a variance that decreases along the dimensions, like after a PCA
+std::vector<float> make_decaying_data(int n, int d, int seed) {
+    std::vector<float> x(size_t(n) * d);
+    faiss::float_randn(x.data(), x.size(), seed);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < d; j++) {
+            x[size_t(i) * d + j] *= std::exp(-j / 10.0);
+        }
+    }
+    return x;
+}
+
+double reconstruction_mse(
+        const faiss::ScalarQuantizer& sq,
+        int n,
+        const float* x) {
+    std::vector<uint8_t> codes(sq.code_size * n);
+    sq.compute_codes(x, codes.data(), n);
+    std::vector<float> x2(sq.d * n);
+    sq.decode(codes.data(), x2.data(), n);
+    double err = 0;
+    for (size_t i = 0; i < x2.size(); i++) {
+        err += (x[i] - x2[i]) * (x[i] - x2[i]);
+    }
+    return err / n;
+}
+
+} // namespace
+
+TEST(ScalarQuantizer, MixedBitAllocation) {
+    int d = 64, n = 2000;
+    std::vector<float> x = make_decaying_data(n, d, 123);
+
+    faiss::ScalarQuantizer sq4(d, faiss::ScalarQuantizer::QT_4bit);
+    sq4.train(n, x.data());
+
+    faiss::ScalarQuantizer sqm(d, faiss::ScalarQuantizer::QT_mixed);
+    EXPECT_EQ(sqm.code_size, sq4.code_size);
+    sqm.train(n, x.data());
+    EXPECT_LE(sqm.code_size, sq4.code_size);
+
+    // the high-variance components get more bits
+    const float* nbits = sqm.trained.data() + 2 * d;
+    EXPECT_EQ(nbits[0], 8);
+    EXPECT_EQ(nbits[d - 1], 0);
+    for (int j = 1; j < d; j++) {
+        EXPECT_LE(nbits[j], nbits[j - 1]);
+    }
+
+    EXPECT_LT(
+            reconstruction_mse(sqm, n, x.data()),
+            0.5 * reconstruction_mse(sq4, n, x.data()));
+
+    // smaller budget
+    faiss::ScalarQuantizer sqm2(d, faiss::ScalarQuantizer::QT_mixed);
+    sqm2.bits = 2;
+    sqm2.train(n, x.data());
+    EXPECT_LE(sqm2.code_size, d / 4);
+}
+
+TEST(ScalarQuantizer, MixedDistances) {
+    int n = 200;
+    for (int d : {16, 37, 100}) {
+        std::vector<float> x = make_decaying_data(n, d, 1234 + d);
+        faiss::ScalarQuantizer sq(d, faiss::ScalarQuantizer::QT_mixed);
+        sq.bits = 3;
+        sq.train(n, x.data());
+        std::vector<uint8_t> codes(sq.code_size * n);
+        sq.compute_codes(x.data(), codes.data(), n);
+        std::vector<float> xd(d * n);
+        sq.decode(codes.data(), xd.data(), n);
+
+        for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+            std::unique_ptr<faiss::ScalarQuantizer::SQDistanceComputer> dc(
+                    sq.get_distance_computer(metric));
+            dc->codes = codes.data();
+            dc->code_size = sq.code_size;
+            for (int q = 0; q < 5; q++) {
+                const float* xq = x.data() + (n - 1 - q) * d;
+                dc->set_query(xq);
+                for (int i = 0; i < n; i++) {
+                    const float* y = xd.data() + i * d;
+                    float ref = metric == faiss::METRIC_L2
+                            ? faiss::fvec_L2sqr(xq, y, d)
+                            : faiss::fvec_inner_product(xq, y, d);
+                    EXPECT_NEAR((*dc)(i), ref, 1e-4 * (1 + std::abs(ref)));
+                }
+            }
+            EXPECT_NEAR(
+                    dc->symmetric_dis(0, 1),
+                    metric == faiss::METRIC_L2
+                            ? faiss::fvec_L2sqr(xd.data(), xd.data() + d, d)
+                            : faiss::fvec_inner_product(
+                                      xd.data(), xd.data() + d, d),
+                    1e-4);
+        }
+    }
+}
+
+// compares the SIMD integer dot products of the int8_query distances with
+// a scalar computation. The SIMD path depends on the compile flags of the
+// tests (eg. AVX512-VNNI with FAISS_OPT_LEVEL=avx512_spr).
+TEST(ScalarQuantizer, Int8QueryDots) {
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int> ucode(0, 255), uweight(-127, 127);
+    for (size_t n : {1, 15, 16, 31, 32, 33, 64, 100, 257}) {
+        std::vector<uint8_t> c(n);
+        std::vector<int8_t> w(2 * n), v(2 * n);
+        for (auto& x : c) {
+            x = ucode(rng);
+        }
+        for (size_t j = 0; j < 2 * n; j++) {
+            w[j] = uweight(rng);
+            // the weights of the squares are non-negative
+            v[j] = std::abs(uweight(rng));
+        }
+
+        int32_t dw8 = 0, dv8 = 0, dw4 = 0, dv4 = 0;
+        for (size_t j = 0; j < n; j++) {
+            int32_t cj = c[j], lo = c[j] & 15, hi = c[j] >> 4;
+            dw8 += cj * w[j];
+            dv8 += cj * cj * v[j];
+            dw4 += lo * w[j] + hi * w[n + j];
+            dv4 += lo * lo * v[j] + hi * hi * v[n + j];
+        }
+
+        namespace iq = faiss::scalar_quantizer::int8_query;
+        int32_t dw, dv;
+        iq::dots_8bit<true>(c.data(), w.data(), v.data(), n, dw, dv);
+        EXPECT_EQ(dw, dw8) << "n=" << n;
+        EXPECT_EQ(dv, dv8) << "n=" << n;
+        iq::dots_8bit<false>(c.data(), w.data(), v.data(), n, dw, dv);
+        EXPECT_EQ(dw, dw8) << "n=" << n;
+        iq::dots_4bit<true>(c.data(), w.data(), v.data(), n, dw, dv);
+        EXPECT_EQ(dw, dw4) << "n=" << n;
+        EXPECT_EQ(dv, dv4) << "n=" << n;
+        iq::dots_4bit<false>(c.data(), w.data(), v.data(), n, dw, dv);
+        EXPECT_EQ(dw, dw4) << "n=" << n;
+    }
+}
@@ -27,7 +27,8 @@ class TestSelector(unittest.TestCase):
         id_selector_type="batch",
         mt=faiss.METRIC_L2,
         k=10,
-        use_heap=True
+        use_heap=True,
+        id_summaries=False
     ):
         """ Verify that the id selector returns the subset of results that are
         members according to the IDSelector.
@@ -107,6 +108,10 @@ class TestSelector(unittest.TestCase):
         # result with selector: fill full database and search with selector
         index.reset()
         index.add(xb)
+        if id_summaries:
+            invlists = faiss.downcast_InvertedLists(
+                faiss.extract_index_ivf(index).invlists)
+            invlists.set_id_summaries(True)
         if id_selector_type == "range":
             sel = faiss.IDSelectorRange(30, 80)
         elif id_selector_type == "range_sorted":
@@ -199,6 +204,14 @@ class TestSelector(unittest.TestCase):
     def test_IVFFlat(self):
         self.do_test_id_selector("IVF32,Flat")
 
+    def test_IVF_id_summaries(self):
+        for index_key in "IVF32,Flat", "IVF32,PQ4":
+            for sel_type in ("batch", "range", "array", "bitmap",
+                             "not", "or", "and"):
+                with self.subTest(index_key=index_key, sel_type=sel_type):
+                    self.do_test_id_selector(
+                        index_key, sel_type, id_summaries=True)
+
     def test_IVFFlat_range_sorted(self):
         self.do_test_id_selector("IVF32,Flat", id_selector_type="range_sorted")
 
@@ -5,11 +5,17 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexReplicas.h>
 #include <faiss/IndexShards.h>
 #include <faiss/impl/ThreadedIndex.h>
+#include <faiss/utils/WorkerThread.h>
+#include <faiss/utils/random.h>
 
 #include <gtest/gtest.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <thread>
@@ -66,6 +72,22 @@ struct MockIndex : public faiss::Index {
     mutable idx_t* labelsCalled;
 };
 
+/// flat index with a slow search
+struct SlowIndex : public faiss::IndexFlatL2 {
+    explicit SlowIndex(idx_t d) : faiss::IndexFlatL2(d) {}
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const faiss::SearchParameters* params) const override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        faiss::IndexFlatL2::search(n, x, k, distances, labels, params);
+    }
+};
+
 template <typename IndexT>
 struct MockThreadedIndex : public faiss::ThreadedIndex<IndexT> {
     using idx_t = faiss::idx_t;
@@ -258,3 +280,162 @@ TEST(ThreadedIndex, TestShards) {
         }
     }
 }
+
+TEST(ThreadedIndex, TestShardsSearchParameters) {
+    int d = 32, nb = 4000, nq = 200, k = 10, nlist = 16, numShards = 4;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    for (faiss::MetricType metric :
+         {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::IndexFlat ref(d, metric);
+        ref.add(nb, xb.data());
+        std::vector<float> refD(nq * k);
+        std::vector<idx_t> refI(nq * k);
+        ref.search(nq, xq.data(), k, refD.data(), refI.data());
+
+        for (bool threaded : {true, false}) {
+            faiss::IndexShards shards(d, threaded);
+            shards.own_indices = true;
+            for (int i = 0; i < numShards; i++) {
+                auto* index = new faiss::IndexIVFFlat(
+                        new faiss::IndexFlat(d, metric), d, nlist, metric);
+                index->own_fields = true;
+                // exhaustive search, so that the results are exact
+                index->nprobe = nlist;
+                shards.addIndex(index);
+            }
+            shards.train(nb, xb.data());
+            shards.add(nb, xb.data());
+
+            faiss::SearchParametersShards params;
+            params.query_block_size = 32;
+            std::vector<uint8_t> partial(nq, 2);
+            params.partial = partial.data();
+
+            for (bool share_threshold : {false, true}) {
+                params.share_threshold = share_threshold;
+                std::vector<float> D(nq * k);
+                std::vector<idx_t> I(nq * k);
+                shards.search(nq, xq.data(), k, D.data(), I.data(), &params);
+                for (int i = 0; i < nq * k; i++) {
+                    EXPECT_EQ(I[i], refI[i]);
+                    EXPECT_NEAR(D[i], refD[i], 1e-4);
+                }
+                for (int i = 0; i < nq; i++) {
+                    EXPECT_EQ(partial[i], 0);
+                }
+            }
+        }
+    }
+}
+
+TEST(ThreadedIndex, TestShardsTimeout) {
+    int d = 8, nb = 100, nq = 100, k = 5, numShards = 2;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexShards shards(d, true);
+    shards.own_indices = true;
+    for (int i = 0; i < numShards; i++) {
+        shards.addIndex(new SlowIndex(d));
+    }
+    shards.add(nb, xb.data());
+
+    // each block takes 20 ms, so the deadline falls after a few blocks
+    faiss::SearchParametersShards params;
+    params.query_block_size = 10;
+    params.timeout_ms = 50;
+    std::vector<uint8_t> partial(nq);
+    params.partial = partial.data();
+
+    std::vector<float> D(nq * k);
+    std::vector<idx_t> I(nq * k);
+    shards.search(nq, xq.data(), k, D.data(), I.data(), &params);
+
+    // the first block is complete
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(partial[i], 0);
+        EXPECT_GE(I[i * k], 0);
+    }
+    // the last one was not searched
+    for (int i = 90; i < nq; i++) {
+        EXPECT_EQ(partial[i], 1);
+        EXPECT_EQ(I[i * k], -1);
+    }
+}
+
+TEST(ThreadedIndex, TestShardsShareThresholdTies) {
+    int d = 8, nb = 100, nq = 20, k = 1;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    // both shards contain the same vectors, the first one with the larger
+    // ids, so that its results tie with the better ones of the second
+    faiss::IndexShards shards(d, false, false);
+    shards.own_indices = true;
+    for (int shard = 0; shard < 2; shard++) {
+        auto* index =
+                new faiss::IndexIVFFlat(new faiss::IndexFlatL2(d), d, 1);
+        index->own_fields = true;
+        index->train(nb, xb.data());
+        std::vector<idx_t> ids(nb);
+        for (int i = 0; i < nb; i++) {
+            ids[i] = shard == 0 ? nb + i : i;
+        }
+        index->add_with_ids(nb, xb.data(), ids.data());
+        shards.addIndex(index);
+    }
+
+    faiss::SearchParametersShards params;
+    params.share_threshold = true;
+    std::vector<float> D(nq * k);
+    std::vector<idx_t> I(nq * k);
+    shards.search(nq, xq.data(), k, D.data(), I.data(), &params);
+    for (int i = 0; i < nq; i++) {
+        EXPECT_LT(I[i], nb);
+    }
+
+    // not supported for the fast-scan shards
+    faiss::IndexShards fs_shards(d, false, false);
+    fs_shards.own_indices = true;
+    auto* fs_index = new faiss::IndexIVFPQFastScan(
+            new faiss::IndexFlatL2(d), d, 1, 4, 4);
+    fs_index->own_fields = true;
+    fs_index->train(nb, xb.data());
+    fs_shards.addIndex(fs_index);
+    EXPECT_THROW(
+            fs_shards.search(nq, xq.data(), k, D.data(), I.data(), &params),
+            faiss::FaissException);
+}
+
+TEST(ThreadedIndex, WorkerThreadPool) {
+    faiss::WorkerThreadPool pool(3);
+
+    // more tasks than threads, several batches on the same threads
+    for (int ntask : {1, 4, 10, 2}) {
+        std::vector<std::atomic<int>> counts(ntask);
+        for (auto& c : counts) {
+            c = 0;
+        }
+        std::vector<std::pair<int, std::exception_ptr>> exceptions;
+        pool.run(
+                ntask,
+                [&](int i) {
+                    counts[i]++;
+                    if (i % 3 == 1) {
+                        throw TestException();
+                    }
+                },
+                1,
+                exceptions);
+
+        for (int i = 0; i < ntask; i++) {
+            EXPECT_EQ(counts[i], 1);
+        }
+        EXPECT_EQ(exceptions.size(), (ntask + 1) / 3);
+    }
+}